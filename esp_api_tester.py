@@ -98,6 +98,7 @@ def run_smoke_tests(api: EspApi,
     try:
         r = api.get_read()
         print(f"HTTP {r.status_code}")
+        print(f"Age: {r.headers.get('Age')}, Cache-Control: {r.headers.get('Cache-Control')}")
         print(pretty(r.json() if r.headers.get("Content-Type",
               "").startswith("application/json") else r.text))
         r.raise_for_status()
@@ -0,0 +1,500 @@
+#!/usr/bin/env python3
+"""
+Mock ingest server — a stand-in upstream for the ESP32 Temperature & Humidity Poster
+
+Speaks just enough HTTP/1.1 for the firmware's upload path (keep-alive,
+Content-Length and chunked bodies, Content-Encoding: gzip) and can misbehave
+on purpose so retries, the circuit breaker and the offline queue can be
+exercised on a desk:
+
+  --latency-ms / --jitter-ms   delay every response
+  --error-rate / --error-status / --retry-after
+                               answer a share of posts with an error status
+  --reset-rate                 drop a share of connections with a TCP RST
+                               after reading the request headers
+  --close-rate                 answer with "Connection: close" now and then
+  --slow-read-bps              read request bodies at this many bytes/s
+  --max-body                   answer 413 above this many body bytes
+
+Every reading post is decoded (JSON and line protocol; CBOR/MessagePack are
+counted, not parsed) and checked for duplicates by (location, boot_id, seq)
+and by Idempotency-Key. Admin endpoints (no auth):
+
+  GET  /__stats    counters, duplicate counts, server-side handling times
+  POST /__faults   JSON patch of the fault settings above (snake_case keys)
+  POST /__reset    clear the counters
+
+With --tls a private CA and a server certificate for --cert-host are created
+in --cert-dir (needs the openssl CLI). Put ca.pem into kHttpsRootCA in
+config.h, or run the device with https_insecure.
+
+Usage examples:
+    python mock_ingest_server.py --port 8080
+    python mock_ingest_server.py --port 8443 --tls --cert-host 192.168.10.20
+    python mock_ingest_server.py --port 8080 --error-rate 0.2 --error-status 503 --retry-after 5
+    curl -s http://localhost:8080/__stats
+
+Requires: Python 3.8+ (standard library only)
+"""
+
+from __future__ import annotations
+import argparse
+import gzip
+import ipaddress
+import json
+import os
+import random
+import re
+import socket
+import socketserver
+import ssl
+import struct
+import subprocess
+import sys
+import threading
+import time
+from dataclasses import asdict, dataclass, fields
+from typing import Any, Dict, List, Optional, Tuple
+
+ADMIN_PREFIX = "/__"
+MAX_HEADER_LINES = 100
+
+
+@dataclass
+class Faults:
+    latency_ms: float = 0.0
+    jitter_ms: float = 0.0
+    error_rate: float = 0.0
+    error_status: int = 503
+    retry_after: Optional[int] = None
+    reset_rate: float = 0.0
+    close_rate: float = 0.0
+    slow_read_bps: int = 0
+    max_body: int = 0
+
+    def update(self, patch: Dict[str, Any]) -> None:
+        known = {f.name: f.type for f in fields(self)}
+        for key, value in patch.items():
+            if key not in known:
+                raise ValueError(f"unknown fault setting: {key}")
+            setattr(self, key, value)
+
+
+class Stats:
+    """Counters shared by all connection threads."""
+
+    def __init__(self) -> None:
+        self.lock = threading.Lock()
+        self.reset()
+
+    def reset(self) -> None:
+        with getattr(self, "lock", threading.Lock()):
+            self.started = time.monotonic()
+            self.connections = 0
+            self.requests = 0
+            self.posts_ok = 0
+            self.statuses: Dict[str, int] = {}
+            self.resets = 0
+            self.readings = 0
+            self.duplicate_readings = 0
+            self.unnumbered_readings = 0
+            self.repeated_keys = 0
+            self.body_bytes = 0
+            self.wire_bytes = 0
+            self.chunked = 0
+            self.gzipped = 0
+            self.handling_ms: List[float] = []
+            self._seen: set = set()
+            self._keys: set = set()
+
+    def record_readings(self, location: str, readings: List[Tuple[Optional[int], Optional[int]]]) -> None:
+        with self.lock:
+            for boot_id, seq in readings:
+                self.readings += 1
+                if not boot_id or not seq:
+                    self.unnumbered_readings += 1
+                    continue
+                ident = (location, boot_id, seq)
+                if ident in self._seen:
+                    self.duplicate_readings += 1
+                else:
+                    self._seen.add(ident)
+
+    def record_key(self, key: Optional[str]) -> None:
+        if not key:
+            return
+        with self.lock:
+            if key in self._keys:
+                self.repeated_keys += 1
+            else:
+                self._keys.add(key)
+
+    def count(self, attr: str, n: int = 1) -> None:
+        with self.lock:
+            setattr(self, attr, getattr(self, attr) + n)
+
+    def record_status(self, status: int, handling_ms: float) -> None:
+        with self.lock:
+            self.statuses[str(status)] = self.statuses.get(str(status), 0) + 1
+            self.handling_ms.append(handling_ms)
+            if 200 <= status < 300:
+                self.posts_ok += 1
+
+    def snapshot(self) -> Dict[str, Any]:
+        with self.lock:
+            elapsed = time.monotonic() - self.started
+            times = sorted(self.handling_ms)
+            return {
+                "elapsed_s": round(elapsed, 3),
+                "connections": self.connections,
+                "requests": self.requests,
+                "posts_ok": self.posts_ok,
+                "posts_per_s": round(self.posts_ok / elapsed, 3) if elapsed > 0 else 0.0,
+                "statuses": dict(self.statuses),
+                "resets": self.resets,
+                "readings": self.readings,
+                "unique_readings": len(self._seen),
+                "duplicate_readings": self.duplicate_readings,
+                "unnumbered_readings": self.unnumbered_readings,
+                "repeated_idempotency_keys": self.repeated_keys,
+                "body_bytes": self.body_bytes,
+                "wire_bytes": self.wire_bytes,
+                "chunked_posts": self.chunked,
+                "gzip_posts": self.gzipped,
+                "handling_ms_p50": percentile(times, 0.50),
+                "handling_ms_p99": percentile(times, 0.99),
+            }
+
+
+def percentile(sorted_values: List[float], q: float) -> Optional[float]:
+    if not sorted_values:
+        return None
+    idx = min(len(sorted_values) - 1, max(0, int(round(q * len(sorted_values) + 0.5)) - 1))
+    return round(sorted_values[idx], 3)
+
+
+# ---- body decoding ----
+
+LINE_SEQ = re.compile(rb"[ ,]boot_id=(\d+)i.*?,seq=(\d+)i")
+LINE_LOCATION = re.compile(rb"^[^ ]*?,location=((?:\\.|[^ ,])*)")
+
+
+def decode_readings(body: bytes, content_type: str) -> Tuple[str, List[Tuple[Optional[int], Optional[int]]]]:
+    """Returns (location, [(boot_id, seq), ...]) for a reading post."""
+    if content_type.startswith("application/json"):
+        doc = json.loads(body)
+        location = str(doc.get("location", ""))
+        if "error" in doc:
+            return location, []
+        items = doc["readings"] if "readings" in doc else [doc]
+        return location, [(r.get("boot_id"), r.get("seq")) for r in items]
+    if content_type.startswith("text/plain"):
+        location = ""
+        out: List[Tuple[Optional[int], Optional[int]]] = []
+        for line in body.splitlines():
+            if not line.strip() or b" error=" in line:
+                continue
+            m = LINE_LOCATION.match(line)
+            if m:
+                location = m.group(1).decode(errors="replace")
+            s = LINE_SEQ.search(line)
+            out.append((int(s.group(1)), int(s.group(2))) if s else (None, None))
+        return location, out
+    # CBOR / MessagePack: counted as one unnumbered post.
+    return "", [(None, None)]
+
+
+# ---- connection handling ----
+
+class ClientGone(Exception):
+    pass
+
+
+class Handler(socketserver.StreamRequestHandler):
+    server: "MockServer"
+
+    def setup(self) -> None:
+        if self.server.tls_context is not None:
+            self.request.settimeout(10)
+            try:
+                self.request = self.server.tls_context.wrap_socket(self.request, server_side=True)
+            except (ssl.SSLError, OSError) as e:
+                self.server.log(f"TLS handshake failed: {e}")
+                raise
+        self.request.settimeout(self.server.idle_timeout)
+        super().setup()
+
+    def handle(self) -> None:
+        stats = self.server.stats
+        stats.count("connections")
+        try:
+            while self.serve_one():
+                pass
+        except (ClientGone, ConnectionError, socket.timeout, ssl.SSLError):
+            pass
+
+    # Returns False when the connection should end.
+    def serve_one(self) -> bool:
+        line = self.rfile.readline(8192)
+        if not line:
+            return False
+        start = time.monotonic()
+        try:
+            method, path, _version = line.decode("latin-1").split()
+        except ValueError:
+            self.respond(400, b"bad request line\n", close=True)
+            return False
+        headers: Dict[str, str] = {}
+        wire = len(line)
+        for _ in range(MAX_HEADER_LINES):
+            h = self.rfile.readline(8192)
+            if not h:
+                raise ClientGone()
+            wire += len(h)
+            h = h.rstrip(b"\r\n")
+            if not h:
+                break
+            name, _, value = h.decode("latin-1").partition(":")
+            headers[name.strip().lower()] = value.strip()
+
+        stats = self.server.stats
+        faults = self.server.faults
+        stats.count("requests")
+
+        if path.startswith(ADMIN_PREFIX):
+            body = self.read_body(headers, throttle=False)
+            return self.admin(method, path, body)
+
+        if random.random() < faults.reset_rate:
+            stats.count("resets")
+            # SO_LINGER 0 turns close() into a RST.
+            self.connection.setsockopt(socket.SOL_SOCKET, socket.SO_LINGER, struct.pack("ii", 1, 0))
+            return False
+
+        body = self.read_body(headers, throttle=True)
+        wire += len(body)
+        stats.count("wire_bytes", wire)
+        if headers.get("transfer-encoding", "").lower() == "chunked":
+            stats.count("chunked")
+        if headers.get("content-encoding", "").lower() == "gzip":
+            stats.count("gzipped")
+            body = gzip.decompress(body)
+        stats.count("body_bytes", len(body))
+
+        delay = faults.latency_ms + (random.uniform(0, faults.jitter_ms) if faults.jitter_ms > 0 else 0.0)
+        if delay > 0:
+            time.sleep(delay / 1000.0)
+
+        close = random.random() < faults.close_rate or headers.get("connection", "").lower() == "close"
+        if faults.max_body and len(body) > faults.max_body:
+            status, extra = 413, {}
+        elif random.random() < faults.error_rate:
+            status = faults.error_status
+            extra = {"Retry-After": str(faults.retry_after)} if faults.retry_after is not None else {}
+        else:
+            status, extra = 204, {}
+            try:
+                location, readings = decode_readings(body, headers.get("content-type", ""))
+                stats.record_readings(location, readings)
+                stats.record_key(headers.get("idempotency-key"))
+            except (ValueError, KeyError, TypeError) as e:
+                self.server.log(f"undecodable body ({e}); answering 400")
+                status = 400
+        self.respond(status, b"", close=close, extra=extra)
+        stats.record_status(status, (time.monotonic() - start) * 1000.0)
+        return not close
+
+    def read_body(self, headers: Dict[str, str], throttle: bool) -> bytes:
+        bps = self.server.faults.slow_read_bps if throttle else 0
+        if headers.get("transfer-encoding", "").lower() == "chunked":
+            out = bytearray()
+            while True:
+                size_line = self.rfile.readline(64)
+                if not size_line:
+                    raise ClientGone()
+                size = int(size_line.split(b";")[0].strip(), 16)
+                if size == 0:
+                    # Trailer section ends with an empty line.
+                    while self.rfile.readline(8192) not in (b"\r\n", b"\n", b""):
+                        pass
+                    return bytes(out)
+                out += self.read_exact(size, bps)
+                self.read_exact(2, 0)
+        length = int(headers.get("content-length", "0") or 0)
+        return self.read_exact(length, bps)
+
+    def read_exact(self, n: int, bps: int) -> bytes:
+        out = bytearray()
+        while len(out) < n:
+            step = n - len(out)
+            if bps > 0:
+                step = min(step, max(1, bps // 10))
+            data = self.rfile.read(step)
+            if not data:
+                raise ClientGone()
+            out += data
+            if bps > 0:
+                time.sleep(len(data) / bps)
+        return bytes(out)
+
+    def respond(self, status: int, body: bytes, close: bool = False, extra: Optional[Dict[str, str]] = None,
+                content_type: str = "text/plain") -> None:
+        reason = {200: "OK", 204: "No Content", 400: "Bad Request", 404: "Not Found", 413: "Payload Too Large",
+                  429: "Too Many Requests", 500: "Internal Server Error", 502: "Bad Gateway",
+                  503: "Service Unavailable"}.get(status, "Status")
+        head = [f"HTTP/1.1 {status} {reason}"]
+        if status != 204:
+            head += [f"Content-Type: {content_type}", f"Content-Length: {len(body)}"]
+        head.append("Connection: close" if close else "Connection: keep-alive")
+        for k, v in (extra or {}).items():
+            head.append(f"{k}: {v}")
+        self.wfile.write(("\r\n".join(head) + "\r\n\r\n").encode("latin-1") + (body if status != 204 else b""))
+        self.wfile.flush()
+
+    def admin(self, method: str, path: str, body: bytes) -> bool:
+        if method == "GET" and path == "/__stats":
+            payload = self.server.stats.snapshot()
+            payload["faults"] = asdict(self.server.faults)
+            self.respond(200, json.dumps(payload).encode(), content_type="application/json")
+        elif method == "POST" and path == "/__faults":
+            try:
+                self.server.faults.update(json.loads(body or b"{}"))
+            except (ValueError, TypeError) as e:
+                self.respond(400, f"{e}\n".encode())
+                return True
+            self.server.log(f"faults now {asdict(self.server.faults)}")
+            self.respond(200, json.dumps(asdict(self.server.faults)).encode(), content_type="application/json")
+        elif method == "POST" and path == "/__reset":
+            self.server.stats.reset()
+            self.respond(204, b"")
+        else:
+            self.respond(404, b"unknown admin endpoint\n")
+        return True
+
+
+class MockServer(socketserver.ThreadingTCPServer):
+    daemon_threads = True
+    allow_reuse_address = True
+
+    def __init__(self, host: str, port: int, faults: Faults, tls_context: Optional[ssl.SSLContext] = None,
+                 idle_timeout: float = 120.0, quiet: bool = False) -> None:
+        self.faults = faults
+        self.stats = Stats()
+        self.tls_context = tls_context
+        self.idle_timeout = idle_timeout
+        self.quiet = quiet
+        super().__init__((host, port), Handler)
+
+    def log(self, message: str) -> None:
+        if not self.quiet:
+            print(f"[mock] {message}", file=sys.stderr)
+
+    def handle_error(self, request: Any, client_address: Any) -> None:
+        self.log(f"connection from {client_address[0]} ended with {sys.exc_info()[1]!r}")
+
+
+# ---- certificates ----
+
+def ensure_certificates(cert_dir: str, cert_host: str) -> Tuple[str, str, str]:
+    """Creates (once) a private CA and a server certificate signed by it.
+    Returns (ca.pem, server.pem, server.key)."""
+    os.makedirs(cert_dir, exist_ok=True)
+    ca_key, ca_pem = os.path.join(cert_dir, "ca.key"), os.path.join(cert_dir, "ca.pem")
+    srv_key, srv_csr, srv_pem = (os.path.join(cert_dir, n) for n in ("server.key", "server.csr", "server.pem"))
+    # P-256 keeps the handshake cheap on the ESP32-C3.
+    ec = ["-newkey", "ec", "-pkeyopt", "ec_paramgen_curve:prime256v1", "-nodes"]
+    if not (os.path.exists(ca_key) and os.path.exists(ca_pem)):
+        subprocess.run(["openssl", "req", "-x509", *ec, "-keyout", ca_key, "-out", ca_pem, "-days", "3650",
+                        "-subj", "/CN=Mock Ingest Test CA",
+                        "-addext", "basicConstraints=critical,CA:TRUE",
+                        "-addext", "keyUsage=critical,keyCertSign,cRLSign"],
+                       check=True, capture_output=True)
+    try:
+        ipaddress.ip_address(cert_host)
+        san = f"IP:{cert_host}"
+    except ValueError:
+        san = f"DNS:{cert_host}"
+    ext = os.path.join(cert_dir, "server.ext")
+    with open(ext, "w", encoding="ascii") as fh:
+        fh.write(f"subjectAltName={san}\nbasicConstraints=CA:FALSE\nextendedKeyUsage=serverAuth\n")
+    subprocess.run(["openssl", "req", *ec, "-keyout", srv_key, "-out", srv_csr, "-subj", f"/CN={cert_host}"],
+                   check=True, capture_output=True)
+    subprocess.run(["openssl", "x509", "-req", "-in", srv_csr, "-CA", ca_pem, "-CAkey", ca_key, "-CAcreateserial",
+                    "-out", srv_pem, "-days", "825", "-extfile", ext],
+                   check=True, capture_output=True)
+    return ca_pem, srv_pem, srv_key
+
+
+def make_tls_context(cert_dir: str, cert_host: str) -> Tuple[ssl.SSLContext, str]:
+    ca_pem, srv_pem, srv_key = ensure_certificates(cert_dir, cert_host)
+    ctx = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
+    ctx.load_cert_chain(srv_pem, srv_key)
+    return ctx, ca_pem
+
+
+def start_server(host: str, port: int, faults: Faults, tls: bool = False, cert_dir: str = "mock_certs",
+                 cert_host: str = "localhost", quiet: bool = False) -> Tuple[MockServer, Optional[str]]:
+    """Starts the server on a background thread; returns it and the CA path (TLS only)."""
+    ctx, ca_pem = make_tls_context(cert_dir, cert_host) if tls else (None, None)
+    server = MockServer(host, port, faults, tls_context=ctx, quiet=quiet)
+    threading.Thread(target=server.serve_forever, name="mock-ingest", daemon=True).start()
+    return server, ca_pem
+
+
+def add_fault_args(p: argparse.ArgumentParser) -> None:
+    p.add_argument("--latency-ms", type=float, default=0.0, help="Delay before every response [default: %(default)s]")
+    p.add_argument("--jitter-ms", type=float, default=0.0, help="Extra random delay, 0..N ms [default: %(default)s]")
+    p.add_argument("--error-rate", type=float, default=0.0, help="Share of posts answered with --error-status [default: %(default)s]")
+    p.add_argument("--error-status", type=int, default=503, help="Status for injected errors [default: %(default)s]")
+    p.add_argument("--retry-after", type=int, default=None, help="Retry-After seconds sent with injected errors")
+    p.add_argument("--reset-rate", type=float, default=0.0, help="Share of requests answered with a TCP RST [default: %(default)s]")
+    p.add_argument("--close-rate", type=float, default=0.0, help="Share of responses with Connection: close [default: %(default)s]")
+    p.add_argument("--slow-read-bps", type=int, default=0, help="Read request bodies at this rate, 0 = full speed [default: %(default)s]")
+    p.add_argument("--max-body", type=int, default=0, help="Answer 413 above this body size, 0 = no limit [default: %(default)s]")
+
+
+def faults_from_args(args: argparse.Namespace) -> Faults:
+    return Faults(latency_ms=args.latency_ms, jitter_ms=args.jitter_ms, error_rate=args.error_rate,
+                  error_status=args.error_status, retry_after=args.retry_after, reset_rate=args.reset_rate,
+                  close_rate=args.close_rate, slow_read_bps=args.slow_read_bps, max_body=args.max_body)
+
+
+def parse_args(argv: list[str]) -> argparse.Namespace:
+    p = argparse.ArgumentParser(description="Mock upstream for the ESP32 upload path, with fault injection")
+    p.add_argument("--bind", default="0.0.0.0", help="Address to listen on [default: %(default)s]")
+    p.add_argument("--port", type=int, default=8080, help="Port to listen on [default: %(default)s]")
+    p.add_argument("--tls", action="store_true", help="Serve HTTPS with a certificate from a private test CA")
+    p.add_argument("--cert-dir", default="mock_certs", help="Where the test CA and server certificate live [default: %(default)s]")
+    p.add_argument("--cert-host", default="localhost",
+                   help="Host name or IP the device connects to (certificate SAN) [default: %(default)s]")
+    p.add_argument("--stats-every", type=float, default=10.0, help="Print counters every N seconds, 0 = never [default: %(default)s]")
+    add_fault_args(p)
+    return p.parse_args(argv)
+
+
+def main(argv: list[str]) -> int:
+    args = parse_args(argv)
+    try:
+        server, ca_pem = start_server(args.bind, args.port, faults_from_args(args), tls=args.tls,
+                                      cert_dir=args.cert_dir, cert_host=args.cert_host)
+    except (OSError, subprocess.CalledProcessError) as e:
+        print(f"Cannot start: {e}", file=sys.stderr)
+        return 2
+    scheme = "https" if args.tls else "http"
+    print(f"Mock ingest listening on {scheme}://{args.bind}:{args.port}/ (any path)")
+    if ca_pem:
+        print(f"Test CA: {ca_pem}  (kHttpsRootCA, or use https_insecure on the device)")
+    try:
+        while True:
+            time.sleep(args.stats_every if args.stats_every > 0 else 3600)
+            if args.stats_every > 0:
+                print(json.dumps(server.stats.snapshot()))
+    except KeyboardInterrupt:
+        pass
+    server.shutdown()
+    print(json.dumps(server.stats.snapshot(), indent=2))
+    return 0
+
+
+if __name__ == "__main__":
+    raise SystemExit(main(sys.argv[1:]))
@@ -21,13 +21,28 @@ namespace
   constexpr const char kKeyHttpsInsecure[] = "https_insecure";
   constexpr const char kKeyPostInterval[] = "post_interval";
   constexpr const char kKeyAlignMinute[] = "align_minute";
+  constexpr const char kKeyBatchMaxReadings[] = "batch_max";
+  constexpr const char kKeyBatchMaxAge[] = "batch_age";
   constexpr const char kKeyWifiStaticIpEnabled[] = "wifi_st_en";
   constexpr const char kKeyWifiStaticIp[] = "wifi_st_ip";
   constexpr const char kKeyWifiStaticGateway[] = "wifi_st_gw";
   constexpr const char kKeyWifiStaticMask[] = "wifi_st_msk";
   constexpr const char kKeyWifiStaticDns1[] = "wifi_st_d1";
   constexpr const char kKeyWifiStaticDns2[] = "wifi_st_d2";
+  constexpr const char kKeyPayloadFormat[] = "payload_fmt";
+  constexpr const char kKeyUploadQueuePolicy[] = "upload_qpol";
+  constexpr const char kKeyExtraSinks[] = "sinks";
+  constexpr const char kKeyInfluxPrecision[] = "influx_prec";
+  constexpr const char kKeyPayloadGzip[] = "payload_gzip";
+  constexpr const char kKeyPayloadStats[] = "payload_stats";
+  constexpr const char kKeyDeadbandTemp[] = "db_temp";
+  constexpr const char kKeyDeadbandHumidity[] = "db_hum";
+  constexpr const char kKeyMaxSilence[] = "max_silence";
+  constexpr const char kKeyReadCacheMaxAge[] = "read_max_age";
+  constexpr const char kKeyFilter[] = "filter";
   constexpr const char kKeyLogLevel[] = "log_level";
+  // Sink names end up in metric labels and task names; keep them short.
+  constexpr size_t kMaxSinkNameLen = 12;
 }
 
 AppConfig &AppConfig::get()
@@ -36,7 +51,7 @@ AppConfig &AppConfig::get()
   return inst;
 }
 
-AppConfig::AppConfig() : prefsReady_(false), logLevel_(StructuredLog::Level::Info)
+AppConfig::AppConfig() : prefsReady_(false), extraSinkCount_(0), logLevel_(StructuredLog::Level::Info), generation_(0)
 {
   mutex_ = xSemaphoreCreateMutex();
   prefsReady_ = prefs_.begin(kPrefsNamespace, false);
@@ -101,6 +116,20 @@ void AppConfig::loadDefaultsLocked()
 #else
   alignPostsToMinute_ = true;
 #endif
+#ifdef BATCH_MAX_READINGS
+  batchMaxReadings_ = BATCH_MAX_READINGS;
+#else
+  batchMaxReadings_ = 1;
+#endif
+  if (batchMaxReadings_ == 0)
+    batchMaxReadings_ = 1;
+  if (batchMaxReadings_ > kMaxBatchReadings)
+    batchMaxReadings_ = kMaxBatchReadings;
+#ifdef BATCH_MAX_AGE_SECONDS
+  batchMaxAgeSeconds_ = BATCH_MAX_AGE_SECONDS;
+#else
+  batchMaxAgeSeconds_ = 300;
+#endif
 #ifdef WIFI_STATIC_IP_ENABLED
   wifiStaticIpEnabled_ = (WIFI_STATIC_IP_ENABLED != 0);
 #else
@@ -132,6 +161,100 @@ void AppConfig::loadDefaultsLocked()
   wifiStaticDns2_.clear();
 #endif
 
+#ifdef PAYLOAD_FORMAT
+  if (!payloadFormatFromString(String(PAYLOAD_FORMAT), payloadFormat_))
+    payloadFormat_ = PayloadFormat::Json;
+#else
+  payloadFormat_ = PayloadFormat::Json;
+#endif
+
+#ifdef UPLOAD_QUEUE_POLICY
+  if (!uploadQueuePolicyFromString(String(UPLOAD_QUEUE_POLICY), uploadQueuePolicy_))
+    uploadQueuePolicy_ = UploadQueuePolicy::DropOldest;
+#else
+  uploadQueuePolicy_ = UploadQueuePolicy::DropOldest;
+#endif
+
+  extraSinkCount_ = 0;
+#ifdef EXTRA_SINKS_JSON
+  {
+    JsonDocument doc;
+    if (!deserializeJson(doc, EXTRA_SINKS_JSON) && doc.is<JsonArrayConst>())
+      sinksFromJson(doc.as<JsonArrayConst>());
+  }
+#endif
+
+#ifdef INFLUX_PRECISION
+  if (!influxPrecisionFromString(String(INFLUX_PRECISION), influxPrecision_))
+    influxPrecision_ = InfluxPrecision::Ns;
+#else
+  influxPrecision_ = InfluxPrecision::Ns;
+#endif
+
+#ifdef PAYLOAD_GZIP
+  payloadGzip_ = PAYLOAD_GZIP;
+#else
+  payloadGzip_ = false;
+#endif
+
+#ifdef PAYLOAD_STATS
+  payloadStats_ = PAYLOAD_STATS;
+#else
+  payloadStats_ = false;
+#endif
+
+#ifdef DEADBAND_TEMP_C
+  deadbandTempC_ = DEADBAND_TEMP_C;
+#else
+  deadbandTempC_ = 0.0f;
+#endif
+
+#ifdef DEADBAND_HUMIDITY_PCT
+  deadbandHumidityPct_ = DEADBAND_HUMIDITY_PCT;
+#else
+  deadbandHumidityPct_ = 0.0f;
+#endif
+
+#ifdef MAX_SILENCE_SECONDS
+  maxSilenceSeconds_ = MAX_SILENCE_SECONDS;
+#else
+  maxSilenceSeconds_ = 900;
+#endif
+
+#ifdef READ_CACHE_MAX_AGE_MS
+  readCacheMaxAgeMs_ = READ_CACHE_MAX_AGE_MS;
+#else
+  readCacheMaxAgeMs_ = 2000;
+#endif
+
+  filter_ = ReadingFilter::Settings();
+#ifdef FILTER_OVERSAMPLE
+  filter_.oversample = FILTER_OVERSAMPLE;
+#endif
+#ifdef FILTER_MEDIAN
+  filter_.median = FILTER_MEDIAN;
+#endif
+#ifdef FILTER_MAX_RATE_TEMP_C_PER_MIN
+  filter_.maxRateTempCPerMin = FILTER_MAX_RATE_TEMP_C_PER_MIN;
+#endif
+#ifdef FILTER_MAX_RATE_HUMIDITY_PCT_PER_MIN
+  filter_.maxRateHumidityPctPerMin = FILTER_MAX_RATE_HUMIDITY_PCT_PER_MIN;
+#endif
+#ifdef FILTER_SMOOTHING
+  if (!ReadingFilter::smoothingFromString(FILTER_SMOOTHING, filter_.smoothing))
+    filter_.smoothing = ReadingFilter::Smoothing::None;
+#endif
+#ifdef FILTER_EMA_ALPHA
+  filter_.emaAlpha = FILTER_EMA_ALPHA;
+#endif
+#ifdef FILTER_KALMAN_Q
+  filter_.kalmanQ = FILTER_KALMAN_Q;
+#endif
+#ifdef FILTER_KALMAN_R
+  filter_.kalmanR = FILTER_KALMAN_R;
+#endif
+  ReadingFilter::clamp(filter_);
+
 #ifdef DEFAULT_LOG_LEVEL
   {
     StructuredLog::Level parsed = StructuredLog::Level::Info;
@@ -147,6 +270,15 @@ void AppConfig::loadDefaultsLocked()
 #else
   logLevel_ = StructuredLog::Level::Info;
 #endif
+  generation_++;
+}
+
+uint32_t AppConfig::getGeneration()
+{
+  xSemaphoreTake(mutex_, portMAX_DELAY);
+  uint32_t v = generation_;
+  xSemaphoreGive(mutex_);
+  return v;
 }
 
 String AppConfig::getDeviceLocation()
@@ -247,6 +379,20 @@ bool AppConfig::getAlignPostsToMinute()
   xSemaphoreGive(mutex_);
   return v;
 }
+uint16_t AppConfig::getBatchMaxReadings()
+{
+  xSemaphoreTake(mutex_, portMAX_DELAY);
+  auto v = batchMaxReadings_;
+  xSemaphoreGive(mutex_);
+  return v;
+}
+uint32_t AppConfig::getBatchMaxAgeSeconds()
+{
+  xSemaphoreTake(mutex_, portMAX_DELAY);
+  auto v = batchMaxAgeSeconds_;
+  xSemaphoreGive(mutex_);
+  return v;
+}
 bool AppConfig::getWifiStaticIpEnabled()
 {
   xSemaphoreTake(mutex_, portMAX_DELAY);
@@ -290,6 +436,197 @@ String AppConfig::getWifiStaticDns2()
   return v;
 }
 
+PayloadFormat AppConfig::getPayloadFormat()
+{
+  xSemaphoreTake(mutex_, portMAX_DELAY);
+  auto v = payloadFormat_;
+  xSemaphoreGive(mutex_);
+  return v;
+}
+
+UploadQueuePolicy AppConfig::getUploadQueuePolicy()
+{
+  xSemaphoreTake(mutex_, portMAX_DELAY);
+  auto v = uploadQueuePolicy_;
+  xSemaphoreGive(mutex_);
+  return v;
+}
+
+size_t AppConfig::getExtraSinkCount()
+{
+  xSemaphoreTake(mutex_, portMAX_DELAY);
+  size_t v = extraSinkCount_;
+  xSemaphoreGive(mutex_);
+  return v;
+}
+
+bool AppConfig::getExtraSink(size_t index, SinkConfig &out)
+{
+  xSemaphoreTake(mutex_, portMAX_DELAY);
+  const bool found = index < extraSinkCount_;
+  if (found)
+    out = extraSinks_[index];
+  xSemaphoreGive(mutex_);
+  return found;
+}
+
+void AppConfig::sinksFromJson(JsonArrayConst sinks)
+{
+  extraSinkCount_ = 0;
+  for (JsonObjectConst o : sinks)
+  {
+    if (extraSinkCount_ >= kMaxExtraSinks)
+      break;
+    String host = o["host"] | "";
+    if (host.length() == 0)
+      continue;
+    SinkConfig &s = extraSinks_[extraSinkCount_];
+    s.name = o["name"] | "";
+    if (s.name.length() == 0)
+      s.name = String("sink") + String(extraSinkCount_ + 1);
+    if (s.name.length() > kMaxSinkNameLen)
+      s.name.remove(kMaxSinkNameLen);
+    s.type = o["type"] | "http";
+    s.host = host;
+    s.path = o["path"] | "/";
+    s.apiKey = o["api_key"] | "";
+    s.useTls = o["use_tls"] | false;
+    s.insecure = o["https_insecure"] | false;
+    uint16_t defaultPort = s.useTls ? 443 : 80;
+    if (s.type.equalsIgnoreCase("mqtt"))
+      defaultPort = s.useTls ? 8883 : 1883;
+    else if (s.type.equalsIgnoreCase("statsd"))
+      defaultPort = 8125;
+    else if (s.type.equalsIgnoreCase("graphite"))
+      defaultPort = 2003;
+    s.port = o["port"] | defaultPort;
+    s.enabled = o["enabled"] | true;
+    s.topic = o["topic"] | "sensors/{location}";
+    s.user = o["user"] | "";
+    uint8_t qos = o["qos"] | static_cast<uint8_t>(1);
+    s.qos = qos > 1 ? 1 : qos;
+    s.retain = o["retain"] | false;
+    s.prefix = o["prefix"] | "esp.{location}";
+    ++extraSinkCount_;
+  }
+}
+
+void AppConfig::sinkToJson(const SinkConfig &sink, JsonObject out)
+{
+  out["name"] = sink.name;
+  out["type"] = sink.type;
+  out["host"] = sink.host;
+  out["port"] = sink.port;
+  out["path"] = sink.path;
+  out["api_key"] = sink.apiKey;
+  out["use_tls"] = sink.useTls;
+  out["https_insecure"] = sink.insecure;
+  out["enabled"] = sink.enabled;
+  if (sink.type.equalsIgnoreCase("mqtt"))
+  {
+    out["topic"] = sink.topic;
+    out["user"] = sink.user;
+    out["qos"] = sink.qos;
+    out["retain"] = sink.retain;
+  }
+  if (sink.type.equalsIgnoreCase("statsd") || sink.type.equalsIgnoreCase("graphite"))
+    out["prefix"] = sink.prefix;
+}
+
+InfluxPrecision AppConfig::getInfluxPrecision()
+{
+  xSemaphoreTake(mutex_, portMAX_DELAY);
+  auto v = influxPrecision_;
+  xSemaphoreGive(mutex_);
+  return v;
+}
+
+bool AppConfig::getPayloadGzip()
+{
+  xSemaphoreTake(mutex_, portMAX_DELAY);
+  auto v = payloadGzip_;
+  xSemaphoreGive(mutex_);
+  return v;
+}
+
+bool AppConfig::getPayloadStats()
+{
+  xSemaphoreTake(mutex_, portMAX_DELAY);
+  auto v = payloadStats_;
+  xSemaphoreGive(mutex_);
+  return v;
+}
+
+float AppConfig::getDeadbandTempC()
+{
+  xSemaphoreTake(mutex_, portMAX_DELAY);
+  auto v = deadbandTempC_;
+  xSemaphoreGive(mutex_);
+  return v;
+}
+
+float AppConfig::getDeadbandHumidityPct()
+{
+  xSemaphoreTake(mutex_, portMAX_DELAY);
+  auto v = deadbandHumidityPct_;
+  xSemaphoreGive(mutex_);
+  return v;
+}
+
+uint32_t AppConfig::getMaxSilenceSeconds()
+{
+  xSemaphoreTake(mutex_, portMAX_DELAY);
+  auto v = maxSilenceSeconds_;
+  xSemaphoreGive(mutex_);
+  return v;
+}
+
+uint32_t AppConfig::getReadCacheMaxAgeMs()
+{
+  xSemaphoreTake(mutex_, portMAX_DELAY);
+  auto v = readCacheMaxAgeMs_;
+  xSemaphoreGive(mutex_);
+  return v;
+}
+
+ReadingFilter::Settings AppConfig::getFilterSettings()
+{
+  xSemaphoreTake(mutex_, portMAX_DELAY);
+  auto v = filter_;
+  xSemaphoreGive(mutex_);
+  return v;
+}
+
+void AppConfig::filterFromJson(JsonObjectConst o)
+{
+  filter_.oversample = o["oversample"] | filter_.oversample;
+  filter_.median = o["median"] | filter_.median;
+  filter_.maxRateTempCPerMin = o["max_rate_temp_c_per_min"] | filter_.maxRateTempCPerMin;
+  filter_.maxRateHumidityPctPerMin = o["max_rate_humidity_pct_per_min"] | filter_.maxRateHumidityPctPerMin;
+  if (o["smoothing"].is<const char *>())
+  {
+    ReadingFilter::Smoothing parsed;
+    if (ReadingFilter::smoothingFromString(o["smoothing"].as<const char *>(), parsed))
+      filter_.smoothing = parsed;
+  }
+  filter_.emaAlpha = o["ema_alpha"] | filter_.emaAlpha;
+  filter_.kalmanQ = o["kalman_q"] | filter_.kalmanQ;
+  filter_.kalmanR = o["kalman_r"] | filter_.kalmanR;
+  ReadingFilter::clamp(filter_);
+}
+
+void AppConfig::filterToJson(const ReadingFilter::Settings &filter, JsonObject out)
+{
+  out["oversample"] = filter.oversample;
+  out["median"] = filter.median;
+  out["max_rate_temp_c_per_min"] = filter.maxRateTempCPerMin;
+  out["max_rate_humidity_pct_per_min"] = filter.maxRateHumidityPctPerMin;
+  out["smoothing"] = ReadingFilter::smoothingName(filter.smoothing);
+  out["ema_alpha"] = filter.emaAlpha;
+  out["kalman_q"] = filter.kalmanQ;
+  out["kalman_r"] = filter.kalmanR;
+}
+
 StructuredLog::Level AppConfig::getLogLevel()
 {
   xSemaphoreTake(mutex_, portMAX_DELAY);
@@ -302,72 +639,84 @@ void AppConfig::setDeviceLocation(const String &v)
 {
   xSemaphoreTake(mutex_, portMAX_DELAY);
   deviceLocation_ = v;
+  generation_++;
   xSemaphoreGive(mutex_);
 }
 void AppConfig::setWifiSSID(const String &v)
 {
   xSemaphoreTake(mutex_, portMAX_DELAY);
   wifiSSID_ = v;
+  generation_++;
   xSemaphoreGive(mutex_);
 }
 void AppConfig::setWifiPassword(const String &v)
 {
   xSemaphoreTake(mutex_, portMAX_DELAY);
   wifiPassword_ = v;
+  generation_++;
   xSemaphoreGive(mutex_);
 }
 void AppConfig::setWifiHostname(const String &v)
 {
   xSemaphoreTake(mutex_, portMAX_DELAY);
   wifiHostname_ = v;
+  generation_++;
   xSemaphoreGive(mutex_);
 }
 void AppConfig::setMdnsHostname(const String &v)
 {
   xSemaphoreTake(mutex_, portMAX_DELAY);
   mdnsHostname_ = v;
+  generation_++;
   xSemaphoreGive(mutex_);
 }
 void AppConfig::setServerHost(const String &v)
 {
   xSemaphoreTake(mutex_, portMAX_DELAY);
   serverHost_ = v;
+  generation_++;
   xSemaphoreGive(mutex_);
 }
 void AppConfig::setServerPath(const String &v)
 {
   xSemaphoreTake(mutex_, portMAX_DELAY);
   serverPath_ = v;
+  generation_++;
   xSemaphoreGive(mutex_);
 }
 void AppConfig::setApiKey(const String &v)
 {
   xSemaphoreTake(mutex_, portMAX_DELAY);
   apiKey_ = v;
+  generation_++;
   xSemaphoreGive(mutex_);
 }
 void AppConfig::setHttpApiKey(const String &v)
 {
   xSemaphoreTake(mutex_, portMAX_DELAY);
   httpApiKey_ = v;
+  generation_++;
   xSemaphoreGive(mutex_);
 }
 void AppConfig::setServerPort(uint16_t p)
 {
   xSemaphoreTake(mutex_, portMAX_DELAY);
   serverPort_ = p;
+  generation_++;
   xSemaphoreGive(mutex_);
 }
 void AppConfig::setUseTls(bool b)
 {
   xSemaphoreTake(mutex_, portMAX_DELAY);
   useTls_ = b;
+  generation_++;
   xSemaphoreGive(mutex_);
 }
 void AppConfig::setHttpsInsecure(bool b)
 {
   xSemaphoreTake(mutex_, portMAX_DELAY);
   httpsInsecure_ = b;
+  generation_++;
   xSemaphoreGive(mutex_);
 }
 void AppConfig::setPostIntervalSeconds(uint32_t s)
@@ -376,48 +725,155 @@ void AppConfig::setPostIntervalSeconds(uint32_t s)
     s = 1;
   xSemaphoreTake(mutex_, portMAX_DELAY);
   postIntervalSeconds_ = s;
+  generation_++;
   xSemaphoreGive(mutex_);
 }
 void AppConfig::setAlignPostsToMinute(bool b)
 {
   xSemaphoreTake(mutex_, portMAX_DELAY);
   alignPostsToMinute_ = b;
+  generation_++;
+  xSemaphoreGive(mutex_);
+}
+void AppConfig::setBatchMaxReadings(uint16_t n)
+{
+  if (n == 0)
+    n = 1;
+  if (n > kMaxBatchReadings)
+    n = kMaxBatchReadings;
+  xSemaphoreTake(mutex_, portMAX_DELAY);
+  batchMaxReadings_ = n;
+  generation_++;
+  xSemaphoreGive(mutex_);
+}
+void AppConfig::setBatchMaxAgeSeconds(uint32_t s)
+{
+  xSemaphoreTake(mutex_, portMAX_DELAY);
+  batchMaxAgeSeconds_ = s;
+  generation_++;
   xSemaphoreGive(mutex_);
 }
 void AppConfig::setWifiStaticIpEnabled(bool b)
 {
   xSemaphoreTake(mutex_, portMAX_DELAY);
   wifiStaticIpEnabled_ = b;
+  generation_++;
   xSemaphoreGive(mutex_);
 }
 void AppConfig::setWifiStaticIp(const String &v)
 {
   xSemaphoreTake(mutex_, portMAX_DELAY);
   wifiStaticIp_ = v;
+  generation_++;
   xSemaphoreGive(mutex_);
 }
 void AppConfig::setWifiStaticGateway(const String &v)
 {
   xSemaphoreTake(mutex_, portMAX_DELAY);
   wifiStaticGateway_ = v;
+  generation_++;
   xSemaphoreGive(mutex_);
 }
 void AppConfig::setWifiStaticSubnet(const String &v)
 {
   xSemaphoreTake(mutex_, portMAX_DELAY);
   wifiStaticSubnet_ = v;
+  generation_++;
   xSemaphoreGive(mutex_);
 }
 void AppConfig::setWifiStaticDns1(const String &v)
 {
   xSemaphoreTake(mutex_, portMAX_DELAY);
   wifiStaticDns1_ = v;
+  generation_++;
   xSemaphoreGive(mutex_);
 }
 void AppConfig::setWifiStaticDns2(const String &v)
 {
   xSemaphoreTake(mutex_, portMAX_DELAY);
   wifiStaticDns2_ = v;
+  generation_++;
+  xSemaphoreGive(mutex_);
+}
+
+void AppConfig::setPayloadFormat(PayloadFormat v)
+{
+  xSemaphoreTake(mutex_, portMAX_DELAY);
+  payloadFormat_ = v;
+  generation_++;
+  xSemaphoreGive(mutex_);
+}
+
+void AppConfig::setUploadQueuePolicy(UploadQueuePolicy v)
+{
+  xSemaphoreTake(mutex_, portMAX_DELAY);
+  uploadQueuePolicy_ = v;
+  generation_++;
+  xSemaphoreGive(mutex_);
+}
+
+void AppConfig::setInfluxPrecision(InfluxPrecision v)
+{
+  xSemaphoreTake(mutex_, portMAX_DELAY);
+  influxPrecision_ = v;
+  generation_++;
+  xSemaphoreGive(mutex_);
+}
+
+void AppConfig::setPayloadGzip(bool v)
+{
+  xSemaphoreTake(mutex_, portMAX_DELAY);
+  payloadGzip_ = v;
+  generation_++;
+  xSemaphoreGive(mutex_);
+}
+
+void AppConfig::setPayloadStats(bool v)
+{
+  xSemaphoreTake(mutex_, portMAX_DELAY);
+  payloadStats_ = v;
+  generation_++;
+  xSemaphoreGive(mutex_);
+}
+
+void AppConfig::setDeadbandTempC(float v)
+{
+  xSemaphoreTake(mutex_, portMAX_DELAY);
+  deadbandTempC_ = v > 0.0f ? v : 0.0f;
+  generation_++;
+  xSemaphoreGive(mutex_);
+}
+
+void AppConfig::setDeadbandHumidityPct(float v)
+{
+  xSemaphoreTake(mutex_, portMAX_DELAY);
+  deadbandHumidityPct_ = v > 0.0f ? v : 0.0f;
+  generation_++;
+  xSemaphoreGive(mutex_);
+}
+
+void AppConfig::setMaxSilenceSeconds(uint32_t v)
+{
+  xSemaphoreTake(mutex_, portMAX_DELAY);
+  maxSilenceSeconds_ = v;
+  generation_++;
+  xSemaphoreGive(mutex_);
+}
+
+void AppConfig::setReadCacheMaxAgeMs(uint32_t v)
+{
+  xSemaphoreTake(mutex_, portMAX_DELAY);
+  readCacheMaxAgeMs_ = v;
+  generation_++;
+  xSemaphoreGive(mutex_);
+}
+
+void AppConfig::setFilterSettings(const ReadingFilter::Settings &v)
+{
+  xSemaphoreTake(mutex_, portMAX_DELAY);
+  filter_ = v;
+  ReadingFilter::clamp(filter_);
+  generation_++;
   xSemaphoreGive(mutex_);
 }
 
@@ -430,6 +886,7 @@ void AppConfig::setLogLevel(StructuredLog::Level level)
     logLevel_ = level;
     changed = true;
   }
+  generation_++;
   xSemaphoreGive(mutex_);
   if (changed)
   {
@@ -518,6 +975,21 @@ bool AppConfig::loadFromNvsLocked()
     alignPostsToMinute_ = prefs_.getBool(kKeyAlignMinute, alignPostsToMinute_);
     loaded = true;
   }
+  if (prefs_.isKey(kKeyBatchMaxReadings))
+  {
+    uint16_t v = prefs_.getUShort(kKeyBatchMaxReadings, batchMaxReadings_);
+    if (v == 0)
+      v = 1;
+    if (v > kMaxBatchReadings)
+      v = kMaxBatchReadings;
+    batchMaxReadings_ = v;
+    loaded = true;
+  }
+  if (prefs_.isKey(kKeyBatchMaxAge))
+  {
+    batchMaxAgeSeconds_ = prefs_.getUInt(kKeyBatchMaxAge, batchMaxAgeSeconds_);
+    loaded = true;
+  }
   if (prefs_.isKey(kKeyWifiStaticIpEnabled))
   {
     wifiStaticIpEnabled_ = prefs_.getBool(kKeyWifiStaticIpEnabled, wifiStaticIpEnabled_);
@@ -548,6 +1020,71 @@ bool AppConfig::loadFromNvsLocked()
     wifiStaticDns2_ = prefs_.getString(kKeyWifiStaticDns2, wifiStaticDns2_);
     loaded = true;
   }
+  if (prefs_.isKey(kKeyPayloadFormat))
+  {
+    uint8_t stored = prefs_.getUChar(kKeyPayloadFormat, static_cast<uint8_t>(payloadFormat_));
+    if (stored <= static_cast<uint8_t>(PayloadFormat::Influx))
+      payloadFormat_ = static_cast<PayloadFormat>(stored);
+    loaded = true;
+  }
+  if (prefs_.isKey(kKeyUploadQueuePolicy))
+  {
+    uint8_t stored = prefs_.getUChar(kKeyUploadQueuePolicy, static_cast<uint8_t>(uploadQueuePolicy_));
+    if (stored <= static_cast<uint8_t>(UploadQueuePolicy::Coalesce))
+      uploadQueuePolicy_ = static_cast<UploadQueuePolicy>(stored);
+    loaded = true;
+  }
+  if (prefs_.isKey(kKeyExtraSinks))
+  {
+    JsonDocument doc;
+    if (!deserializeJson(doc, prefs_.getString(kKeyExtraSinks)) && doc.is<JsonArrayConst>())
+      sinksFromJson(doc.as<JsonArrayConst>());
+    loaded = true;
+  }
+  if (prefs_.isKey(kKeyInfluxPrecision))
+  {
+    uint8_t stored = prefs_.getUChar(kKeyInfluxPrecision, static_cast<uint8_t>(influxPrecision_));
+    if (stored <= static_cast<uint8_t>(InfluxPrecision::S))
+      influxPrecision_ = static_cast<InfluxPrecision>(stored);
+    loaded = true;
+  }
+  if (prefs_.isKey(kKeyPayloadGzip))
+  {
+    payloadGzip_ = prefs_.getBool(kKeyPayloadGzip, payloadGzip_);
+    loaded = true;
+  }
+  if (prefs_.isKey(kKeyPayloadStats))
+  {
+    payloadStats_ = prefs_.getBool(kKeyPayloadStats, payloadStats_);
+    loaded = true;
+  }
+  if (prefs_.isKey(kKeyDeadbandTemp))
+  {
+    deadbandTempC_ = prefs_.getFloat(kKeyDeadbandTemp, deadbandTempC_);
+    loaded = true;
+  }
+  if (prefs_.isKey(kKeyDeadbandHumidity))
+  {
+    deadbandHumidityPct_ = prefs_.getFloat(kKeyDeadbandHumidity, deadbandHumidityPct_);
+    loaded = true;
+  }
+  if (prefs_.isKey(kKeyMaxSilence))
+  {
+    maxSilenceSeconds_ = prefs_.getUInt(kKeyMaxSilence, maxSilenceSeconds_);
+    loaded = true;
+  }
+  if (prefs_.isKey(kKeyReadCacheMaxAge))
+  {
+    readCacheMaxAgeMs_ = prefs_.getUInt(kKeyReadCacheMaxAge, readCacheMaxAgeMs_);
+    loaded = true;
+  }
+  if (prefs_.isKey(kKeyFilter))
+  {
+    JsonDocument doc;
+    if (!deserializeJson(doc, prefs_.getString(kKeyFilter)) && doc.is<JsonObjectConst>())
+      filterFromJson(doc.as<JsonObjectConst>());
+    loaded = true;
+  }
   if (prefs_.isKey(kKeyLogLevel))
   {
     uint8_t stored = prefs_.getUChar(kKeyLogLevel, static_cast<uint8_t>(logLevel_));
@@ -566,6 +1103,7 @@ bool AppConfig::loadFromNvsLocked()
 #endif
   }
 
+  generation_++;
   return loaded;
 }
 
@@ -605,12 +1143,25 @@ bool AppConfig::saveToNvs()
   bool httpsInsecure;
   uint32_t postInterval;
   bool alignMinute;
+  uint16_t batchMaxReadings;
+  uint32_t batchMaxAge;
   bool wifiStaticEnabled;
   String wifiStaticIp;
   String wifiStaticGateway;
   String wifiStaticNetmask;
   String wifiStaticDns1;
   String wifiStaticDns2;
+  PayloadFormat payloadFormat;
+  UploadQueuePolicy uploadQueuePolicy;
+  String extraSinks;
+  InfluxPrecision influxPrecision;
+  bool payloadGzip;
+  bool payloadStats;
+  float deadbandTemp;
+  float deadbandHumidity;
+  uint32_t maxSilence;
+  uint32_t readCacheMaxAge;
+  String filter;
   StructuredLog::Level logLevel;
 
   xSemaphoreTake(mutex_, portMAX_DELAY);
@@ -630,12 +1181,35 @@ bool AppConfig::saveToNvs()
   if (postInterval == 0)
     postInterval = 1;
   alignMinute = alignPostsToMinute_;
+  batchMaxReadings = batchMaxReadings_;
+  batchMaxAge = batchMaxAgeSeconds_;
   wifiStaticEnabled = wifiStaticIpEnabled_;
   wifiStaticIp = wifiStaticIp_;
   wifiStaticGateway = wifiStaticGateway_;
   wifiStaticNetmask = wifiStaticSubnet_;
   wifiStaticDns1 = wifiStaticDns1_;
   wifiStaticDns2 = wifiStaticDns2_;
+  payloadFormat = payloadFormat_;
+  uploadQueuePolicy = uploadQueuePolicy_;
+  {
+    JsonDocument doc;
+    JsonArray sinks = doc.to<JsonArray>();
+    for (size_t i = 0; i < extraSinkCount_; ++i)
+      sinkToJson(extraSinks_[i], sinks.add<JsonObject>());
+    serializeJson(doc, extraSinks);
+  }
+  influxPrecision = influxPrecision_;
+  payloadGzip = payloadGzip_;
+  payloadStats = payloadStats_;
+  deadbandTemp = deadbandTempC_;
+  deadbandHumidity = deadbandHumidityPct_;
+  maxSilence = maxSilenceSeconds_;
+  readCacheMaxAge = readCacheMaxAgeMs_;
+  {
+    JsonDocument doc;
+    filterToJson(filter_, doc.to<JsonObject>());
+    serializeJson(doc, filter);
+  }
   logLevel = logLevel_;
   xSemaphoreGive(mutex_);
 
@@ -653,12 +1227,25 @@ bool AppConfig::saveToNvs()
   prefs_.putBool(kKeyHttpsInsecure, httpsInsecure);
   prefs_.putUInt(kKeyPostInterval, postInterval);
   prefs_.putBool(kKeyAlignMinute, alignMinute);
+  prefs_.putUShort(kKeyBatchMaxReadings, batchMaxReadings);
+  prefs_.putUInt(kKeyBatchMaxAge, batchMaxAge);
   prefs_.putBool(kKeyWifiStaticIpEnabled, wifiStaticEnabled);
   prefs_.putString(kKeyWifiStaticIp, wifiStaticIp);
   prefs_.putString(kKeyWifiStaticGateway, wifiStaticGateway);
   prefs_.putString(kKeyWifiStaticMask, wifiStaticNetmask);
   prefs_.putString(kKeyWifiStaticDns1, wifiStaticDns1);
   prefs_.putString(kKeyWifiStaticDns2, wifiStaticDns2);
+  prefs_.putUChar(kKeyPayloadFormat, static_cast<uint8_t>(payloadFormat));
+  prefs_.putUChar(kKeyUploadQueuePolicy, static_cast<uint8_t>(uploadQueuePolicy));
+  prefs_.putString(kKeyExtraSinks, extraSinks);
+  prefs_.putUChar(kKeyInfluxPrecision, static_cast<uint8_t>(influxPrecision));
+  prefs_.putBool(kKeyPayloadGzip, payloadGzip);
+  prefs_.putBool(kKeyPayloadStats, payloadStats);
+  prefs_.putFloat(kKeyDeadbandTemp, deadbandTemp);
+  prefs_.putFloat(kKeyDeadbandHumidity, deadbandHumidity);
+  prefs_.putUInt(kKeyMaxSilence, maxSilence);
+  prefs_.putUInt(kKeyReadCacheMaxAge, readCacheMaxAge);
+  prefs_.putString(kKeyFilter, filter);
   prefs_.putUChar(kKeyLogLevel, static_cast<uint8_t>(logLevel));
 
   return true;
@@ -682,12 +1269,25 @@ bool AppConfig::hasPersistedConfig()
          prefs_.isKey(kKeyHttpsInsecure) ||
          prefs_.isKey(kKeyPostInterval) ||
          prefs_.isKey(kKeyAlignMinute) ||
+         prefs_.isKey(kKeyBatchMaxReadings) ||
+         prefs_.isKey(kKeyBatchMaxAge) ||
          prefs_.isKey(kKeyWifiStaticIpEnabled) ||
          prefs_.isKey(kKeyWifiStaticIp) ||
          prefs_.isKey(kKeyWifiStaticGateway) ||
          prefs_.isKey(kKeyWifiStaticMask) ||
          prefs_.isKey(kKeyWifiStaticDns1) ||
          prefs_.isKey(kKeyWifiStaticDns2) ||
+         prefs_.isKey(kKeyPayloadFormat) ||
+         prefs_.isKey(kKeyUploadQueuePolicy) ||
+         prefs_.isKey(kKeyExtraSinks) ||
+         prefs_.isKey(kKeyInfluxPrecision) ||
+         prefs_.isKey(kKeyPayloadGzip) ||
+         prefs_.isKey(kKeyPayloadStats) ||
+         prefs_.isKey(kKeyDeadbandTemp) ||
+         prefs_.isKey(kKeyDeadbandHumidity) ||
+         prefs_.isKey(kKeyMaxSilence) ||
+         prefs_.isKey(kKeyReadCacheMaxAge) ||
+         prefs_.isKey(kKeyFilter) ||
          prefs_.isKey(kKeyLogLevel);
 }
 
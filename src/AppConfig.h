@@ -6,16 +6,51 @@
 #include <freertos/FreeRTOS.h>
 #include <freertos/semphr.h>
 
+#include "LineProtocol.h"
+#include "PayloadWriter.h"
+#include "ReadingFilter.h"
 #include "StructuredLog.h"
+#include "UploaderTask.h"
 
 // Central runtime configuration with thread-safe access
 class AppConfig
 {
 public:
+  // Upper bound for batch_max_readings (sizes the Poster batch buffer).
+  static constexpr uint16_t kMaxBatchReadings = 32;
+  // Upload targets besides the primary server_* endpoint ("sinks").
+  static constexpr size_t kMaxExtraSinks = 2;
+
+  struct SinkConfig
+  {
+    String name;
+    String type; // "http", "mqtt", "statsd" or "graphite"
+    String host;
+    String path;
+    String apiKey; // HTTP: "Authorization: Bearer" ("Token" for influx); MQTT: password
+    uint16_t port = 80;
+    bool useTls = false;
+    bool insecure = false;
+    bool enabled = true;
+    // MQTT only: topic prefix ({location}, {name} and {client_id} are
+    // expanded), user name, publish QoS (0/1) and retain flag for readings.
+    String topic;
+    String user;
+    uint8_t qos = 1;
+    bool retain = false;
+    // StatsD / Graphite only: metric name prefix ({location} and {name}
+    // are expanded).
+    String prefix;
+  };
+
   static AppConfig &get();
 
   void loadDefaultsFromMacros();
 
+  // Incremented by every change (setters, JSON update, NVS load, reset) so
+  // callers can cache derived values and refresh only when it moves.
+  uint32_t getGeneration();
+
   // getters (copy out for thread safety)
   String getDeviceLocation();
   String getWifiSSID();
@@ -31,13 +66,30 @@ public:
   bool getHttpsInsecure();
   uint32_t getPostIntervalSeconds();
   bool getAlignPostsToMinute();
+  uint16_t getBatchMaxReadings();
+  uint32_t getBatchMaxAgeSeconds();
   bool getWifiStaticIpEnabled();
   String getWifiStaticIp();
   String getWifiStaticGateway();
   String getWifiStaticSubnet();
   String getWifiStaticDns1();
   String getWifiStaticDns2();
+  PayloadFormat getPayloadFormat();
+  UploadQueuePolicy getUploadQueuePolicy();
+  InfluxPrecision getInfluxPrecision();
+  bool getPayloadGzip();
+  bool getPayloadStats();
+  float getDeadbandTempC();
+  float getDeadbandHumidityPct();
+  uint32_t getMaxSilenceSeconds();
+  // GET /read answers from the last sample while it is at most this old.
+  uint32_t getReadCacheMaxAgeMs();
+  ReadingFilter::Settings getFilterSettings();
   StructuredLog::Level getLogLevel();
+  // Extra sinks are instantiated at boot, so adding or removing entries
+  // needs a reboot; edits to an existing entry apply on its next post.
+  size_t getExtraSinkCount();
+  bool getExtraSink(size_t index, SinkConfig &out);
 
   // setters (update one or more fields)
   void setDeviceLocation(const String &v);
@@ -54,12 +106,24 @@ public:
   void setHttpsInsecure(bool b);
   void setPostIntervalSeconds(uint32_t s);
   void setAlignPostsToMinute(bool b);
+  void setBatchMaxReadings(uint16_t n);
+  void setBatchMaxAgeSeconds(uint32_t s);
   void setWifiStaticIpEnabled(bool b);
   void setWifiStaticIp(const String &v);
   void setWifiStaticGateway(const String &v);
   void setWifiStaticSubnet(const String &v);
   void setWifiStaticDns1(const String &v);
   void setWifiStaticDns2(const String &v);
+  void setPayloadFormat(PayloadFormat v);
+  void setUploadQueuePolicy(UploadQueuePolicy v);
+  void setInfluxPrecision(InfluxPrecision v);
+  void setPayloadGzip(bool v);
+  void setPayloadStats(bool v);
+  void setDeadbandTempC(float v);
+  void setDeadbandHumidityPct(float v);
+  void setMaxSilenceSeconds(uint32_t v);
+  void setReadCacheMaxAgeMs(uint32_t v);
+  void setFilterSettings(const ReadingFilter::Settings &v);
   void setLogLevel(StructuredLog::Level level);
 
   // JSON helpers (ArduinoJson Document)
@@ -81,13 +145,28 @@ public:
     doc["http_api_key"] = httpApiKey_;
     doc["post_interval_sec"] = postIntervalSeconds_;
     doc["align_to_minute"] = alignPostsToMinute_;
+    doc["batch_max_readings"] = batchMaxReadings_;
+    doc["batch_max_age_sec"] = batchMaxAgeSeconds_;
     doc["wifi_static_ip_enabled"] = wifiStaticIpEnabled_;
     doc["wifi_static_ip"] = wifiStaticIp_;
     doc["wifi_static_gateway"] = wifiStaticGateway_;
     doc["wifi_static_netmask"] = wifiStaticSubnet_;
     doc["wifi_static_dns1"] = wifiStaticDns1_;
     doc["wifi_static_dns2"] = wifiStaticDns2_;
+    doc["payload_format"] = payloadFormatName(payloadFormat_);
+    doc["upload_queue_policy"] = uploadQueuePolicyName(uploadQueuePolicy_);
+    doc["influx_precision"] = influxPrecisionName(influxPrecision_);
+    doc["payload_gzip"] = payloadGzip_;
+    doc["payload_stats"] = payloadStats_;
+    doc["deadband_temp_c"] = deadbandTempC_;
+    doc["deadband_humidity_pct"] = deadbandHumidityPct_;
+    doc["max_silence_sec"] = maxSilenceSeconds_;
+    doc["read_cache_max_age_ms"] = readCacheMaxAgeMs_;
+    filterToJson(filter_, doc["filter"].template to<JsonObject>());
     doc["log_level"] = StructuredLog::levelName(logLevel_);
+    JsonArray sinks = doc["sinks"].template to<JsonArray>();
+    for (size_t i = 0; i < extraSinkCount_; ++i)
+      sinkToJson(extraSinks_[i], sinks.template add<JsonObject>());
     doc["persisted"] = hasPersistedConfig();
     xSemaphoreGive(mutex_);
   }
@@ -156,6 +235,19 @@ public:
         alignPostsToMinute_ = (doc["align_to_minute"].template as<int>() != 0);
     }
 
+    if (!doc["batch_max_readings"].isNull())
+    {
+      uint32_t tmp = doc["batch_max_readings"].template as<uint32_t>();
+      if (tmp == 0)
+        tmp = 1;
+      if (tmp > kMaxBatchReadings)
+        tmp = kMaxBatchReadings;
+      batchMaxReadings_ = static_cast<uint16_t>(tmp);
+    }
+
+    if (!doc["batch_max_age_sec"].isNull())
+      batchMaxAgeSeconds_ = doc["batch_max_age_sec"].template as<uint32_t>();
+
     if (!doc["wifi_static_ip_enabled"].isNull())
     {
       if (doc["wifi_static_ip_enabled"].template is<bool>())
@@ -179,6 +271,67 @@ public:
     if (doc["wifi_static_dns2"].template is<const char *>())
       wifiStaticDns2_ = doc["wifi_static_dns2"].template as<String>();
 
+    if (doc["payload_format"].template is<const char *>())
+    {
+      PayloadFormat parsed;
+      if (payloadFormatFromString(doc["payload_format"].template as<String>(), parsed))
+        payloadFormat_ = parsed;
+    }
+
+    if (doc["upload_queue_policy"].template is<const char *>())
+    {
+      UploadQueuePolicy parsed;
+      if (uploadQueuePolicyFromString(doc["upload_queue_policy"].template as<String>(), parsed))
+        uploadQueuePolicy_ = parsed;
+    }
+
+    if (doc["sinks"].template is<JsonArrayConst>())
+      sinksFromJson(doc["sinks"].template as<JsonArrayConst>());
+
+    if (doc["influx_precision"].template is<const char *>())
+    {
+      InfluxPrecision parsed;
+      if (influxPrecisionFromString(doc["influx_precision"].template as<String>(), parsed))
+        influxPrecision_ = parsed;
+    }
+
+    if (!doc["payload_gzip"].isNull())
+    {
+      if (doc["payload_gzip"].template is<bool>())
+        payloadGzip_ = doc["payload_gzip"].template as<bool>();
+      else
+        payloadGzip_ = (doc["payload_gzip"].template as<int>() != 0);
+    }
+
+    if (!doc["payload_stats"].isNull())
+    {
+      if (doc["payload_stats"].template is<bool>())
+        payloadStats_ = doc["payload_stats"].template as<bool>();
+      else
+        payloadStats_ = (doc["payload_stats"].template as<int>() != 0);
+    }
+
+    if (!doc["deadband_temp_c"].isNull())
+    {
+      float v = doc["deadband_temp_c"].template as<float>();
+      deadbandTempC_ = v > 0.0f ? v : 0.0f;
+    }
+
+    if (!doc["deadband_humidity_pct"].isNull())
+    {
+      float v = doc["deadband_humidity_pct"].template as<float>();
+      deadbandHumidityPct_ = v > 0.0f ? v : 0.0f;
+    }
+
+    if (!doc["max_silence_sec"].isNull())
+      maxSilenceSeconds_ = doc["max_silence_sec"].template as<uint32_t>();
+
+    if (!doc["read_cache_max_age_ms"].isNull())
+      readCacheMaxAgeMs_ = doc["read_cache_max_age_ms"].template as<uint32_t>();
+
+    if (doc["filter"].template is<JsonObjectConst>())
+      filterFromJson(doc["filter"].template as<JsonObjectConst>());
+
     if (doc["log_level"].template is<const char *>())
     {
       String levelText = doc["log_level"].template as<String>();
@@ -195,6 +348,7 @@ public:
       }
     }
 
+    generation_++;
     xSemaphoreGive(mutex_);
 
     if (logLevelChanged)
@@ -217,6 +371,12 @@ private:
 
   void loadDefaultsLocked();
   bool loadFromNvsLocked();
+  // Replaces the extra sink list; entries without a host are skipped.
+  void sinksFromJson(JsonArrayConst sinks);
+  static void sinkToJson(const SinkConfig &sink, JsonObject out);
+  // Updates the filter settings named in the object; others keep their value.
+  void filterFromJson(JsonObjectConst o);
+  static void filterToJson(const ReadingFilter::Settings &filter, JsonObject out);
 
   SemaphoreHandle_t mutex_;
 
@@ -237,11 +397,26 @@ private:
   bool httpsInsecure_;
   uint32_t postIntervalSeconds_;
   bool alignPostsToMinute_;
+  uint16_t batchMaxReadings_;
+  uint32_t batchMaxAgeSeconds_;
   bool wifiStaticIpEnabled_;
   String wifiStaticIp_;
   String wifiStaticGateway_;
   String wifiStaticSubnet_;
   String wifiStaticDns1_;
   String wifiStaticDns2_;
+  PayloadFormat payloadFormat_;
+  UploadQueuePolicy uploadQueuePolicy_;
+  SinkConfig extraSinks_[kMaxExtraSinks];
+  size_t extraSinkCount_;
+  InfluxPrecision influxPrecision_;
+  bool payloadGzip_;
+  bool payloadStats_;
+  float deadbandTempC_;
+  float deadbandHumidityPct_;
+  uint32_t maxSilenceSeconds_;
+  uint32_t readCacheMaxAgeMs_;
+  ReadingFilter::Settings filter_;
   StructuredLog::Level logLevel_;
+  uint32_t generation_;
 };
@@ -0,0 +1,231 @@
+#include "BinaryWriters.h"
+
+#include <math.h>
+#include <string.h>
+
+namespace
+{
+  uint32_t floatBits(float v)
+  {
+    uint32_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    return bits;
+  }
+}
+
+// ---------------------------------------------------------------- CBOR
+
+void CborWriter::head(uint8_t major, uint32_t v)
+{
+  const uint8_t m = static_cast<uint8_t>(major << 5);
+  if (v < 24)
+  {
+    put(m | static_cast<uint8_t>(v));
+  }
+  else if (v <= 0xFF)
+  {
+    put(m | 24);
+    put(static_cast<uint8_t>(v));
+  }
+  else if (v <= 0xFFFF)
+  {
+    put(m | 25);
+    put(static_cast<uint8_t>(v >> 8));
+    put(static_cast<uint8_t>(v));
+  }
+  else
+  {
+    put(m | 26);
+    put(static_cast<uint8_t>(v >> 24));
+    put(static_cast<uint8_t>(v >> 16));
+    put(static_cast<uint8_t>(v >> 8));
+    put(static_cast<uint8_t>(v));
+  }
+}
+
+void CborWriter::beginObject(size_t fields)
+{
+  head(5, static_cast<uint32_t>(fields));
+}
+
+void CborWriter::beginArray(size_t items)
+{
+  head(4, static_cast<uint32_t>(items));
+}
+
+void CborWriter::value(const char *s)
+{
+  const size_t n = s ? strlen(s) : 0;
+  head(3, static_cast<uint32_t>(n));
+  putRaw(s, n);
+}
+
+void CborWriter::value(float v, uint8_t)
+{
+  if (isnan(v) || isinf(v))
+  {
+    null();
+    return;
+  }
+  const uint32_t bits = floatBits(v);
+  put(0xFA);
+  put(static_cast<uint8_t>(bits >> 24));
+  put(static_cast<uint8_t>(bits >> 16));
+  put(static_cast<uint8_t>(bits >> 8));
+  put(static_cast<uint8_t>(bits));
+}
+
+void CborWriter::value(uint32_t v)
+{
+  head(0, v);
+}
+
+void CborWriter::value(int32_t v)
+{
+  if (v < 0)
+    head(1, static_cast<uint32_t>(-1 - static_cast<int64_t>(v)));
+  else
+    head(0, static_cast<uint32_t>(v));
+}
+
+void CborWriter::value(bool b)
+{
+  put(b ? 0xF5 : 0xF4);
+}
+
+void CborWriter::null()
+{
+  put(0xF6);
+}
+
+// ---------------------------------------------------------- MessagePack
+
+void MsgPackWriter::putBE(uint32_t v, uint8_t bytes)
+{
+  while (bytes--)
+    put(static_cast<uint8_t>(v >> (bytes * 8)));
+}
+
+void MsgPackWriter::container(uint8_t fixBase, uint8_t fixLimit, uint8_t tag16, size_t n)
+{
+  if (n < fixLimit)
+  {
+    put(fixBase | static_cast<uint8_t>(n));
+  }
+  else if (n <= 0xFFFF)
+  {
+    put(tag16);
+    putBE(static_cast<uint32_t>(n), 2);
+  }
+  else
+  {
+    put(tag16 + 1);
+    putBE(static_cast<uint32_t>(n), 4);
+  }
+}
+
+void MsgPackWriter::beginObject(size_t fields)
+{
+  container(0x80, 16, 0xDE, fields);
+}
+
+void MsgPackWriter::beginArray(size_t items)
+{
+  container(0x90, 16, 0xDC, items);
+}
+
+void MsgPackWriter::value(const char *s)
+{
+  const size_t n = s ? strlen(s) : 0;
+  if (n < 32)
+  {
+    put(0xA0 | static_cast<uint8_t>(n));
+  }
+  else if (n <= 0xFF)
+  {
+    put(0xD9);
+    put(static_cast<uint8_t>(n));
+  }
+  else if (n <= 0xFFFF)
+  {
+    put(0xDA);
+    putBE(static_cast<uint32_t>(n), 2);
+  }
+  else
+  {
+    put(0xDB);
+    putBE(static_cast<uint32_t>(n), 4);
+  }
+  putRaw(s, n);
+}
+
+void MsgPackWriter::value(float v, uint8_t)
+{
+  if (isnan(v) || isinf(v))
+  {
+    null();
+    return;
+  }
+  put(0xCA);
+  putBE(floatBits(v), 4);
+}
+
+void MsgPackWriter::value(uint32_t v)
+{
+  if (v < 0x80)
+  {
+    put(static_cast<uint8_t>(v));
+  }
+  else if (v <= 0xFF)
+  {
+    put(0xCC);
+    put(static_cast<uint8_t>(v));
+  }
+  else if (v <= 0xFFFF)
+  {
+    put(0xCD);
+    putBE(v, 2);
+  }
+  else
+  {
+    put(0xCE);
+    putBE(v, 4);
+  }
+}
+
+void MsgPackWriter::value(int32_t v)
+{
+  if (v >= 0)
+  {
+    value(static_cast<uint32_t>(v));
+  }
+  else if (v >= -32)
+  {
+    put(static_cast<uint8_t>(v));
+  }
+  else if (v >= -128)
+  {
+    put(0xD0);
+    put(static_cast<uint8_t>(v));
+  }
+  else if (v >= -32768)
+  {
+    put(0xD1);
+    putBE(static_cast<uint16_t>(v), 2);
+  }
+  else
+  {
+    put(0xD2);
+    putBE(static_cast<uint32_t>(v), 4);
+  }
+}
+
+void MsgPackWriter::value(bool b)
+{
+  put(b ? 0xC3 : 0xC2);
+}
+
+void MsgPackWriter::null()
+{
+  put(0xC0);
+}
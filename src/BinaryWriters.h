@@ -0,0 +1,54 @@
+#pragma once
+
+#include "PayloadWriter.h"
+
+// CBOR (RFC 8949) encoder: definite-length maps/arrays, text strings,
+// shortest-form integers and float32 for measurements.
+class CborWriter : public PayloadWriter
+{
+public:
+  explicit CborWriter(Print &out) : PayloadWriter(out) {}
+
+  using PayloadWriter::value;
+
+  void beginObject(size_t fields) override;
+  void endObject() override {}
+  void beginArray(size_t items) override;
+  void endArray() override {}
+  void key(const char *name) override { value(name); }
+  void value(const char *s) override;
+  void value(float v, uint8_t decimals) override;
+  void value(uint32_t v) override;
+  void value(int32_t v) override;
+  void value(bool b) override;
+  void null() override;
+
+private:
+  void head(uint8_t major, uint32_t v);
+};
+
+// MessagePack encoder: fix/16/32 maps and arrays, str8/16/32, smallest
+// integer form and float32 for measurements.
+class MsgPackWriter : public PayloadWriter
+{
+public:
+  explicit MsgPackWriter(Print &out) : PayloadWriter(out) {}
+
+  using PayloadWriter::value;
+
+  void beginObject(size_t fields) override;
+  void endObject() override {}
+  void beginArray(size_t items) override;
+  void endArray() override {}
+  void key(const char *name) override { value(name); }
+  void value(const char *s) override;
+  void value(float v, uint8_t decimals) override;
+  void value(uint32_t v) override;
+  void value(int32_t v) override;
+  void value(bool b) override;
+  void null() override;
+
+private:
+  void putBE(uint32_t v, uint8_t bytes);
+  void container(uint8_t fixBase, uint8_t fixLimit, uint8_t tag16, size_t n);
+};
@@ -0,0 +1,158 @@
+#include "Bme280Driver.h"
+
+#include <math.h>
+
+namespace
+{
+  constexpr uint8_t kRegCalibT = 0x88;
+  constexpr uint8_t kRegCalibH1 = 0xA1;
+  constexpr uint8_t kRegChipId = 0xD0;
+  constexpr uint8_t kRegReset = 0xE0;
+  constexpr uint8_t kRegCalibH2 = 0xE1;
+  constexpr uint8_t kRegCtrlHum = 0xF2;
+  constexpr uint8_t kRegStatus = 0xF3;
+  constexpr uint8_t kRegCtrlMeas = 0xF4;
+  constexpr uint8_t kRegConfig = 0xF5;
+  constexpr uint8_t kRegTempMsb = 0xFA;
+
+  constexpr uint8_t kChipIdBme280 = 0x60;
+  constexpr uint8_t kResetWord = 0xB6;
+  constexpr uint8_t kStatusMeasuring = 0x08;
+  constexpr uint8_t kStatusImUpdate = 0x01;
+  // osrs_t = 1x, osrs_p = skipped; mode bits: 00 sleep, 01 forced.
+  constexpr uint8_t kCtrlMeasSleep = 0x20;
+  constexpr uint8_t kCtrlMeasForced = 0x21;
+  constexpr uint8_t kCtrlHum1x = 0x01;
+
+  // Typical conversion is 1 + 2 + 2.5 ms; allow for the maximum and a few
+  // status polls beyond it.
+  constexpr uint32_t kMeasureMs = 7;
+  constexpr int kStatusPolls = 10;
+  // A skipped or not yet written channel reads back as this.
+  constexpr int32_t kTempSkipped = 0x80000;
+  constexpr int32_t kHumSkipped = 0x8000;
+}
+
+Bme280Driver::Bme280Driver(TwoWire &wire, uint8_t address) : wire_(wire), address_(address), ready_(false), cal_()
+{
+}
+
+bool Bme280Driver::writeRegister(uint8_t reg, uint8_t value)
+{
+  wire_.beginTransmission(address_);
+  wire_.write(reg);
+  wire_.write(value);
+  return wire_.endTransmission() == 0;
+}
+
+bool Bme280Driver::readRegisters(uint8_t reg, uint8_t *out, uint8_t len)
+{
+  wire_.beginTransmission(address_);
+  wire_.write(reg);
+  if (wire_.endTransmission(false) != 0)
+    return false;
+  if (wire_.requestFrom(address_, len) != len)
+    return false;
+  for (uint8_t i = 0; i < len; ++i)
+    out[i] = static_cast<uint8_t>(wire_.read());
+  return true;
+}
+
+bool Bme280Driver::begin()
+{
+  ready_ = false;
+  uint8_t id = 0;
+  if (!readRegisters(kRegChipId, &id, 1) || id != kChipIdBme280)
+    return false;
+  if (!writeRegister(kRegReset, kResetWord))
+    return false;
+  delay(3);
+  uint8_t status = kStatusImUpdate;
+  for (int i = 0; i < kStatusPolls && (status & kStatusImUpdate); ++i)
+  {
+    delay(1);
+    if (!readRegisters(kRegStatus, &status, 1))
+      return false;
+  }
+
+  uint8_t t[6];
+  uint8_t h[7];
+  if (!readRegisters(kRegCalibT, t, sizeof(t)) || !readRegisters(kRegCalibH1, &cal_.h1, 1) ||
+      !readRegisters(kRegCalibH2, h, sizeof(h)))
+    return false;
+  cal_.t1 = static_cast<uint16_t>(t[0] | (t[1] << 8));
+  cal_.t2 = static_cast<int16_t>(t[2] | (t[3] << 8));
+  cal_.t3 = static_cast<int16_t>(t[4] | (t[5] << 8));
+  cal_.h2 = static_cast<int16_t>(h[0] | (h[1] << 8));
+  cal_.h3 = h[2];
+  // H4 and H5 are signed 12-bit values sharing the nibbles of 0xE5.
+  cal_.h4 = static_cast<int16_t>(static_cast<int16_t>(static_cast<int8_t>(h[3])) * 16 | (h[4] & 0x0F));
+  cal_.h5 = static_cast<int16_t>(static_cast<int16_t>(static_cast<int8_t>(h[5])) * 16 | (h[4] >> 4));
+  cal_.h6 = static_cast<int8_t>(h[6]);
+
+  // ctrl_hum only takes effect after the following ctrl_meas write.
+  ready_ = writeRegister(kRegCtrlHum, kCtrlHum1x) && writeRegister(kRegConfig, 0x00) &&
+           writeRegister(kRegCtrlMeas, kCtrlMeasSleep);
+  return ready_;
+}
+
+int32_t Bme280Driver::compensateTemperature(int32_t adc, int32_t &tFine) const
+{
+  const int32_t t1 = cal_.t1;
+  int32_t var1 = ((((adc >> 3) - (t1 << 1))) * static_cast<int32_t>(cal_.t2)) >> 11;
+  int32_t var2 = (((((adc >> 4) - t1) * ((adc >> 4) - t1)) >> 12) * static_cast<int32_t>(cal_.t3)) >> 14;
+  tFine = var1 + var2;
+  return (tFine * 5 + 128) >> 8; // 0.01 °C
+}
+
+uint32_t Bme280Driver::compensateHumidity(int32_t adc, int32_t tFine) const
+{
+  int32_t v = tFine - 76800;
+  v = (((((adc << 14) - (static_cast<int32_t>(cal_.h4) << 20) - (static_cast<int32_t>(cal_.h5) * v)) + 16384) >> 15) *
+       (((((((v * static_cast<int32_t>(cal_.h6)) >> 10) * (((v * static_cast<int32_t>(cal_.h3)) >> 11) + 32768)) >> 10) +
+          2097152) *
+             static_cast<int32_t>(cal_.h2) +
+         8192) >>
+        14));
+  v = v - (((((v >> 15) * (v >> 15)) >> 7) * static_cast<int32_t>(cal_.h1)) >> 4);
+  if (v < 0)
+    v = 0;
+  if (v > 419430400)
+    v = 419430400;
+  return static_cast<uint32_t>(v >> 12); // Q22.10 %RH
+}
+
+bool Bme280Driver::read(float &temperatureC, float &humidityPct)
+{
+  temperatureC = NAN;
+  humidityPct = NAN;
+  if (!ready_ || !writeRegister(kRegCtrlMeas, kCtrlMeasForced))
+    return false;
+  delay(kMeasureMs);
+  uint8_t status = kStatusMeasuring;
+  for (int i = 0; i < kStatusPolls && (status & kStatusMeasuring); ++i)
+  {
+    if (!readRegisters(kRegStatus, &status, 1))
+      return false;
+    if (status & kStatusMeasuring)
+      delay(1);
+  }
+  if (status & kStatusMeasuring)
+    return false;
+
+  // Temperature (0xFA..0xFC) and humidity (0xFD..0xFE) in one burst so
+  // both come from the same conversion.
+  uint8_t d[5];
+  if (!readRegisters(kRegTempMsb, d, sizeof(d)))
+    return false;
+  const int32_t adcT = (static_cast<int32_t>(d[0]) << 12) | (static_cast<int32_t>(d[1]) << 4) | (d[2] >> 4);
+  const int32_t adcH = (static_cast<int32_t>(d[3]) << 8) | d[4];
+  if (adcT == kTempSkipped)
+    return false;
+
+  int32_t tFine = 0;
+  temperatureC = static_cast<float>(compensateTemperature(adcT, tFine)) / 100.0f;
+  if (adcH != kHumSkipped)
+    humidityPct = static_cast<float>(compensateHumidity(adcH, tFine)) / 1024.0f;
+  return !isnan(humidityPct);
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <Wire.h>
+
+#include "SensorDriver.h"
+
+// Bosch BME280 over I2C in forced mode: every read triggers one
+// conversion (temperature and humidity at 1x oversampling, pressure
+// skipped, ~7 ms) and the sensor sleeps in between. Compensation uses the
+// datasheet's integer formulas with the chip's trimming parameters, read
+// once in begin(). A BMP280 (no humidity) is refused.
+class Bme280Driver : public SensorDriver
+{
+public:
+  static constexpr uint8_t kDefaultAddress = 0x76; // SDO low; 0x77 when high
+
+  explicit Bme280Driver(TwoWire &wire, uint8_t address = kDefaultAddress);
+
+  const char *name() const override { return "BME280"; }
+  bool begin() override;
+  bool read(float &temperatureC, float &humidityPct) override;
+
+private:
+  struct Calibration
+  {
+    uint16_t t1;
+    int16_t t2, t3;
+    uint8_t h1;
+    int16_t h2;
+    uint8_t h3;
+    int16_t h4, h5;
+    int8_t h6;
+  };
+
+  bool writeRegister(uint8_t reg, uint8_t value);
+  bool readRegisters(uint8_t reg, uint8_t *out, uint8_t len);
+  int32_t compensateTemperature(int32_t adc, int32_t &tFine) const;
+  uint32_t compensateHumidity(int32_t adc, int32_t tFine) const;
+
+  TwoWire &wire_;
+  uint8_t address_;
+  bool ready_;
+  Calibration cal_;
+};
@@ -0,0 +1,73 @@
+#include "CircuitBreaker.h"
+
+CircuitBreaker::CircuitBreaker(uint8_t failureThreshold, uint32_t baseOpenMs, uint32_t maxOpenMs)
+    : threshold_(failureThreshold ? failureThreshold : 1), baseOpenMs_(baseOpenMs), maxOpenMs_(maxOpenMs),
+      state_(State::Closed), failures_(0), openMs_(0), openUntilMs_(0), trips_(0), probes_(0)
+{
+}
+
+bool CircuitBreaker::allow(uint32_t nowMs)
+{
+  if (state_ == State::Open && static_cast<int32_t>(nowMs - openUntilMs_) >= 0)
+  {
+    state_ = State::HalfOpen;
+    ++probes_;
+  }
+  return state_ != State::Open;
+}
+
+void CircuitBreaker::onSuccess()
+{
+  state_ = State::Closed;
+  failures_ = 0;
+  openMs_ = 0;
+}
+
+void CircuitBreaker::onFailure(uint32_t nowMs, uint32_t random)
+{
+  if (failures_ < 0xFF)
+    ++failures_;
+
+  if (state_ == State::HalfOpen)
+  {
+    // Probe failed: back off further.
+    openMs_ = (openMs_ >= maxOpenMs_ / 2) ? maxOpenMs_ : openMs_ * 2;
+    open(nowMs, random);
+  }
+  else if (state_ == State::Closed && failures_ >= threshold_)
+  {
+    openMs_ = baseOpenMs_;
+    ++trips_;
+    open(nowMs, random);
+  }
+}
+
+void CircuitBreaker::open(uint32_t nowMs, uint32_t random)
+{
+  // Up to +25 % jitter.
+  const uint32_t jitter = random % (openMs_ / 4 + 1);
+  openUntilMs_ = nowMs + openMs_ + jitter;
+  state_ = State::Open;
+}
+
+uint32_t CircuitBreaker::retryInMs(uint32_t nowMs) const
+{
+  if (state_ != State::Open)
+    return 0;
+  const int32_t left = static_cast<int32_t>(openUntilMs_ - nowMs);
+  return left > 0 ? static_cast<uint32_t>(left) : 0;
+}
+
+const char *CircuitBreaker::stateName(State state)
+{
+  switch (state)
+  {
+  case State::Open:
+    return "open";
+  case State::HalfOpen:
+    return "half_open";
+  case State::Closed:
+  default:
+    return "closed";
+  }
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stdint.h>
+
+// Closed / open / half-open circuit breaker for the upstream.
+//
+// Closed: requests flow; consecutive failures are counted. Reaching the
+// threshold opens the circuit. Open: requests are refused without touching
+// the network until the cool-down expires. HalfOpen: the next request is a
+// probe; success closes the circuit, failure reopens it with the cool-down
+// doubled (up to maxOpenMs) plus jitter so a fleet does not retry in step.
+//
+// Time comes from the caller (millis()) and so does the randomness for the
+// jitter, which keeps the class free of platform calls.
+class CircuitBreaker
+{
+public:
+  enum class State : uint8_t
+  {
+    Closed = 0,
+    Open = 1,
+    HalfOpen = 2
+  };
+
+  CircuitBreaker(uint8_t failureThreshold, uint32_t baseOpenMs, uint32_t maxOpenMs);
+
+  // True if a request may go out now; moves Open to HalfOpen once the
+  // cool-down has passed. Has no other side effects, so it can gate a
+  // request and be asked again right before sending it.
+  bool allow(uint32_t nowMs);
+  void onSuccess();
+  // random is any uniformly distributed value (e.g. esp_random()).
+  void onFailure(uint32_t nowMs, uint32_t random);
+
+  State state() const { return state_; }
+  uint8_t consecutiveFailures() const { return failures_; }
+  // Milliseconds until an Open circuit admits a probe; 0 otherwise.
+  uint32_t retryInMs(uint32_t nowMs) const;
+  uint32_t trips() const { return trips_; }
+  uint32_t probes() const { return probes_; }
+
+  static const char *stateName(State state);
+
+private:
+  void open(uint32_t nowMs, uint32_t random);
+
+  const uint8_t threshold_;
+  const uint32_t baseOpenMs_;
+  const uint32_t maxOpenMs_;
+
+  State state_;
+  uint8_t failures_;
+  uint32_t openMs_;
+  uint32_t openUntilMs_;
+  uint32_t trips_;
+  uint32_t probes_;
+};
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// CRC-32 (IEEE 802.3, reflected, poly 0xEDB88320) using a 16-entry nibble
+// table: small enough for flash-constrained builds, fast enough for the
+// short records it protects. Compatible with zlib's crc32().
+namespace Crc32
+{
+    inline uint32_t update(uint32_t crc, const void *data, size_t len)
+    {
+        static const uint32_t kTable[16] = {
+            0x00000000UL, 0x1DB71064UL, 0x3B6E20C8UL, 0x26D930ACUL,
+            0x76DC4190UL, 0x6B6B51F4UL, 0x4DB26158UL, 0x5005713CUL,
+            0xEDB88320UL, 0xF00F9344UL, 0xD6D6A3E8UL, 0xCB61B38CUL,
+            0x9B64C2B0UL, 0x86D3D2D4UL, 0xA00AE278UL, 0xBDBDF21CUL};
+        const uint8_t *p = static_cast<const uint8_t *>(data);
+        crc = ~crc;
+        while (len--)
+        {
+            crc ^= *p++;
+            crc = (crc >> 4) ^ kTable[crc & 0x0F];
+            crc = (crc >> 4) ^ kTable[crc & 0x0F];
+        }
+        return ~crc;
+    }
+
+    inline uint32_t compute(const void *data, size_t len)
+    {
+        return update(0, data, len);
+    }
+}
@@ -0,0 +1,37 @@
+#include "Deadband.h"
+
+#include <math.h>
+
+Deadband::Deadband() : haveLast_(false), lastTempC_(NAN), lastHumidityPct_(NAN), lastReportMs_(0)
+{
+}
+
+bool Deadband::moved(float last, float now, float band)
+{
+  const bool lastValid = !isnan(last);
+  const bool nowValid = !isnan(now);
+  if (lastValid != nowValid)
+    return true;
+  if (!nowValid || band <= 0.0f)
+    return false;
+  return fabsf(now - last) >= band;
+}
+
+bool Deadband::shouldReport(float temperatureC, float humidityPct, uint32_t nowMs, float tempBand, float humidityBand,
+                            uint32_t maxSilenceMs)
+{
+  bool report = !haveLast_ || (tempBand <= 0.0f && humidityBand <= 0.0f);
+  if (!report)
+  {
+    report = moved(lastTempC_, temperatureC, tempBand) || moved(lastHumidityPct_, humidityPct, humidityBand) ||
+             (maxSilenceMs > 0 && nowMs - lastReportMs_ >= maxSilenceMs);
+  }
+  if (report)
+  {
+    haveLast_ = true;
+    lastTempC_ = temperatureC;
+    lastHumidityPct_ = humidityPct;
+    lastReportMs_ = nowMs;
+  }
+  return report;
+}
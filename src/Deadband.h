@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stdint.h>
+
+// Report-by-exception filter for readings. A reading is reported when it is
+// the first one, when temperature or humidity has moved by at least its
+// deadband since the last *reported* reading (so slow drifts still get
+// through), when a value appears or disappears (NaN), or when nothing has
+// been reported for maxSilenceMs (heartbeat). A deadband of 0 disables that
+// channel's check; with both at 0 every reading is reported.
+//
+// Time comes from the caller (millis()), keeping the class free of platform
+// calls.
+class Deadband
+{
+public:
+  Deadband();
+
+  // Decides for one sample and, when it is to be reported, remembers it as
+  // the new reference. maxSilenceMs 0 = no heartbeat.
+  bool shouldReport(float temperatureC, float humidityPct, uint32_t nowMs, float tempBand, float humidityBand,
+                    uint32_t maxSilenceMs);
+
+  // Forget the reference so the next sample is reported.
+  void reset() { haveLast_ = false; }
+
+private:
+  static bool moved(float last, float now, float band);
+
+  bool haveLast_;
+  float lastTempC_;
+  float lastHumidityPct_;
+  uint32_t lastReportMs_;
+};
@@ -0,0 +1,30 @@
+#include "DhtDriver.h"
+
+#include <Adafruit_Sensor.h>
+
+DhtDriver::DhtDriver(uint8_t pin, uint8_t type) : dht_(pin, type)
+{
+}
+
+bool DhtDriver::begin()
+{
+  dht_.begin();
+  return true;
+}
+
+bool DhtDriver::read(float &temperatureC, float &humidityPct)
+{
+  sensors_event_t event;
+  temperatureC = NAN;
+  humidityPct = NAN;
+
+  dht_.temperature().getEvent(&event);
+  if (!isnan(event.temperature))
+    temperatureC = event.temperature;
+
+  dht_.humidity().getEvent(&event);
+  if (!isnan(event.relative_humidity))
+    humidityPct = event.relative_humidity;
+
+  return !isnan(temperatureC) && !isnan(humidityPct);
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <DHT_U.h>
+
+#include "SensorDriver.h"
+
+// DHT11/DHT22 through the Adafruit Unified Sensor library. The single-wire
+// protocol is bit-banged with interrupts off for ~5 ms per read, and the
+// library returns its cached value when asked again within 2 s.
+class DhtDriver : public SensorDriver
+{
+public:
+  DhtDriver(uint8_t pin, uint8_t type);
+
+  const char *name() const override { return "DHT"; }
+  bool begin() override;
+  bool read(float &temperatureC, float &humidityPct) override;
+  // DHT22 datasheet: at most one conversion every 2 s.
+  uint32_t minIntervalMs() const override { return 2000; }
+
+private:
+  DHT_Unified dht_;
+};
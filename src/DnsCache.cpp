@@ -0,0 +1,239 @@
+#include "DnsCache.h"
+
+#include <WiFi.h>
+#include <string.h>
+
+#include "config.h"
+#include "StructuredLog.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#ifndef DNS_CACHE_TTL_SECONDS
+#define DNS_CACHE_TTL_SECONDS 300
+#endif
+
+namespace
+{
+    // Primary + extra sinks, with one spare.
+    constexpr size_t kMaxEntries = 4;
+    constexpr size_t kMaxHostLen = 64;
+    constexpr uint32_t kTtlMs = DNS_CACHE_TTL_SECONDS * 1000UL;
+    // Background refresh starts this long before expiry.
+    constexpr uint32_t kRefreshWindowMs = kTtlMs / 5;
+    // A failed lookup (refresh or resolve) is retried after this long, not
+    // on every service() or post.
+    constexpr uint32_t kRefreshRetryMs = 30000;
+
+    struct Entry
+    {
+        char host[kMaxHostLen];
+        uint32_t address;
+        uint32_t resolvedMs;
+        // Last lookup (successful or not).
+        uint32_t attemptMs;
+        // The last lookup failed; resolve() serves the old address until
+        // kRefreshRetryMs after it.
+        bool lookupFailed;
+        bool used;
+        bool expired;
+    };
+
+    Entry gEntries[kMaxEntries];
+    DnsCache::Stats gStats = {};
+
+    // Created by init() before any task can use the cache.
+    SemaphoreHandle_t gMutex = nullptr;
+
+    void lock()
+    {
+        xSemaphoreTake(gMutex, portMAX_DELAY);
+    }
+
+    void unlock()
+    {
+        xSemaphoreGive(gMutex);
+    }
+
+    Entry *find(const char *host)
+    {
+        for (Entry &e : gEntries)
+        {
+            if (e.used && strcmp(e.host, host) == 0)
+                return &e;
+        }
+        return nullptr;
+    }
+
+    uint32_t ageMs(const Entry &e)
+    {
+        return millis() - e.resolvedMs;
+    }
+
+    bool fresh(const Entry &e)
+    {
+        return !e.expired && ageMs(e) < kTtlMs;
+    }
+
+    // Stores a lookup result, evicting the least recently resolved entry.
+    void store(const char *host, uint32_t address)
+    {
+        Entry *e = find(host);
+        if (!e)
+        {
+            e = &gEntries[0];
+            for (Entry &candidate : gEntries)
+            {
+                if (!candidate.used)
+                {
+                    e = &candidate;
+                    break;
+                }
+                if (ageMs(candidate) > ageMs(*e))
+                    e = &candidate;
+            }
+            strncpy(e->host, host, sizeof(e->host) - 1);
+            e->host[sizeof(e->host) - 1] = '\0';
+            e->used = true;
+        }
+        e->address = address;
+        e->resolvedMs = millis();
+        e->attemptMs = e->resolvedMs;
+        e->lookupFailed = false;
+        e->expired = false;
+    }
+
+    // Blocking lookup, done without holding the cache lock.
+    bool lookup(const String &host, uint32_t &address)
+    {
+        IPAddress ip;
+        if (!WiFi.hostByName(host.c_str(), ip) || static_cast<uint32_t>(ip) == 0)
+            return false;
+        address = static_cast<uint32_t>(ip);
+        return true;
+    }
+}
+
+void DnsCache::init()
+{
+    if (!gMutex)
+        gMutex = xSemaphoreCreateMutex();
+}
+
+bool DnsCache::resolve(const String &host, IPAddress &out)
+{
+    // Literal addresses need no lookup and are not cached.
+    if (out.fromString(host))
+        return true;
+    if (host.length() >= kMaxHostLen)
+        return WiFi.hostByName(host.c_str(), out) == 1;
+
+    lock();
+    Entry *e = find(host.c_str());
+    if (e && fresh(*e))
+    {
+        out = IPAddress(e->address);
+        gStats.hits++;
+        unlock();
+        return true;
+    }
+    if (e && e->lookupFailed && millis() - e->attemptMs < kRefreshRetryMs)
+    {
+        // The resolver failed moments ago; do not block the caller on it
+        // again before the retry time.
+        out = IPAddress(e->address);
+        gStats.staleServes++;
+        unlock();
+        return true;
+    }
+    gStats.misses++;
+    if (e)
+        e->attemptMs = millis();
+    unlock();
+
+    uint32_t address = 0;
+    const bool ok = lookup(host, address);
+
+    lock();
+    if (ok)
+    {
+        store(host.c_str(), address);
+        out = IPAddress(address);
+    }
+    else
+    {
+        gStats.failures++;
+        e = find(host.c_str());
+        if (e)
+        {
+            e->lookupFailed = true;
+            out = IPAddress(e->address);
+            gStats.staleServes++;
+        }
+    }
+    const bool served = ok || e != nullptr;
+    unlock();
+
+    if (!ok && served)
+        LOGF_WARN("DNS lookup for %s failed; using last known address for %u s", host.c_str(),
+                  static_cast<unsigned>(kRefreshRetryMs / 1000));
+    return served;
+}
+
+void DnsCache::refresh(const String &host)
+{
+    if (host.length() == 0 || host.length() >= kMaxHostLen)
+        return;
+
+    lock();
+    Entry *e = find(host.c_str());
+    const bool due = e && !e->expired && ageMs(*e) >= kTtlMs - kRefreshWindowMs && millis() - e->attemptMs >= kRefreshRetryMs;
+    if (due)
+        e->attemptMs = millis();
+    unlock();
+    if (!due)
+        return;
+
+    uint32_t address = 0;
+    const bool ok = lookup(host, address);
+
+    lock();
+    if (ok)
+    {
+        store(host.c_str(), address);
+        gStats.refreshes++;
+    }
+    else
+    {
+        gStats.failures++;
+        e = find(host.c_str());
+        if (e)
+            e->lookupFailed = true;
+    }
+    unlock();
+    if (!ok)
+        LOGF_DEBUG("DNS refresh for %s failed; retrying in %u s", host.c_str(), static_cast<unsigned>(kRefreshRetryMs / 1000));
+}
+
+void DnsCache::expire(const String &host)
+{
+    lock();
+    Entry *e = find(host.c_str());
+    if (e)
+        e->expired = true;
+    unlock();
+}
+
+DnsCache::Stats DnsCache::stats()
+{
+    lock();
+    Stats s = gStats;
+    s.entries = 0;
+    for (const Entry &e : gEntries)
+    {
+        if (e.used)
+            s.entries++;
+    }
+    unlock();
+    return s;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Hostname -> IPv4 cache for upstream connections.
+//
+// The Arduino resolver does not expose record TTLs, so entries live for a
+// fixed DNS_CACHE_TTL_SECONDS (default 300). refresh() re-resolves an entry
+// during the last fifth of its lifetime, off the post path, and a failed
+// lookup falls back to the last good address ("stale serve") so a DNS outage
+// does not take the upstream with it. After a failed lookup, refresh or
+// resolve, the host is not looked up again for 30 s: resolve() serves the
+// last good address meanwhile instead of blocking every post on the
+// resolver timeout.
+namespace DnsCache
+{
+    struct Stats
+    {
+        uint32_t hits;
+        uint32_t misses;
+        uint32_t staleServes;
+        uint32_t refreshes;
+        uint32_t failures;
+        uint32_t entries;
+    };
+
+    // Creates the cache lock. Call once at startup, before the tasks start.
+    void init();
+
+    // Cached address if fresh, else a lookup; false only if the lookup failed
+    // and nothing was ever resolved for host.
+    bool resolve(const String &host, IPAddress &out);
+    // Re-resolves host if its entry is close to expiry. Call regularly from
+    // the task that posts to host.
+    void refresh(const String &host);
+    // Marks host's entry expired (e.g. the address refused connections); the
+    // old address is kept as a stale fallback.
+    void expire(const String &host);
+    Stats stats();
+}
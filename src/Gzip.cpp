@@ -0,0 +1,187 @@
+#include "Gzip.h"
+
+#include <string.h>
+
+#include "Crc32.h"
+
+namespace
+{
+    constexpr size_t kHashBits = 9;
+    constexpr size_t kHashSize = 1u << kHashBits;
+    constexpr size_t kMinMatch = 3;
+    constexpr size_t kMaxMatch = 258;
+    constexpr size_t kMaxDistance = 32768;
+
+    const uint16_t kLengthBase[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                      35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+    const uint8_t kLengthExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                      3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+    const uint16_t kDistBase[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129,
+                                    193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097,
+                                    6145, 8193, 12289, 16385, 24577};
+    const uint8_t kDistExtra[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6,
+                                    6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+    // LSB-first bit packer staging bytes for a Print.
+    class BitWriter
+    {
+    public:
+        explicit BitWriter(Print &out) : out_(out), bits_(0), count_(0), len_(0), total_(0), failed_(false) {}
+
+        void bits(uint32_t value, uint8_t n)
+        {
+            bits_ |= value << count_;
+            count_ += n;
+            while (count_ >= 8)
+            {
+                byte(static_cast<uint8_t>(bits_));
+                bits_ >>= 8;
+                count_ -= 8;
+            }
+        }
+
+        // Huffman codes are defined MSB first.
+        void code(uint32_t value, uint8_t n)
+        {
+            uint32_t reversed = 0;
+            for (uint8_t i = 0; i < n; ++i)
+                reversed |= ((value >> i) & 1u) << (n - 1 - i);
+            bits(reversed, n);
+        }
+
+        void alignToByte()
+        {
+            if (count_)
+                bits(0, 8 - count_);
+        }
+
+        void byte(uint8_t b)
+        {
+            if (len_ == sizeof(buf_))
+                flush();
+            buf_[len_++] = b;
+            ++total_;
+        }
+
+        void le32(uint32_t v)
+        {
+            for (int i = 0; i < 4; ++i)
+                byte(static_cast<uint8_t>(v >> (8 * i)));
+        }
+
+        void flush()
+        {
+            if (len_ && out_.write(buf_, len_) != len_)
+                failed_ = true;
+            len_ = 0;
+        }
+
+        size_t total() const { return total_; }
+        bool ok() const { return !failed_; }
+
+    private:
+        Print &out_;
+        uint32_t bits_;
+        uint8_t count_;
+        uint8_t buf_[64];
+        size_t len_;
+        size_t total_;
+        bool failed_;
+    };
+
+    // Fixed literal/length code (RFC 1951 3.2.6).
+    void symbol(BitWriter &w, uint16_t sym)
+    {
+        if (sym <= 143)
+            w.code(0x30 + sym, 8);
+        else if (sym <= 255)
+            w.code(0x190 + (sym - 144), 9);
+        else if (sym <= 279)
+            w.code(sym - 256, 7);
+        else
+            w.code(0xC0 + (sym - 280), 8);
+    }
+
+    void match(BitWriter &w, size_t length, size_t distance)
+    {
+        size_t i = 28;
+        while (kLengthBase[i] > length)
+            --i;
+        symbol(w, static_cast<uint16_t>(257 + i));
+        if (kLengthExtra[i])
+            w.bits(static_cast<uint32_t>(length - kLengthBase[i]), kLengthExtra[i]);
+
+        size_t d = 29;
+        while (kDistBase[d] > distance)
+            --d;
+        w.code(static_cast<uint32_t>(d), 5);
+        if (kDistExtra[d])
+            w.bits(static_cast<uint32_t>(distance - kDistBase[d]), kDistExtra[d]);
+    }
+
+    inline size_t hash3(const uint8_t *p)
+    {
+        const uint32_t v = (static_cast<uint32_t>(p[0]) << 16) | (static_cast<uint32_t>(p[1]) << 8) | p[2];
+        return (v * 2654435761u) >> (32 - kHashBits);
+    }
+}
+
+size_t Gzip::compress(const uint8_t *data, size_t len, Print &out)
+{
+    if (len > kMaxInput)
+        return 0;
+
+    BitWriter w(out);
+    // Header: magic, deflate, no flags, no mtime, no extra flags, OS unknown.
+    const uint8_t header[10] = {0x1F, 0x8B, 0x08, 0x00, 0, 0, 0, 0, 0x00, 0xFF};
+    for (uint8_t b : header)
+        w.byte(b);
+
+    // Single final block with fixed codes.
+    w.bits(1, 1);
+    w.bits(1, 2);
+
+    uint16_t head[kHashSize];
+    memset(head, 0, sizeof(head));
+    size_t i = 0;
+    while (i < len)
+    {
+        size_t best = 0;
+        size_t distance = 0;
+        if (i + kMinMatch <= len)
+        {
+            const size_t h = hash3(data + i);
+            const size_t candidate = head[h];
+            head[h] = static_cast<uint16_t>(i + 1);
+            if (candidate && i - (candidate - 1) <= kMaxDistance)
+            {
+                const size_t from = candidate - 1;
+                const size_t limit = (len - i) < kMaxMatch ? (len - i) : kMaxMatch;
+                while (best < limit && data[from + best] == data[i + best])
+                    ++best;
+                distance = i - from;
+            }
+        }
+
+        if (best >= kMinMatch)
+        {
+            match(w, best, distance);
+            // Index the covered positions so later data can refer to them.
+            for (size_t k = 1; k < best && i + k + kMinMatch <= len; ++k)
+                head[hash3(data + i + k)] = static_cast<uint16_t>(i + k + 1);
+            i += best;
+        }
+        else
+        {
+            symbol(w, data[i]);
+            ++i;
+        }
+    }
+    symbol(w, 256);
+    w.alignToByte();
+
+    w.le32(Crc32::compute(data, len));
+    w.le32(static_cast<uint32_t>(len));
+    w.flush();
+    return w.ok() ? w.total() : 0;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <Arduino.h>
+
+// One-shot gzip (RFC 1952) encoder for request bodies. Deflate uses greedy
+// LZ77 over the whole input with a single-candidate hash table and the
+// fixed Huffman code: no dynamic tables, no heap, about 1 KB of stack.
+// Upload payloads repeat the same keys/tags on every reading, so that is
+// enough to shrink them several-fold.
+//
+// The output depends only on the input, so a payload can be compressed once
+// into a ByteCounter for Content-Length and again into the socket.
+namespace Gzip
+{
+    // Longest input accepted (positions are 16 bit).
+    constexpr size_t kMaxInput = 65535;
+
+    // Writes the gzip stream for data to out. Returns the bytes written, or
+    // 0 if the input is too long or out refused data.
+    size_t compress(const uint8_t *data, size_t len, Print &out);
+}
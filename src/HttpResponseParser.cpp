@@ -0,0 +1,258 @@
+#include "HttpResponseParser.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+
+namespace
+{
+  // Retry-After beyond this is treated as a misconfiguration and clamped.
+  constexpr uint32_t kMaxRetryAfterSec = 3600;
+  constexpr time_t kMinValidEpoch = 1600000000;
+
+  bool headerIs(const char *line, const char *name)
+  {
+    size_t n = strlen(name);
+    return strncasecmp(line, name, n) == 0 && line[n] == ':';
+  }
+
+  const char *headerValue(const char *line)
+  {
+    const char *v = strchr(line, ':');
+    if (!v)
+      return "";
+    ++v;
+    while (*v == ' ' || *v == '\t')
+      ++v;
+    return v;
+  }
+
+  // Days since 1970-01-01 for a proleptic Gregorian date (H. Hinnant).
+  long daysFromCivil(int y, unsigned m, unsigned d)
+  {
+    y -= m <= 2;
+    const long era = (y >= 0 ? y : y - 399) / 400;
+    const unsigned yoe = static_cast<unsigned>(y - era * 400);
+    const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + static_cast<long>(doe) - 719468;
+  }
+
+  // Parses "Sun, 06 Nov 1994 08:49:37 GMT" (IMF-fixdate).
+  bool parseHttpDate(const char *v, time_t &out)
+  {
+    static const char kMonths[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+    const char *comma = strchr(v, ',');
+    if (!comma)
+      return false;
+    int day = 0, year = 0, hh = 0, mm = 0, ss = 0;
+    char mon[4] = {0};
+    if (sscanf(comma + 1, " %d %3s %d %d:%d:%d", &day, mon, &year, &hh, &mm, &ss) != 6)
+      return false;
+    const char *hit = strstr(kMonths, mon);
+    if (!hit || strlen(mon) != 3 || (hit - kMonths) % 3 != 0)
+      return false;
+    const unsigned month = static_cast<unsigned>((hit - kMonths) / 3 + 1);
+    out = static_cast<time_t>(daysFromCivil(year, month, static_cast<unsigned>(day)) * 86400L + hh * 3600L + mm * 60L + ss);
+    return true;
+  }
+
+  uint32_t parseRetryAfter(const char *v)
+  {
+    uint32_t sec = 0;
+    if (isdigit(static_cast<unsigned char>(*v)))
+    {
+      sec = static_cast<uint32_t>(strtoul(v, nullptr, 10));
+    }
+    else
+    {
+      time_t when;
+      const time_t now = time(nullptr);
+      if (now >= kMinValidEpoch && parseHttpDate(v, when) && when > now)
+        sec = static_cast<uint32_t>(when - now);
+    }
+    return sec > kMaxRetryAfterSec ? kMaxRetryAfterSec : sec;
+  }
+}
+
+void HttpResponseParser::reset()
+{
+  state_ = State::StatusLine;
+  lineLen_ = 0;
+  status_ = 0;
+  keepAlive_ = false;
+  chunked_ = false;
+  untilClose_ = false;
+  contentLength_ = -1;
+  remaining_ = 0;
+  retryAfterSec_ = 0;
+}
+
+bool HttpResponseParser::lineComplete(uint8_t c)
+{
+  if (c == '\n')
+  {
+    if (lineLen_ > 0 && line_[lineLen_ - 1] == '\r')
+      --lineLen_;
+    line_[lineLen_] = '\0';
+    return true;
+  }
+  // Overlong lines are truncated; only the leading part is ever inspected.
+  if (lineLen_ + 1 < kMaxLineBytes)
+    line_[lineLen_++] = static_cast<char>(c);
+  return false;
+}
+
+void HttpResponseParser::handleStatusLine()
+{
+  // "HTTP/1.1 200 OK"
+  const char *sp = strchr(line_, ' ');
+  if (strncmp(line_, "HTTP/1.", 7) != 0 || !sp)
+  {
+    state_ = State::Error;
+    return;
+  }
+  status_ = atoi(sp + 1);
+  if (status_ < 100 || status_ > 999)
+  {
+    state_ = State::Error;
+    return;
+  }
+  keepAlive_ = (line_[7] == '1');
+  state_ = State::Headers;
+}
+
+void HttpResponseParser::handleHeaderLine()
+{
+  if (headerIs(line_, "Content-Length"))
+  {
+    contentLength_ = atol(headerValue(line_));
+  }
+  else if (headerIs(line_, "Transfer-Encoding"))
+  {
+    chunked_ = (strcasestr(headerValue(line_), "chunked") != nullptr);
+  }
+  else if (headerIs(line_, "Connection"))
+  {
+    const char *v = headerValue(line_);
+    if (strcasestr(v, "close"))
+      keepAlive_ = false;
+    else if (strcasestr(v, "keep-alive"))
+      keepAlive_ = true;
+  }
+  else if (headerIs(line_, "Retry-After"))
+  {
+    retryAfterSec_ = parseRetryAfter(headerValue(line_));
+  }
+}
+
+void HttpResponseParser::finishHeaders()
+{
+  if (status_ < 200)
+  {
+    // Interim response (100 Continue etc.); the real one follows.
+    const bool keep = keepAlive_;
+    reset();
+    keepAlive_ = keep;
+    return;
+  }
+  if (status_ == 204 || status_ == 304)
+  {
+    state_ = State::Done;
+  }
+  else if (chunked_)
+  {
+    state_ = State::ChunkSize;
+  }
+  else if (contentLength_ >= 0)
+  {
+    remaining_ = static_cast<uint32_t>(contentLength_);
+    state_ = remaining_ ? State::Body : State::Done;
+  }
+  else
+  {
+    untilClose_ = true;
+    state_ = State::UntilClose;
+  }
+}
+
+bool HttpResponseParser::handleChunkSizeLine()
+{
+  char *end = nullptr;
+  unsigned long size = strtoul(line_, &end, 16);
+  if (end == line_)
+    return false;
+  remaining_ = static_cast<uint32_t>(size);
+  state_ = size ? State::ChunkData : State::Trailers;
+  return true;
+}
+
+size_t HttpResponseParser::feed(const uint8_t *data, size_t len)
+{
+  size_t i = 0;
+  while (i < len && state_ != State::Done && state_ != State::Error)
+  {
+    switch (state_)
+    {
+    case State::Body:
+    case State::ChunkData:
+    {
+      size_t take = len - i;
+      if (take > remaining_)
+        take = remaining_;
+      i += take;
+      remaining_ -= static_cast<uint32_t>(take);
+      if (remaining_ == 0)
+        state_ = (state_ == State::Body) ? State::Done : State::ChunkDataEnd;
+      break;
+    }
+    case State::UntilClose:
+      i = len;
+      break;
+    default:
+    {
+      if (!lineComplete(data[i++]))
+        break;
+      switch (state_)
+      {
+      case State::StatusLine:
+        handleStatusLine();
+        break;
+      case State::Headers:
+        if (line_[0] == '\0')
+          finishHeaders();
+        else
+          handleHeaderLine();
+        break;
+      case State::ChunkSize:
+        if (!handleChunkSizeLine())
+          state_ = State::Error;
+        break;
+      case State::ChunkDataEnd:
+        state_ = (line_[0] == '\0') ? State::ChunkSize : State::Error;
+        break;
+      case State::Trailers:
+        if (line_[0] == '\0')
+          state_ = State::Done;
+        break;
+      default:
+        break;
+      }
+      lineLen_ = 0;
+      break;
+    }
+    }
+  }
+  return i;
+}
+
+void HttpResponseParser::onClose()
+{
+  if (state_ == State::UntilClose)
+    state_ = State::Done;
+  else if (state_ != State::Done)
+    state_ = State::Error;
+}
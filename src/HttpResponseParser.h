@@ -0,0 +1,67 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Incremental HTTP/1.1 response parser. Bytes are fed as they arrive from
+// the socket in arbitrary slices; the parser tracks the status line, the
+// headers it cares about (Content-Length, Transfer-Encoding, Connection,
+// Retry-After) and discards the body, honouring Content-Length or chunked
+// framing so the connection can be reused afterwards.
+class HttpResponseParser
+{
+public:
+  enum class State : uint8_t
+  {
+    StatusLine,
+    Headers,
+    Body,
+    ChunkSize,
+    ChunkData,
+    ChunkDataEnd,
+    Trailers,
+    UntilClose, // no length information: body runs until the peer closes
+    Done,
+    Error
+  };
+
+  HttpResponseParser() { reset(); }
+
+  void reset();
+  // Consumes up to len bytes; returns how many were used. Stops consuming
+  // once the response is complete (extra bytes belong to the next one).
+  size_t feed(const uint8_t *data, size_t len);
+  // Tells the parser the peer closed; completes an UntilClose body.
+  void onClose();
+
+  bool done() const { return state_ == State::Done; }
+  bool failed() const { return state_ == State::Error; }
+  State state() const { return state_; }
+
+  int status() const { return status_; }
+  // True when the response framing and headers allow reusing the socket.
+  bool keepAlive() const { return keepAlive_ && !untilClose_; }
+  // Seconds from Retry-After (delta or HTTP-date); 0 when absent.
+  uint32_t retryAfterSeconds() const { return retryAfterSec_; }
+  bool chunked() const { return chunked_; }
+
+  static constexpr size_t kMaxLineBytes = 128;
+
+private:
+  bool lineComplete(uint8_t c);
+  void handleStatusLine();
+  void handleHeaderLine();
+  void finishHeaders();
+  bool handleChunkSizeLine();
+
+  State state_;
+  char line_[kMaxLineBytes];
+  size_t lineLen_;
+  int status_;
+  bool keepAlive_;
+  bool chunked_;
+  bool untilClose_;
+  long contentLength_;
+  uint32_t remaining_;
+  uint32_t retryAfterSec_;
+};
@@ -6,11 +6,17 @@
 #include <ArduinoJson.h>
 
 #include "AppConfig.h"
+#include "CircuitBreaker.h"
+#include "DnsCache.h"
 #include "SensorTask.h"
 #include "Metrics.h"
+#include "OfflineQueue.h"
+#include "SensorChannels.h"
+#include "SensorStats.h"
 #include "WifiManager.h"
 #include "StructuredLog.h"
 #include "TaskWatchdog.h"
+#include "UploaderTask.h"
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
@@ -24,6 +30,7 @@ static constexpr const char *kAuthScheme = "Bearer ";
 static constexpr size_t kAuthSchemeLen = 7;
 static constexpr size_t kLogSnapshotSize = 64;
 static StructuredLog::Entry gLogSnapshot[kLogSnapshotSize]; // static to avoid large stack frames
+static SensorStats::Snapshot gStatsSnapshot;                // likewise
 
 static void sendAuthFailure(int statusCode, const __FlashStringHelper *message)
 {
@@ -147,6 +154,14 @@ static void appendJsonEscaped(String &out, const char *text)
   }
 }
 
+static uint32_t breakerRetryInMs(const MetricsSnapshot &snap)
+{
+  if (snap.breakerState != static_cast<uint8_t>(CircuitBreaker::State::Open))
+    return 0;
+  const int32_t left = static_cast<int32_t>(snap.breakerRetryAtMillis - millis());
+  return left > 0 ? static_cast<uint32_t>(left) : 0;
+}
+
 static void handleRoot()
 {
   LOG_DEBUG(F("HTTP root request"));
@@ -202,13 +217,114 @@ static void handleGetMetrics()
     return String(value, static_cast<unsigned int>(decimals));
   };
 
-  appendCounter(F("esp_sensor_readings_total"), F("Total DHT sensor read attempts"), snap.sensorReadTotal);
-  appendCounter(F("esp_sensor_readings_failed_total"), F("Failed DHT sensor reads"), snap.sensorReadFailed);
-  appendGauge(F("esp_sensor_read_consecutive_failures"), F("Current consecutive DHT read failures"), String(snap.sensorReadConsecutiveFailures));
+  appendCounter(F("esp_sensor_readings_total"), F("Total sensor read attempts"), snap.sensorReadTotal);
+  appendCounter(F("esp_sensor_readings_failed_total"), F("Failed sensor reads"), snap.sensorReadFailed);
+  appendGauge(F("esp_sensor_read_consecutive_failures"), F("Current consecutive sensor read failures"), String(snap.sensorReadConsecutiveFailures));
   appendGauge(F("esp_last_sensor_read_millis"), F("Millis timestamp of the most recent sensor read attempt"), String(snap.lastSensorReadMillis));
   appendGauge(F("esp_last_sensor_read_success_millis"), F("Millis timestamp of the most recent successful sensor read"), String(snap.lastSensorReadSuccessMillis));
-  appendGauge(F("esp_last_temperature_celsius"), F("Most recent temperature reading in Celsius"), floatStr(snap.lastTemperatureC, 2));
-  appendGauge(F("esp_last_humidity_percent"), F("Most recent humidity reading (percent)"), floatStr(snap.lastHumidityPct, 2));
+  appendGauge(F("esp_sensor_read_duration_millis"), F("Duration of the most recent sensor sample (driver calls incl. oversampling and conversion wait)"), String(snap.lastSensorReadDurationMillis));
+  auto appendChannelSeries = [&](const __FlashStringHelper *name, const __FlashStringHelper *help, const __FlashStringHelper *type,
+                                 uint32_t (*value)(const ChannelMetrics &))
+  {
+    out += F("# HELP ");
+    out += name;
+    out += ' ';
+    out += help;
+    out += F("\n# TYPE ");
+    out += name;
+    out += ' ';
+    out += type;
+    out += '\n';
+    for (size_t i = 0; i < SensorChannels::count() && i < kMetricsMaxChannels; ++i)
+    {
+      out += name;
+      out += F("{channel=\"");
+      out += SensorChannels::get(static_cast<uint8_t>(i)).name;
+      out += F("\"} ");
+      out += String(value(snap.channels[i]));
+      out += '\n';
+    }
+  };
+  appendChannelSeries(F("esp_sensor_channel_reads_total"), F("Read attempts on the sensor channel"), F("counter"),
+                      [](const ChannelMetrics &c) { return c.reads; });
+  appendChannelSeries(F("esp_sensor_channel_read_failures_total"), F("Failed reads on the sensor channel"), F("counter"),
+                      [](const ChannelMetrics &c) { return c.failed; });
+  appendChannelSeries(F("esp_sensor_channel_consecutive_failures"), F("Current consecutive read failures on the sensor channel"), F("gauge"),
+                      [](const ChannelMetrics &c) { return c.consecutiveFailures; });
+  appendChannelSeries(F("esp_sensor_channel_read_duration_millis"), F("Duration of the channel's most recent read"), F("gauge"),
+                      [](const ChannelMetrics &c) { return c.latencyLastMillis; });
+  appendChannelSeries(F("esp_sensor_channel_read_duration_max_millis"), F("Longest read on the channel since boot"), F("gauge"),
+                      [](const ChannelMetrics &c) { return c.latencyMaxMillis; });
+  appendChannelSeries(F("esp_sensor_channel_read_duration_millis_total"), F("Cumulative milliseconds spent reading the channel"), F("counter"),
+                      [](const ChannelMetrics &c) { return c.latencyMillisTotal; });
+  SensorStats::snapshot(gStatsSnapshot);
+  auto appendWindowSeries = [&](const __FlashStringHelper *name, const __FlashStringHelper *help, bool temperature)
+  {
+    if (gStatsSnapshot.windows == 0)
+      return;
+    out += F("# HELP ");
+    out += name;
+    out += ' ';
+    out += help;
+    out += F("\n# TYPE ");
+    out += name;
+    out += F(" gauge\n");
+    for (size_t c = 0; c < gStatsSnapshot.channels; ++c)
+    {
+      for (size_t w = 0; w < gStatsSnapshot.windows; ++w)
+      {
+        const WindowStats::Summary &s = gStatsSnapshot.summaries[c][w];
+        const WindowStats::Quantity &q = temperature ? s.temperature : s.humidity;
+        if (!q.count)
+          continue;
+        const struct
+        {
+          const char *stat;
+          float value;
+        } stats[] = {{"min", q.min}, {"max", q.max}, {"mean", q.mean}, {"stddev", q.stddev}};
+        for (const auto &st : stats)
+        {
+          out += name;
+          out += F("{channel=\"");
+          out += SensorChannels::get(static_cast<uint8_t>(c)).name;
+          out += F("\",window=\"");
+          out += String(s.windowSec);
+          out += F("\",stat=\"");
+          out += st.stat;
+          out += F("\"} ");
+          out += floatStr(st.value, 3);
+          out += '\n';
+        }
+      }
+    }
+  };
+  appendWindowSeries(F("esp_window_temperature_celsius"), F("Temperature statistics over the sliding window (window label in seconds)"), true);
+  appendWindowSeries(F("esp_window_humidity_percent"), F("Humidity statistics over the sliding window (window label in seconds)"), false);
+  if (gStatsSnapshot.windows)
+  {
+    out += F("# HELP esp_window_samples Samples inside the sliding window\n# TYPE esp_window_samples gauge\n");
+    for (size_t c = 0; c < gStatsSnapshot.channels; ++c)
+    {
+      for (size_t w = 0; w < gStatsSnapshot.windows; ++w)
+      {
+        out += F("esp_window_samples{channel=\"");
+        out += SensorChannels::get(static_cast<uint8_t>(c)).name;
+        out += F("\",window=\"");
+        out += String(gStatsSnapshot.summaries[c][w].windowSec);
+        out += F("\"} ");
+        out += String(gStatsSnapshot.summaries[c][w].temperature.count);
+        out += '\n';
+      }
+    }
+  }
+  appendGauge(F("esp_last_temperature_celsius"), F("Most recent temperature reading in Celsius (first sensor channel)"), floatStr(snap.lastTemperatureC, 2));
+  appendGauge(F("esp_last_humidity_percent"), F("Most recent humidity reading (percent, first sensor channel)"), floatStr(snap.lastHumidityPct, 2));
+  appendCounter(F("esp_read_cache_hits_total"), F("GET /read answers served from the last sample"), snap.readCacheHits);
+  appendCounter(F("esp_read_cache_coalesced_total"), F("GET /read answers that shared a sensor read already in flight"), snap.readCacheCoalesced);
+  appendCounter(F("esp_read_cache_misses_total"), F("GET /read answers that needed a new sensor read"), snap.readCacheMisses);
+  appendCounter(F("esp_filter_rejected_total"), F("Temperature/humidity values the reading filter replaced as spikes (rate-of-change limit)"), snap.filterRejected);
+  appendCounter(F("esp_readings_reported_total"), F("Readings handed to the uploader (deadband exceeded, heartbeat or deadband off)"), snap.readingsReported);
+  appendCounter(F("esp_readings_suppressed_total"), F("Readings held back because they stayed inside the deadband"), snap.readingsSuppressed);
 
   appendCounter(F("esp_post_reading_total"), F("Total attempts to post sensor readings upstream"), snap.postReadingTotal);
   appendCounter(F("esp_post_reading_failed_total"), F("Failed attempts to post sensor readings upstream"), snap.postReadingFailed);
@@ -222,6 +338,148 @@ static void handleGetMetrics()
   appendGauge(F("esp_last_post_error_millis"), F("Millis timestamp of the most recent error post attempt"), String(snap.lastPostErrorMillis));
   appendGauge(F("esp_last_post_error_success_millis"), F("Millis timestamp of the most recent successful error post"), String(snap.lastPostErrorSuccessMillis));
 
+  // Prometheus histogram: cumulative le buckets, then _sum and _count.
+  out += F("# HELP esp_post_phase_duration_millis Upstream post latency by phase (dns, connect, tls, ttfb, total)\n");
+  out += F("# TYPE esp_post_phase_duration_millis histogram\n");
+  for (size_t p = 0; p < static_cast<size_t>(Metrics::PostPhase::Count); ++p)
+  {
+    const Metrics::PostPhase phase = static_cast<Metrics::PostPhase>(p);
+    const char *phaseName = Metrics::postPhaseName(phase);
+    LatencyHistogram hist;
+    Metrics::latencyHistogram(phase, hist);
+    uint32_t cumulative = 0;
+    for (size_t b = 0; b < kLatencyBuckets; ++b)
+    {
+      cumulative += hist.buckets[b];
+      out += F("esp_post_phase_duration_millis_bucket{phase=\"");
+      out += phaseName;
+      out += F("\",le=\"");
+      if (b + 1 < kLatencyBuckets)
+        out += String(kLatencyBucketBoundsMs[b]);
+      else
+        out += F("+Inf");
+      out += F("\"} ");
+      out += String(cumulative);
+      out += '\n';
+    }
+    out += F("esp_post_phase_duration_millis_sum{phase=\"");
+    out += phaseName;
+    out += F("\"} ");
+    out += String(hist.sumMillis);
+    out += F("\nesp_post_phase_duration_millis_count{phase=\"");
+    out += phaseName;
+    out += F("\"} ");
+    out += String(hist.count);
+    out += '\n';
+  }
+
+  appendCounter(F("esp_post_batch_total"), F("Multi-reading batch posts attempted"), snap.postBatchTotal);
+  appendCounter(F("esp_post_batch_failed_total"), F("Multi-reading batch posts that failed"), snap.postBatchFailed);
+  appendCounter(F("esp_post_batch_readings_sent_total"), F("Readings delivered inside successful batch posts"), snap.postBatchReadingsSent);
+  appendCounter(F("esp_post_batch_readings_dropped_total"), F("Readings dropped because the batch buffer was full"), snap.postBatchReadingsDropped);
+
+  appendCounter(F("esp_post_fail_connect_total"), F("Posts that failed to connect (DNS, TCP or TLS)"), snap.postFailConnect);
+  appendCounter(F("esp_post_fail_write_total"), F("Posts whose request could not be written"), snap.postFailWrite);
+  appendCounter(F("esp_post_fail_timeout_total"), F("Posts whose response did not complete in time"), snap.postFailTimeout);
+  appendCounter(F("esp_post_fail_bad_response_total"), F("Posts answered with a malformed or truncated HTTP response"), snap.postFailBadResponse);
+  appendCounter(F("esp_post_fail_http_4xx_total"), F("Posts answered with a 4xx status"), snap.postFailHttp4xx);
+  appendCounter(F("esp_post_fail_http_5xx_total"), F("Posts answered with a 5xx status"), snap.postFailHttp5xx);
+  appendCounter(F("esp_post_fail_http_other_total"), F("Posts answered with a non-2xx status outside 4xx/5xx"), snap.postFailHttpOther);
+  appendCounter(F("esp_post_readings_rejected_total"), F("Readings discarded because upstream refused the payload (400/413/422)"), snap.postReadingsRejected);
+  appendGauge(F("esp_post_last_http_status"), F("HTTP status of the most recent upstream response"), String(snap.lastHttpStatus));
+
+  appendGauge(F("esp_upload_queue_depth"), F("Items waiting in the sensor-to-uploader queue"), String(uploaderQueueDepth()));
+  appendGauge(F("esp_upload_queue_depth_max"), F("Highest upload queue depth seen since boot"), String(snap.uploadQueueDepthMax));
+  appendCounter(F("esp_upload_queue_enqueued_total"), F("Items handed from the sensor task to the uploader task"), snap.uploadQueueEnqueued);
+  appendCounter(F("esp_upload_queue_dropped_total"), F("Upload queue items discarded by the backpressure policy"), snap.uploadQueueDropped);
+  appendCounter(F("esp_upload_queue_coalesced_total"), F("Readings moved from a full upload queue to the offline queue"), snap.uploadQueueCoalesced);
+  appendCounter(F("esp_upload_queue_blocked_total"), F("Times the sensor task waited for upload queue space"), snap.uploadQueueBlocked);
+  appendCounter(F("esp_upload_queue_blocked_millis_total"), F("Cumulative milliseconds the sensor task waited for upload queue space"), snap.uploadQueueBlockedMillisTotal);
+  appendCounter(F("esp_upload_queue_waits_total"), F("Items taken off the upload queue (count for the wait totals)"), snap.uploadQueueDequeued);
+  appendCounter(F("esp_upload_queue_wait_millis_total"), F("Cumulative milliseconds items waited in the upload queue"), snap.uploadQueueWaitMillisTotal);
+  appendGauge(F("esp_upload_queue_wait_last_millis"), F("Queue wait of the most recently dequeued item"), String(snap.uploadQueueWaitLastMillis));
+  appendGauge(F("esp_upload_queue_wait_max_millis"), F("Longest upload queue wait seen since boot"), String(snap.uploadQueueWaitMaxMillis));
+
+  OfflineQueue::Stats oq = OfflineQueue::stats();
+  appendGauge(F("esp_offline_queue_depth"), F("Readings waiting in the offline queue (RAM + flash)"), String(oq.depth));
+  appendGauge(F("esp_offline_queue_flash_depth"), F("Offline queue readings stored in the flash segment log"), String(oq.flashDepth));
+  appendGauge(F("esp_offline_queue_bytes"), F("Bytes used by the offline queue segment log"), String(oq.flashBytes));
+  appendGauge(F("esp_offline_queue_oldest_age_seconds"), F("Age of the oldest queued reading in seconds"), String(oq.oldestAgeSec));
+  appendGauge(F("esp_offline_queue_drain_rate"), F("Smoothed offline queue drain throughput (readings per second)"), floatStr(oq.drainRatePerSec, 2));
+  appendCounter(F("esp_offline_queue_enqueued_total"), F("Readings placed in the offline queue"), oq.enqueued);
+  appendCounter(F("esp_offline_queue_drained_total"), F("Queued readings delivered upstream"), oq.drained);
+  appendCounter(F("esp_offline_queue_dropped_total"), F("Queued readings discarded because the queue was full"), oq.dropped);
+  appendCounter(F("esp_offline_queue_corrupt_segments_total"), F("Flash segments found torn or corrupt when reopened"), oq.corruptSegments);
+
+  // Per-sink series carry a sink="<name>" label.
+  auto appendSinkSeries = [&](const __FlashStringHelper *name, const __FlashStringHelper *help, const __FlashStringHelper *type,
+                              uint32_t (*value)(const MetricsSnapshot &, size_t))
+  {
+    out += F("# HELP ");
+    out += name;
+    out += ' ';
+    out += help;
+    out += F("\n# TYPE ");
+    out += name;
+    out += ' ';
+    out += type;
+    out += '\n';
+    for (size_t i = 0; i < uploaderSinkCount() && i < kMetricsMaxSinks; ++i)
+    {
+      out += name;
+      out += F("{sink=\"");
+      out += uploaderSinkName(i);
+      out += F("\"} ");
+      out += String(value(snap, i));
+      out += '\n';
+    }
+  };
+  appendSinkSeries(F("esp_sink_queue_depth"), F("Items waiting in the sink's upload queue"), F("gauge"),
+                   [](const MetricsSnapshot &, size_t i) -> uint32_t { return uploaderSinkQueueDepth(i); });
+  appendSinkSeries(F("esp_sink_delivered_total"), F("Items the sink accepted (posted or buffered for a batch)"), F("counter"),
+                   [](const MetricsSnapshot &m, size_t i) { return m.sinks[i].delivered; });
+  appendSinkSeries(F("esp_sink_failed_total"), F("Items the sink could not deliver"), F("counter"),
+                   [](const MetricsSnapshot &m, size_t i) { return m.sinks[i].failed; });
+  appendSinkSeries(F("esp_sink_dropped_total"), F("Items the sink discarded (queue overflow or undeliverable)"), F("counter"),
+                   [](const MetricsSnapshot &m, size_t i) { return m.sinks[i].dropped; });
+  appendSinkSeries(F("esp_sink_latency_last_millis"), F("Duration of the sink's most recent post call"), F("gauge"),
+                   [](const MetricsSnapshot &m, size_t i) { return m.sinks[i].latencyLastMillis; });
+  appendSinkSeries(F("esp_sink_latency_max_millis"), F("Longest sink post call since boot"), F("gauge"),
+                   [](const MetricsSnapshot &m, size_t i) { return m.sinks[i].latencyMaxMillis; });
+  appendSinkSeries(F("esp_sink_latency_millis_total"), F("Cumulative milliseconds spent in the sink's post calls"), F("counter"),
+                   [](const MetricsSnapshot &m, size_t i) { return m.sinks[i].latencyMillisTotal; });
+
+  appendGauge(F("esp_upstream_circuit_state"), F("Upstream circuit breaker state (0 = closed, 1 = open, 2 = half-open)"), String(snap.breakerState));
+  appendGauge(F("esp_upstream_circuit_consecutive_failures"), F("Failed upstream posts in a row"), String(snap.breakerConsecutiveFailures));
+  appendGauge(F("esp_upstream_circuit_retry_in_millis"), F("Milliseconds until an open circuit admits a probe"), String(breakerRetryInMs(snap)));
+  appendCounter(F("esp_upstream_circuit_trips_total"), F("Times the upstream circuit breaker opened"), snap.breakerTrips);
+  appendCounter(F("esp_upstream_circuit_probes_total"), F("Probe posts sent from the half-open state"), snap.breakerProbes);
+  appendCounter(F("esp_upstream_circuit_short_circuits_total"), F("Posts skipped without network I/O because the circuit was open"), snap.breakerShortCircuits);
+
+  DnsCache::Stats dns = DnsCache::stats();
+  appendCounter(F("esp_dns_cache_hits_total"), F("Upstream host lookups answered from the DNS cache"), dns.hits);
+  appendCounter(F("esp_dns_cache_misses_total"), F("Upstream host lookups that went to the resolver"), dns.misses);
+  appendCounter(F("esp_dns_cache_stale_serves_total"), F("Failed lookups answered with the last known address"), dns.staleServes);
+  appendCounter(F("esp_dns_cache_refreshes_total"), F("Cache entries re-resolved in the background before expiry"), dns.refreshes);
+  appendCounter(F("esp_dns_cache_failures_total"), F("Resolver lookups that failed"), dns.failures);
+  appendGauge(F("esp_dns_cache_entries"), F("Hostnames currently held in the DNS cache"), String(dns.entries));
+
+  appendCounter(F("esp_upstream_connections_opened_total"), F("New upstream HTTP connections established (TCP/TLS handshakes)"), snap.upstreamConnectionsOpened);
+  appendCounter(F("esp_upstream_connections_reused_total"), F("Upstream posts sent over an already open keep-alive connection"), snap.upstreamConnectionsReused);
+  appendCounter(F("esp_upstream_server_closes_total"), F("Keep-alive connections found closed by the server before reuse"), snap.upstreamServerCloses);
+  appendCounter(F("esp_post_body_bytes_total"), F("Upstream request body bytes before compression"), snap.postBodyBytes);
+  appendCounter(F("esp_post_wire_bytes_total"), F("Upstream request body bytes as sent (after gzip when enabled)"), snap.postWireBytes);
+  appendCounter(F("esp_posts_compressed_total"), F("Upstream requests sent with Content-Encoding: gzip"), snap.postsCompressed);
+  appendCounter(F("esp_posts_chunked_total"), F("Upstream requests sent with Transfer-Encoding: chunked (streamed offline backlog)"), snap.postsChunked);
+  appendCounter(F("esp_post_socket_writes_total"), F("Client write calls made to send upstream requests (header and body)"), snap.postSocketWrites);
+  appendCounter(F("esp_tls_records_written_total"), F("TLS application data records sent for upstream requests"), snap.tlsRecordsWritten);
+  appendCounter(F("esp_tls_handshakes_full_total"), F("Upstream TLS handshakes that performed a full key exchange"), snap.tlsHandshakesFull);
+  appendCounter(F("esp_tls_handshakes_resumed_total"), F("Upstream TLS handshakes abbreviated via session resumption"), snap.tlsHandshakesResumed);
+  appendCounter(F("esp_tls_handshakes_failed_total"), F("Upstream TLS connection attempts that failed"), snap.tlsHandshakesFailed);
+  appendCounter(F("esp_tls_handshake_full_millis_total"), F("Cumulative milliseconds spent in full TLS handshakes"), snap.tlsHandshakeFullMillisTotal);
+  appendCounter(F("esp_tls_handshake_resumed_millis_total"), F("Cumulative milliseconds spent in resumed TLS handshakes"), snap.tlsHandshakeResumedMillisTotal);
+  appendGauge(F("esp_tls_handshake_last_millis"), F("Duration of the most recent upstream TLS handshake"), String(snap.tlsHandshakeLastMillis));
+
   appendGauge(F("esp_uptime_millis"), F("Device uptime in milliseconds"), String(snap.uptimeMillis));
   appendGauge(F("esp_heap_free_bytes"), F("Free heap bytes at the time of metrics snapshot"), String(snap.heapFreeBytes));
   appendGauge(F("esp_heap_min_bytes"), F("Minimum observed free heap bytes"), String(snap.heapMinBytes));
@@ -341,6 +599,18 @@ static void handlePostLogs()
   server.send(200, "application/json", out);
 }
 
+// Window statistics of one quantity; only the count while it has no samples.
+static void addQuantity(JsonObject o, const WindowStats::Quantity &q)
+{
+  o["count"] = q.count;
+  if (!q.count)
+    return;
+  o["min"] = q.min;
+  o["max"] = q.max;
+  o["mean"] = q.mean;
+  o["stddev"] = q.stddev;
+}
+
 static void handleGetStatus()
 {
   LOG_DEBUG(F("HTTP status request"));
@@ -352,6 +622,82 @@ static void handleGetStatus()
   doc["heap_free"] = ESP.getFreeHeap();
   doc["heap_min"] = ESP.getMinFreeHeap();
   doc["uptime_ms"] = millis();
+  doc["sensor"] = sensorDriverName();
+  {
+    MetricsSnapshot snap = Metrics::snapshot();
+    const String &deviceLocation = AppConfig::get().getDeviceLocation();
+    SensorStats::snapshot(gStatsSnapshot);
+    JsonArray sensors = doc["sensors"].to<JsonArray>();
+    for (size_t i = 0; i < SensorChannels::count(); ++i)
+    {
+      const uint8_t idx = static_cast<uint8_t>(i);
+      const SensorChannels::Channel &ch = SensorChannels::get(idx);
+      const ChannelMetrics &m = snap.channels[i];
+      JsonObject o = sensors.add<JsonObject>();
+      o["name"] = ch.name;
+      o["driver"] = sensorDriverName(idx);
+      o["location"] = SensorChannels::location(idx, deviceLocation);
+      o["interval_sec"] = ch.intervalSec ? ch.intervalSec : AppConfig::get().getPostIntervalSeconds();
+      o["reads"] = m.reads;
+      o["failures"] = m.failed;
+      o["consecutive_failures"] = m.consecutiveFailures;
+      o["read_ms_last"] = m.latencyLastMillis;
+      o["read_ms_max"] = m.latencyMaxMillis;
+      if (i < gStatsSnapshot.channels)
+      {
+        JsonArray stats = o["stats"].to<JsonArray>();
+        for (size_t w = 0; w < gStatsSnapshot.windows; ++w)
+        {
+          const WindowStats::Summary &s = gStatsSnapshot.summaries[i][w];
+          JsonObject so = stats.add<JsonObject>();
+          so["window_sec"] = s.windowSec;
+          addQuantity(so["temperature_c"].to<JsonObject>(), s.temperature);
+          addQuantity(so["humidity_pct"].to<JsonObject>(), s.humidity);
+        }
+      }
+    }
+  }
+  {
+    OfflineQueue::Stats oq = OfflineQueue::stats();
+    JsonObject q = doc["offline_queue"].to<JsonObject>();
+    q["depth"] = oq.depth;
+    q["ram_depth"] = oq.ramDepth;
+    q["flash_depth"] = oq.flashDepth;
+    q["flash_bytes"] = oq.flashBytes;
+    q["oldest_age_sec"] = oq.oldestAgeSec;
+    q["flash_available"] = oq.flashAvailable;
+  }
+  {
+    MetricsSnapshot snap = Metrics::snapshot();
+    JsonObject c = doc["upstream_circuit"].to<JsonObject>();
+    c["state"] = CircuitBreaker::stateName(static_cast<CircuitBreaker::State>(snap.breakerState));
+    c["consecutive_failures"] = snap.breakerConsecutiveFailures;
+    c["retry_in_ms"] = breakerRetryInMs(snap);
+    c["trips"] = snap.breakerTrips;
+    c["short_circuits"] = snap.breakerShortCircuits;
+
+    JsonObject u = doc["upload_queue"].to<JsonObject>();
+    u["depth"] = uploaderQueueDepth();
+    u["depth_max"] = snap.uploadQueueDepthMax;
+    u["policy"] = uploadQueuePolicyName(AppConfig::get().getUploadQueuePolicy());
+    u["dropped"] = snap.uploadQueueDropped;
+    u["wait_last_ms"] = snap.uploadQueueWaitLastMillis;
+    u["wait_max_ms"] = snap.uploadQueueWaitMaxMillis;
+
+    JsonArray sinks = doc["sinks"].to<JsonArray>();
+    for (size_t i = 0; i < uploaderSinkCount() && i < kMetricsMaxSinks; ++i)
+    {
+      const SinkMetrics &m = snap.sinks[i];
+      JsonObject o = sinks.add<JsonObject>();
+      o["name"] = uploaderSinkName(i);
+      o["queue_depth"] = uploaderSinkQueueDepth(i);
+      o["delivered"] = m.delivered;
+      o["failed"] = m.failed;
+      o["dropped"] = m.dropped;
+      o["latency_last_ms"] = m.latencyLastMillis;
+      o["latency_max_ms"] = m.latencyMaxMillis;
+    }
+  }
 
   JsonArray tasks = doc["tasks"].to<JsonArray>();
 
@@ -365,6 +711,18 @@ static void handleGetStatus()
     t["stack_hwm_words"] = uxTaskGetStackHighWaterMark(sh);
     t["priority"] = uxTaskPriorityGet(sh);
   }
+  // Uploader tasks (one per output sink)
+  for (size_t i = 0; i < uploaderSinkCount(); ++i)
+  {
+    TaskHandle_t uh = uploaderSinkTaskHandle(i);
+    if (!uh)
+      continue;
+    JsonObject t = tasks.add<JsonObject>();
+    t["name"] = uploaderSinkTaskName(i);
+    t["state"] = stateToStr(eTaskGetState(uh));
+    t["stack_hwm_words"] = uxTaskGetStackHighWaterMark(uh);
+    t["priority"] = uxTaskPriorityGet(uh);
+  }
   // HTTP server task (self)
   TaskHandle_t hh = httpServerTaskHandle();
   if (hh)
@@ -386,22 +744,77 @@ static void handleGetRead()
   LOG_DEBUG(F("HTTP read request"));
   if (!authorizeRequest())
     return;
-  float t = NAN, h = NAN;
-  String err;
-  bool ok = sensorTakeReading(t, h, err);
+  // ?max_age_ms= lets a caller ask for a fresher sample than configured.
+  uint32_t maxAgeMs = AppConfig::get().getReadCacheMaxAgeMs();
+  if (server.hasArg("max_age_ms"))
+  {
+    const long v = server.arg("max_age_ms").toInt();
+    maxAgeMs = v > 0 ? static_cast<uint32_t>(v) : 0;
+  }
+
+  SensorSample first;
+  const bool ok = sensorReadCached(0, maxAgeMs, first);
+  uint32_t oldestMs = first.ageMs;
 
   JsonDocument doc;
   doc["ok"] = ok;
   doc["location"] = AppConfig::get().getDeviceLocation();
+  doc["age_ms"] = first.ageMs;
   if (ok)
   {
-    doc["temperature_c"] = t;
-    doc["humidity_pct"] = h;
+    doc["temperature_c"] = first.temperatureC;
+    doc["humidity_pct"] = first.humidityPct;
+  }
+  else
+  {
+    doc["error"] = first.error;
+  }
+  // The top-level fields stay the first channel's; with several channels
+  // every one is listed (the first repeating the sample above).
+  if (SensorChannels::tagged())
+  {
+    const String &deviceLocation = AppConfig::get().getDeviceLocation();
+    JsonArray channels = doc["channels"].to<JsonArray>();
+    for (size_t i = 0; i < SensorChannels::count(); ++i)
+    {
+      const uint8_t idx = static_cast<uint8_t>(i);
+      SensorSample sample = first;
+      if (i > 0)
+        (void)sensorReadCached(idx, maxAgeMs, sample);
+      if (sample.ageMs > oldestMs)
+        oldestMs = sample.ageMs;
+      JsonObject o = channels.add<JsonObject>();
+      o["name"] = SensorChannels::get(idx).name;
+      o["location"] = SensorChannels::location(idx, deviceLocation);
+      o["ok"] = sample.ok;
+      o["age_ms"] = sample.ageMs;
+      if (sample.ok)
+      {
+        o["temperature_c"] = sample.temperatureC;
+        o["humidity_pct"] = sample.humidityPct;
+      }
+      else
+      {
+        o["error"] = sample.error;
+      }
+    }
+  }
+
+  // Pollers (and proxies) may reuse the answer until the oldest sample in
+  // it reaches the configured max age.
+  server.sendHeader("Age", String(oldestMs / 1000));
+  const uint32_t configuredMs = AppConfig::get().getReadCacheMaxAgeMs();
+  if (configuredMs > oldestMs)
+  {
+    String cacheControl = F("private, max-age=");
+    cacheControl += String((configuredMs - oldestMs) / 1000);
+    server.sendHeader("Cache-Control", cacheControl);
   }
   else
   {
-    doc["error"] = err;
+    server.sendHeader("Cache-Control", "no-cache");
   }
+
   String out;
   serializeJson(doc, out);
   server.send(200, "application/json", out);
@@ -595,6 +1008,31 @@ static void handlePostTask()
       ok = true;
     }
   }
+  else if (name.startsWith("Up"))
+  {
+    for (size_t i = 0; i < uploaderSinkCount(); ++i)
+    {
+      if (name != uploaderSinkTaskName(i))
+        continue;
+      TaskHandle_t h = uploaderSinkTaskHandle(i);
+      if (action == "suspend" && h)
+      {
+        vTaskSuspend(h);
+        ok = true;
+      }
+      else if (action == "resume" && h)
+      {
+        vTaskResume(h);
+        ok = true;
+      }
+      else if (action == "restart")
+      {
+        restartUploaderSink(i);
+        ok = true;
+      }
+      break;
+    }
+  }
   else if (name == "HttpServerTask")
   {
     TaskHandle_t h = httpServerTaskHandle();
@@ -0,0 +1,189 @@
+#include "JsonWriter.h"
+
+#include <math.h>
+
+namespace
+{
+  constexpr uint32_t kPow10[] = {1, 10, 100, 1000, 10000, 100000, 1000000};
+
+  // Writes v in decimal into the end of buf, returning the first digit.
+  char *formatUnsigned(char *end, uint64_t v)
+  {
+    char *p = end;
+    do
+    {
+      *--p = static_cast<char>('0' + (v % 10));
+      v /= 10;
+    } while (v);
+    return p;
+  }
+}
+
+JsonWriter::JsonWriter(Print &out) : PayloadWriter(out), needComma_(false), afterKey_(false)
+{
+}
+
+void JsonWriter::putEscaped(const char *s)
+{
+  static const char kHex[] = "0123456789abcdef";
+  put('"');
+  for (; s && *s; ++s)
+  {
+    const unsigned char c = static_cast<unsigned char>(*s);
+    switch (c)
+    {
+    case '"':
+      putRaw("\\\"", 2);
+      break;
+    case '\\':
+      putRaw("\\\\", 2);
+      break;
+    case '\n':
+      putRaw("\\n", 2);
+      break;
+    case '\r':
+      putRaw("\\r", 2);
+      break;
+    case '\t':
+      putRaw("\\t", 2);
+      break;
+    default:
+      if (c < 0x20)
+      {
+        putRaw("\\u00", 4);
+        put(kHex[c >> 4]);
+        put(kHex[c & 0x0F]);
+      }
+      else
+      {
+        put(c);
+      }
+      break;
+    }
+  }
+  put('"');
+}
+
+void JsonWriter::separate()
+{
+  if (afterKey_)
+  {
+    afterKey_ = false;
+    return;
+  }
+  if (needComma_)
+    put(',');
+}
+
+void JsonWriter::beginObject(size_t)
+{
+  separate();
+  put('{');
+  needComma_ = false;
+}
+
+void JsonWriter::endObject()
+{
+  put('}');
+  needComma_ = true;
+}
+
+void JsonWriter::beginArray(size_t)
+{
+  separate();
+  put('[');
+  needComma_ = false;
+}
+
+void JsonWriter::endArray()
+{
+  put(']');
+  needComma_ = true;
+}
+
+void JsonWriter::key(const char *name)
+{
+  separate();
+  putEscaped(name);
+  put(':');
+  afterKey_ = true;
+}
+
+void JsonWriter::value(const char *s)
+{
+  separate();
+  putEscaped(s);
+  needComma_ = true;
+}
+
+void JsonWriter::value(float v, uint8_t decimals)
+{
+  if (isnan(v) || isinf(v))
+  {
+    null();
+    return;
+  }
+  if (decimals > 6)
+    decimals = 6;
+
+  separate();
+  const uint32_t scale = kPow10[decimals];
+  const double scaled = fabs(static_cast<double>(v)) * scale + 0.5;
+  const uint64_t n = static_cast<uint64_t>(scaled);
+  if (v < 0 && n != 0)
+    put('-');
+
+  char digits[24];
+  char *end = digits + sizeof(digits);
+  char *p = formatUnsigned(end, n / scale);
+  putRaw(p, end - p);
+  if (decimals)
+  {
+    put('.');
+    p = formatUnsigned(end, n % scale);
+    for (size_t pad = decimals - (end - p); pad > 0; --pad)
+      put('0');
+    putRaw(p, end - p);
+  }
+  needComma_ = true;
+}
+
+void JsonWriter::value(uint32_t v)
+{
+  separate();
+  char digits[12];
+  char *end = digits + sizeof(digits);
+  char *p = formatUnsigned(end, v);
+  putRaw(p, end - p);
+  needComma_ = true;
+}
+
+void JsonWriter::value(int32_t v)
+{
+  if (v < 0)
+  {
+    separate();
+    put('-');
+    afterKey_ = true; // suppress the separator for the magnitude
+    value(static_cast<uint32_t>(-(static_cast<int64_t>(v))));
+    return;
+  }
+  value(static_cast<uint32_t>(v));
+}
+
+void JsonWriter::value(bool b)
+{
+  separate();
+  if (b)
+    putRaw("true", 4);
+  else
+    putRaw("false", 5);
+  needComma_ = true;
+}
+
+void JsonWriter::null()
+{
+  separate();
+  putRaw("null", 4);
+  needComma_ = true;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "PayloadWriter.h"
+
+// Streams JSON into any Print without touching the heap. Commas are
+// inserted automatically; strings are escaped per RFC 8259.
+//
+//   JsonWriter w(client);
+//   w.beginObject(2);
+//   w.field("location", loc);
+//   w.field("temperature_c", t, 2);
+//   w.endObject();
+//   w.flush();
+class JsonWriter : public PayloadWriter
+{
+public:
+  explicit JsonWriter(Print &out);
+
+  using PayloadWriter::value;
+
+  void beginObject(size_t fields) override;
+  void endObject() override;
+  void beginArray(size_t items) override;
+  void endArray() override;
+  void key(const char *name) override;
+  void value(const char *s) override;
+  void value(float v, uint8_t decimals) override;
+  void value(uint32_t v) override;
+  void value(int32_t v) override;
+  void value(bool b) override;
+  void null() override;
+
+private:
+  void separate();
+  void putEscaped(const char *s);
+
+  bool needComma_;
+  bool afterKey_;
+};
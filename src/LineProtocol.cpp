@@ -0,0 +1,201 @@
+#include "LineProtocol.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+const char *influxPrecisionName(InfluxPrecision precision)
+{
+  switch (precision)
+  {
+  case InfluxPrecision::Us:
+    return "us";
+  case InfluxPrecision::Ms:
+    return "ms";
+  case InfluxPrecision::S:
+    return "s";
+  case InfluxPrecision::Ns:
+  default:
+    return "ns";
+  }
+}
+
+bool influxPrecisionFromString(const String &text, InfluxPrecision &out)
+{
+  if (text.equalsIgnoreCase("ns"))
+    out = InfluxPrecision::Ns;
+  else if (text.equalsIgnoreCase("us"))
+    out = InfluxPrecision::Us;
+  else if (text.equalsIgnoreCase("ms"))
+    out = InfluxPrecision::Ms;
+  else if (text.equalsIgnoreCase("s"))
+    out = InfluxPrecision::S;
+  else
+    return false;
+  return true;
+}
+
+LineProtocolWriter::LineProtocolWriter(Print &out, const char *measurement, const String &location, InfluxPrecision precision)
+    : out_(out), measurement_(measurement), location_(location), precision_(precision), len_(0), total_(0), failed_(false)
+{
+}
+
+void LineProtocolWriter::reading(const Reading &r, uint32_t nowMs, uint32_t nowEpoch, const char *channel, const String *location)
+{
+  const bool haveT = !isnan(r.temperatureC) && !isinf(r.temperatureC);
+  const bool haveH = !isnan(r.humidityPct) && !isinf(r.humidityPct);
+  // A line needs at least one field.
+  if (!haveT && !haveH)
+    return;
+
+  head(channel, location);
+  char num[24];
+  if (haveT)
+  {
+    snprintf(num, sizeof(num), " temperature_c=%.2f", static_cast<double>(r.temperatureC));
+    put(num);
+  }
+  if (haveH)
+  {
+    snprintf(num, sizeof(num), "%shumidity_pct=%.2f", haveT ? "," : " ", static_cast<double>(r.humidityPct));
+    put(num);
+  }
+  if (r.seq)
+  {
+    snprintf(num, sizeof(num), ",boot_id=%lui", static_cast<unsigned long>(r.bootId));
+    put(num);
+    snprintf(num, sizeof(num), ",seq=%lui", static_cast<unsigned long>(r.seq));
+    put(num);
+  }
+
+  if (r.timestamp)
+  {
+    timestamp(r.timestamp, 0);
+  }
+  else if (r.sampledMs && nowEpoch)
+  {
+    // Sampled before the clock was set: place it by its age.
+    const uint32_t ageMs = nowMs - r.sampledMs;
+    const uint32_t ageSec = ageMs / 1000;
+    const uint16_t ms = static_cast<uint16_t>(ageMs % 1000);
+    timestamp(ms ? nowEpoch - ageSec - 1 : nowEpoch - ageSec, ms ? 1000 - ms : 0);
+  }
+  put("\n");
+}
+
+void LineProtocolWriter::error(const String &message)
+{
+  head();
+  put(" error=\"");
+  putEscaped(message.c_str(), "\"\\");
+  put("\"\n");
+}
+
+void LineProtocolWriter::stats(const WindowStats::Summary &s, uint32_t nowEpoch, const char *channel, const String *location)
+{
+  if (!s.temperature.count && !s.humidity.count)
+    return;
+  head(channel, location, "_stats");
+  char num[24];
+  snprintf(num, sizeof(num), ",window=%lu", static_cast<unsigned long>(s.windowSec));
+  put(num);
+  quantity("temperature_c", s.temperature, true);
+  quantity("humidity_pct", s.humidity, !s.temperature.count);
+  if (nowEpoch)
+    timestamp(nowEpoch, 0);
+  put("\n");
+}
+
+void LineProtocolWriter::quantity(const char *name, const WindowStats::Quantity &q, bool first)
+{
+  if (!q.count)
+    return;
+  const struct
+  {
+    const char *stat;
+    float value;
+    uint8_t decimals;
+  } fields[] = {{"min", q.min, 2}, {"max", q.max, 2}, {"mean", q.mean, 2}, {"stddev", q.stddev, 3}};
+  char num[48];
+  snprintf(num, sizeof(num), "%s%s_count=%lui", first ? " " : ",", name, static_cast<unsigned long>(q.count));
+  put(num);
+  for (const auto &f : fields)
+  {
+    snprintf(num, sizeof(num), ",%s_%s=%.*f", name, f.stat, f.decimals, static_cast<double>(f.value));
+    put(num);
+  }
+}
+
+void LineProtocolWriter::head(const char *channel, const String *location, const char *suffix)
+{
+  // Tags in key order, as InfluxDB prefers.
+  const String &loc = (location && location->length()) ? *location : location_;
+  putEscaped(measurement_, ", ");
+  if (suffix)
+    put(suffix);
+  if (channel && *channel)
+  {
+    put(",channel=");
+    putEscaped(channel, ",= ");
+  }
+  put(",location=");
+  putEscaped(loc.length() ? loc.c_str() : "unknown", ",= ");
+}
+
+void LineProtocolWriter::timestamp(uint32_t epochSeconds, uint16_t millisPart)
+{
+  uint64_t ts = epochSeconds;
+  switch (precision_)
+  {
+  case InfluxPrecision::S:
+    break;
+  case InfluxPrecision::Ms:
+    ts = ts * 1000ULL + millisPart;
+    break;
+  case InfluxPrecision::Us:
+    ts = ts * 1000000ULL + millisPart * 1000ULL;
+    break;
+  case InfluxPrecision::Ns:
+  default:
+    ts = ts * 1000000000ULL + millisPart * 1000000ULL;
+    break;
+  }
+  char buf[24];
+  snprintf(buf, sizeof(buf), " %llu", static_cast<unsigned long long>(ts));
+  put(buf);
+}
+
+void LineProtocolWriter::flush()
+{
+  if (len_ == 0)
+    return;
+  if (out_.write(buf_, len_) != len_)
+    failed_ = true;
+  len_ = 0;
+}
+
+void LineProtocolWriter::put(char c)
+{
+  if (len_ == sizeof(buf_))
+    flush();
+  buf_[len_++] = static_cast<uint8_t>(c);
+  ++total_;
+}
+
+void LineProtocolWriter::put(const char *s)
+{
+  while (*s)
+    put(*s++);
+}
+
+void LineProtocolWriter::putEscaped(const char *s, const char *special)
+{
+  for (; *s; ++s)
+  {
+    // Line breaks cannot be escaped; flatten them.
+    const char c = (*s == '\n' || *s == '\r') ? ' ' : *s;
+    if (strchr(special, c))
+      put('\\');
+    put(c);
+  }
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "Reading.h"
+#include "WindowStats.h"
+
+// Timestamp resolution of InfluxDB line protocol (the write endpoint's
+// `precision` query parameter).
+enum class InfluxPrecision : uint8_t
+{
+  Ns = 0,
+  Us = 1,
+  Ms = 2,
+  S = 3
+};
+
+const char *influxPrecisionName(InfluxPrecision precision);
+bool influxPrecisionFromString(const String &text, InfluxPrecision &out);
+
+// Streams InfluxDB line protocol into any Print:
+//
+//   <measurement>,location=<location> temperature_c=21.50,humidity_pct=40.20 <timestamp>
+//
+// Measurement and tag value are escaped as the protocol requires; NaN fields
+// are left out. Numbered readings also carry boot_id/seq as integer fields.
+// With several sensor channels, each line gets a channel tag and the
+// channel's own location. Timestamps come from the reading's epoch seconds,
+// or from its age relative to the current wall clock when it was sampled before
+// SNTP synced; lines without either are written without a timestamp and
+// the server stamps them on arrival. Output is staged in a small buffer
+// like PayloadWriter's, so the socket sees a few large writes.
+class LineProtocolWriter
+{
+public:
+  LineProtocolWriter(Print &out, const char *measurement, const String &location, InfluxPrecision precision);
+  ~LineProtocolWriter() { flush(); }
+
+  // nowMs / nowEpoch: millis() and time() at render time (nowEpoch 0 if the
+  // clock is not set). channel, if given, is written as a tag and location,
+  // if given, replaces the writer's location for this line.
+  void reading(const Reading &r, uint32_t nowMs, uint32_t nowEpoch, const char *channel = nullptr, const String *location = nullptr);
+  // Writes the message as a string field named "error".
+  void error(const String &message);
+  // One window's statistics as a "<measurement>_stats" line with a window
+  // tag (seconds) and <quantity>_{count,min,max,mean,stddev} fields,
+  // stamped with nowEpoch (or by the server when it is 0).
+  void stats(const WindowStats::Summary &s, uint32_t nowEpoch, const char *channel = nullptr, const String *location = nullptr);
+
+  void flush();
+  // Bytes produced so far (buffered or flushed).
+  size_t bytesWritten() const { return total_; }
+  // False once the underlying Print accepted fewer bytes than offered.
+  bool ok() const { return !failed_; }
+
+private:
+  void head(const char *channel = nullptr, const String *location = nullptr, const char *suffix = nullptr);
+  void quantity(const char *name, const WindowStats::Quantity &q, bool first);
+  void timestamp(uint32_t epochSeconds, uint16_t millisPart);
+  void put(char c);
+  void put(const char *s);
+  void putEscaped(const char *s, const char *special);
+
+  Print &out_;
+  const char *measurement_;
+  const String &location_;
+  InfluxPrecision precision_;
+  uint8_t buf_[64];
+  size_t len_;
+  size_t total_;
+  bool failed_;
+};
@@ -17,9 +17,19 @@ namespace
         uint32_t sensorReadConsecutiveFailures = 0;
         uint32_t lastSensorReadMillis = 0;
         uint32_t lastSensorReadSuccessMillis = 0;
+        uint32_t lastSensorReadDurationMillis = 0;
         float lastTemperatureC = NAN;
         float lastHumidityPct = NAN;
 
+        uint32_t readingsReported = 0;
+        uint32_t readingsSuppressed = 0;
+
+        uint32_t readCacheHits = 0;
+        uint32_t readCacheCoalesced = 0;
+        uint32_t readCacheMisses = 0;
+
+        uint32_t filterRejected = 0;
+
         uint32_t postReadingTotal = 0;
         uint32_t postReadingFailed = 0;
         uint32_t postReadingConsecutiveFailures = 0;
@@ -32,6 +42,56 @@ namespace
         uint32_t lastPostErrorMillis = 0;
         uint32_t lastPostErrorSuccessMillis = 0;
 
+        uint32_t postBatchTotal = 0;
+        uint32_t postBatchFailed = 0;
+        uint32_t postBatchReadingsSent = 0;
+        uint32_t postBatchReadingsDropped = 0;
+
+        uint32_t postFailures[7] = {0};
+        uint32_t postReadingsRejected = 0;
+        int32_t lastHttpStatus = 0;
+
+        uint32_t uploadQueueEnqueued = 0;
+        uint32_t uploadQueueDequeued = 0;
+        uint32_t uploadQueueDropped = 0;
+        uint32_t uploadQueueCoalesced = 0;
+        uint32_t uploadQueueBlocked = 0;
+        uint32_t uploadQueueBlockedMillisTotal = 0;
+        uint32_t uploadQueueDepthMax = 0;
+        uint32_t uploadQueueWaitLastMillis = 0;
+        uint32_t uploadQueueWaitMaxMillis = 0;
+        uint32_t uploadQueueWaitMillisTotal = 0;
+
+        uint8_t breakerState = 0;
+        uint32_t breakerConsecutiveFailures = 0;
+        uint32_t breakerRetryAtMillis = 0;
+        uint32_t breakerTrips = 0;
+        uint32_t breakerProbes = 0;
+        uint32_t breakerShortCircuits = 0;
+
+        SinkMetrics sinks[kMetricsMaxSinks] = {};
+        ChannelMetrics channels[kMetricsMaxChannels] = {};
+
+        LatencyHistogram postPhases[static_cast<size_t>(Metrics::PostPhase::Count)] = {};
+
+        uint32_t upstreamConnectionsOpened = 0;
+        uint32_t upstreamConnectionsReused = 0;
+        uint32_t upstreamServerCloses = 0;
+
+        uint32_t postBodyBytes = 0;
+        uint32_t postWireBytes = 0;
+        uint32_t postsCompressed = 0;
+        uint32_t postsChunked = 0;
+        uint32_t postSocketWrites = 0;
+        uint32_t tlsRecordsWritten = 0;
+
+        uint32_t tlsHandshakesFull = 0;
+        uint32_t tlsHandshakesResumed = 0;
+        uint32_t tlsHandshakesFailed = 0;
+        uint32_t tlsHandshakeLastMillis = 0;
+        uint32_t tlsHandshakeFullMillisTotal = 0;
+        uint32_t tlsHandshakeResumedMillisTotal = 0;
+
         uint32_t wifiConnectAttempts = 0;
         uint32_t wifiReconnectEvents = 0;
         uint32_t wifiLastAttemptMillis = 0;
@@ -45,25 +105,82 @@ namespace
     portMUX_TYPE gMetricsMux = portMUX_INITIALIZER_UNLOCKED;
 }
 
-void Metrics::recordSensorRead(bool success, float temperatureC, float humidityPct)
+void Metrics::recordSensorRead(uint8_t channel, bool success, float temperatureC, float humidityPct, uint32_t durationMs)
 {
     const uint32_t now = millis();
     portENTER_CRITICAL(&gMetricsMux);
     gMetrics.sensorReadTotal++;
     gMetrics.lastSensorReadMillis = now;
+    gMetrics.lastSensorReadDurationMillis = durationMs;
     if (success)
     {
         gMetrics.sensorReadSuccess++;
         gMetrics.sensorReadConsecutiveFailures = 0;
         gMetrics.lastSensorReadSuccessMillis = now;
-        gMetrics.lastTemperatureC = temperatureC;
-        gMetrics.lastHumidityPct = humidityPct;
+        if (channel == 0)
+        {
+            gMetrics.lastTemperatureC = temperatureC;
+            gMetrics.lastHumidityPct = humidityPct;
+        }
     }
     else
     {
         gMetrics.sensorReadFailed++;
         gMetrics.sensorReadConsecutiveFailures++;
     }
+    if (channel < kMetricsMaxChannels)
+    {
+        ChannelMetrics &c = gMetrics.channels[channel];
+        c.reads++;
+        if (success)
+        {
+            c.consecutiveFailures = 0;
+        }
+        else
+        {
+            c.failed++;
+            c.consecutiveFailures++;
+        }
+        c.latencyLastMillis = durationMs;
+        c.latencyMillisTotal += durationMs;
+        if (durationMs > c.latencyMaxMillis)
+            c.latencyMaxMillis = durationMs;
+    }
+    portEXIT_CRITICAL(&gMetricsMux);
+}
+
+void Metrics::recordReadingReported(bool reported)
+{
+    portENTER_CRITICAL(&gMetricsMux);
+    if (reported)
+        gMetrics.readingsReported++;
+    else
+        gMetrics.readingsSuppressed++;
+    portEXIT_CRITICAL(&gMetricsMux);
+}
+
+void Metrics::recordReadCache(ReadCacheResult result)
+{
+    portENTER_CRITICAL(&gMetricsMux);
+    switch (result)
+    {
+    case ReadCacheResult::Hit:
+        gMetrics.readCacheHits++;
+        break;
+    case ReadCacheResult::Coalesced:
+        gMetrics.readCacheCoalesced++;
+        break;
+    case ReadCacheResult::Miss:
+        gMetrics.readCacheMisses++;
+        break;
+    }
+    portEXIT_CRITICAL(&gMetricsMux);
+}
+
+void Metrics::recordFilterRejected(uint32_t values)
+{
+    portENTER_CRITICAL(&gMetricsMux);
+    gMetrics.filterRejected += values;
     portEXIT_CRITICAL(&gMetricsMux);
 }
 
@@ -104,6 +221,251 @@ void Metrics::recordPostResult(PostKind kind, bool success)
     portEXIT_CRITICAL(&gMetricsMux);
 }
 
+void Metrics::recordPostFailure(PostFailure reason)
+{
+    const size_t idx = static_cast<size_t>(reason);
+    portENTER_CRITICAL(&gMetricsMux);
+    if (idx < sizeof(gMetrics.postFailures) / sizeof(gMetrics.postFailures[0]))
+    {
+        gMetrics.postFailures[idx]++;
+    }
+    portEXIT_CRITICAL(&gMetricsMux);
+}
+
+void Metrics::recordHttpStatus(int status)
+{
+    portENTER_CRITICAL(&gMetricsMux);
+    gMetrics.lastHttpStatus = status;
+    portEXIT_CRITICAL(&gMetricsMux);
+}
+
+void Metrics::recordPostRejected(uint32_t readings)
+{
+    portENTER_CRITICAL(&gMetricsMux);
+    gMetrics.postReadingsRejected += readings;
+    portEXIT_CRITICAL(&gMetricsMux);
+}
+
+void Metrics::recordBatchFlush(uint32_t readings, bool success)
+{
+    portENTER_CRITICAL(&gMetricsMux);
+    gMetrics.postBatchTotal++;
+    if (success)
+    {
+        gMetrics.postBatchReadingsSent += readings;
+    }
+    else
+    {
+        gMetrics.postBatchFailed++;
+    }
+    portEXIT_CRITICAL(&gMetricsMux);
+}
+
+void Metrics::recordBatchDropped(uint32_t readings)
+{
+    portENTER_CRITICAL(&gMetricsMux);
+    gMetrics.postBatchReadingsDropped += readings;
+    portEXIT_CRITICAL(&gMetricsMux);
+}
+
+void Metrics::recordUploadQueued(uint32_t depth)
+{
+    portENTER_CRITICAL(&gMetricsMux);
+    gMetrics.uploadQueueEnqueued++;
+    if (depth > gMetrics.uploadQueueDepthMax)
+        gMetrics.uploadQueueDepthMax = depth;
+    portEXIT_CRITICAL(&gMetricsMux);
+}
+
+void Metrics::recordUploadQueueWait(uint32_t waitMs)
+{
+    portENTER_CRITICAL(&gMetricsMux);
+    gMetrics.uploadQueueDequeued++;
+    gMetrics.uploadQueueWaitLastMillis = waitMs;
+    gMetrics.uploadQueueWaitMillisTotal += waitMs;
+    if (waitMs > gMetrics.uploadQueueWaitMaxMillis)
+        gMetrics.uploadQueueWaitMaxMillis = waitMs;
+    portEXIT_CRITICAL(&gMetricsMux);
+}
+
+void Metrics::recordUploadQueueDropped(uint32_t items)
+{
+    portENTER_CRITICAL(&gMetricsMux);
+    gMetrics.uploadQueueDropped += items;
+    portEXIT_CRITICAL(&gMetricsMux);
+}
+
+void Metrics::recordUploadQueueCoalesced(uint32_t readings)
+{
+    portENTER_CRITICAL(&gMetricsMux);
+    gMetrics.uploadQueueCoalesced += readings;
+    portEXIT_CRITICAL(&gMetricsMux);
+}
+
+void Metrics::recordUploadQueueBlocked(uint32_t waitMs)
+{
+    portENTER_CRITICAL(&gMetricsMux);
+    gMetrics.uploadQueueBlocked++;
+    gMetrics.uploadQueueBlockedMillisTotal += waitMs;
+    portEXIT_CRITICAL(&gMetricsMux);
+}
+
+void Metrics::recordBreakerState(uint8_t state, uint32_t consecutiveFailures, uint32_t retryAtMillis, uint32_t trips, uint32_t probes)
+{
+    portENTER_CRITICAL(&gMetricsMux);
+    gMetrics.breakerState = state;
+    gMetrics.breakerConsecutiveFailures = consecutiveFailures;
+    gMetrics.breakerRetryAtMillis = retryAtMillis;
+    gMetrics.breakerTrips = trips;
+    gMetrics.breakerProbes = probes;
+    portEXIT_CRITICAL(&gMetricsMux);
+}
+
+void Metrics::recordBreakerShortCircuit()
+{
+    portENTER_CRITICAL(&gMetricsMux);
+    gMetrics.breakerShortCircuits++;
+    portEXIT_CRITICAL(&gMetricsMux);
+}
+
+void Metrics::recordSinkPost(size_t sink, bool success, uint32_t latencyMs)
+{
+    if (sink >= kMetricsMaxSinks)
+        return;
+    portENTER_CRITICAL(&gMetricsMux);
+    SinkMetrics &m = gMetrics.sinks[sink];
+    if (success)
+        m.delivered++;
+    else
+        m.failed++;
+    m.latencyLastMillis = latencyMs;
+    m.latencyMillisTotal += latencyMs;
+    if (latencyMs > m.latencyMaxMillis)
+        m.latencyMaxMillis = latencyMs;
+    portEXIT_CRITICAL(&gMetricsMux);
+}
+
+void Metrics::recordSinkDropped(size_t sink, uint32_t items)
+{
+    if (sink >= kMetricsMaxSinks)
+        return;
+    portENTER_CRITICAL(&gMetricsMux);
+    gMetrics.sinks[sink].dropped += items;
+    portEXIT_CRITICAL(&gMetricsMux);
+}
+
+void Metrics::recordUpstreamConnection(bool reused)
+{
+    portENTER_CRITICAL(&gMetricsMux);
+    if (reused)
+    {
+        gMetrics.upstreamConnectionsReused++;
+    }
+    else
+    {
+        gMetrics.upstreamConnectionsOpened++;
+    }
+    portEXIT_CRITICAL(&gMetricsMux);
+}
+
+void Metrics::recordUpstreamServerClose()
+{
+    portENTER_CRITICAL(&gMetricsMux);
+    gMetrics.upstreamServerCloses++;
+    portEXIT_CRITICAL(&gMetricsMux);
+}
+
+void Metrics::recordPostBody(uint32_t rawBytes, uint32_t wireBytes, bool compressed, bool chunked)
+{
+    portENTER_CRITICAL(&gMetricsMux);
+    gMetrics.postBodyBytes += rawBytes;
+    gMetrics.postWireBytes += wireBytes;
+    if (compressed)
+        gMetrics.postsCompressed++;
+    if (chunked)
+        gMetrics.postsChunked++;
+    portEXIT_CRITICAL(&gMetricsMux);
+}
+
+void Metrics::recordPostWrites(uint32_t writes, uint32_t tlsRecords)
+{
+    portENTER_CRITICAL(&gMetricsMux);
+    gMetrics.postSocketWrites += writes;
+    gMetrics.tlsRecordsWritten += tlsRecords;
+    portEXIT_CRITICAL(&gMetricsMux);
+}
+
+void Metrics::recordTlsHandshake(uint32_t durationMs, bool resumed)
+{
+    portENTER_CRITICAL(&gMetricsMux);
+    gMetrics.tlsHandshakeLastMillis = durationMs;
+    if (resumed)
+    {
+        gMetrics.tlsHandshakesResumed++;
+        gMetrics.tlsHandshakeResumedMillisTotal += durationMs;
+    }
+    else
+    {
+        gMetrics.tlsHandshakesFull++;
+        gMetrics.tlsHandshakeFullMillisTotal += durationMs;
+    }
+    portEXIT_CRITICAL(&gMetricsMux);
+}
+
+void Metrics::recordTlsHandshakeFailure()
+{
+    portENTER_CRITICAL(&gMetricsMux);
+    gMetrics.tlsHandshakesFailed++;
+    portEXIT_CRITICAL(&gMetricsMux);
+}
+
+const char *Metrics::postPhaseName(PostPhase phase)
+{
+    switch (phase)
+    {
+    case PostPhase::Dns:
+        return "dns";
+    case PostPhase::Connect:
+        return "connect";
+    case PostPhase::Tls:
+        return "tls";
+    case PostPhase::Ttfb:
+        return "ttfb";
+    case PostPhase::Total:
+    default:
+        return "total";
+    }
+}
+
+void Metrics::recordPostPhase(PostPhase phase, uint32_t durationMs)
+{
+    const size_t p = static_cast<size_t>(phase);
+    if (p >= static_cast<size_t>(PostPhase::Count))
+        return;
+    size_t bucket = 0;
+    while (bucket < kLatencyBuckets - 1 && durationMs > kLatencyBucketBoundsMs[bucket])
+        ++bucket;
+    portENTER_CRITICAL(&gMetricsMux);
+    LatencyHistogram &h = gMetrics.postPhases[p];
+    h.buckets[bucket]++;
+    h.count++;
+    h.sumMillis += durationMs;
+    portEXIT_CRITICAL(&gMetricsMux);
+}
+
+void Metrics::latencyHistogram(PostPhase phase, LatencyHistogram &out)
+{
+    const size_t p = static_cast<size_t>(phase);
+    if (p >= static_cast<size_t>(PostPhase::Count))
+    {
+        out = LatencyHistogram{};
+        return;
+    }
+    portENTER_CRITICAL(&gMetricsMux);
+    out = gMetrics.postPhases[p];
+    portEXIT_CRITICAL(&gMetricsMux);
+}
+
 MetricsSnapshot Metrics::snapshot()
 {
     MetricsSnapshot snap{};
@@ -114,8 +476,15 @@ MetricsSnapshot Metrics::snapshot()
     snap.sensorReadConsecutiveFailures = gMetrics.sensorReadConsecutiveFailures;
     snap.lastSensorReadMillis = gMetrics.lastSensorReadMillis;
     snap.lastSensorReadSuccessMillis = gMetrics.lastSensorReadSuccessMillis;
+    snap.lastSensorReadDurationMillis = gMetrics.lastSensorReadDurationMillis;
     snap.lastTemperatureC = gMetrics.lastTemperatureC;
     snap.lastHumidityPct = gMetrics.lastHumidityPct;
+    snap.readingsReported = gMetrics.readingsReported;
+    snap.readingsSuppressed = gMetrics.readingsSuppressed;
+    snap.readCacheHits = gMetrics.readCacheHits;
+    snap.readCacheCoalesced = gMetrics.readCacheCoalesced;
+    snap.readCacheMisses = gMetrics.readCacheMisses;
+    snap.filterRejected = gMetrics.filterRejected;
 
     snap.postReadingTotal = gMetrics.postReadingTotal;
     snap.postReadingFailed = gMetrics.postReadingFailed;
@@ -129,6 +498,62 @@ MetricsSnapshot Metrics::snapshot()
     snap.lastPostErrorMillis = gMetrics.lastPostErrorMillis;
     snap.lastPostErrorSuccessMillis = gMetrics.lastPostErrorSuccessMillis;
 
+    snap.postBatchTotal = gMetrics.postBatchTotal;
+    snap.postBatchFailed = gMetrics.postBatchFailed;
+    snap.postBatchReadingsSent = gMetrics.postBatchReadingsSent;
+    snap.postBatchReadingsDropped = gMetrics.postBatchReadingsDropped;
+
+    snap.postFailConnect = gMetrics.postFailures[static_cast<size_t>(PostFailure::Connect)];
+    snap.postFailWrite = gMetrics.postFailures[static_cast<size_t>(PostFailure::Write)];
+    snap.postFailTimeout = gMetrics.postFailures[static_cast<size_t>(PostFailure::Timeout)];
+    snap.postFailBadResponse = gMetrics.postFailures[static_cast<size_t>(PostFailure::BadResponse)];
+    snap.postFailHttp4xx = gMetrics.postFailures[static_cast<size_t>(PostFailure::Http4xx)];
+    snap.postFailHttp5xx = gMetrics.postFailures[static_cast<size_t>(PostFailure::Http5xx)];
+    snap.postFailHttpOther = gMetrics.postFailures[static_cast<size_t>(PostFailure::HttpOther)];
+    snap.postReadingsRejected = gMetrics.postReadingsRejected;
+    snap.lastHttpStatus = gMetrics.lastHttpStatus;
+
+    snap.uploadQueueEnqueued = gMetrics.uploadQueueEnqueued;
+    snap.uploadQueueDequeued = gMetrics.uploadQueueDequeued;
+    snap.uploadQueueDropped = gMetrics.uploadQueueDropped;
+    snap.uploadQueueCoalesced = gMetrics.uploadQueueCoalesced;
+    snap.uploadQueueBlocked = gMetrics.uploadQueueBlocked;
+    snap.uploadQueueBlockedMillisTotal = gMetrics.uploadQueueBlockedMillisTotal;
+    snap.uploadQueueDepthMax = gMetrics.uploadQueueDepthMax;
+    snap.uploadQueueWaitLastMillis = gMetrics.uploadQueueWaitLastMillis;
+    snap.uploadQueueWaitMaxMillis = gMetrics.uploadQueueWaitMaxMillis;
+    snap.uploadQueueWaitMillisTotal = gMetrics.uploadQueueWaitMillisTotal;
+
+    snap.breakerState = gMetrics.breakerState;
+    snap.breakerConsecutiveFailures = gMetrics.breakerConsecutiveFailures;
+    snap.breakerRetryAtMillis = gMetrics.breakerRetryAtMillis;
+    snap.breakerTrips = gMetrics.breakerTrips;
+    snap.breakerProbes = gMetrics.breakerProbes;
+    snap.breakerShortCircuits = gMetrics.breakerShortCircuits;
+
+    for (size_t i = 0; i < kMetricsMaxSinks; ++i)
+        snap.sinks[i] = gMetrics.sinks[i];
+    for (size_t i = 0; i < kMetricsMaxChannels; ++i)
+        snap.channels[i] = gMetrics.channels[i];
+
+    snap.upstreamConnectionsOpened = gMetrics.upstreamConnectionsOpened;
+    snap.upstreamConnectionsReused = gMetrics.upstreamConnectionsReused;
+    snap.upstreamServerCloses = gMetrics.upstreamServerCloses;
+
+    snap.postBodyBytes = gMetrics.postBodyBytes;
+    snap.postWireBytes = gMetrics.postWireBytes;
+    snap.postsCompressed = gMetrics.postsCompressed;
+    snap.postsChunked = gMetrics.postsChunked;
+    snap.postSocketWrites = gMetrics.postSocketWrites;
+    snap.tlsRecordsWritten = gMetrics.tlsRecordsWritten;
+
+    snap.tlsHandshakesFull = gMetrics.tlsHandshakesFull;
+    snap.tlsHandshakesResumed = gMetrics.tlsHandshakesResumed;
+    snap.tlsHandshakesFailed = gMetrics.tlsHandshakesFailed;
+    snap.tlsHandshakeLastMillis = gMetrics.tlsHandshakeLastMillis;
+    snap.tlsHandshakeFullMillisTotal = gMetrics.tlsHandshakeFullMillisTotal;
+    snap.tlsHandshakeResumedMillisTotal = gMetrics.tlsHandshakeResumedMillisTotal;
+
     snap.wifiConnectAttempts = gMetrics.wifiConnectAttempts;
     snap.wifiReconnectEvents = gMetrics.wifiReconnectEvents;
     snap.wifiLastAttemptMillis = gMetrics.wifiLastAttemptMillis;
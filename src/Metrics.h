@@ -1,7 +1,49 @@
 #pragma once
 
+#include <stddef.h>
 #include <stdint.h>
 
+// Primary sink plus AppConfig::kMaxExtraSinks.
+constexpr size_t kMetricsMaxSinks = 3;
+
+// Per output sink, indexed like the uploader's sink workers (0 = primary).
+struct SinkMetrics
+{
+    uint32_t delivered;
+    uint32_t failed;
+    uint32_t dropped;
+    uint32_t latencyLastMillis;
+    uint32_t latencyMaxMillis;
+    uint32_t latencyMillisTotal;
+};
+
+// SensorChannels::kMaxChannels.
+constexpr size_t kMetricsMaxChannels = 4;
+
+// Per sensor channel, indexed like SensorChannels.
+struct ChannelMetrics
+{
+    uint32_t reads;
+    uint32_t failed;
+    uint32_t consecutiveFailures;
+    uint32_t latencyLastMillis;
+    uint32_t latencyMaxMillis;
+    uint32_t latencyMillisTotal;
+};
+
+// Upper bounds (ms) of the post phase histogram buckets; one more bucket
+// (+Inf) follows the last bound.
+constexpr uint32_t kLatencyBucketBoundsMs[] = {5, 10, 25, 50, 100, 250, 500, 1000, 2500, 5000, 10000};
+constexpr size_t kLatencyBuckets = sizeof(kLatencyBucketBoundsMs) / sizeof(kLatencyBucketBoundsMs[0]) + 1;
+
+// Non-cumulative bucket counts; the exporter accumulates them.
+struct LatencyHistogram
+{
+    uint32_t buckets[kLatencyBuckets];
+    uint32_t count;
+    uint32_t sumMillis;
+};
+
 struct MetricsSnapshot
 {
     uint32_t sensorReadTotal;
@@ -10,9 +52,19 @@ struct MetricsSnapshot
     uint32_t sensorReadConsecutiveFailures;
     uint32_t lastSensorReadMillis;
     uint32_t lastSensorReadSuccessMillis;
+    uint32_t lastSensorReadDurationMillis;
     float lastTemperatureC;
     float lastHumidityPct;
 
+    uint32_t readingsReported;
+    uint32_t readingsSuppressed;
+
+    uint32_t readCacheHits;
+    uint32_t readCacheCoalesced;
+    uint32_t readCacheMisses;
+
+    uint32_t filterRejected;
+
     uint32_t postReadingTotal;
     uint32_t postReadingFailed;
     uint32_t postReadingConsecutiveFailures;
@@ -25,6 +77,60 @@ struct MetricsSnapshot
     uint32_t lastPostErrorMillis;
     uint32_t lastPostErrorSuccessMillis;
 
+    uint32_t postBatchTotal;
+    uint32_t postBatchFailed;
+    uint32_t postBatchReadingsSent;
+    uint32_t postBatchReadingsDropped;
+
+    uint32_t postFailConnect;
+    uint32_t postFailWrite;
+    uint32_t postFailTimeout;
+    uint32_t postFailBadResponse;
+    uint32_t postFailHttp4xx;
+    uint32_t postFailHttp5xx;
+    uint32_t postFailHttpOther;
+    uint32_t postReadingsRejected;
+    int32_t lastHttpStatus;
+
+    uint32_t uploadQueueEnqueued;
+    uint32_t uploadQueueDequeued;
+    uint32_t uploadQueueDropped;
+    uint32_t uploadQueueCoalesced;
+    uint32_t uploadQueueBlocked;
+    uint32_t uploadQueueBlockedMillisTotal;
+    uint32_t uploadQueueDepthMax;
+    uint32_t uploadQueueWaitLastMillis;
+    uint32_t uploadQueueWaitMaxMillis;
+    uint32_t uploadQueueWaitMillisTotal;
+
+    uint8_t breakerState; // CircuitBreaker::State
+    uint32_t breakerConsecutiveFailures;
+    uint32_t breakerRetryAtMillis; // millis() when an open circuit admits a probe; 0 if not open
+    uint32_t breakerTrips;
+    uint32_t breakerProbes;
+    uint32_t breakerShortCircuits;
+
+    SinkMetrics sinks[kMetricsMaxSinks];
+    ChannelMetrics channels[kMetricsMaxChannels];
+
+    uint32_t upstreamConnectionsOpened;
+    uint32_t upstreamConnectionsReused;
+    uint32_t upstreamServerCloses;
+
+    uint32_t postBodyBytes;
+    uint32_t postWireBytes;
+    uint32_t postsCompressed;
+    uint32_t postsChunked;
+    uint32_t postSocketWrites;
+    uint32_t tlsRecordsWritten;
+
+    uint32_t tlsHandshakesFull;
+    uint32_t tlsHandshakesResumed;
+    uint32_t tlsHandshakesFailed;
+    uint32_t tlsHandshakeLastMillis;
+    uint32_t tlsHandshakeFullMillisTotal;
+    uint32_t tlsHandshakeResumedMillisTotal;
+
     uint32_t uptimeMillis;
     uint32_t heapFreeBytes;
     uint32_t heapMinBytes;
@@ -48,10 +154,80 @@ namespace Metrics
         Error = 1
     };
 
-    void recordSensorRead(bool success, float temperatureC, float humidityPct);
+    // Why an upstream post did not end in a 2xx response.
+    enum class PostFailure : uint8_t
+    {
+        Connect = 0,
+        Write = 1,
+        Timeout = 2,
+        BadResponse = 3,
+        Http4xx = 4,
+        Http5xx = 5,
+        HttpOther = 6
+    };
+
+    // Phases of one upstream post. Dns/Connect/Tls are only observed when a
+    // new connection is opened; Ttfb runs from the request being written to
+    // the first response byte; Total covers the whole exchange.
+    enum class PostPhase : uint8_t
+    {
+        Dns = 0,
+        Connect = 1,
+        Tls = 2,
+        Ttfb = 3,
+        Total = 4,
+        Count
+    };
+
+    const char *postPhaseName(PostPhase phase);
+
+    // How an on-demand read (GET /read) was answered.
+    enum class ReadCacheResult : uint8_t
+    {
+        Hit = 0,       // cached sample young enough
+        Coalesced = 1, // waited for a read already in flight and shared its result
+        Miss = 2       // took a new sensor reading
+    };
+
+    // Totals cover every channel; the last temperature/humidity gauges
+    // follow channel 0.
+    void recordSensorRead(uint8_t channel, bool success, float temperatureC, float humidityPct, uint32_t durationMs);
+    // Deadband outcome for a successful reading.
+    void recordReadingReported(bool reported);
+    void recordReadCache(ReadCacheResult result);
+    // Values the reading filter dropped as spikes.
+    void recordFilterRejected(uint32_t values);
     void recordPostResult(PostKind kind, bool success);
+    void recordPostFailure(PostFailure reason);
+    void recordHttpStatus(int status);
+    void recordPostRejected(uint32_t readings);
+    void recordBatchFlush(uint32_t readings, bool success);
+    void recordBatchDropped(uint32_t readings);
+    // Upload queue between the sensor and uploader tasks.
+    void recordUploadQueued(uint32_t depth);
+    void recordUploadQueueWait(uint32_t waitMs);
+    void recordUploadQueueDropped(uint32_t items);
+    void recordUploadQueueCoalesced(uint32_t readings);
+    void recordUploadQueueBlocked(uint32_t waitMs);
+    void recordBreakerState(uint8_t state, uint32_t consecutiveFailures, uint32_t retryAtMillis, uint32_t trips, uint32_t probes);
+    void recordBreakerShortCircuit();
+    // One call per item handed to a sink; latency is how long the sink call blocked.
+    void recordSinkPost(size_t sink, bool success, uint32_t latencyMs);
+    // Items a sink discarded (queue overflow, or undeliverable on a sink
+    // without store-and-forward).
+    void recordSinkDropped(size_t sink, uint32_t items);
+    void recordUpstreamConnection(bool reused);
+    void recordUpstreamServerClose();
+    // Request body size before and after Content-Encoding.
+    void recordPostBody(uint32_t rawBytes, uint32_t wireBytes, bool compressed, bool chunked);
+    // Client::write calls (and TLS records, 0 on plain HTTP) one request took.
+    void recordPostWrites(uint32_t writes, uint32_t tlsRecords);
+    void recordTlsHandshake(uint32_t durationMs, bool resumed);
+    void recordTlsHandshakeFailure();
     void recordWifiAttempt(uint32_t attemptNumber, uint32_t backoffMs);
     void recordWifiConnected();
     void recordWifiDisconnected();
+    void recordPostPhase(PostPhase phase, uint32_t durationMs);
+    void latencyHistogram(PostPhase phase, LatencyHistogram &out);
     MetricsSnapshot snapshot();
 }
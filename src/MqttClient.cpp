@@ -0,0 +1,406 @@
+#include "MqttClient.h"
+
+#include <string.h>
+
+namespace
+{
+  constexpr uint8_t kConnect = 0x10;
+  constexpr uint8_t kConnack = 0x20;
+  constexpr uint8_t kPublish = 0x30;
+  constexpr uint8_t kPuback = 0x40;
+  constexpr uint8_t kPingreq = 0xC0;
+  constexpr uint8_t kPingresp = 0xD0;
+  constexpr uint8_t kDisconnect = 0xE0;
+
+  // Once the first byte of a packet is in, the rest must follow within this.
+  constexpr uint32_t kPacketTimeoutMs = 2000;
+  // Client id, will payload, user name and password share this budget.
+  constexpr size_t kMaxConnectLen = 512;
+  constexpr size_t kMaxPublishLen = 5 + 2 + MqttClient::kMaxTopicLen + 2 + MqttClient::kMaxPayloadLen;
+
+  // Appends to a fixed packet buffer; remembers overflow instead of writing
+  // past the end.
+  struct PacketBuilder
+  {
+    uint8_t *buf;
+    size_t cap;
+    size_t len;
+    bool overflow;
+
+    void byte(uint8_t b)
+    {
+      if (len < cap)
+        buf[len++] = b;
+      else
+        overflow = true;
+    }
+    void u16(uint16_t v)
+    {
+      byte(static_cast<uint8_t>(v >> 8));
+      byte(static_cast<uint8_t>(v & 0xFF));
+    }
+    void raw(const void *data, size_t n)
+    {
+      if (n > cap - len)
+      {
+        overflow = true;
+        return;
+      }
+      memcpy(buf + len, data, n);
+      len += n;
+    }
+    void str(const char *s, size_t n)
+    {
+      u16(static_cast<uint16_t>(n));
+      raw(s, n);
+    }
+    void str(const char *s) { str(s, strlen(s)); }
+  };
+
+  // Writes the fixed header for a body of bodyLen bytes; returns its length.
+  size_t fixedHeader(uint8_t *out, uint8_t type, size_t bodyLen)
+  {
+    size_t n = 0;
+    out[n++] = type;
+    do
+    {
+      uint8_t digit = bodyLen % 128;
+      bodyLen /= 128;
+      if (bodyLen)
+        digit |= 0x80;
+      out[n++] = digit;
+    } while (bodyLen && n < 5);
+    return n;
+  }
+
+  // Builds header + body in buf: the body is assembled after a 5-byte gap,
+  // then the header is written right in front of it.
+  size_t frame(uint8_t *buf, uint8_t type, size_t bodyLen)
+  {
+    uint8_t header[5];
+    const size_t headerLen = fixedHeader(header, type, bodyLen);
+    memmove(buf + headerLen, buf + 5, bodyLen);
+    memcpy(buf, header, headerLen);
+    return headerLen + bodyLen;
+  }
+}
+
+MqttClient::MqttClient()
+    : client_(nullptr), connected_(false), connectResult_(-1), sessionPresent_(false), keepAliveMs_(0), lastSendMs_(0),
+      pingSentMs_(0), pingPending_(false), packetId_(0), inflightCount_(0), acked_(0), resent_(0)
+{
+  memset(inflight_, 0, sizeof(inflight_));
+}
+
+bool MqttClient::connect(const char *clientId, const char *user, const char *password, uint16_t keepAliveSec,
+                         bool cleanSession, const Will *will, uint32_t timeoutMs)
+{
+  connected_ = false;
+  connectResult_ = -1;
+  sessionPresent_ = false;
+  pingPending_ = false;
+  if (!client_ || !client_->connected())
+    return false;
+
+  uint8_t buf[kMaxConnectLen];
+  PacketBuilder p{buf + 5, sizeof(buf) - 5, 0, false};
+  uint8_t flags = cleanSession ? 0x02 : 0x00;
+  if (will && will->topic && will->topic[0])
+    flags |= 0x04 | static_cast<uint8_t>((will->qos & 0x03) << 3) | (will->retain ? 0x20 : 0x00);
+  if (user && user[0])
+  {
+    flags |= 0x80;
+    if (password && password[0])
+      flags |= 0x40;
+  }
+  p.str("MQTT");
+  p.byte(4); // protocol level 3.1.1
+  p.byte(flags);
+  p.u16(keepAliveSec);
+  p.str(clientId);
+  if (flags & 0x04)
+  {
+    p.str(will->topic);
+    p.str(will->payload ? will->payload : "");
+  }
+  if (flags & 0x80)
+    p.str(user);
+  if (flags & 0x40)
+    p.str(password);
+  if (p.overflow)
+    return false;
+  if (!sendPacket(buf, frame(buf, kConnect, p.len)))
+    return false;
+
+  const uint32_t start = millis();
+  for (;;)
+  {
+    uint8_t type = 0;
+    uint8_t body[4];
+    size_t bodyLen = 0;
+    bool got = false;
+    const uint32_t elapsed = millis() - start;
+    if (elapsed >= timeoutMs)
+      return false;
+    if (!readPacket(type, body, sizeof(body), bodyLen, got, timeoutMs - elapsed))
+      return false;
+    if (!got)
+      continue;
+    if ((type & 0xF0) != kConnack || bodyLen < 2)
+      return false;
+    sessionPresent_ = (body[0] & 0x01) != 0;
+    connectResult_ = body[1];
+    break;
+  }
+  if (connectResult_ != 0)
+    return false;
+
+  connected_ = true;
+  keepAliveMs_ = static_cast<uint32_t>(keepAliveSec) * 1000UL;
+  lastSendMs_ = millis();
+  return true;
+}
+
+bool MqttClient::publish(const char *topic, const uint8_t *payload, size_t length, uint8_t qos, bool retain)
+{
+  const size_t topicLen = strlen(topic);
+  if (topicLen == 0 || topicLen > kMaxTopicLen || length > kMaxPayloadLen)
+    return false;
+
+  Pending msg;
+  msg.packetId = 0;
+  msg.used = true;
+  msg.retain = retain;
+  msg.topicLen = static_cast<uint8_t>(topicLen);
+  msg.payloadLen = static_cast<uint16_t>(length);
+  memcpy(msg.topic, topic, topicLen);
+  memcpy(msg.payload, payload, length);
+
+  if (qos == 0)
+    return connected_ && sendPublish(msg, 0, false);
+
+  if (windowFull())
+    return false;
+  Pending *slot = nullptr;
+  for (Pending &p : inflight_)
+  {
+    if (!p.used)
+    {
+      slot = &p;
+      break;
+    }
+  }
+  if (!slot)
+    return false;
+  msg.packetId = nextPacketId();
+  *slot = msg;
+  ++inflightCount_;
+  // Once in the window the message is resent after a reconnect, so a
+  // failed write here still counts as accepted.
+  if (connected_)
+    (void)sendPublish(*slot, 1, false);
+  return true;
+}
+
+bool MqttClient::resendInflight()
+{
+  for (const Pending &p : inflight_)
+  {
+    if (!p.used)
+      continue;
+    if (!sendPublish(p, 1, true))
+      return false;
+    ++resent_;
+  }
+  return true;
+}
+
+bool MqttClient::loop()
+{
+  if (!connected_)
+    return false;
+  if (!client_->connected())
+  {
+    drop();
+    return false;
+  }
+
+  while (client_->available() > 0)
+  {
+    uint8_t type = 0;
+    uint8_t body[4];
+    size_t bodyLen = 0;
+    bool got = false;
+    if (!readPacket(type, body, sizeof(body), bodyLen, got, 0))
+    {
+      drop();
+      return false;
+    }
+    if (!got)
+      break;
+    switch (type & 0xF0)
+    {
+    case kPuback:
+      if (bodyLen >= 2)
+        handleAck(static_cast<uint16_t>((body[0] << 8) | body[1]));
+      break;
+    case kPingresp:
+      pingPending_ = false;
+      break;
+    default:
+      // Nothing else is expected on a publish-only session.
+      break;
+    }
+  }
+
+  if (keepAliveMs_ == 0)
+    return true;
+  const uint32_t now = millis();
+  if (pingPending_)
+  {
+    if (now - pingSentMs_ >= keepAliveMs_)
+    {
+      drop();
+      return false;
+    }
+  }
+  else if (now - lastSendMs_ >= keepAliveMs_ / 2)
+  {
+    const uint8_t ping[2] = {kPingreq, 0};
+    if (!sendPacket(ping, sizeof(ping)))
+      return false;
+    pingPending_ = true;
+    pingSentMs_ = now;
+  }
+  return true;
+}
+
+void MqttClient::disconnect()
+{
+  if (connected_)
+  {
+    const uint8_t packet[2] = {kDisconnect, 0};
+    (void)sendPacket(packet, sizeof(packet));
+  }
+  drop();
+}
+
+void MqttClient::drop()
+{
+  connected_ = false;
+  pingPending_ = false;
+  if (client_)
+    client_->stop();
+}
+
+bool MqttClient::sendPublish(const Pending &msg, uint8_t qos, bool dup)
+{
+  uint8_t buf[kMaxPublishLen];
+  PacketBuilder p{buf + 5, sizeof(buf) - 5, 0, false};
+  p.str(msg.topic, msg.topicLen);
+  if (qos > 0)
+    p.u16(msg.packetId);
+  p.raw(msg.payload, msg.payloadLen);
+  if (p.overflow)
+    return false;
+  const uint8_t type = kPublish | (dup ? 0x08 : 0x00) | static_cast<uint8_t>((qos & 0x03) << 1) | (msg.retain ? 0x01 : 0x00);
+  return sendPacket(buf, frame(buf, type, p.len));
+}
+
+bool MqttClient::sendPacket(const uint8_t *buf, size_t len)
+{
+  if (!client_ || client_->write(buf, len) != len)
+  {
+    drop();
+    return false;
+  }
+  lastSendMs_ = millis();
+  return true;
+}
+
+bool MqttClient::readPacket(uint8_t &type, uint8_t *body, size_t bodyCap, size_t &bodyLen, bool &got, uint32_t waitMs)
+{
+  got = false;
+  bodyLen = 0;
+  if (!readByte(type, waitMs))
+    return client_->connected() || client_->available() > 0;
+
+  size_t remaining = 0;
+  uint32_t multiplier = 1;
+  for (int i = 0;; ++i)
+  {
+    uint8_t digit;
+    if (i == 4 || !readByte(digit, kPacketTimeoutMs))
+      return false;
+    remaining += (digit & 0x7F) * multiplier;
+    multiplier *= 128;
+    if (!(digit & 0x80))
+      break;
+  }
+
+  while (remaining--)
+  {
+    uint8_t b;
+    if (!readByte(b, kPacketTimeoutMs))
+      return false;
+    if (bodyLen < bodyCap)
+      body[bodyLen++] = b;
+  }
+  got = true;
+  return true;
+}
+
+bool MqttClient::readByte(uint8_t &b, uint32_t timeoutMs)
+{
+  const uint32_t start = millis();
+  for (;;)
+  {
+    if (client_->available() > 0)
+    {
+      const int c = client_->read();
+      if (c >= 0)
+      {
+        b = static_cast<uint8_t>(c);
+        return true;
+      }
+    }
+    if (!client_->connected() || millis() - start >= timeoutMs)
+      return false;
+    delay(1);
+  }
+}
+
+void MqttClient::handleAck(uint16_t packetId)
+{
+  for (Pending &p : inflight_)
+  {
+    if (p.used && p.packetId == packetId)
+    {
+      p.used = false;
+      --inflightCount_;
+      ++acked_;
+      return;
+    }
+  }
+}
+
+uint16_t MqttClient::nextPacketId()
+{
+  // 0 is not a valid packet id; skip ids still waiting for a PUBACK.
+  for (;;)
+  {
+    if (++packetId_ == 0)
+      packetId_ = 1;
+    bool busy = false;
+    for (const Pending &p : inflight_)
+    {
+      if (p.used && p.packetId == packetId_)
+      {
+        busy = true;
+        break;
+      }
+    }
+    if (!busy)
+      return packetId_;
+  }
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <Arduino.h>
+#include <Client.h>
+
+// Minimal MQTT 3.1.1 publisher over any Arduino Client (plain TCP or
+// TlsClient). Publish-only: no subscriptions, so the only packets expected
+// from the broker are CONNACK, PUBACK and PINGRESP.
+//
+// QoS 1 messages are kept in a small in-flight window until the broker
+// acknowledges them. With a persistent session (cleanSession = false) the
+// window survives reconnects: resendInflight() re-sends what was never
+// acknowledged, flagged as duplicates, as the spec requires.
+//
+// Every packet is framed in a stack buffer and handed to the Client in one
+// write, so over TLS each packet is a single record.
+class MqttClient
+{
+public:
+  static constexpr size_t kMaxTopicLen = 96;
+  static constexpr size_t kMaxPayloadLen = 256;
+  static constexpr size_t kMaxInflight = 8;
+
+  struct Will
+  {
+    const char *topic;
+    const char *payload;
+    uint8_t qos;
+    bool retain;
+  };
+
+  MqttClient();
+
+  // Socket to speak MQTT over; must already be connected when connect() runs.
+  void setClient(Client *client) { client_ = client; }
+
+  // Sends CONNECT and waits for CONNACK. user/password may be empty.
+  bool connect(const char *clientId, const char *user, const char *password, uint16_t keepAliveSec,
+               bool cleanSession, const Will *will, uint32_t timeoutMs);
+  // CONNACK return code of the last connect() (0 = accepted, -1 = no reply).
+  int lastConnectResult() const { return connectResult_; }
+  bool sessionPresent() const { return sessionPresent_; }
+
+  // QoS 0 or 1. False if the socket write failed or, for QoS 1, the
+  // in-flight window is full (call loop() to collect PUBACKs and retry).
+  bool publish(const char *topic, const uint8_t *payload, size_t length, uint8_t qos, bool retain);
+
+  // Reads whatever the broker sent and keeps the session alive with
+  // PINGREQ. Returns false once the connection is gone or the broker
+  // stopped answering pings.
+  bool loop();
+
+  // Re-sends unacknowledged QoS 1 messages with DUP set; false on a write
+  // error.
+  bool resendInflight();
+  // Sends DISCONNECT (the broker then discards the will) and closes the socket.
+  void disconnect();
+  // Closes the socket without DISCONNECT (the broker publishes the will).
+  void drop();
+
+  bool connected() const { return connected_; }
+  bool windowFull() const { return inflightCount_ >= kMaxInflight; }
+  size_t inflight() const { return inflightCount_; }
+
+  // Lifetime counters.
+  uint32_t acked() const { return acked_; }
+  uint32_t resent() const { return resent_; }
+
+private:
+  struct Pending
+  {
+    uint16_t packetId;
+    bool used;
+    bool retain;
+    uint8_t topicLen;
+    uint16_t payloadLen;
+    char topic[kMaxTopicLen];
+    uint8_t payload[kMaxPayloadLen];
+  };
+
+  bool sendPublish(const Pending &msg, uint8_t qos, bool dup);
+  bool sendPacket(const uint8_t *buf, size_t len);
+  // Reads one packet if one is (starting to be) available. Returns false on
+  // a malformed packet or timeout mid-packet; sets got when one was read.
+  bool readPacket(uint8_t &type, uint8_t *body, size_t bodyCap, size_t &bodyLen, bool &got, uint32_t waitMs);
+  bool readByte(uint8_t &b, uint32_t timeoutMs);
+  void handleAck(uint16_t packetId);
+  uint16_t nextPacketId();
+
+  Client *client_;
+  bool connected_;
+  int connectResult_;
+  bool sessionPresent_;
+  uint32_t keepAliveMs_;
+  uint32_t lastSendMs_;
+  uint32_t pingSentMs_;
+  bool pingPending_;
+  uint16_t packetId_;
+
+  Pending inflight_[kMaxInflight];
+  size_t inflightCount_;
+  uint32_t acked_;
+  uint32_t resent_;
+};
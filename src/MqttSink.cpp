@@ -0,0 +1,325 @@
+#include "MqttSink.h"
+
+#include <esp_system.h>
+#include <string.h>
+
+#include "config.h"
+#include "AppConfig.h"
+#include "DnsCache.h"
+#include "JsonWriter.h"
+#include "Metrics.h"
+#include "SensorChannels.h"
+#include "StructuredLog.h"
+
+namespace
+{
+  constexpr uint16_t kKeepAliveSec = 60;
+  constexpr uint32_t kConnectTimeoutMs = 5000;
+  // Longest a publish waits for PUBACKs when the QoS 1 window is full.
+  constexpr uint32_t kWindowWaitMs = 2000;
+  // Reconnect backoff: doubles per failed attempt, plus jitter.
+  constexpr uint32_t kReconnectMinMs = 2000;
+  constexpr uint32_t kReconnectMaxMs = 5UL * 60UL * 1000UL;
+  constexpr uint32_t kReconnectJitterMs = 1000;
+
+  const char kOnline[] = "online";
+  const char kOffline[] = "offline";
+}
+
+MqttSink::MqttSink(uint8_t sinkIndex)
+    : sinkIndex_(sinkIndex), settingsGeneration_(0), settingsValid_(false), reconnectAtMs_(0), reconnectBackoffMs_(0)
+{
+  strncpy(name_, "mqtt", sizeof(name_) - 1);
+  name_[sizeof(name_) - 1] = '\0';
+  AppConfig::SinkConfig sink;
+  if (sinkIndex_ > 0 && AppConfig::get().getExtraSink(sinkIndex_ - 1, sink))
+  {
+    strncpy(name_, sink.name.c_str(), sizeof(name_) - 1);
+    name_[sizeof(name_) - 1] = '\0';
+  }
+  // Stable across reboots so the broker can resume the persistent session.
+  const uint64_t mac = ESP.getEfuseMac();
+  snprintf(clientId_, sizeof(clientId_), "esp32-%06lx-%s", static_cast<unsigned long>((mac >> 24) & 0xFFFFFF), name_);
+  mqtt_.setClient(&plainClient_);
+}
+
+void MqttSink::refreshSettings()
+{
+  auto &cfg = AppConfig::get();
+  const uint32_t gen = cfg.getGeneration();
+  if (settingsValid_ && gen == settingsGeneration_)
+    return;
+
+  Settings next;
+  AppConfig::SinkConfig sink;
+  next.enabled = cfg.getExtraSink(sinkIndex_ - 1, sink) && sink.enabled && sink.type.equalsIgnoreCase("mqtt");
+  next.host = sink.host;
+  next.user = sink.user;
+  next.password = sink.apiKey;
+  next.location = cfg.getDeviceLocation();
+  next.port = sink.port;
+  next.qos = sink.qos;
+  next.useTls = sink.useTls;
+  next.insecure = sink.insecure;
+  next.retain = sink.retain;
+
+  next.topic = sink.topic;
+  next.topic.replace("{location}", next.location);
+  next.topic.replace("{name}", String(name_));
+  next.topic.replace("{client_id}", String(clientId_));
+  // Wildcards are not allowed in topic names we publish to.
+  next.topic.replace("+", "_");
+  next.topic.replace("#", "_");
+  while (next.topic.endsWith("/"))
+    next.topic.remove(next.topic.length() - 1);
+
+  const bool sessionChanged = !settingsValid_ || next.enabled != settings_.enabled || next.host != settings_.host ||
+                              next.port != settings_.port || next.useTls != settings_.useTls ||
+                              next.insecure != settings_.insecure || next.user != settings_.user ||
+                              next.password != settings_.password || next.topic != settings_.topic;
+  if (sessionChanged && mqtt_.connected())
+  {
+    LOGF_INFO("MQTT sink '%s': settings changed; reconnecting", name_);
+    closeSession(true);
+  }
+  if (sessionChanged)
+    reconnectAtMs_ = millis();
+
+  settings_ = next;
+  settingsGeneration_ = gen;
+  settingsValid_ = true;
+}
+
+Client *MqttSink::openSocket()
+{
+  IPAddress ip;
+  if (!DnsCache::resolve(settings_.host, ip))
+  {
+    LOGF_WARN("MQTT sink '%s': cannot resolve %s", name_, settings_.host.c_str());
+    return nullptr;
+  }
+
+  if (settings_.useTls)
+  {
+    if (settings_.insecure)
+      tlsClient_.setInsecure();
+    else
+      tlsClient_.setCACert(kHttpsRootCA);
+    if (!tlsClient_.connect(ip, settings_.port, settings_.host.c_str()))
+    {
+      Metrics::recordTlsHandshakeFailure();
+      DnsCache::expire(settings_.host);
+      return nullptr;
+    }
+    Metrics::recordTlsHandshake(tlsClient_.lastHandshakeMillis(), tlsClient_.lastHandshakeResumed());
+    return &tlsClient_;
+  }
+
+  if (!plainClient_.connect(ip, settings_.port))
+  {
+    DnsCache::expire(settings_.host);
+    return nullptr;
+  }
+  plainClient_.setNoDelay(true);
+  return &plainClient_;
+}
+
+bool MqttSink::ensureSession()
+{
+  if (mqtt_.connected())
+    return true;
+  if (!settings_.enabled || WiFi.status() != WL_CONNECTED)
+    return false;
+  if (static_cast<int32_t>(millis() - reconnectAtMs_) < 0)
+    return false;
+
+  Client *socket = openSocket();
+  if (!socket)
+  {
+    LOGF_WARN("MQTT sink '%s': connect to %s:%u failed", name_, settings_.host.c_str(), static_cast<unsigned>(settings_.port));
+    scheduleReconnect();
+    return false;
+  }
+  mqtt_.setClient(socket);
+
+  const String statusTopic = settings_.topic + "/status";
+  MqttClient::Will will{statusTopic.c_str(), kOffline, 1, true};
+  if (!mqtt_.connect(clientId_, settings_.user.c_str(), settings_.password.c_str(), kKeepAliveSec, false, &will, kConnectTimeoutMs))
+  {
+    LOGF_WARN("MQTT sink '%s': broker refused session (code %d)", name_, mqtt_.lastConnectResult());
+    mqtt_.drop();
+    scheduleReconnect();
+    return false;
+  }
+
+  reconnectBackoffMs_ = 0;
+  LOGF_INFO("MQTT sink '%s' connected as %s (session %s, %u in flight)", name_, clientId_,
+            mqtt_.sessionPresent() ? "resumed" : "new", static_cast<unsigned>(mqtt_.inflight()));
+  if (!mqtt_.resendInflight())
+    return false;
+  (void)mqtt_.publish(statusTopic.c_str(), reinterpret_cast<const uint8_t *>(kOnline), strlen(kOnline), 1, true);
+  return mqtt_.connected();
+}
+
+void MqttSink::scheduleReconnect()
+{
+  reconnectBackoffMs_ = reconnectBackoffMs_ == 0 ? kReconnectMinMs : reconnectBackoffMs_ * 2;
+  if (reconnectBackoffMs_ > kReconnectMaxMs)
+    reconnectBackoffMs_ = kReconnectMaxMs;
+  reconnectAtMs_ = millis() + reconnectBackoffMs_ + (esp_random() % kReconnectJitterMs);
+}
+
+void MqttSink::closeSession(bool graceful)
+{
+  if (graceful && mqtt_.connected())
+  {
+    const String statusTopic = settings_.topic + "/status";
+    (void)mqtt_.publish(statusTopic.c_str(), reinterpret_cast<const uint8_t *>(kOffline), strlen(kOffline), 0, true);
+    mqtt_.disconnect();
+  }
+  else
+  {
+    mqtt_.drop();
+  }
+}
+
+bool MqttSink::publish(const char *leaf, const uint8_t *payload, size_t length, uint8_t qos, bool retain)
+{
+  if (!ensureSession())
+    return false;
+
+  char topic[MqttClient::kMaxTopicLen + 1];
+  const int n = snprintf(topic, sizeof(topic), "%s/%s", settings_.topic.c_str(), leaf);
+  if (n <= 0 || static_cast<size_t>(n) >= sizeof(topic))
+  {
+    LOGF_WARN("MQTT sink '%s': topic too long", name_);
+    return false;
+  }
+
+  if (qos > 0 && mqtt_.windowFull())
+  {
+    // Give the broker a moment to acknowledge before giving up.
+    const uint32_t start = millis();
+    while (mqtt_.windowFull() && mqtt_.loop() && millis() - start < kWindowWaitMs)
+      delay(10);
+    if (mqtt_.windowFull())
+    {
+      LOGF_WARN("MQTT sink '%s': %u messages unacknowledged; dropping", name_, static_cast<unsigned>(mqtt_.inflight()));
+      return false;
+    }
+  }
+  return mqtt_.publish(topic, payload, length, qos, retain);
+}
+
+void MqttSink::dropped()
+{
+  Metrics::recordSinkDropped(sinkIndex_, 1);
+}
+
+bool MqttSink::postReading(const Reading &reading)
+{
+  refreshSettings();
+  if (!settings_.enabled)
+  {
+    dropped();
+    return false;
+  }
+
+  uint8_t payload[MqttClient::kMaxPayloadLen];
+  BufferPrint out(payload, sizeof(payload));
+  {
+    JsonWriter w(out);
+    const bool tagged = SensorChannels::tagged();
+    w.beginObject((reading.timestamp ? 4 : 3) + (reading.seq ? 2 : 0) + (tagged ? 1 : 0));
+    if (tagged)
+    {
+      w.field("location", SensorChannels::location(reading.channel, settings_.location));
+      w.field("channel", SensorChannels::get(reading.channel).name);
+    }
+    else
+    {
+      w.field("location", settings_.location);
+    }
+    if (reading.seq)
+    {
+      w.field("boot_id", reading.bootId);
+      w.field("seq", reading.seq);
+    }
+    if (reading.timestamp)
+      w.field("timestamp", reading.timestamp);
+    w.field("temperature_c", reading.temperatureC, 2);
+    w.field("humidity_pct", reading.humidityPct, 2);
+    w.endObject();
+    w.flush();
+    if (!w.ok())
+    {
+      dropped();
+      return false;
+    }
+  }
+
+  if (!publish("reading", payload, out.length(), settings_.qos, settings_.retain))
+  {
+    dropped();
+    return false;
+  }
+  return true;
+}
+
+bool MqttSink::postError(const String &message)
+{
+  refreshSettings();
+  if (!settings_.enabled)
+  {
+    dropped();
+    return false;
+  }
+
+  uint8_t payload[MqttClient::kMaxPayloadLen];
+  BufferPrint out(payload, sizeof(payload));
+  {
+    JsonWriter w(out);
+    w.beginObject(2);
+    w.field("location", settings_.location);
+    w.field("error", message);
+    w.endObject();
+    w.flush();
+    if (!w.ok())
+    {
+      dropped();
+      return false;
+    }
+  }
+
+  if (!publish("error", payload, out.length(), settings_.qos, false))
+  {
+    dropped();
+    return false;
+  }
+  return true;
+}
+
+void MqttSink::service()
+{
+  refreshSettings();
+  if (!settings_.enabled)
+  {
+    if (mqtt_.connected())
+      closeSession(true);
+    return;
+  }
+  if (mqtt_.connected())
+  {
+    if (!mqtt_.loop())
+    {
+      LOGF_WARN("MQTT sink '%s': connection lost", name_);
+      scheduleReconnect();
+    }
+    return;
+  }
+  if (WiFi.status() == WL_CONNECTED)
+  {
+    DnsCache::refresh(settings_.host);
+    (void)ensureSession();
+  }
+}
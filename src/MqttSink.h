@@ -0,0 +1,78 @@
+#pragma once
+
+#include <Arduino.h>
+#include <WiFi.h>
+
+#include "MqttClient.h"
+#include "OutputSink.h"
+#include "Reading.h"
+#include "TlsClient.h"
+
+// MQTT output sink (an extra sink with "type": "mqtt"). Keeps one MQTT
+// session open to the broker instead of a request per reading:
+//
+//   <topic>/reading  JSON reading (one per sensor channel), sink QoS and
+//                    retain flag
+//   <topic>/error    JSON error message, sink QoS
+//   <topic>/status   "online" / "offline", retained; "offline" is also the
+//                    will, so the broker publishes it if the device vanishes
+//
+// The session is persistent (clean session off, stable client id), so QoS 1
+// readings still in flight when the link drops are re-sent after the
+// reconnect. Like the other extra sinks it is best effort: readings that
+// cannot be published are counted as dropped rather than queued offline.
+class MqttSink : public OutputSink
+{
+public:
+  explicit MqttSink(uint8_t sinkIndex);
+
+  const char *name() const override { return name_; }
+
+  bool postReading(const Reading &reading) override;
+  bool postError(const String &message) override;
+  // Keeps the session alive (pings, PUBACKs) and reconnects in the
+  // background with backoff.
+  void service() override;
+
+private:
+  // Broker settings copied from AppConfig, refreshed only when the config
+  // generation changes.
+  struct Settings
+  {
+    String host;
+    String user;
+    String password;
+    String topic; // prefix with placeholders expanded
+    String location;
+    uint16_t port = 1883;
+    uint8_t qos = 1;
+    bool useTls = false;
+    bool insecure = false;
+    bool retain = false;
+    bool enabled = false;
+  };
+
+  void refreshSettings();
+  bool ensureSession();
+  Client *openSocket();
+  // graceful: publish "offline" and send DISCONNECT first.
+  void closeSession(bool graceful);
+  void scheduleReconnect();
+  bool publish(const char *leaf, const uint8_t *payload, size_t length, uint8_t qos, bool retain);
+  void dropped();
+
+  uint8_t sinkIndex_;
+  char name_[16];
+  char clientId_[40];
+
+  WiFiClient plainClient_;
+  TlsClient tlsClient_;
+  MqttClient mqtt_;
+
+  Settings settings_;
+  uint32_t settingsGeneration_;
+  bool settingsValid_;
+
+  uint32_t reconnectAtMs_;
+  uint32_t reconnectBackoffMs_;
+};
@@ -0,0 +1,346 @@
+#include "OfflineQueue.h"
+
+#include <LittleFS.h>
+#include <esp_system.h>
+#include <time.h>
+
+#include "SegmentLog.h"
+#include "StructuredLog.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+// Segment log directory (LittleFS is mounted at /littlefs).
+#ifndef OFFLINE_QUEUE_DIR
+#define OFFLINE_QUEUE_DIR "/littlefs/oq"
+#endif
+
+namespace
+{
+    constexpr size_t kRamCapacity = 64;
+    // RAM entries older than this are moved to flash so a reset loses little.
+    constexpr uint32_t kSpillAgeMs = 5UL * 60UL * 1000UL;
+    // 64 x 4 KiB segments hold roughly 9000 readings (~6 days at 1/min).
+    constexpr uint32_t kSegmentBytes = 4096;
+    constexpr uint32_t kMaxSegments = 64;
+    constexpr time_t kMinValidEpoch = 1600000000;
+
+    // On-flash form of a Reading. bootNonce tells whether sampledMs still
+    // refers to the current millis() timeline. bootId/seq and later channel
+    // were appended; older records are 20 or 28 bytes long and read back
+    // with the missing fields zero (SegmentLog zero-extends short records).
+    struct StoredReading
+    {
+        uint32_t timestamp;
+        uint32_t bootNonce;
+        uint32_t sampledMs;
+        float temperatureC;
+        float humidityPct;
+        uint32_t bootId;
+        uint32_t seq;
+        uint8_t channel;
+        uint8_t reserved[3];
+    };
+    static_assert(sizeof(StoredReading) == 32, "StoredReading layout is part of the flash format");
+
+    SegmentLog gLog(OFFLINE_QUEUE_DIR, kSegmentBytes, kMaxSegments);
+    bool gFlashOk = false;
+    uint32_t gBootNonce = 0;
+
+    Reading gRing[kRamCapacity];
+    size_t gRingHead = 0; // index of the oldest entry
+    size_t gRingCount = 0;
+    StoredReading gScratch[kRamCapacity];
+
+    uint32_t gEnqueued = 0;
+    uint32_t gDrained = 0;
+    uint32_t gRamDropped = 0;
+    float gDrainRate = 0.0f;
+
+    // Created by init() before any task can use the queue.
+    SemaphoreHandle_t gMutex = nullptr;
+
+    void lock()
+    {
+        xSemaphoreTake(gMutex, portMAX_DELAY);
+    }
+
+    void unlock()
+    {
+        xSemaphoreGive(gMutex);
+    }
+
+    // Fills in wall time for readings taken before SNTP synced.
+    void backfill(Reading &r, uint32_t nowMs)
+    {
+        if (r.timestamp || r.sampledMs == 0)
+            return;
+        const time_t now = time(nullptr);
+        if (now < kMinValidEpoch)
+            return;
+        r.timestamp = static_cast<uint32_t>(now) - (nowMs - r.sampledMs) / 1000UL;
+    }
+
+    Reading fromStored(const StoredReading &s, uint32_t nowMs)
+    {
+        Reading r;
+        r.timestamp = s.timestamp;
+        r.sampledMs = (s.bootNonce == gBootNonce) ? s.sampledMs : 0;
+        r.temperatureC = s.temperatureC;
+        r.humidityPct = s.humidityPct;
+        r.bootId = s.bootId;
+        r.seq = s.seq;
+        r.channel = s.channel;
+        backfill(r, nowMs);
+        return r;
+    }
+
+    Reading &ringAt(size_t i)
+    {
+        return gRing[(gRingHead + i) % kRamCapacity];
+    }
+
+    bool spillLocked()
+    {
+        if (!gFlashOk || gRingCount == 0)
+            return false;
+        const uint32_t nowMs = millis();
+        for (size_t i = 0; i < gRingCount; ++i)
+        {
+            Reading r = ringAt(i);
+            backfill(r, nowMs);
+            gScratch[i] = {r.timestamp, gBootNonce, r.sampledMs, r.temperatureC, r.humidityPct, r.bootId, r.seq, r.channel, {0, 0, 0}};
+        }
+        if (!gLog.append(gScratch, sizeof(StoredReading), gRingCount))
+        {
+            LOG_WARN(F("Offline queue: flash append failed"));
+            return false;
+        }
+        LOGF_DEBUG("Offline queue: spilled %u readings to flash", static_cast<unsigned>(gRingCount));
+        gRingHead = 0;
+        gRingCount = 0;
+        return true;
+    }
+
+    void popLocked(size_t count, uint32_t durationMs)
+    {
+        size_t remaining = count;
+        if (gFlashOk && gLog.records() > 0)
+        {
+            size_t fromFlash = remaining < gLog.records() ? remaining : gLog.records();
+            gLog.consume(fromFlash);
+            remaining -= fromFlash;
+        }
+        if (remaining > gRingCount)
+            remaining = gRingCount;
+        gRingHead = (gRingHead + remaining) % kRamCapacity;
+        gRingCount -= remaining;
+
+        gDrained += count;
+        if (durationMs > 0)
+        {
+            const float rate = (count * 1000.0f) / durationMs;
+            gDrainRate = (gDrainRate > 0.0f) ? (gDrainRate * 0.7f + rate * 0.3f) : rate;
+        }
+    }
+
+    void pushLocked(const Reading &reading)
+    {
+        if (gRingCount == kRamCapacity && !spillLocked())
+        {
+            gRingHead = (gRingHead + 1) % kRamCapacity;
+            gRingCount--;
+            gRamDropped++;
+        }
+        ringAt(gRingCount) = reading;
+        gRingCount++;
+        gEnqueued++;
+    }
+}
+
+bool OfflineQueue::init()
+{
+    if (!gMutex)
+        gMutex = xSemaphoreCreateMutex();
+    gBootNonce = esp_random();
+    if (!LittleFS.begin(true))
+    {
+        LOG_WARN(F("Offline queue: LittleFS mount failed; buffering in RAM only"));
+        return false;
+    }
+    lock();
+    gFlashOk = gLog.open();
+    const uint32_t recovered = gLog.records();
+    unlock();
+    if (!gFlashOk)
+    {
+        LOG_WARN(F("Offline queue: cannot open segment log; buffering in RAM only"));
+        return false;
+    }
+    if (recovered)
+        LOGF_INFO("Offline queue: %u readings pending from previous boot", static_cast<unsigned>(recovered));
+    return true;
+}
+
+void OfflineQueue::push(const Reading &reading)
+{
+    lock();
+    pushLocked(reading);
+    unlock();
+}
+
+void OfflineQueue::pushMany(const Reading *readings, size_t count)
+{
+    lock();
+    for (size_t i = 0; i < count; ++i)
+        pushLocked(readings[i]);
+    unlock();
+}
+
+size_t OfflineQueue::peek(Reading *out, size_t maxCount, Mark &mark)
+{
+    const uint32_t nowMs = millis();
+    size_t n = 0;
+    lock();
+    const SegmentLog::Position start = gLog.cursor();
+    mark.segment = start.segment;
+    mark.offset = start.offset;
+    mark.dropMark = gLog.droppedRecords();
+    mark.ramDropMark = gRamDropped;
+    if (gFlashOk && gLog.records() > 0)
+    {
+        size_t want = maxCount < kRamCapacity ? maxCount : kRamCapacity;
+        size_t got = gLog.peek(gScratch, sizeof(StoredReading), want);
+        for (; n < got; ++n)
+            out[n] = fromStored(gScratch[n], nowMs);
+    }
+    for (size_t i = 0; n < maxCount && i < gRingCount; ++i, ++n)
+    {
+        out[n] = ringAt(i);
+        backfill(out[n], nowMs);
+    }
+    unlock();
+    return n;
+}
+
+bool OfflineQueue::beginStream(Stream &s, size_t maxCount)
+{
+    lock();
+    const uint32_t depth = gFlashOk ? gLog.records() : 0;
+    const SegmentLog::Position start = gLog.cursor();
+    s.startSegment = s.segment = start.segment;
+    s.startOffset = s.offset = start.offset;
+    s.count = maxCount < depth ? static_cast<uint32_t>(maxCount) : depth;
+    s.yielded = 0;
+    s.dropMark = gLog.droppedRecords();
+    unlock();
+    return s.count > 0;
+}
+
+size_t OfflineQueue::readStream(Stream &s, Reading *out, size_t maxCount)
+{
+    const uint32_t nowMs = millis();
+    size_t want = s.count - s.yielded;
+    if (want > maxCount)
+        want = maxCount;
+    if (want > kRamCapacity)
+        want = kRamCapacity;
+    size_t got = 0;
+    lock();
+    if (gFlashOk && want > 0 && gLog.droppedRecords() == s.dropMark)
+    {
+        SegmentLog::Position pos{s.segment, s.offset};
+        got = gLog.read(pos, gScratch, sizeof(StoredReading), want);
+        for (size_t i = 0; i < got; ++i)
+            out[i] = fromStored(gScratch[i], nowMs);
+        s.segment = pos.segment;
+        s.offset = pos.offset;
+    }
+    unlock();
+    s.yielded += static_cast<uint32_t>(got);
+    return got;
+}
+
+bool OfflineQueue::commitStream(const Stream &s, uint32_t durationMs)
+{
+    lock();
+    const SegmentLog::Position start = gLog.cursor();
+    const bool unchanged = gFlashOk && start.segment == s.startSegment && start.offset == s.startOffset &&
+                           gLog.droppedRecords() == s.dropMark && gLog.records() >= s.yielded;
+    if (unchanged)
+        popLocked(s.yielded, durationMs);
+    unlock();
+    return unchanged;
+}
+
+bool OfflineQueue::pop(const Mark &mark, size_t count, uint32_t durationMs)
+{
+    lock();
+    // A spill between peek and pop only moves RAM entries behind the flash
+    // ones, which keeps the order; a drop on either tier does not.
+    const SegmentLog::Position start = gLog.cursor();
+    const bool unchanged = start.segment == mark.segment && start.offset == mark.offset &&
+                           gLog.droppedRecords() == mark.dropMark && gRamDropped == mark.ramDropMark;
+    if (unchanged)
+        popLocked(count, durationMs);
+    unlock();
+    return unchanged;
+}
+
+bool OfflineQueue::empty()
+{
+    lock();
+    bool isEmpty = gRingCount == 0 && (!gFlashOk || gLog.records() == 0);
+    unlock();
+    return isEmpty;
+}
+
+void OfflineQueue::maintain()
+{
+    lock();
+    if (gRingCount > 0 && (millis() - ringAt(0).sampledMs) >= kSpillAgeMs)
+        (void)spillLocked();
+    unlock();
+}
+
+OfflineQueue::Stats OfflineQueue::stats()
+{
+    Stats s{};
+    const uint32_t nowMs = millis();
+    lock();
+    s.ramDepth = gRingCount;
+    s.flashDepth = gFlashOk ? gLog.records() : 0;
+    s.flashBytes = gFlashOk ? gLog.bytes() : 0;
+    s.depth = s.ramDepth + s.flashDepth;
+    s.enqueued = gEnqueued;
+    s.drained = gDrained;
+    s.dropped = gRamDropped + gLog.droppedRecords();
+    s.corruptSegments = gLog.corruptSegments();
+    s.drainRatePerSec = gDrainRate;
+    s.flashAvailable = gFlashOk;
+
+    bool haveOldest = false;
+    Reading oldest{};
+    StoredReading stored;
+    if (s.flashDepth > 0 && gLog.peek(&stored, sizeof(stored), 1) == 1)
+    {
+        oldest = fromStored(stored, nowMs);
+        haveOldest = true;
+    }
+    else if (gRingCount > 0)
+    {
+        oldest = ringAt(0);
+        haveOldest = true;
+    }
+    unlock();
+
+    if (haveOldest)
+    {
+        const time_t now = time(nullptr);
+        if (oldest.sampledMs)
+            s.oldestAgeSec = (nowMs - oldest.sampledMs) / 1000UL;
+        else if (oldest.timestamp && now >= kMinValidEpoch && static_cast<uint32_t>(now) > oldest.timestamp)
+            s.oldestAgeSec = static_cast<uint32_t>(now) - oldest.timestamp;
+    }
+    return s;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "Reading.h"
+
+// Store-and-forward queue for readings that could not be delivered.
+//
+// Readings land in a RAM ring first. The ring spills to an append-only
+// segment log on LittleFS when it fills up or when its oldest entry has
+// waited for a while, so a long outage or a reboot does not lose data.
+// peek()/pop() always hand out the oldest readings first (flash, then RAM).
+namespace OfflineQueue
+{
+    struct Stats
+    {
+        uint32_t depth;
+        uint32_t ramDepth;
+        uint32_t flashDepth;
+        uint32_t flashBytes;
+        uint32_t oldestAgeSec;
+        uint32_t enqueued;
+        uint32_t drained;
+        uint32_t dropped;
+        uint32_t corruptSegments;
+        float drainRatePerSec;
+        bool flashAvailable;
+    };
+
+    // Where the queue started when peek() copied readings out; pop() checks
+    // it so readings dropped meanwhile are not mistaken for delivered ones.
+    struct Mark
+    {
+        uint32_t segment;
+        uint32_t offset;
+        uint32_t dropMark;    // flash drops at peek time
+        uint32_t ramDropMark; // RAM ring drops at peek time
+    };
+
+    // Sequential read over the flash backlog, for posts too large to hold
+    // in RAM: beginStream(), readStream() page by page, then commitStream()
+    // once the upstream accepted what was read.
+    struct Stream
+    {
+        uint32_t startSegment;
+        uint32_t startOffset;
+        uint32_t segment;
+        uint32_t offset;
+        uint32_t count;    // readings the stream will yield at most
+        uint32_t yielded;  // readings handed out so far
+        uint32_t dropMark; // flash drops when the stream began
+    };
+
+    // Creates the queue lock, mounts LittleFS and reopens the segment log
+    // left by a previous boot. Call once at startup, before the tasks start.
+    bool init();
+
+    void push(const Reading &reading);
+    void pushMany(const Reading *readings, size_t count);
+    // Copies up to maxCount of the oldest readings without removing them.
+    size_t peek(Reading *out, size_t maxCount, Mark &mark);
+    // Removes the count oldest readings after they were delivered,
+    // provided the queue lost none since the peek() that filled in mark;
+    // false (nothing removed) otherwise. durationMs is how long the
+    // delivery took (drain throughput).
+    bool pop(const Mark &mark, size_t count, uint32_t durationMs);
+    bool empty();
+    // Starts a stream over at most maxCount of the oldest flash readings;
+    // false if flash holds none. Reading RAM entries is left to peek().
+    bool beginStream(Stream &s, size_t maxCount);
+    // Next readings of the stream; fewer than asked at its end, or 0 if
+    // flash changed under it (oldest segment dropped).
+    size_t readStream(Stream &s, Reading *out, size_t maxCount);
+    // Removes the s.yielded readings after delivery, provided the log
+    // still starts where the stream did; false (nothing removed) otherwise.
+    bool commitStream(const Stream &s, uint32_t durationMs);
+    // Spills aged RAM entries to flash. Call regularly.
+    void maintain();
+    Stats stats();
+}
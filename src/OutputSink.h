@@ -0,0 +1,37 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "Reading.h"
+
+// A destination for readings. Each configured sink is driven by its own
+// uploader worker task (see UploaderTask.h), so implementations are only
+// ever called from one task and may block on network I/O without holding
+// up sampling or the other sinks.
+class OutputSink
+{
+public:
+  virtual ~OutputSink() {}
+
+  // Short label used in logs, task names and metric labels.
+  virtual const char *name() const = 0;
+
+  // Delivers or buffers one reading; false if it was not delivered (it may
+  // still be queued for a later attempt).
+  virtual bool postReading(const Reading &reading) = 0;
+  // One sample cycle (a reading per sensor channel). Sinks that can carry
+  // several readings in one message override this; the default posts them
+  // one by one.
+  virtual bool postReadings(const Reading *readings, size_t count)
+  {
+    bool ok = true;
+    for (size_t i = 0; i < count; ++i)
+      ok = postReading(readings[i]) && ok;
+    return ok;
+  }
+  virtual bool postError(const String &message) = 0;
+
+  // Periodic housekeeping (batch flush, retries). Called at least once a
+  // second by the worker.
+  virtual void service() = 0;
+};
@@ -0,0 +1,77 @@
+#include "PayloadWriter.h"
+
+const char *payloadFormatName(PayloadFormat format)
+{
+  switch (format)
+  {
+  case PayloadFormat::Cbor:
+    return "cbor";
+  case PayloadFormat::MsgPack:
+    return "msgpack";
+  case PayloadFormat::Influx:
+    return "influx";
+  case PayloadFormat::Json:
+  default:
+    return "json";
+  }
+}
+
+const char *payloadContentType(PayloadFormat format)
+{
+  switch (format)
+  {
+  case PayloadFormat::Cbor:
+    return "application/cbor";
+  case PayloadFormat::MsgPack:
+    return "application/msgpack";
+  case PayloadFormat::Influx:
+    return "text/plain; charset=utf-8";
+  case PayloadFormat::Json:
+  default:
+    return "application/json";
+  }
+}
+
+bool payloadFormatFromString(const String &text, PayloadFormat &out)
+{
+  if (text.equalsIgnoreCase("json"))
+    out = PayloadFormat::Json;
+  else if (text.equalsIgnoreCase("cbor"))
+    out = PayloadFormat::Cbor;
+  else if (text.equalsIgnoreCase("msgpack") || text.equalsIgnoreCase("messagepack"))
+    out = PayloadFormat::MsgPack;
+  else if (text.equalsIgnoreCase("influx") || text.equalsIgnoreCase("line"))
+    out = PayloadFormat::Influx;
+  else
+    return false;
+  return true;
+}
+
+PayloadWriter::PayloadWriter(Print &out) : out_(out), len_(0), total_(0), failed_(false)
+{
+}
+
+void PayloadWriter::flush()
+{
+  if (len_ == 0)
+    return;
+  size_t written = out_.write(buf_, len_);
+  if (written != len_)
+    failed_ = true;
+  len_ = 0;
+}
+
+void PayloadWriter::put(uint8_t b)
+{
+  if (len_ == kBufferSize)
+    flush();
+  buf_[len_++] = b;
+  ++total_;
+}
+
+void PayloadWriter::putRaw(const void *data, size_t n)
+{
+  const uint8_t *p = static_cast<const uint8_t *>(data);
+  while (n--)
+    put(*p++);
+}
@@ -0,0 +1,256 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Wire encodings for upload payloads.
+enum class PayloadFormat : uint8_t
+{
+  Json = 0,
+  Cbor = 1,
+  MsgPack = 2,
+  // InfluxDB line protocol; rendered by LineProtocolWriter, not a PayloadWriter.
+  Influx = 3
+};
+
+const char *payloadFormatName(PayloadFormat format);
+const char *payloadContentType(PayloadFormat format);
+bool payloadFormatFromString(const String &text, PayloadFormat &out);
+
+// Streaming encoder interface shared by the JSON, CBOR and MessagePack
+// writers. Output goes through a small stack buffer into any Print, so
+// nothing is allocated on the heap. Binary formats need container sizes up
+// front, so beginObject/beginArray take the number of fields/items (JSON
+// ignores them).
+class PayloadWriter
+{
+public:
+  explicit PayloadWriter(Print &out);
+  virtual ~PayloadWriter() { flush(); }
+
+  virtual void beginObject(size_t fields) = 0;
+  virtual void endObject() = 0;
+  virtual void beginArray(size_t items) = 0;
+  virtual void endArray() = 0;
+
+  // Writes a map key; must be followed by exactly one value or container.
+  virtual void key(const char *name) = 0;
+
+  virtual void value(const char *s) = 0;
+  void value(const String &s) { value(s.c_str()); }
+  // decimals only affects text output (max 6); NaN/inf become null.
+  virtual void value(float v, uint8_t decimals) = 0;
+  virtual void value(uint32_t v) = 0;
+  virtual void value(int32_t v) = 0;
+  virtual void value(bool b) = 0;
+  virtual void null() = 0;
+
+  template <typename T>
+  void field(const char *name, const T &v)
+  {
+    key(name);
+    value(v);
+  }
+  void field(const char *name, float v, uint8_t decimals)
+  {
+    key(name);
+    value(v, decimals);
+  }
+
+  // Pushes buffered bytes to the underlying Print.
+  void flush();
+  // Bytes produced so far (buffered or flushed).
+  size_t bytesWritten() const { return total_; }
+  // False once the underlying Print accepted fewer bytes than offered.
+  bool ok() const { return !failed_; }
+
+  static constexpr size_t kBufferSize = 64;
+
+protected:
+  void put(uint8_t b);
+  void putRaw(const void *data, size_t n);
+
+private:
+  Print &out_;
+  uint8_t buf_[kBufferSize];
+  size_t len_;
+  size_t total_;
+  bool failed_;
+};
+
+// Print sink that only counts bytes (used to size Content-Length before
+// streaming the same payload into the socket).
+class ByteCounter : public Print
+{
+public:
+  size_t write(uint8_t) override
+  {
+    ++count_;
+    return 1;
+  }
+  size_t write(const uint8_t *, size_t size) override
+  {
+    count_ += size;
+    return size;
+  }
+  size_t count() const { return count_; }
+
+private:
+  size_t count_ = 0;
+};
+
+// Print into a caller-owned fixed buffer (for payloads that must be complete
+// before they are framed, e.g. MQTT PUBLISH). Bytes past the end are
+// refused, which makes PayloadWriter::ok() report the overflow.
+class BufferPrint : public Print
+{
+public:
+  BufferPrint(uint8_t *buf, size_t capacity) : buf_(buf), capacity_(capacity) {}
+
+  size_t write(uint8_t b) override
+  {
+    if (len_ >= capacity_)
+      return 0;
+    buf_[len_++] = b;
+    return 1;
+  }
+  size_t write(const uint8_t *data, size_t size) override
+  {
+    if (size > capacity_ - len_)
+      return 0;
+    memcpy(buf_ + len_, data, size);
+    len_ += size;
+    return size;
+  }
+  size_t length() const { return len_; }
+
+private:
+  uint8_t *buf_;
+  size_t capacity_;
+  size_t len_ = 0;
+};
+
+// Collects small prints in a caller-owned buffer and hands them to out in
+// as few writes as the buffer allows (on TLS each write is a record of its
+// own). Call flush() at the end; ok() turns false once out took less than
+// offered.
+class WriteCoalescer : public Print
+{
+public:
+  WriteCoalescer(Print &out, uint8_t *buf, size_t capacity) : out_(out), buf_(buf), capacity_(capacity) {}
+
+  size_t write(uint8_t b) override { return write(&b, 1); }
+  size_t write(const uint8_t *data, size_t size) override
+  {
+    if (failed_)
+      return 0;
+    if (size > capacity_ - len_)
+    {
+      flush();
+      // Larger than the whole buffer: pass straight through.
+      if (size > capacity_)
+        return forward(data, size) ? size : 0;
+    }
+    memcpy(buf_ + len_, data, size);
+    len_ += size;
+    return size;
+  }
+  void flush() override
+  {
+    if (len_ > 0 && !failed_)
+      (void)forward(buf_, len_);
+    len_ = 0;
+  }
+  bool ok() const { return !failed_; }
+  // Writes issued to out so far.
+  uint32_t writes() const { return writes_; }
+
+private:
+  bool forward(const uint8_t *data, size_t size)
+  {
+    ++writes_;
+    if (out_.write(data, size) != size)
+      failed_ = true;
+    return !failed_;
+  }
+
+  Print &out_;
+  uint8_t *buf_;
+  size_t capacity_;
+  size_t len_ = 0;
+  uint32_t writes_ = 0;
+  bool failed_ = false;
+};
+
+// HTTP/1.1 chunked transfer coding (RFC 9112 7.1) over out, for bodies
+// whose length is not known up front. Data is collected in a caller-owned
+// buffer that also holds the framing, so every chunk is a single write:
+// "<size hex>\r\n<data>\r\n". finish() sends the last chunk and the
+// terminating "0\r\n\r\n"; a body abandoned without it is incomplete to the
+// server.
+class ChunkedPrint : public Print
+{
+public:
+  // capacity covers data and framing; it must exceed kFraming.
+  ChunkedPrint(Print &out, uint8_t *buf, size_t capacity) : out_(out), buf_(buf), capacity_(capacity - kFraming) {}
+
+  size_t write(uint8_t b) override { return write(&b, 1); }
+  size_t write(const uint8_t *data, size_t size) override
+  {
+    size_t done = 0;
+    while (done < size && !failed_)
+    {
+      size_t n = capacity_ - len_;
+      if (n > size - done)
+        n = size - done;
+      memcpy(buf_ + kSizeLine + len_, data + done, n);
+      len_ += n;
+      done += n;
+      if (len_ == capacity_)
+        flush();
+    }
+    return failed_ ? 0 : done;
+  }
+  // Sends the pending data as one chunk.
+  void flush() override
+  {
+    if (len_ == 0 || failed_)
+      return;
+    char line[kSizeLine + 1];
+    const int n = snprintf(line, sizeof(line), "%X\r\n", static_cast<unsigned>(len_));
+    uint8_t *start = buf_ + kSizeLine - n;
+    memcpy(start, line, static_cast<size_t>(n));
+    buf_[kSizeLine + len_] = '\r';
+    buf_[kSizeLine + len_ + 1] = '\n';
+    const size_t total = static_cast<size_t>(n) + len_ + 2;
+    ++writes_;
+    if (out_.write(start, total) != total)
+      failed_ = true;
+    len_ = 0;
+  }
+  // Ends the body; false if any write came up short.
+  bool finish()
+  {
+    flush();
+    if (!failed_)
+    {
+      ++writes_;
+      if (out_.write(reinterpret_cast<const uint8_t *>("0\r\n\r\n"), 5) != 5)
+        failed_ = true;
+    }
+    return !failed_;
+  }
+  bool ok() const { return !failed_; }
+  uint32_t writes() const { return writes_; }
+
+  // Room for up to six hex digits plus CRLF before the data, CRLF after.
+  static constexpr size_t kSizeLine = 8;
+  static constexpr size_t kFraming = kSizeLine + 2;
+
+private:
+  Print &out_;
+  uint8_t *buf_;
+  size_t capacity_; // data bytes per chunk
+  size_t len_ = 0;
+  uint32_t writes_ = 0;
+  bool failed_ = false;
+};
@@ -1,145 +1,1122 @@
 #include "Poster.h"
 
-#include <WiFi.h>
-#include <WiFiClientSecure.h>
+#include <esp_system.h>
+#include <lwip/sockets.h>
+#include <string.h>
 #include <time.h>
 
 #include "config.h"
 #include "AppConfig.h"
+#include "BinaryWriters.h"
+#include "DnsCache.h"
+#include "Gzip.h"
+#include "HttpResponseParser.h"
+#include "JsonWriter.h"
 #include "Metrics.h"
+#include "OfflineQueue.h"
+#include "SensorChannels.h"
+#include "Sequence.h"
 #include "StructuredLog.h"
+#include "TaskWatchdog.h"
+
+#ifndef INFLUX_MEASUREMENT
+#define INFLUX_MEASUREMENT "environment"
+#endif
+
+#ifndef OFFLINE_STREAM_MAX_READINGS
+#define OFFLINE_STREAM_MAX_READINGS 1440
+#endif
 
 static inline void logHeap(const char *tag)
 {
   LOGF_DEBUG("[Heap][%s] Free:%u Min:%u", tag, ESP.getFreeHeap(), ESP.getMinFreeHeap());
 }
 
-Poster::Poster() {}
+namespace
+{
+  // Upper bound for the whole response (status line to end of body).
+  constexpr unsigned long kResponseTimeoutMs = 5000;
+  // Reconnect instead of reusing a socket that sat idle this long; NAT boxes
+  // and proxies tend to drop idle flows silently well before this.
+  constexpr unsigned long kMaxIdleReuseMs = 5UL * 60UL * 1000UL;
+  constexpr size_t kReadChunk = 128;
+  // Offline queue drain: one chunk per interval while the upstream accepts,
+  // exponential backoff (plus jitter) while it does not.
+  constexpr size_t kDrainChunk = 16;
+  constexpr uint32_t kDrainIntervalMs = 2000;
+  constexpr uint32_t kDrainBackoffMinMs = 5000;
+  constexpr uint32_t kDrainBackoffMaxMs = 5UL * 60UL * 1000UL;
+  constexpr uint32_t kDrainJitterMs = 1000;
+  // A flash backlog deeper than one chunk is sent as one chunked post of up
+  // to this many readings, read from flash kDrainChunk at a time.
+  constexpr size_t kStreamMaxReadings = OFFLINE_STREAM_MAX_READINGS;
+  // Circuit breaker: open after this many failed posts in a row, for 10 s
+  // at first and doubling per failed probe up to 10 min.
+  constexpr uint8_t kBreakerFailureThreshold = 3;
+  constexpr uint32_t kBreakerBaseOpenMs = 10000;
+  constexpr uint32_t kBreakerMaxOpenMs = 10UL * 60UL * 1000UL;
+  // Epoch values below this mean SNTP has not set the clock yet.
+  constexpr time_t kMinValidEpoch = 1600000000;
+
+  // Blocks until fd is readable or timeoutMs passes.
+  bool waitReadable(int fd, uint32_t timeoutMs)
+  {
+    if (fd < 0)
+    {
+      delay(timeoutMs < 10 ? timeoutMs : 10);
+      return true;
+    }
+    fd_set readSet;
+    FD_ZERO(&readSet);
+    FD_SET(fd, &readSet);
+    struct timeval tv;
+    tv.tv_sec = timeoutMs / 1000;
+    tv.tv_usec = (timeoutMs % 1000) * 1000;
+    return select(fd + 1, &readSet, nullptr, nullptr, &tv) > 0;
+  }
 
-bool Poster::postJSON(const String &body)
+  // Renders a payload in one of the PayloadWriter encodings. Returns the
+  // bytes produced, or 0 when the sink did not accept all of them.
+  size_t encodePayload(Print &out, PayloadFormat format, void (*render)(PayloadWriter &, const void *), const void *ctx)
+  {
+    auto run = [&](PayloadWriter &w) -> size_t
+    {
+      render(w, ctx);
+      w.flush();
+      return w.ok() ? w.bytesWritten() : 0;
+    };
+    switch (format)
+    {
+    case PayloadFormat::Cbor:
+    {
+      CborWriter w(out);
+      return run(w);
+    }
+    case PayloadFormat::MsgPack:
+    {
+      MsgPackWriter w(out);
+      return run(w);
+    }
+    case PayloadFormat::Json:
+    default:
+    {
+      JsonWriter w(out);
+      return run(w);
+    }
+    }
+  }
+}
+
+Poster::Poster(uint8_t sinkIndex)
+    : sinkIndex_(sinkIndex), active_(nullptr), connPort_(0), connTls_(false), connInsecure_(false), connLastUsedMs_(0),
+      endpointGeneration_(0), endpointValid_(false), holdUntilMs_(0), holdActive_(false),
+      breaker_(kBreakerFailureThreshold, kBreakerBaseOpenMs, kBreakerMaxOpenMs), breakerReported_(CircuitBreaker::State::Closed), batchCount_(0),
+      writeBuf_(), gzipBuf_(nullptr), gzipCap_(0), stats_(), drainNextMs_(0), drainBackoffMs_(0),
+      lastStatus_(0), streamTooLarge_(false), streamRejected_(false)
 {
-  if (WiFi.status() != WL_CONNECTED)
-    return false;
+  strncpy(name_, "primary", sizeof(name_) - 1);
+  name_[sizeof(name_) - 1] = '\0';
+  AppConfig::SinkConfig sink;
+  if (sinkIndex_ > 0 && AppConfig::get().getExtraSink(sinkIndex_ - 1, sink))
+  {
+    strncpy(name_, sink.name.c_str(), sizeof(name_) - 1);
+    name_[sizeof(name_) - 1] = '\0';
+  }
+  // The RTC copy has a single slot; it belongs to the primary endpoint.
+  tlsClient_.persistSessionInRtc(sinkIndex_ == 0);
+}
 
-  auto &cfg = AppConfig::get();
-  const String host = cfg.getServerHost();
-  const uint16_t port = cfg.getServerPort();
-  const String path = cfg.getServerPath();
-  const String apiKey = cfg.getApiKey();
-  const bool useTls = cfg.getUseTls();
-  const bool insecure = cfg.getHttpsInsecure();
-
-  auto sendRequest = [&](Client &c)
-  {
-    c.print(F("POST "));
-    c.print(path);
-    c.println(F(" HTTP/1.1"));
-    c.print(F("Host: "));
-    c.print(host);
-    if (port != 80 && port != 443)
-    {
-      c.print(F(":"));
-      c.print(port);
-    }
-    c.println();
-    if (apiKey.length())
-    {
-      c.print(F("Authorization: Bearer "));
-      c.println(apiKey);
-    }
-    c.println(F("Content-Type: application/json"));
-    c.print(F("Content-Length: "));
-    c.println(body.length());
-    c.println(F("Connection: close"));
-    c.println();
-    c.print(body);
-  };
+void Poster::closeConnection()
+{
+  if (active_)
+  {
+    active_->stop();
+    active_ = nullptr;
+  }
+}
+
+Client *Poster::acquireConnection(const String &host, uint16_t port, bool useTls, bool insecure, bool &reused)
+{
+  reused = false;
+  if (active_)
+  {
+    bool sameEndpoint = (connHost_ == host) && (connPort_ == port) && (connTls_ == useTls) && (connInsecure_ == insecure);
+    bool fresh = (millis() - connLastUsedMs_) < kMaxIdleReuseMs;
+    if (sameEndpoint && fresh && active_->connected())
+    {
+      reused = true;
+      return active_;
+    }
+    if (sameEndpoint && fresh)
+    {
+      LOG_DEBUG(F("Upstream connection closed by server; reconnecting"));
+      if (primary())
+        Metrics::recordUpstreamServerClose();
+    }
+    closeConnection();
+  }
 
+  // Resolve separately so DNS time shows up as its own phase.
+  const uint32_t dnsStart = millis();
+  IPAddress ip;
+  if (!DnsCache::resolve(host, ip))
+  {
+    LOG_WARN(F("HTTP connect failed (DNS)"));
+    return nullptr;
+  }
+  if (primary())
+    Metrics::recordPostPhase(Metrics::PostPhase::Dns, millis() - dnsStart);
+
+  Client *client = nullptr;
+  const uint32_t connectStart = millis();
   if (useTls)
   {
-    WiFiClientSecure client;
     if (insecure)
     {
-      client.setInsecure();
+      tlsClient_.setInsecure();
     }
     else
     {
-      client.setCACert(kHttpsRootCA);
+      tlsClient_.setCACert(kHttpsRootCA);
     }
-    if (!client.connect(host.c_str(), port))
+    if (!tlsClient_.connect(ip, port, host.c_str()))
     {
       LOG_WARN(F("HTTP connect failed (TLS)"));
-      return false;
+      if (primary())
+        Metrics::recordTlsHandshakeFailure();
+      DnsCache::expire(host);
+      return nullptr;
     }
-    sendRequest(client);
-    unsigned long start = millis();
-    while (!client.available() && millis() - start < 1500)
-      delay(10);
-    if (client.available())
+    // connect() covers TCP + handshake; split them using the handshake timer.
+    const uint32_t handshakeMs = tlsClient_.lastHandshakeMillis();
+    const uint32_t elapsed = millis() - connectStart;
+    if (primary())
     {
-      String statusLine = client.readStringUntil('\n');
-      statusLine.trim();
-      String msg = F("HTTP status: ");
-      msg += statusLine;
-      LOG_INFO(msg);
+      Metrics::recordPostPhase(Metrics::PostPhase::Connect, elapsed > handshakeMs ? elapsed - handshakeMs : 0);
+      Metrics::recordPostPhase(Metrics::PostPhase::Tls, handshakeMs);
+      Metrics::recordTlsHandshake(handshakeMs, tlsClient_.lastHandshakeResumed());
     }
-    client.stop();
+    LOGF_DEBUG("TLS handshake %s in %u ms", tlsClient_.lastHandshakeResumed() ? "resumed" : "full",
+               static_cast<unsigned>(tlsClient_.lastHandshakeMillis()));
+    client = &tlsClient_;
   }
   else
   {
-    WiFiClient client;
-    if (!client.connect(host.c_str(), port))
+    if (!plainClient_.connect(ip, port))
     {
       LOG_WARN(F("HTTP connect failed"));
-      return false;
+      // The host may have moved; look it up again next time.
+      DnsCache::expire(host);
+      return nullptr;
+    }
+    if (primary())
+      Metrics::recordPostPhase(Metrics::PostPhase::Connect, millis() - connectStart);
+    plainClient_.setNoDelay(true);
+    client = &plainClient_;
+  }
+
+  active_ = client;
+  connHost_ = host;
+  connPort_ = port;
+  connTls_ = useTls;
+  connInsecure_ = insecure;
+  return client;
+}
+
+bool Poster::readResponse(Client &c, ResponseInfo &info)
+{
+  info = ResponseInfo();
+  HttpResponseParser parser;
+  uint8_t buf[kReadChunk];
+  const int fd = (&c == &tlsClient_) ? tlsClient_.fd() : plainClient_.fd();
+  const unsigned long start = millis();
+
+  while (!parser.done() && !parser.failed())
+  {
+    int avail = c.available();
+    if (avail > 0)
+    {
+      int n = c.read(buf, static_cast<size_t>(avail) < sizeof(buf) ? static_cast<size_t>(avail) : sizeof(buf));
+      if (n > 0)
+      {
+        if (info.bytesReceived == 0 && primary())
+          Metrics::recordPostPhase(Metrics::PostPhase::Ttfb, millis() - start);
+        info.bytesReceived += static_cast<size_t>(n);
+        parser.feed(buf, static_cast<size_t>(n));
+        continue;
+      }
     }
-    sendRequest(client);
-    unsigned long start = millis();
-    while (!client.available() && millis() - start < 1500)
-      delay(10);
-    if (client.available())
+    if (!c.connected())
     {
-      String statusLine = client.readStringUntil('\n');
-      statusLine.trim();
-      String msg = F("HTTP status: ");
-      msg += statusLine;
-      LOG_INFO(msg);
+      parser.onClose();
+      break;
     }
-    client.stop();
+    const unsigned long elapsed = millis() - start;
+    if (elapsed >= kResponseTimeoutMs)
+    {
+      info.failure = Metrics::PostFailure::Timeout;
+      return false;
+    }
+    (void)waitReadable(fd, kResponseTimeoutMs - elapsed);
   }
 
-  logHeap("postJSON");
+  if (!parser.done())
+  {
+    info.failure = Metrics::PostFailure::BadResponse;
+    return false;
+  }
+  info.status = parser.status();
+  info.keepAlive = parser.keepAlive();
+  info.retryAfterSec = parser.retryAfterSeconds();
+  LOGF_INFO("HTTP status: %d", info.status);
   return true;
 }
 
-bool Poster::postError(const String &message)
+void Poster::refreshEndpoint()
 {
-  String body;
-  body.reserve(128);
-  body += F("{\"location\":\"");
-  body += AppConfig::get().getDeviceLocation();
-  body += F("\",\"error\":\"");
-  body += message;
-  body += F("\"}");
+  auto &cfg = AppConfig::get();
+  const uint32_t gen = cfg.getGeneration();
+  if (endpointValid_ && gen == endpointGeneration_)
+    return;
+  // Assigning into the existing Strings reuses their buffers, so steady-state
+  // posts do not allocate for configuration values.
+  endpoint_.location = cfg.getDeviceLocation();
+  endpoint_.format = cfg.getPayloadFormat();
+  endpoint_.precision = cfg.getInfluxPrecision();
+  endpoint_.gzip = cfg.getPayloadGzip();
+  endpoint_.stats = cfg.getPayloadStats();
+  if (sinkIndex_ == 0)
+  {
+    endpoint_.host = cfg.getServerHost();
+    endpoint_.path = cfg.getServerPath();
+    endpoint_.apiKey = cfg.getApiKey();
+    endpoint_.port = cfg.getServerPort();
+    endpoint_.useTls = cfg.getUseTls();
+    endpoint_.insecure = cfg.getHttpsInsecure();
+    endpoint_.enabled = true;
+  }
+  else
+  {
+    AppConfig::SinkConfig sink;
+    endpoint_.enabled = cfg.getExtraSink(sinkIndex_ - 1, sink) && sink.enabled && sink.type.equalsIgnoreCase("http");
+    endpoint_.host = sink.host;
+    endpoint_.path = sink.path;
+    endpoint_.apiKey = sink.apiKey;
+    endpoint_.port = sink.port;
+    endpoint_.useTls = sink.useTls;
+    endpoint_.insecure = sink.insecure;
+  }
+  // The write endpoint needs to know how to read the timestamps.
+  if (endpoint_.format == PayloadFormat::Influx && endpoint_.path.indexOf("precision=") < 0)
+  {
+    endpoint_.path += endpoint_.path.indexOf('?') < 0 ? "?precision=" : "&precision=";
+    endpoint_.path += influxPrecisionName(endpoint_.precision);
+  }
+  renderHeaderBlock();
+  endpointGeneration_ = gen;
+  endpointValid_ = true;
+}
+
+void Poster::renderHeaderBlock()
+{
+  const Endpoint &ep = endpoint_;
+  String &h = endpoint_.headerBlock;
+  h = F("POST ");
+  h += ep.path;
+  h += F(" HTTP/1.1\r\nHost: ");
+  h += ep.host;
+  if (ep.port != 80 && ep.port != 443)
+  {
+    h += ':';
+    h += ep.port;
+  }
+  h += F("\r\n");
+  if (ep.apiKey.length())
+  {
+    // InfluxDB's write API wants its own scheme for API tokens.
+    h += ep.format == PayloadFormat::Influx ? F("Authorization: Token ") : F("Authorization: Bearer ");
+    h += ep.apiKey;
+    h += F("\r\n");
+  }
+  h += F("Content-Type: ");
+  h += payloadContentType(ep.format);
+  h += F("\r\nConnection: keep-alive\r\n");
+}
+
+Poster::PostOutcome Poster::postPayload(const Body &body)
+{
+  if (WiFi.status() != WL_CONNECTED)
+  {
+    closeConnection();
+    if (primary())
+      Metrics::recordPostFailure(Metrics::PostFailure::Connect);
+    return PostOutcome::Retry;
+  }
+
+  // A rejected payload still proves the upstream is up.
+  const uint32_t start = millis();
+  PostOutcome outcome = exchange(body);
+  if (primary())
+    Metrics::recordPostPhase(Metrics::PostPhase::Total, millis() - start);
+  if (outcome == PostOutcome::Retry)
+    breaker_.onFailure(millis(), esp_random());
+  else
+    breaker_.onSuccess();
+  publishBreaker();
+  return outcome;
+}
+
+size_t Poster::encodeBody(Print &out, const Body &body) const
+{
+  if (endpoint_.format != PayloadFormat::Influx)
+    return encodePayload(out, endpoint_.format, body.render, body.ctx);
+  LineProtocolWriter w(out, INFLUX_MEASUREMENT, endpoint_.location, endpoint_.precision);
+  body.lines(w, body.ctx);
+  w.flush();
+  return w.ok() ? w.bytesWritten() : 0;
+}
+
+bool Poster::stageCompressed(const Body &body, size_t rawLength, size_t &gzipLength)
+{
+  if (rawLength == 0 || rawLength > Gzip::kMaxInput)
+    return false;
+  if (rawLength > gzipCap_)
+  {
+    uint8_t *grown = static_cast<uint8_t *>(realloc(gzipBuf_, rawLength));
+    if (!grown)
+    {
+      LOGF_WARN("No memory to stage a %u byte body for gzip; sending it uncompressed", static_cast<unsigned>(rawLength));
+      return false;
+    }
+    gzipBuf_ = grown;
+    gzipCap_ = rawLength;
+  }
+  BufferPrint staged(gzipBuf_, rawLength);
+  if (encodeBody(staged, body) != rawLength)
+    return false;
+  ByteCounter counter;
+  gzipLength = Gzip::compress(gzipBuf_, rawLength, counter);
+  return gzipLength > 0;
+}
+
+Poster::PostOutcome Poster::exchange(const Body &body)
+{
+  lastStatus_ = 0;
+  refreshEndpoint();
+  const Endpoint &ep = endpoint_;
+
+  // Size the body first so it can be streamed without being buffered.
+  // Chunked bodies are rendered once, straight into the socket.
+  size_t rawLength = 0;
+  if (!body.chunked)
+  {
+    ByteCounter counter;
+    (void)encodeBody(counter, body);
+    rawLength = counter.count();
+  }
+  // gzip needs the whole body at hand: it is rendered once into gzipBuf_
+  // and compressed twice (length, then send), which gives the same bytes.
+  size_t bodyLength = rawLength;
+  const bool gzip = !body.chunked && ep.gzip && stageCompressed(body, rawLength, bodyLength);
+  if (!gzip)
+    bodyLength = rawLength;
+
+  auto sendRequest = [&](Client &c) -> bool
+  {
+    const uint32_t recordsBefore = ep.useTls ? tlsClient_.recordsWritten() : 0;
+    WriteCoalescer out(c, writeBuf_, sizeof(writeBuf_));
+    out.print(ep.headerBlock);
+    if (body.idempotencyKey)
+    {
+      out.print(F("Idempotency-Key: "));
+      out.println(body.idempotencyKey);
+    }
+    if (gzip)
+      out.println(F("Content-Encoding: gzip"));
+    if (body.chunked)
+    {
+      out.println(F("Transfer-Encoding: chunked"));
+      out.println();
+      // The header leaves first; writeBuf_ then holds one chunk at a time.
+      out.flush();
+      ChunkedPrint chunks(c, writeBuf_, sizeof(writeBuf_));
+      rawLength = bodyLength = encodeBody(chunks, body);
+      const bool ok = out.ok() && chunks.finish() && bodyLength > 0;
+      if (primary())
+        Metrics::recordPostWrites(out.writes() + chunks.writes(), ep.useTls ? tlsClient_.recordsWritten() - recordsBefore : 0);
+      return ok;
+    }
+    out.print(F("Content-Length: "));
+    out.println(bodyLength);
+    out.println();
+
+    const size_t sent = gzip ? Gzip::compress(gzipBuf_, rawLength, out) : encodeBody(out, body);
+    out.flush();
+    if (primary())
+      Metrics::recordPostWrites(out.writes(), ep.useTls ? tlsClient_.recordsWritten() - recordsBefore : 0);
+    return out.ok() && sent == bodyLength;
+  };
+
+  // A reused socket may have been closed by the server while idle; in that
+  // case retry once on a fresh connection before giving up.
+  ResponseInfo info;
+  for (int attempt = 0; attempt < 2; ++attempt)
+  {
+    bool reused = false;
+    Client *client = acquireConnection(ep.host, ep.port, ep.useTls, ep.insecure, reused);
+    if (!client)
+    {
+      if (primary())
+        Metrics::recordPostFailure(Metrics::PostFailure::Connect);
+      return PostOutcome::Retry;
+    }
+    if (primary())
+      Metrics::recordUpstreamConnection(reused);
+
+    if (!sendRequest(*client))
+    {
+      closeConnection();
+      if (reused)
+        continue;
+      LOG_WARN(F("HTTP request write failed"));
+      if (primary())
+        Metrics::recordPostFailure(Metrics::PostFailure::Write);
+      return PostOutcome::Retry;
+    }
+    if (primary())
+      Metrics::recordPostBody(rawLength, bodyLength, gzip, body.chunked);
+    if (!readResponse(*client, info))
+    {
+      closeConnection();
+      if (reused && info.bytesReceived == 0 && info.failure != Metrics::PostFailure::Timeout)
+      {
+        LOG_DEBUG(F("Reused upstream connection went stale; retrying on a new one"));
+        if (primary())
+          Metrics::recordUpstreamServerClose();
+        continue;
+      }
+      LOG_WARN(info.failure == Metrics::PostFailure::Timeout ? F("HTTP response timed out") : F("Malformed HTTP response"));
+      if (primary())
+        Metrics::recordPostFailure(info.failure);
+      return PostOutcome::Retry;
+    }
+
+    connLastUsedMs_ = millis();
+    if (!info.keepAlive)
+      closeConnection();
+    break;
+  }
+
+  logHeap("exchange");
+  lastStatus_ = info.status;
+  if (primary())
+    Metrics::recordHttpStatus(info.status);
+  if (info.status == 0)
+  {
+    if (primary())
+      Metrics::recordPostFailure(Metrics::PostFailure::Write);
+    return PostOutcome::Retry;
+  }
+  if (info.status >= 200 && info.status < 300)
+    return PostOutcome::Delivered;
+
+  if (info.retryAfterSec > 0 && (info.status == 429 || info.status == 503))
+  {
+    holdUntilMs_ = millis() + info.retryAfterSec * 1000UL;
+    holdActive_ = true;
+    LOGF_WARN("Upstream asked to retry after %u s", static_cast<unsigned>(info.retryAfterSec));
+  }
+  if (info.status >= 500)
+  {
+    if (primary())
+      Metrics::recordPostFailure(Metrics::PostFailure::Http5xx);
+    return PostOutcome::Retry;
+  }
+  if (info.status >= 400)
+  {
+    if (primary())
+      Metrics::recordPostFailure(Metrics::PostFailure::Http4xx);
+    // The payload itself was refused; resending it cannot succeed.
+    if (info.status == 400 || info.status == 413 || info.status == 422)
+      return PostOutcome::Rejected;
+    return PostOutcome::Retry;
+  }
+  if (primary())
+    Metrics::recordPostFailure(Metrics::PostFailure::HttpOther);
+  return PostOutcome::Retry;
+}
+
+bool Poster::holding()
+{
+  if (holdActive_ && static_cast<int32_t>(millis() - holdUntilMs_) >= 0)
+    holdActive_ = false;
+  return holdActive_;
+}
+
+bool Poster::upstreamReady()
+{
+  if (holding())
+    return false;
+  const bool allowed = breaker_.allow(millis());
+  publishBreaker();
+  if (!allowed && primary())
+    Metrics::recordBreakerShortCircuit();
+  return allowed;
+}
+
+void Poster::publishBreaker()
+{
+  const CircuitBreaker::State state = breaker_.state();
+  if (state != breakerReported_)
+  {
+    if (state == CircuitBreaker::State::Open)
+      LOGF_WARN("Upstream circuit (%s) open after %u failures; next probe in %u ms", name_, static_cast<unsigned>(breaker_.consecutiveFailures()),
+                static_cast<unsigned>(breaker_.retryInMs(millis())));
+    else
+      LOGF_INFO("Upstream circuit (%s) %s", name_, CircuitBreaker::stateName(state));
+    breakerReported_ = state;
+  }
+  if (!primary())
+    return;
+  const uint32_t now = millis();
+  Metrics::recordBreakerState(static_cast<uint8_t>(state), breaker_.consecutiveFailures(),
+                              state == CircuitBreaker::State::Open ? now + breaker_.retryInMs(now) : 0, breaker_.trips(), breaker_.probes());
+}
+
+namespace
+{
+  struct ErrorPayload
+  {
+    const String *location;
+    const String *message;
+  };
+
+  struct ReadingsPayload
+  {
+    const String *location;
+    const Reading *readings;
+    size_t count;
+    bool batch;
+    uint32_t nowMs;
+    // Wall clock at render time (0 if not set); places readings sampled
+    // before SNTP synced in line protocol output.
+    uint32_t nowEpoch;
+    // Window statistics to append (payload_stats); nullptr for none.
+    const SensorStats::Snapshot *stats;
+  };
+
+  struct StreamPayload
+  {
+    const String *location;
+    // Where every rendering pass starts; *stream is the pass in progress
+    // (its yielded count is what the last pass sent).
+    OfflineQueue::Stream start;
+    OfflineQueue::Stream *stream;
+    uint32_t nowMs;
+    uint32_t nowEpoch;
+  };
+
+  uint32_t wallClockNow()
+  {
+    const time_t now = time(nullptr);
+    return now >= kMinValidEpoch ? static_cast<uint32_t>(now) : 0;
+  }
+
+  void renderError(PayloadWriter &w, const void *ctx)
+  {
+    const ErrorPayload &p = *static_cast<const ErrorPayload *>(ctx);
+    w.beginObject(2);
+    w.field("location", *p.location);
+    w.field("error", *p.message);
+    w.endObject();
+  }
+
+  void renderSequence(PayloadWriter &w, const Reading &r)
+  {
+    if (!r.seq)
+      return;
+    w.field("boot_id", r.bootId);
+    w.field("seq", r.seq);
+  }
+
+  // With several sensor channels every entry names its channel and that
+  // channel's location (the device location unless the channel has one).
+  void renderBatchEntry(PayloadWriter &w, const Reading &r, uint32_t nowMs, const String &location)
+  {
+    const bool tagged = SensorChannels::tagged();
+    w.beginObject(((r.timestamp || r.sampledMs) ? 3 : 2) + (r.seq ? 2 : 0) + (tagged ? 2 : 0));
+    if (tagged)
+    {
+      w.field("channel", SensorChannels::get(r.channel).name);
+      w.field("location", SensorChannels::location(r.channel, location));
+    }
+    renderSequence(w, r);
+    if (r.timestamp)
+      w.field("timestamp", r.timestamp);
+    else if (r.sampledMs)
+      w.field("age_ms", static_cast<uint32_t>(nowMs - r.sampledMs));
+    w.field("temperature_c", r.temperatureC, 2);
+    w.field("humidity_pct", r.humidityPct, 2);
+    w.endObject();
+  }
+
+  void renderQuantity(PayloadWriter &w, const char *name, const WindowStats::Quantity &q)
+  {
+    w.key(name);
+    w.beginObject(q.count ? 5 : 1);
+    w.field("count", q.count);
+    if (q.count)
+    {
+      w.field("min", q.min, 2);
+      w.field("max", q.max, 2);
+      w.field("mean", q.mean, 2);
+      w.field("stddev", q.stddev, 3);
+    }
+    w.endObject();
+  }
+
+  // "stats": one entry per channel and window.
+  void renderStats(PayloadWriter &w, const SensorStats::Snapshot &s)
+  {
+    const bool tagged = SensorChannels::tagged();
+    w.key("stats");
+    w.beginArray(s.channels * s.windows);
+    for (size_t c = 0; c < s.channels; ++c)
+    {
+      for (size_t i = 0; i < s.windows; ++i)
+      {
+        const WindowStats::Summary &sum = s.summaries[c][i];
+        w.beginObject(tagged ? 4 : 3);
+        if (tagged)
+          w.field("channel", SensorChannels::get(static_cast<uint8_t>(c)).name);
+        w.field("window_sec", sum.windowSec);
+        renderQuantity(w, "temperature_c", sum.temperature);
+        renderQuantity(w, "humidity_pct", sum.humidity);
+        w.endObject();
+      }
+    }
+    w.endArray();
+  }
+
+  void renderReadings(PayloadWriter &w, const void *ctx)
+  {
+    const ReadingsPayload &p = *static_cast<const ReadingsPayload *>(ctx);
+    const size_t seqFields = (!p.batch && p.readings[0].seq) ? 2 : 0;
+    const bool tagged = !p.batch && SensorChannels::tagged();
+    w.beginObject((p.batch ? 2 : 3) + seqFields + (tagged ? 1 : 0) + (p.stats ? 1 : 0));
+    if (tagged)
+    {
+      w.field("location", SensorChannels::location(p.readings[0].channel, *p.location));
+      w.field("channel", SensorChannels::get(p.readings[0].channel).name);
+    }
+    else
+    {
+      w.field("location", *p.location);
+    }
+    if (!p.batch)
+    {
+      renderSequence(w, p.readings[0]);
+      w.field("temperature_c", p.readings[0].temperatureC, 2);
+      w.field("humidity_pct", p.readings[0].humidityPct, 2);
+      if (p.stats)
+        renderStats(w, *p.stats);
+      w.endObject();
+      return;
+    }
+    w.key("readings");
+    w.beginArray(p.count);
+    for (size_t i = 0; i < p.count; ++i)
+      renderBatchEntry(w, p.readings[i], p.nowMs, *p.location);
+    w.endArray();
+    if (p.stats)
+      renderStats(w, *p.stats);
+    w.endObject();
+  }
+
+  // Same body as a batch, pulled from the offline queue's flash log page by
+  // page while it is written out.
+  void renderStream(PayloadWriter &w, const void *ctx)
+  {
+    const StreamPayload &p = *static_cast<const StreamPayload *>(ctx);
+    OfflineQueue::Stream &s = *p.stream;
+    s = p.start;
+    w.beginObject(2);
+    w.field("location", *p.location);
+    w.key("readings");
+    // A stream cut short (flash dropped a segment meanwhile) makes the
+    // binary encodings invalid; the upstream then refuses the post.
+    w.beginArray(s.count);
+    Reading page[kDrainChunk];
+    size_t n;
+    while ((n = OfflineQueue::readStream(s, page, kDrainChunk)) > 0)
+    {
+      for (size_t i = 0; i < n; ++i)
+        renderBatchEntry(w, page[i], p.nowMs, *p.location);
+      TaskWatchdog::heartbeat(TaskWatchdog::TaskId::Uploader);
+    }
+    w.endArray();
+    w.endObject();
+  }
+
+  void renderErrorLines(LineProtocolWriter &w, const void *ctx)
+  {
+    w.error(*static_cast<const ErrorPayload *>(ctx)->message);
+  }
+
+  void renderReadingLine(LineProtocolWriter &w, const Reading &r, uint32_t nowMs, uint32_t nowEpoch)
+  {
+    if (!SensorChannels::tagged())
+    {
+      w.reading(r, nowMs, nowEpoch);
+      return;
+    }
+    const SensorChannels::Channel &ch = SensorChannels::get(r.channel);
+    w.reading(r, nowMs, nowEpoch, ch.name.c_str(), &ch.location);
+  }
+
+  void renderReadingLines(LineProtocolWriter &w, const void *ctx)
+  {
+    const ReadingsPayload &p = *static_cast<const ReadingsPayload *>(ctx);
+    for (size_t i = 0; i < p.count; ++i)
+      renderReadingLine(w, p.readings[i], p.nowMs, p.nowEpoch);
+    if (!p.stats)
+      return;
+    const bool tagged = SensorChannels::tagged();
+    for (size_t c = 0; c < p.stats->channels; ++c)
+    {
+      const SensorChannels::Channel &ch = SensorChannels::get(static_cast<uint8_t>(c));
+      for (size_t i = 0; i < p.stats->windows; ++i)
+      {
+        if (tagged)
+          w.stats(p.stats->summaries[c][i], p.nowEpoch, ch.name.c_str(), &ch.location);
+        else
+          w.stats(p.stats->summaries[c][i], p.nowEpoch);
+      }
+    }
+  }
+
+  void renderStreamLines(LineProtocolWriter &w, const void *ctx)
+  {
+    const StreamPayload &p = *static_cast<const StreamPayload *>(ctx);
+    OfflineQueue::Stream &s = *p.stream;
+    s = p.start;
+    Reading page[kDrainChunk];
+    size_t n;
+    while ((n = OfflineQueue::readStream(s, page, kDrainChunk)) > 0)
+    {
+      for (size_t i = 0; i < n; ++i)
+        renderReadingLine(w, page[i], p.nowMs, p.nowEpoch);
+      TaskWatchdog::heartbeat(TaskWatchdog::TaskId::Uploader);
+    }
+  }
 
-  bool ok = postJSON(body);
-  Metrics::recordPostResult(Metrics::PostKind::Error, ok);
+  // "<boot>-<seq>" for one reading, "<first>..<last>" for a batch. Only
+  // when every reading is numbered (queued readings from older firmware
+  // are not), otherwise nullptr.
+  const char *idempotencyKey(const Reading *readings, size_t count, char *out, size_t outSize)
+  {
+    for (size_t i = 0; i < count; ++i)
+    {
+      if (!readings[i].seq)
+        return nullptr;
+    }
+    if (!Sequence::formatKey(readings[0], out, outSize))
+      return nullptr;
+    if (count > 1)
+    {
+      const size_t used = strlen(out);
+      if (outSize - used < 3 || !Sequence::formatKey(readings[count - 1], out + used + 2, outSize - used - 2))
+        return nullptr;
+      out[used] = '.';
+      out[used + 1] = '.';
+    }
+    return out;
+  }
+
+}
+
+bool Poster::postError(const String &message)
+{
+  refreshEndpoint();
+  // Error posts are best effort; skip them outright while the circuit is open.
+  if (!endpoint_.enabled || !upstreamReady())
+    return false;
+  ErrorPayload payload{&endpoint_.location, &message};
+  bool ok = postPayload(Body{renderError, renderErrorLines, &payload, nullptr, false}) == PostOutcome::Delivered;
+  if (primary())
+    Metrics::recordPostResult(Metrics::PostKind::Error, ok);
   return ok;
 }
 
 bool Poster::postReading(float temperatureC, float humidityPct)
 {
-  String body;
-  body.reserve(64);
-  body += F("{\"location\":\"");
-  body += AppConfig::get().getDeviceLocation();
-  body += F("\",\"temperature_c\":");
-  body += String(temperatureC, 2);
-  body += F(",\"humidity_pct\":");
-  body += String(humidityPct, 2);
-  body += F("}");
-
-  bool ok = postJSON(body);
-  Metrics::recordPostResult(Metrics::PostKind::Reading, ok);
+  Reading r;
+  const time_t now = time(nullptr);
+  r.timestamp = (now >= kMinValidEpoch) ? static_cast<uint32_t>(now) : 0;
+  r.sampledMs = millis();
+  r.temperatureC = temperatureC;
+  r.humidityPct = humidityPct;
+  r.channel = 0;
+  Sequence::stamp(r);
+  return postReading(r);
+}
+
+bool Poster::postReading(const Reading &r)
+{
+  refreshEndpoint();
+  if (!endpoint_.enabled)
+  {
+    Metrics::recordSinkDropped(sinkIndex_, 1);
+    return false;
+  }
+
+  const uint16_t batchMax = AppConfig::get().getBatchMaxReadings();
+  if (batchMax <= 1 && batchCount_ == 0)
+  {
+    if (WiFi.status() != WL_CONNECTED || !upstreamReady())
+    {
+      stash(&r, 1);
+      return false;
+    }
+
+    refreshEndpoint();
+    ReadingsPayload payload{&endpoint_.location, &r, 1, false, static_cast<uint32_t>(millis()), wallClockNow(), takeStats()};
+    char key[kIdempotencyKeyLen];
+    PostOutcome outcome = postPayload(Body{renderReadings, renderReadingLines, &payload, idempotencyKey(&r, 1, key, sizeof(key)), false});
+    if (primary())
+      Metrics::recordPostResult(Metrics::PostKind::Reading, outcome == PostOutcome::Delivered);
+    if (outcome == PostOutcome::Retry)
+      stash(&r, 1);
+    else if (outcome == PostOutcome::Rejected && primary())
+      Metrics::recordPostRejected(1);
+    return outcome == PostOutcome::Delivered;
+  }
+
+  if (batchCount_ >= AppConfig::kMaxBatchReadings)
+  {
+    // Cannot normally happen (full batches flush or move to the offline
+    // queue), but never overrun the buffer.
+    memmove(&batch_[0], &batch_[1], sizeof(Reading) * (batchCount_ - 1));
+    --batchCount_;
+    if (primary())
+      Metrics::recordBatchDropped(1);
+    else
+      Metrics::recordSinkDropped(sinkIndex_, 1);
+    LOG_WARN(F("Batch buffer full; dropped oldest reading"));
+  }
+
+  batch_[batchCount_++] = r;
+  if (batchDue(millis()))
+    return flushBatch();
+  return true;
+}
+
+bool Poster::postReadings(const Reading *readings, size_t count)
+{
+  if (count <= 1)
+    return count == 0 || postReading(readings[0]);
+
+  refreshEndpoint();
+  if (!endpoint_.enabled)
+  {
+    Metrics::recordSinkDropped(sinkIndex_, count);
+    return false;
+  }
+
+  const uint16_t batchMax = AppConfig::get().getBatchMaxReadings();
+  if (batchMax <= 1 && batchCount_ == 0)
+  {
+    // One sample cycle of several channels goes out as a single post.
+    if (WiFi.status() != WL_CONNECTED || !upstreamReady())
+    {
+      stash(readings, count);
+      return false;
+    }
+    PostOutcome outcome = postBatch(readings, count);
+    if (outcome == PostOutcome::Retry)
+      stash(readings, count);
+    return outcome == PostOutcome::Delivered;
+  }
+
+  // Batching: the whole cycle joins the buffer before checking whether it
+  // is due, so a cycle is not split across posts by the age limit.
+  bool ok = true;
+  for (size_t i = 0; i < count; ++i)
+  {
+    // flushBatch() empties the buffer either way (failures are stashed).
+    if (batchCount_ >= AppConfig::kMaxBatchReadings)
+      ok = flushBatch() && ok;
+    batch_[batchCount_++] = readings[i];
+  }
+  if (batchDue(millis()))
+    ok = flushBatch() && ok;
   return ok;
 }
+
+void Poster::stash(const Reading *readings, size_t count)
+{
+  if (storeAndForward())
+    OfflineQueue::pushMany(readings, count);
+  else
+    Metrics::recordSinkDropped(sinkIndex_, count);
+}
+
+bool Poster::batchDue(uint32_t nowMs)
+{
+  if (batchCount_ == 0)
+    return false;
+
+  auto &cfg = AppConfig::get();
+  if (batchCount_ >= cfg.getBatchMaxReadings())
+    return true;
+  const uint32_t maxAgeSec = cfg.getBatchMaxAgeSeconds();
+  return maxAgeSec > 0 && (nowMs - batch_[0].sampledMs) >= maxAgeSec * 1000UL;
+}
+
+void Poster::service()
+{
+  const uint32_t nowMs = millis();
+  if (storeAndForward())
+    OfflineQueue::maintain();
+  if (batchDue(nowMs))
+    (void)flushBatch();
+  if (endpointValid_ && WiFi.status() == WL_CONNECTED)
+    DnsCache::refresh(endpoint_.host);
+  if (storeAndForward() && WiFi.status() == WL_CONNECTED)
+    drainOffline(nowMs);
+}
+
+bool Poster::flushBatch()
+{
+  if (batchCount_ == 0)
+    return true;
+
+  PostOutcome outcome = PostOutcome::Retry;
+  if (WiFi.status() == WL_CONNECTED && upstreamReady())
+    outcome = postBatch(batch_, batchCount_);
+  if (outcome == PostOutcome::Retry)
+  {
+    // The offline queue takes over retrying (with backoff) from here.
+    stash(batch_, batchCount_);
+  }
+  batchCount_ = 0;
+  return outcome == PostOutcome::Delivered;
+}
+
+Poster::PostOutcome Poster::postBatch(const Reading *readings, size_t count, bool withStats)
+{
+  refreshEndpoint();
+  ReadingsPayload payload{&endpoint_.location, readings, count, true, static_cast<uint32_t>(millis()), wallClockNow(), withStats ? takeStats() : nullptr};
+  char key[kIdempotencyKeyLen];
+  PostOutcome outcome = postPayload(Body{renderReadings, renderReadingLines, &payload, idempotencyKey(readings, count, key, sizeof(key)), false});
+  const bool ok = outcome == PostOutcome::Delivered;
+  if (primary())
+  {
+    Metrics::recordPostResult(Metrics::PostKind::Reading, ok);
+    Metrics::recordBatchFlush(count, ok);
+    if (outcome == PostOutcome::Rejected)
+      Metrics::recordPostRejected(count);
+  }
+  return outcome;
+}
+
+const SensorStats::Snapshot *Poster::takeStats()
+{
+  if (!endpoint_.stats || SensorStats::windowCount() == 0)
+    return nullptr;
+  SensorStats::snapshot(stats_);
+  return &stats_;
+}
+
+Poster::PostOutcome Poster::postStream(OfflineQueue::Stream &stream)
+{
+  refreshEndpoint();
+  StreamPayload payload{&endpoint_.location, stream, &stream, static_cast<uint32_t>(millis()), wallClockNow()};
+  // No Idempotency-Key: the last reading is not known before the body is
+  // written. Each entry still carries its boot_id/seq.
+  PostOutcome outcome = postPayload(Body{renderStream, renderStreamLines, &payload, nullptr, true});
+  const bool ok = outcome == PostOutcome::Delivered;
+  Metrics::recordPostResult(Metrics::PostKind::Reading, ok);
+  Metrics::recordBatchFlush(stream.yielded, ok);
+  return outcome;
+}
+
+void Poster::drainOffline(uint32_t nowMs)
+{
+  if (static_cast<int32_t>(nowMs - drainNextMs_) < 0 || holding())
+    return;
+  if (OfflineQueue::empty())
+  {
+    drainBackoffMs_ = 0;
+    return;
+  }
+  // An open circuit is waited out here; the drain post doubles as its probe.
+  if (!breaker_.allow(nowMs))
+    return;
+
+  const uint32_t start = millis();
+  PostOutcome outcome;
+  OfflineQueue::Stream stream;
+  if (!streamTooLarge_ && !streamRejected_ && kStreamMaxReadings > kDrainChunk && OfflineQueue::beginStream(stream, kStreamMaxReadings) &&
+      stream.count > kDrainChunk)
+  {
+    outcome = postStream(stream);
+    if (outcome == PostOutcome::Rejected)
+    {
+      // Nothing is discarded: the regular batches take over and are judged
+      // one by one. A 413 is a body size limit, so streaming stays off
+      // until reboot. Any other refusal (a bad reading, a proxy's passing
+      // 400) only pauses it until a batch has gone through, which also
+      // discards the chunk holding a bad reading.
+      if (lastStatus_ == 413)
+      {
+        LOGF_WARN("Upstream refused a streamed post of %u queued readings as too large; draining in batches of %u from now on",
+                  static_cast<unsigned>(stream.yielded), static_cast<unsigned>(kDrainChunk));
+        streamTooLarge_ = true;
+      }
+      else
+      {
+        LOGF_WARN("Upstream rejected a streamed post of %u queued readings (HTTP %d); draining in batches of %u until one is delivered",
+                  static_cast<unsigned>(stream.yielded), lastStatus_, static_cast<unsigned>(kDrainChunk));
+        streamRejected_ = true;
+      }
+    }
+    // If flash moved under the stream its readings stay queued and go out
+    // again; their sequence numbers let the upstream drop the copies.
+    else if (outcome == PostOutcome::Delivered && !OfflineQueue::commitStream(stream, millis() - start))
+      LOG_WARN(F("Offline queue changed during a streamed post; its readings will be resent"));
+  }
+  else
+  {
+    Reading chunk[kDrainChunk];
+    OfflineQueue::Mark mark;
+    const size_t n = OfflineQueue::peek(chunk, kDrainChunk, mark);
+    if (n == 0)
+      return;
+    outcome = postBatch(chunk, n, false);
+    if (outcome == PostOutcome::Delivered)
+      streamRejected_ = false;
+    if (outcome != PostOutcome::Retry)
+    {
+      // Rejected chunks are discarded too, or they would block the queue.
+      if (outcome == PostOutcome::Rejected)
+        LOGF_WARN("Upstream rejected %u queued readings; discarding them", static_cast<unsigned>(n));
+      // Same as for streams: if the queue dropped readings during the post,
+      // the chunk stays queued and goes out again.
+      if (!OfflineQueue::pop(mark, n, millis() - start))
+        LOG_WARN(F("Offline queue changed during a drain post; its readings will be resent"));
+    }
+  }
+  if (outcome != PostOutcome::Retry)
+  {
+    drainBackoffMs_ = 0;
+    drainNextMs_ = millis() + kDrainIntervalMs;
+    return;
+  }
+
+  drainBackoffMs_ = drainBackoffMs_ ? drainBackoffMs_ * 2 : kDrainBackoffMinMs;
+  if (drainBackoffMs_ > kDrainBackoffMaxMs)
+    drainBackoffMs_ = kDrainBackoffMaxMs;
+  drainNextMs_ = millis() + drainBackoffMs_ + (esp_random() % kDrainJitterMs);
+  LOGF_DEBUG("Offline drain failed; next attempt in %u ms", static_cast<unsigned>(drainNextMs_ - millis()));
+}
@@ -1,14 +1,202 @@
 #pragma once
 
 #include <Arduino.h>
+#include <WiFi.h>
 
-class Poster {
+#include "AppConfig.h"
+#include "CircuitBreaker.h"
+#include "LineProtocol.h"
+#include "Metrics.h"
+#include "OfflineQueue.h"
+#include "OutputSink.h"
+#include "PayloadWriter.h"
+#include "Reading.h"
+#include "SensorStats.h"
+#include "TlsClient.h"
+
+// HTTP(S) output sink. Sink 0 is the primary endpoint (server_* settings)
+// and owns the store-and-forward offline queue; sinks 1.. read their
+// endpoint from AppConfig's extra sink list and are best effort: readings
+// they cannot deliver are counted as dropped.
+class Poster : public OutputSink {
 public:
-  Poster();
+  explicit Poster(uint8_t sinkIndex = 0);
+
+  const char *name() const override { return name_; }
 
+  // Posts a reading, or buffers it when batching is enabled
+  // (batch_max_readings > 1). Readings that cannot be delivered (offline or
+  // failed post) are stashed (see stash()); returns false in that case.
   bool postReading(float temperatureC, float humidityPct);
-  bool postError(const String &message);
+  // Same, for a reading sampled earlier (keeps its original timestamps).
+  bool postReading(const Reading &reading) override;
+  // One sample cycle of several sensor channels: a single post when not
+  // batching, otherwise added to the batch buffer together.
+  bool postReadings(const Reading *readings, size_t count) override;
+  bool postError(const String &message) override;
+
+  // Flushes the batch buffer once its max age has elapsed and drains the
+  // offline queue at a limited pace. Call regularly.
+  void service() override;
+  bool flushBatch();
+
+  // Drops the cached upstream connection (next post reconnects).
+  void closeConnection();
 
 private:
-  bool postJSON(const String &body);
+  struct ResponseInfo
+  {
+    int status = 0;
+    bool keepAlive = false;
+    uint32_t retryAfterSec = 0;
+    size_t bytesReceived = 0;
+    Metrics::PostFailure failure = Metrics::PostFailure::BadResponse;
+  };
+
+  // Delivered: 2xx. Retry: transport failure or a status worth retrying.
+  // Rejected: the upstream refused the payload itself (400/413/422).
+  enum class PostOutcome : uint8_t
+  {
+    Delivered,
+    Retry,
+    Rejected
+  };
+
+  // Renders the body into w; called twice per post (length, then send).
+  using RenderFn = void (*)(PayloadWriter &w, const void *ctx);
+  // Same for the line protocol format.
+  using LineRenderFn = void (*)(LineProtocolWriter &w, const void *ctx);
+
+  // A request body in every supported encoding.
+  struct Body
+  {
+    RenderFn render;
+    LineRenderFn lines;
+    const void *ctx;
+    // Sent as Idempotency-Key when set; the same readings always get the
+    // same key, however often they are retried.
+    const char *idempotencyKey;
+    // Sent with Transfer-Encoding: chunked and rendered only once per
+    // attempt (no sizing pass, no gzip); for bodies of unbounded length.
+    bool chunked;
+  };
+
+  // Room for "<boot>-<seq>..<boot>-<seq>" with 32-bit values.
+  static constexpr size_t kIdempotencyKeyLen = 48;
+
+  // Upstream settings copied from AppConfig, refreshed only when the config
+  // generation changes.
+  struct Endpoint
+  {
+    String host;
+    String path;
+    String apiKey;
+    String location;
+    uint16_t port = 0;
+    bool useTls = false;
+    bool insecure = false;
+    PayloadFormat format = PayloadFormat::Json;
+    InfluxPrecision precision = InfluxPrecision::Ns;
+    bool gzip = false;
+    bool stats = false;
+    bool enabled = true;
+    // Request line and the headers that only depend on the settings above,
+    // CRLF-terminated; per-post headers are appended when sending.
+    String headerBlock;
+  };
+
+  // Header and body are staged here and leave in writes of this size, so a
+  // typical post is one TCP segment and, over TLS, one record.
+  static constexpr size_t kWriteBufferBytes = 1024;
+
+  bool storeAndForward() const { return sinkIndex_ == 0; }
+  // The global upload metrics (results, phases, connections, breaker)
+  // describe the primary endpoint; extra HTTP sinks only feed their
+  // esp_sink_* series.
+  bool primary() const { return sinkIndex_ == 0; }
+  // Hands undeliverable readings to the offline queue (primary) or counts
+  // them as dropped.
+  void stash(const Reading *readings, size_t count);
+
+  void refreshEndpoint();
+  void renderHeaderBlock();
+  // Runs exchange() and feeds the outcome to the circuit breaker.
+  PostOutcome postPayload(const Body &body);
+  PostOutcome exchange(const Body &body);
+  // Renders body in the endpoint's format; returns the bytes produced, or 0
+  // when out did not accept all of them.
+  size_t encodeBody(Print &out, const Body &body) const;
+  // Renders body into gzipBuf_ and sizes its gzip stream; false if the
+  // buffer cannot be allocated (the body is then sent uncompressed).
+  bool stageCompressed(const Body &body, size_t rawLength, size_t &gzipLength);
+  // Backlog drains pass withStats = false: the current window statistics
+  // belong to live posts, not to readings from hours ago.
+  PostOutcome postBatch(const Reading *readings, size_t count, bool withStats = true);
+  // Freezes the window statistics into stats_ for one post, or nullptr
+  // when payload_stats is off.
+  const SensorStats::Snapshot *takeStats();
+  // Posts the flash backlog covered by stream as one chunked batch.
+  PostOutcome postStream(OfflineQueue::Stream &stream);
+  // True while an upstream Retry-After window is in effect.
+  bool holding();
+  // False while a Retry-After hold or an open circuit keeps posts off the
+  // air; counts the skipped post.
+  bool upstreamReady();
+  void publishBreaker();
+  bool batchDue(uint32_t nowMs);
+  void drainOffline(uint32_t nowMs);
+  Client *acquireConnection(const String &host, uint16_t port, bool useTls, bool insecure, bool &reused);
+  bool readResponse(Client &c, ResponseInfo &info);
+
+  uint8_t sinkIndex_;
+  char name_[16];
+
+  // One persistent HTTP/1.1 connection is kept open across posts and reused
+  // while the peer keeps it alive and the endpoint settings are unchanged.
+  WiFiClient plainClient_;
+  TlsClient tlsClient_;
+  Client *active_;
+  String connHost_;
+  uint16_t connPort_;
+  bool connTls_;
+  bool connInsecure_;
+  unsigned long connLastUsedMs_;
+
+  Endpoint endpoint_;
+  uint32_t endpointGeneration_;
+  bool endpointValid_;
+
+  // Set from Retry-After on 429/503; posts go to the offline queue until then.
+  uint32_t holdUntilMs_;
+  bool holdActive_;
+
+  // Trips after repeated failed posts so a dead upstream costs no connect
+  // timeouts until a probe gets through.
+  CircuitBreaker breaker_;
+  CircuitBreaker::State breakerReported_;
+
+  // Readings waiting to be flushed as one multi-reading payload.
+  Reading batch_[AppConfig::kMaxBatchReadings];
+  size_t batchCount_;
+
+  uint8_t writeBuf_[kWriteBufferBytes];
+
+  // Uncompressed body staged for gzip; grown on demand and kept for reuse.
+  uint8_t *gzipBuf_;
+  size_t gzipCap_;
+
+  // Window statistics of the post being rendered (payload_stats).
+  SensorStats::Snapshot stats_;
+
+  // Offline queue drain pacing.
+  uint32_t drainNextMs_;
+  uint32_t drainBackoffMs_;
+  // HTTP status of the last exchange; 0 if there was no response.
+  int lastStatus_;
+  // The upstream answered a streamed backlog post with 413: the drain
+  // sticks to kDrainChunk batches until reboot.
+  bool streamTooLarge_;
+  // It refused one otherwise (400/422): batches only until one is
+  // delivered, then streaming is tried again.
+  bool streamRejected_;
 };
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <stdint.h>
+
+// One sensor sample as buffered for upload.
+struct Reading
+{
+  uint32_t timestamp;  // Unix epoch seconds at sample time; 0 if wall time was not synced yet
+  uint32_t sampledMs;  // millis() at sample time (drives age-based flushing); 0 if from an earlier boot
+  float temperatureC;
+  float humidityPct;
+  uint32_t bootId;     // boot counter at sample time; 0 if not assigned (see Sequence.h)
+  uint32_t seq;        // per-boot sequence number, from 1; 0 if not assigned
+  uint8_t channel;     // sensor channel index (see SensorChannels.h); 0 = the first or only one
+};
@@ -0,0 +1,196 @@
+#include "ReadingFilter.h"
+
+#include <math.h>
+#include <strings.h>
+
+const char *ReadingFilter::smoothingName(Smoothing smoothing)
+{
+  switch (smoothing)
+  {
+  case Smoothing::Ema:
+    return "ema";
+  case Smoothing::Kalman:
+    return "kalman";
+  case Smoothing::None:
+  default:
+    return "none";
+  }
+}
+
+bool ReadingFilter::smoothingFromString(const char *text, Smoothing &out)
+{
+  if (strcasecmp(text, "none") == 0)
+    out = Smoothing::None;
+  else if (strcasecmp(text, "ema") == 0)
+    out = Smoothing::Ema;
+  else if (strcasecmp(text, "kalman") == 0)
+    out = Smoothing::Kalman;
+  else
+    return false;
+  return true;
+}
+
+void ReadingFilter::clamp(Settings &s)
+{
+  if (s.oversample < 1)
+    s.oversample = 1;
+  if (s.oversample > kMaxOversample)
+    s.oversample = kMaxOversample;
+  if (s.median < 1)
+    s.median = 1;
+  if (s.median > kMaxMedian)
+    s.median = kMaxMedian;
+  if (!(s.maxRateTempCPerMin > 0.0f))
+    s.maxRateTempCPerMin = 0.0f;
+  if (!(s.maxRateHumidityPctPerMin > 0.0f))
+    s.maxRateHumidityPctPerMin = 0.0f;
+  if (!(s.emaAlpha > 0.0f) || s.emaAlpha > 1.0f)
+    s.emaAlpha = 1.0f;
+  if (!(s.kalmanQ >= 0.0f))
+    s.kalmanQ = 0.0f;
+  if (!(s.kalmanR > 0.0f))
+    s.kalmanR = 1e-6f;
+}
+
+ReadingFilter::Track::Track()
+{
+  reset();
+}
+
+void ReadingFilter::Track::reset()
+{
+  haveLast_ = false;
+  last_ = NAN;
+  lastMs_ = 0;
+  rejects_ = 0;
+  head_ = 0;
+  count_ = 0;
+  haveOutput_ = false;
+  output_ = NAN;
+  variance_ = 0.0f;
+}
+
+float ReadingFilter::Track::median(uint8_t window) const
+{
+  const uint8_t n = window < count_ ? window : count_;
+  float v[kMaxMedian];
+  // The n most recent values, newest first.
+  for (uint8_t i = 0; i < n; ++i)
+    v[i] = window_[(head_ + kMaxMedian - 1 - i) % kMaxMedian];
+  // Insertion sort; n is at most kMaxMedian.
+  for (uint8_t i = 1; i < n; ++i)
+  {
+    const float x = v[i];
+    uint8_t j = i;
+    for (; j > 0 && v[j - 1] > x; --j)
+      v[j] = v[j - 1];
+    v[j] = x;
+  }
+  return (n & 1) ? v[n / 2] : (v[n / 2 - 1] + v[n / 2]) / 2.0f;
+}
+
+float ReadingFilter::Track::smooth(const Settings &s, float value)
+{
+  if (!haveOutput_ || s.smoothing == Smoothing::None)
+  {
+    variance_ = s.kalmanR;
+    return value;
+  }
+  if (s.smoothing == Smoothing::Ema)
+    return output_ + s.emaAlpha * (value - output_);
+
+  // Constant-level Kalman filter.
+  variance_ += s.kalmanQ;
+  const float gain = variance_ / (variance_ + s.kalmanR);
+  variance_ *= 1.0f - gain;
+  return output_ + gain * (value - output_);
+}
+
+float ReadingFilter::Track::apply(const Settings &s, float maxRatePerMin, float value, uint32_t nowMs, bool &rejected)
+{
+  rejected = false;
+  if (isnan(value))
+    return value;
+
+  if (haveLast_ && maxRatePerMin > 0.0f)
+  {
+    // Measured against the current estimate, so one noisy accepted value
+    // does not move the reference; the allowance grows while samples are
+    // being rejected.
+    const float reference = haveOutput_ ? output_ : last_;
+    const float minutes = static_cast<float>(nowMs - lastMs_) / 60000.0f;
+    if (fabsf(value - reference) > maxRatePerMin * minutes)
+    {
+      if (++rejects_ <= kMaxRejects)
+      {
+        rejected = true;
+        return haveOutput_ ? output_ : last_;
+      }
+      // Kept moving away for several samples: a real step. Start over
+      // from it rather than smoothing across it.
+      reset();
+    }
+  }
+  rejects_ = 0;
+  haveLast_ = true;
+  last_ = value;
+  lastMs_ = nowMs;
+
+  window_[head_] = value;
+  head_ = (head_ + 1) % kMaxMedian;
+  if (count_ < kMaxMedian)
+    ++count_;
+
+  output_ = smooth(s, s.median > 1 ? median(s.median) : value);
+  haveOutput_ = true;
+  return output_;
+}
+
+ReadingFilter::ReadingFilter()
+{
+}
+
+uint8_t ReadingFilter::apply(const Settings &s, float &temperatureC, float &humidityPct, uint32_t nowMs)
+{
+  uint8_t result = 0;
+  bool rejected;
+  temperatureC = temperature_.apply(s, s.maxRateTempCPerMin, temperatureC, nowMs, rejected);
+  if (rejected)
+    result |= kRejectedTemperature;
+  humidityPct = humidity_.apply(s, s.maxRateHumidityPctPerMin, humidityPct, nowMs, rejected);
+  if (rejected)
+    result |= kRejectedHumidity;
+  return result;
+}
+
+void ReadingFilter::reset()
+{
+  temperature_.reset();
+  humidity_.reset();
+}
+
+Oversampler::Oversampler() : sumT_(0.0f), sumH_(0.0f), countT_(0), countH_(0), reads_(0)
+{
+}
+
+void Oversampler::add(float temperatureC, float humidityPct)
+{
+  ++reads_;
+  if (!isnan(temperatureC))
+  {
+    sumT_ += temperatureC;
+    ++countT_;
+  }
+  if (!isnan(humidityPct))
+  {
+    sumH_ += humidityPct;
+    ++countH_;
+  }
+}
+
+bool Oversampler::result(float &temperatureC, float &humidityPct) const
+{
+  temperatureC = countT_ ? sumT_ / countT_ : NAN;
+  humidityPct = countH_ ? sumH_ / countH_ : NAN;
+  return countT_ && countH_;
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Clean-up stage between a channel's sensor and its uploads. Every sample
+// of a quantity (temperature, humidity) runs through:
+//
+//   1. rate-of-change limit: a value further from the current output than
+//      max_rate * time since the last accepted value is treated as a spike
+//      and replaced by the previous output. kMaxRejects rejections in a row
+//      are taken as a real step instead; the filter then restarts from the
+//      new level. Set the rate so one sample interval allows more than the
+//      sensor's noise (DHT22: about 0.2 °C / 0.5 %RH).
+//   2. median of the last k accepted values (k = 1: off).
+//   3. optional smoothing: an exponential moving average, or a
+//      one-dimensional Kalman filter (constant-level model, process noise
+//      q per sample, measurement noise r; only q/r matters for the gain).
+//
+// Oversampling (averaging N back-to-back reads into one sample) happens
+// before this, at the driver; see Oversampler.
+//
+// All state lives in fixed-size members: no heap, no platform calls. Time
+// comes from the caller (millis()). NaN values pass through without
+// touching the state.
+class ReadingFilter
+{
+public:
+  static constexpr uint8_t kMaxOversample = 8;
+  static constexpr uint8_t kMaxMedian = 9;
+  static constexpr uint8_t kMaxRejects = 3;
+
+  enum class Smoothing : uint8_t
+  {
+    None = 0,
+    Ema = 1,
+    Kalman = 2
+  };
+
+  static const char *smoothingName(Smoothing smoothing);
+  static bool smoothingFromString(const char *text, Smoothing &out);
+
+  // Defaults leave readings untouched.
+  struct Settings
+  {
+    uint8_t oversample = 1;                // raw reads averaged per sample, 1..kMaxOversample
+    uint8_t median = 1;                    // median window, 1..kMaxMedian
+    float maxRateTempCPerMin = 0.0f;       // 0 = no limit
+    float maxRateHumidityPctPerMin = 0.0f; // 0 = no limit
+    Smoothing smoothing = Smoothing::None;
+    float emaAlpha = 0.3f;                 // weight of the new value, (0, 1]
+    float kalmanQ = 0.01f;
+    float kalmanR = 0.25f;
+  };
+
+  // Brings out-of-range settings into range.
+  static void clamp(Settings &s);
+
+  // Bits of apply()'s result.
+  static constexpr uint8_t kRejectedTemperature = 0x01;
+  static constexpr uint8_t kRejectedHumidity = 0x02;
+
+  ReadingFilter();
+
+  // Filters one sample in place. Returns which values were rejected as
+  // spikes (kRejected* bits); those hold the previous output.
+  uint8_t apply(const Settings &s, float &temperatureC, float &humidityPct, uint32_t nowMs);
+
+  void reset();
+
+private:
+  // Pipeline state of one quantity.
+  class Track
+  {
+  public:
+    Track();
+    // Returns the filtered value; rejected is set for a spike.
+    float apply(const Settings &s, float maxRatePerMin, float value, uint32_t nowMs, bool &rejected);
+    void reset();
+
+  private:
+    float median(uint8_t window) const;
+    float smooth(const Settings &s, float value);
+
+    bool haveLast_;
+    float last_;       // last accepted raw value
+    uint32_t lastMs_;
+    uint8_t rejects_;  // consecutive rejections
+    float window_[kMaxMedian];
+    uint8_t head_;     // next slot in window_
+    uint8_t count_;    // valid entries in window_
+    bool haveOutput_;
+    float output_;
+    float variance_;   // Kalman estimate variance
+  };
+
+  Track temperature_;
+  Track humidity_;
+};
+
+// Averages a burst of raw reads into one sample; a value is averaged over
+// the reads where it was valid and stays NaN if none had it.
+class Oversampler
+{
+public:
+  Oversampler();
+
+  void add(float temperatureC, float humidityPct);
+  // True if both values were valid at least once.
+  bool result(float &temperatureC, float &humidityPct) const;
+  uint8_t reads() const { return reads_; }
+
+private:
+  float sumT_;
+  float sumH_;
+  uint8_t countT_;
+  uint8_t countH_;
+  uint8_t reads_;
+};
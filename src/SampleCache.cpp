@@ -0,0 +1,38 @@
+#include "SampleCache.h"
+
+SampleCache::SampleCache() : slots_()
+{
+}
+
+bool SampleCache::get(uint8_t channel, uint32_t maxAgeMs, uint32_t nowMs, Entry &out) const
+{
+  if (channel >= SensorChannels::kMaxChannels)
+    return false;
+  const Slot &s = slots_[channel];
+  if (!s.valid || nowMs - s.sample.takenMs > maxAgeMs)
+    return false;
+  out = s.sample;
+  return true;
+}
+
+SampleCache::Claim SampleCache::claim(uint8_t channel, uint32_t maxAgeMs, uint32_t nowMs, Entry &out)
+{
+  if (!get(channel, maxAgeMs, nowMs, out))
+    return Claim::None;
+  Slot &s = slots_[channel];
+  if (s.consumed)
+    return Claim::Seen;
+  s.consumed = true;
+  return Claim::Fresh;
+}
+
+void SampleCache::store(uint8_t channel, const Entry &sample, bool bySampler)
+{
+  if (channel >= SensorChannels::kMaxChannels)
+    return;
+  Slot &s = slots_[channel];
+  s.valid = true;
+  s.consumed = bySampler;
+  s.sample = sample;
+  s.sample.error[kErrorLen - 1] = '\0';
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "SensorChannels.h"
+
+// Last sample per sensor channel, whoever took it: the sampler or an
+// on-demand read (GET /read). Pollers are answered from it while it is
+// young enough, and it stands in for a read a driver cannot serve yet
+// (SensorDriver::minIntervalMs()).
+//
+// Each entry remembers whether the sampler has processed it. A sample a
+// poller took is new to the sampler, which uses it as its own measurement
+// instead of reading the sensor again; a sample the sampler already
+// filtered and reported is not handed to it twice.
+//
+// Plain data, no locking and no platform calls: the caller serialises
+// access and passes the time in.
+class SampleCache
+{
+public:
+  static constexpr size_t kErrorLen = 48;
+
+  struct Entry
+  {
+    bool ok;
+    float temperatureC;
+    float humidityPct;
+    uint32_t takenMs;       // millis() when the read finished
+    char error[kErrorLen];  // set when !ok
+  };
+
+  enum class Claim : uint8_t
+  {
+    Fresh, // young enough and not processed yet: now marked as processed
+    Seen,  // young enough but the sampler already processed it
+    None   // nothing young enough; read the sensor
+  };
+
+  SampleCache();
+
+  // The channel's sample if it is at most maxAgeMs old; leaves the
+  // processed mark alone.
+  bool get(uint8_t channel, uint32_t maxAgeMs, uint32_t nowMs, Entry &out) const;
+
+  // For the sampler: fills out for Fresh and Seen.
+  Claim claim(uint8_t channel, uint32_t maxAgeMs, uint32_t nowMs, Entry &out);
+
+  // bySampler: the sampler took it and processes it right away.
+  void store(uint8_t channel, const Entry &sample, bool bySampler);
+
+private:
+  struct Slot
+  {
+    bool valid;
+    bool consumed;
+    Entry sample;
+  };
+
+  Slot slots_[SensorChannels::kMaxChannels];
+};
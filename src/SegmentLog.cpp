@@ -0,0 +1,443 @@
+#include "SegmentLog.h"
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "Crc32.h"
+
+namespace
+{
+  constexpr uint32_t kSegmentMagic = 0x4753514F; // "OQSG"
+  constexpr uint16_t kSegmentVersion = 1;
+  constexpr uint32_t kSegmentHeaderBytes = 8;
+  constexpr uint16_t kRecordMagic = 0x5152;
+  constexpr uint32_t kRecordHeaderBytes = 8;
+  constexpr uint32_t kCursorMagic = 0x5243514F; // "OQCR"
+
+  void put16(uint8_t *p, uint16_t v)
+  {
+    p[0] = static_cast<uint8_t>(v);
+    p[1] = static_cast<uint8_t>(v >> 8);
+  }
+
+  void put32(uint8_t *p, uint32_t v)
+  {
+    put16(p, static_cast<uint16_t>(v));
+    put16(p + 2, static_cast<uint16_t>(v >> 16));
+  }
+
+  uint16_t get16(const uint8_t *p)
+  {
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+  }
+
+  uint32_t get32(const uint8_t *p)
+  {
+    return static_cast<uint32_t>(get16(p)) | (static_cast<uint32_t>(get16(p + 2)) << 16);
+  }
+
+  bool parseSegmentName(const char *name, uint32_t &id)
+  {
+    if (strlen(name) != 12 || strcmp(name + 8, ".seg") != 0)
+      return false;
+    char *end = nullptr;
+    unsigned long v = strtoul(name, &end, 16);
+    if (end != name + 8)
+      return false;
+    id = static_cast<uint32_t>(v);
+    return true;
+  }
+
+  // Reads and validates one framed record. Returns false at EOF or on a
+  // torn/corrupt record.
+  bool readRecord(FILE *f, uint8_t *payload, uint16_t &len)
+  {
+    uint8_t hdr[kRecordHeaderBytes];
+    if (fread(hdr, 1, sizeof(hdr), f) != sizeof(hdr))
+      return false;
+    len = get16(hdr + 2);
+    if (get16(hdr) != kRecordMagic || len > SegmentLog::kMaxRecordBytes)
+      return false;
+    if (fread(payload, 1, len, f) != len)
+      return false;
+    uint32_t crc = Crc32::update(Crc32::compute(hdr + 2, 2), payload, len);
+    return crc == get32(hdr + 4);
+  }
+}
+
+SegmentLog::SegmentLog(const char *dir, uint32_t segmentBytes, uint32_t maxSegments)
+    : segmentBytes_(segmentBytes), maxSegments_(maxSegments < 2 ? 2 : maxSegments), open_(false),
+      haveSegments_(false), headNeedsRoll_(false), tailId_(0), headId_(0), headSize_(0),
+      cursor_{0, kSegmentHeaderBytes}, records_(0), bytes_(0), dropped_(0), corrupt_(0)
+{
+  strncpy(dir_, dir ? dir : "", sizeof(dir_) - 1);
+  dir_[sizeof(dir_) - 1] = '\0';
+}
+
+void SegmentLog::segmentPath(uint32_t id, char *out, size_t outSize) const
+{
+  snprintf(out, outSize, "%s/%08lx.seg", dir_, static_cast<unsigned long>(id));
+}
+
+bool SegmentLog::open()
+{
+  open_ = false;
+  haveSegments_ = false;
+  headNeedsRoll_ = false;
+  records_ = 0;
+  bytes_ = 0;
+
+  mkdir(dir_, 0775);
+  DIR *d = opendir(dir_);
+  if (!d)
+    return false;
+  bool found = false;
+  uint32_t minId = 0;
+  uint32_t maxId = 0;
+  while (struct dirent *e = readdir(d))
+  {
+    uint32_t id;
+    if (!parseSegmentName(e->d_name, id))
+      continue;
+    if (!found || id < minId)
+      minId = id;
+    if (!found || id > maxId)
+      maxId = id;
+    found = true;
+  }
+  closedir(d);
+
+  if (!found)
+  {
+    tailId_ = headId_ = 0;
+    headSize_ = 0;
+    cursor_ = {0, kSegmentHeaderBytes};
+    open_ = true;
+    return true;
+  }
+
+  Position saved;
+  if (loadCursor(saved) && saved.segment >= minId && saved.segment <= maxId)
+    cursor_ = saved;
+  else
+    cursor_ = {minId, kSegmentHeaderBytes};
+
+  // Segments before the cursor were consumed right before a reset.
+  char path[96];
+  for (uint32_t id = minId; id < cursor_.segment; ++id)
+  {
+    segmentPath(id, path, sizeof(path));
+    remove(path);
+  }
+
+  tailId_ = cursor_.segment;
+  headId_ = maxId;
+  haveSegments_ = true;
+  for (uint32_t id = tailId_; id <= headId_; ++id)
+  {
+    uint32_t count = 0;
+    uint32_t bytes = 0;
+    uint32_t end = 0;
+    bool clean = scanSegment(id, id == tailId_ ? cursor_.offset : kSegmentHeaderBytes, count, bytes, end);
+    records_ += count;
+    bytes_ += bytes;
+    if (!clean)
+      corrupt_++;
+    if (id == headId_)
+    {
+      headSize_ = end;
+      // Never append behind a torn record: it would be unreachable.
+      headNeedsRoll_ = !clean;
+    }
+  }
+  open_ = true;
+  return true;
+}
+
+bool SegmentLog::scanSegment(uint32_t id, uint32_t from, uint32_t &count, uint32_t &bytes, uint32_t &end)
+{
+  count = 0;
+  bytes = 0;
+  end = 0;
+  char path[96];
+  segmentPath(id, path, sizeof(path));
+  FILE *f = fopen(path, "rb");
+  if (!f)
+    return false;
+
+  uint8_t hdr[kSegmentHeaderBytes];
+  if (fread(hdr, 1, sizeof(hdr), f) != sizeof(hdr) || get32(hdr) != kSegmentMagic || get16(hdr + 4) != kSegmentVersion)
+  {
+    fclose(f);
+    return false;
+  }
+  if (from < kSegmentHeaderBytes)
+    from = kSegmentHeaderBytes;
+  end = kSegmentHeaderBytes;
+
+  // Records before 'from' still count towards the append position.
+  uint8_t payload[kMaxRecordBytes];
+  uint16_t len = 0;
+  bool clean = true;
+  for (;;)
+  {
+    long pos = ftell(f);
+    if (!readRecord(f, payload, len))
+    {
+      // Clean EOF ends exactly at a record boundary.
+      fseek(f, 0, SEEK_END);
+      clean = (ftell(f) == pos);
+      break;
+    }
+    end = static_cast<uint32_t>(pos) + kRecordHeaderBytes + len;
+    if (static_cast<uint32_t>(pos) >= from)
+    {
+      count++;
+      bytes += kRecordHeaderBytes + len;
+    }
+  }
+  fclose(f);
+  return clean;
+}
+
+bool SegmentLog::createSegment(uint32_t id)
+{
+  char path[96];
+  segmentPath(id, path, sizeof(path));
+  FILE *f = fopen(path, "wb");
+  if (!f)
+    return false;
+  uint8_t hdr[kSegmentHeaderBytes];
+  put32(hdr, kSegmentMagic);
+  put16(hdr + 4, kSegmentVersion);
+  put16(hdr + 6, 0);
+  bool ok = fwrite(hdr, 1, sizeof(hdr), f) == sizeof(hdr);
+  ok = (fclose(f) == 0) && ok;
+  if (!ok)
+  {
+    remove(path);
+    return false;
+  }
+
+  if (!haveSegments_)
+  {
+    haveSegments_ = true;
+    tailId_ = id;
+    cursor_ = {id, kSegmentHeaderBytes};
+    saveCursor();
+  }
+  headId_ = id;
+  headSize_ = kSegmentHeaderBytes;
+  headNeedsRoll_ = false;
+  while (headId_ - tailId_ + 1 > maxSegments_)
+    dropOldestSegment();
+  return true;
+}
+
+void SegmentLog::dropOldestSegment()
+{
+  if (tailId_ >= headId_)
+    return;
+  uint32_t count = 0;
+  uint32_t bytes = 0;
+  uint32_t end = 0;
+  scanSegment(tailId_, cursor_.segment == tailId_ ? cursor_.offset : kSegmentHeaderBytes, count, bytes, end);
+  records_ -= (count < records_) ? count : records_;
+  bytes_ -= (bytes < bytes_) ? bytes : bytes_;
+  dropped_ += count;
+
+  char path[96];
+  segmentPath(tailId_, path, sizeof(path));
+  remove(path);
+  tailId_++;
+  if (cursor_.segment < tailId_)
+  {
+    cursor_ = {tailId_, kSegmentHeaderBytes};
+    saveCursor();
+  }
+}
+
+bool SegmentLog::append(const void *records, uint16_t recordSize, size_t count)
+{
+  if (!open_ || recordSize == 0 || recordSize > kMaxRecordBytes)
+    return false;
+
+  const uint8_t *src = static_cast<const uint8_t *>(records);
+  const uint32_t framed = kRecordHeaderBytes + recordSize;
+  char path[96];
+  FILE *f = nullptr;
+  bool ok = true;
+  for (size_t i = 0; i < count; ++i, src += recordSize)
+  {
+    if (!haveSegments_ || headNeedsRoll_ || headSize_ + framed > segmentBytes_)
+    {
+      if (f)
+      {
+        fclose(f);
+        f = nullptr;
+      }
+      if (!createSegment(haveSegments_ ? headId_ + 1 : headId_))
+      {
+        ok = false;
+        break;
+      }
+    }
+    if (!f)
+    {
+      segmentPath(headId_, path, sizeof(path));
+      f = fopen(path, "ab");
+      if (!f)
+      {
+        ok = false;
+        break;
+      }
+    }
+
+    uint8_t hdr[kRecordHeaderBytes];
+    put16(hdr, kRecordMagic);
+    put16(hdr + 2, recordSize);
+    put32(hdr + 4, Crc32::update(Crc32::compute(hdr + 2, 2), src, recordSize));
+    if (fwrite(hdr, 1, sizeof(hdr), f) != sizeof(hdr) || fwrite(src, 1, recordSize, f) != recordSize)
+    {
+      // Leave the partial record behind a roll so it is never read back.
+      headNeedsRoll_ = true;
+      ok = false;
+      break;
+    }
+    headSize_ += framed;
+    records_++;
+    bytes_ += framed;
+  }
+  if (f && fclose(f) != 0)
+    ok = false;
+  return ok;
+}
+
+size_t SegmentLog::walk(Position &pos, void *out, uint16_t recordSize, size_t maxRecords, uint32_t &walkedBytes,
+                        bool deleteConsumed)
+{
+  walkedBytes = 0;
+  size_t walked = 0;
+  uint8_t *dst = static_cast<uint8_t *>(out);
+  uint8_t payload[kMaxRecordBytes];
+  char path[96];
+
+  while (walked < maxRecords && haveSegments_ && pos.segment <= headId_)
+  {
+    segmentPath(pos.segment, path, sizeof(path));
+    bool segmentEnded = true;
+    FILE *f = fopen(path, "rb");
+    if (f)
+    {
+      if (fseek(f, pos.offset, SEEK_SET) == 0)
+      {
+        segmentEnded = false;
+        while (walked < maxRecords)
+        {
+          uint16_t len = 0;
+          if (!readRecord(f, payload, len) || (recordSize && len > recordSize))
+          {
+            segmentEnded = true;
+            break;
+          }
+          if (dst)
+          {
+            // A shorter record predates fields appended to the layout.
+            memcpy(dst, payload, len);
+            const uint16_t stride = recordSize ? recordSize : len;
+            memset(dst + len, 0, stride - len);
+            dst += stride;
+          }
+          pos.offset += kRecordHeaderBytes + len;
+          walkedBytes += kRecordHeaderBytes + len;
+          walked++;
+        }
+      }
+      fclose(f);
+    }
+
+    // The head segment is where new records land; stay on it.
+    if (!segmentEnded || pos.segment == headId_)
+      break;
+
+    if (deleteConsumed)
+    {
+      remove(path);
+      tailId_ = pos.segment + 1;
+    }
+    pos.segment++;
+    pos.offset = kSegmentHeaderBytes;
+  }
+  return walked;
+}
+
+size_t SegmentLog::peek(void *out, uint16_t recordSize, size_t maxRecords)
+{
+  if (!open_ || records_ == 0)
+    return 0;
+  Position pos = cursor_;
+  uint32_t walkedBytes = 0;
+  size_t n = walk(pos, out, recordSize, maxRecords, walkedBytes, false);
+  if (n == 0)
+  {
+    // Counted records turned out unreadable (flash corruption); resync.
+    records_ = 0;
+    bytes_ = 0;
+  }
+  return n;
+}
+
+size_t SegmentLog::read(Position &pos, void *out, uint16_t recordSize, size_t maxRecords)
+{
+  if (!open_ || records_ == 0 || pos.segment < tailId_)
+    return 0;
+  uint32_t walkedBytes = 0;
+  return walk(pos, out, recordSize, maxRecords, walkedBytes, false);
+}
+
+void SegmentLog::consume(size_t count)
+{
+  if (!open_ || count == 0)
+    return;
+  uint32_t walkedBytes = 0;
+  size_t n = walk(cursor_, nullptr, 0, count, walkedBytes, true);
+  records_ -= (n < records_) ? static_cast<uint32_t>(n) : records_;
+  bytes_ -= (walkedBytes < bytes_) ? walkedBytes : bytes_;
+  saveCursor();
+}
+
+bool SegmentLog::saveCursor()
+{
+  uint8_t buf[16];
+  put32(buf, kCursorMagic);
+  put32(buf + 4, cursor_.segment);
+  put32(buf + 8, cursor_.offset);
+  put32(buf + 12, Crc32::compute(buf, 12));
+  char path[96];
+  snprintf(path, sizeof(path), "%s/cursor", dir_);
+  FILE *f = fopen(path, "wb");
+  if (!f)
+    return false;
+  bool ok = fwrite(buf, 1, sizeof(buf), f) == sizeof(buf);
+  return (fclose(f) == 0) && ok;
+}
+
+bool SegmentLog::loadCursor(Position &pos)
+{
+  char path[96];
+  snprintf(path, sizeof(path), "%s/cursor", dir_);
+  FILE *f = fopen(path, "rb");
+  if (!f)
+    return false;
+  uint8_t buf[16];
+  bool ok = fread(buf, 1, sizeof(buf), f) == sizeof(buf);
+  fclose(f);
+  if (!ok || get32(buf) != kCursorMagic || get32(buf + 12) != Crc32::compute(buf, 12))
+    return false;
+  pos.segment = get32(buf + 4);
+  pos.offset = get32(buf + 8);
+  return pos.offset >= kSegmentHeaderBytes;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Append-only record log split into segment files inside one directory.
+//
+// Segment file "<dir>/<id as 8 hex digits>.seg":
+//   header:  magic "OQSG" (u32) | version (u16) | reserved (u16)
+//   records: magic 0x5152 (u16) | length (u16) | crc32(length + payload) (u32) | payload
+//
+// All integers are little-endian. A record that is truncated or fails its
+// CRC (torn write at power loss) ends its segment; reading resumes at the
+// next segment. Consumption is tracked by "<dir>/cursor" (segment id, byte
+// offset, crc32) so nothing is rewritten when records are consumed; fully
+// consumed segments are deleted. When more than maxSegments exist the
+// oldest segment is dropped.
+//
+// Only stdio/dirent calls are used: on the device the directory lives on
+// LittleFS through the VFS, on a desktop any plain directory works.
+class SegmentLog
+{
+public:
+  struct Position
+  {
+    uint32_t segment;
+    uint32_t offset;
+  };
+
+  SegmentLog(const char *dir, uint32_t segmentBytes, uint32_t maxSegments);
+
+  // Scans existing segments and restores the read cursor.
+  bool open();
+  bool isOpen() const { return open_; }
+
+  // Appends count records of recordSize bytes each, stored contiguously.
+  bool append(const void *records, uint16_t recordSize, size_t count);
+  // Copies up to maxRecords records into recordSize-byte slots, oldest
+  // first, without consuming them. Records shorter than recordSize (an
+  // older layout, fields only ever appended) are zero-extended; longer ones
+  // end the walk. Returns the number copied.
+  size_t peek(void *out, uint16_t recordSize, size_t maxRecords);
+  // Like peek(), but from pos (start at cursor()) and advancing it, for
+  // reading further than one buffer's worth. pos is only valid while
+  // nothing is consumed and droppedRecords() stays the same.
+  size_t read(Position &pos, void *out, uint16_t recordSize, size_t maxRecords);
+  // Consumes the count oldest records.
+  void consume(size_t count);
+
+  // Position of the oldest unconsumed record.
+  Position cursor() const { return cursor_; }
+
+  uint32_t records() const { return records_; }
+  uint32_t bytes() const { return bytes_; }
+  uint32_t droppedRecords() const { return dropped_; }
+  uint32_t corruptSegments() const { return corrupt_; }
+
+  static constexpr uint16_t kMaxRecordBytes = 256;
+
+private:
+  void segmentPath(uint32_t id, char *out, size_t outSize) const;
+  bool createSegment(uint32_t id);
+  void dropOldestSegment();
+  bool saveCursor();
+  bool loadCursor(Position &pos);
+  // Walks up to maxRecords records from pos, optionally copying them into
+  // out. Advances pos and returns the number walked plus their framed size.
+  size_t walk(Position &pos, void *out, uint16_t recordSize, size_t maxRecords, uint32_t &walkedBytes,
+              bool deleteConsumed);
+  bool scanSegment(uint32_t id, uint32_t from, uint32_t &count, uint32_t &bytes, uint32_t &end);
+
+  char dir_[48];
+  uint32_t segmentBytes_;
+  uint32_t maxSegments_;
+  bool open_;
+  bool haveSegments_;
+  bool headNeedsRoll_;
+  uint32_t tailId_;
+  uint32_t headId_;
+  uint32_t headSize_;
+  Position cursor_;
+  uint32_t records_;
+  uint32_t bytes_;
+  uint32_t dropped_;
+  uint32_t corrupt_;
+};
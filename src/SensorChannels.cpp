@@ -0,0 +1,118 @@
+#include "SensorChannels.h"
+
+#include "Metrics.h"
+#include "StructuredLog.h"
+#include "config.h"
+
+#ifdef SENSOR_CHANNELS_JSON
+#include <ArduinoJson.h>
+#endif
+
+#ifndef SENSOR_DRIVER
+#define SENSOR_DRIVER "dht"
+#endif
+#ifndef SENSOR_I2C_ADDRESS
+#define SENSOR_I2C_ADDRESS 0
+#endif
+#ifndef SENSOR_SIM_SCRIPT
+#define SENSOR_SIM_SCRIPT ""
+#endif
+
+static_assert(SensorChannels::kMaxChannels <= kMetricsMaxChannels, "Metrics must have a slot per sensor channel");
+
+namespace
+{
+    SensorChannels::Channel gChannels[SensorChannels::kMaxChannels];
+    size_t gCount = 0;
+
+    void setDefaults(SensorChannels::Channel &ch)
+    {
+        ch.name = F("main");
+        ch.location = String();
+        ch.driver = SENSOR_DRIVER;
+        ch.i2cAddress = SENSOR_I2C_ADDRESS;
+        ch.pin = -1;
+        ch.script = SENSOR_SIM_SCRIPT;
+        ch.intervalSec = 0;
+    }
+
+#ifdef SENSOR_CHANNELS_JSON
+    void fromJson(JsonArrayConst arr)
+    {
+        for (JsonObjectConst o : arr)
+        {
+            if (gCount >= SensorChannels::kMaxChannels)
+            {
+                LOGF_WARN("More than %u sensor channels configured; extra ones ignored",
+                          static_cast<unsigned>(SensorChannels::kMaxChannels));
+                break;
+            }
+            SensorChannels::Channel &ch = gChannels[gCount];
+            setDefaults(ch);
+            ch.name = o["name"] | "";
+            if (ch.name.isEmpty())
+                ch.name = String(F("ch")) + String(static_cast<unsigned>(gCount));
+            ch.location = o["location"] | "";
+            ch.driver = o["driver"] | SENSOR_DRIVER;
+            ch.i2cAddress = o["address"] | static_cast<uint8_t>(SENSOR_I2C_ADDRESS);
+            ch.pin = o["pin"] | static_cast<int8_t>(-1);
+            ch.script = o["script"] | SENSOR_SIM_SCRIPT;
+            ch.intervalSec = o["interval_sec"] | 0U;
+            ++gCount;
+        }
+    }
+#endif
+}
+
+void SensorChannels::init()
+{
+    gCount = 0;
+#ifdef SENSOR_CHANNELS_JSON
+    {
+        JsonDocument doc;
+        if (!deserializeJson(doc, SENSOR_CHANNELS_JSON) && doc.is<JsonArrayConst>())
+            fromJson(doc.as<JsonArrayConst>());
+        else
+            LOG_WARN(F("SENSOR_CHANNELS_JSON is not a JSON array; using the single default sensor"));
+    }
+#endif
+    if (gCount == 0)
+    {
+        setDefaults(gChannels[0]);
+        gCount = 1;
+    }
+    for (size_t i = 0; i < gCount; ++i)
+    {
+        const Channel &ch = gChannels[i];
+        if (ch.intervalSec)
+            LOGF_INFO("Sensor channel '%s': %s every %lu s", ch.name.c_str(), ch.driver.c_str(), static_cast<unsigned long>(ch.intervalSec));
+        else
+            LOGF_INFO("Sensor channel '%s': %s at post_interval_sec", ch.name.c_str(), ch.driver.c_str());
+    }
+}
+
+size_t SensorChannels::count()
+{
+    return gCount ? gCount : 1;
+}
+
+const SensorChannels::Channel &SensorChannels::get(uint8_t index)
+{
+    if (gCount == 0)
+    {
+        setDefaults(gChannels[0]);
+        gCount = 1;
+    }
+    return gChannels[index < gCount ? index : 0];
+}
+
+bool SensorChannels::tagged()
+{
+    return gCount > 1;
+}
+
+const String &SensorChannels::location(uint8_t index, const String &deviceLocation)
+{
+    const Channel &ch = get(index);
+    return ch.location.length() ? ch.location : deviceLocation;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <Arduino.h>
+
+// The sensor channels one board samples: a probe each, with its own driver,
+// sample interval and location label. Without SENSOR_CHANNELS_JSON there is
+// a single channel built from SENSOR_DRIVER / DHTPIN / SENSOR_I2C_ADDRESS,
+// sampled at post_interval_sec and labelled with device_location, which is
+// exactly the single-sensor setup.
+//
+// The table is filled once by init() before the tasks start and is
+// read-only afterwards, so lookups take no lock. Readings refer to their
+// channel by index (Reading::channel).
+namespace SensorChannels
+{
+    constexpr size_t kMaxChannels = 4;
+
+    struct Channel
+    {
+        String name;          // metric label and "channel" field; "main" by default
+        String location;      // upstream location label; empty = device_location
+        String driver;        // see createSensorDriver()
+        uint8_t i2cAddress;   // 0 = driver default
+        int8_t pin;           // DHT data pin; -1 = DHTPIN
+        String script;        // simulated driver steps
+        uint32_t intervalSec; // 0 = post_interval_sec
+    };
+
+    // Parses SENSOR_CHANNELS_JSON (if defined). Call once at startup.
+    void init();
+
+    size_t count();
+    // Channel index out of range (e.g. a queued reading from a previous
+    // configuration) falls back to channel 0.
+    const Channel &get(uint8_t index);
+
+    // True with more than one channel: readings are then tagged with their
+    // channel name and location in every payload.
+    bool tagged();
+
+    // The channel's location label, or deviceLocation when it has none.
+    const String &location(uint8_t index, const String &deviceLocation);
+}
@@ -0,0 +1,51 @@
+#include "SensorDriver.h"
+
+#include <Wire.h>
+#include <strings.h>
+
+#include "Bme280Driver.h"
+#include "DhtDriver.h"
+#include "Sht3xDriver.h"
+#include "SimulatedDriver.h"
+#include "StructuredLog.h"
+#include "config.h"
+
+#ifndef SENSOR_I2C_SDA
+#define SENSOR_I2C_SDA -1
+#endif
+#ifndef SENSOR_I2C_SCL
+#define SENSOR_I2C_SCL -1
+#endif
+
+namespace
+{
+  // Both I2C sensors are specified for fast mode.
+  constexpr uint32_t kI2cClockHz = 400000;
+
+  bool gWireStarted = false;
+
+  // All I2C channels share the one bus; start it once.
+  TwoWire &i2cBus()
+  {
+    if (!gWireStarted)
+    {
+      // -1 selects the board's default SDA/SCL pins.
+      Wire.begin(SENSOR_I2C_SDA, SENSOR_I2C_SCL, kI2cClockHz);
+      gWireStarted = true;
+    }
+    return Wire;
+  }
+}
+
+SensorDriver *createSensorDriver(const char *type, uint8_t i2cAddress, int dhtPin, const char *simScript)
+{
+  if (strcasecmp(type, "sht3x") == 0)
+    return new Sht3xDriver(i2cBus(), i2cAddress ? i2cAddress : Sht3xDriver::kDefaultAddress);
+  if (strcasecmp(type, "bme280") == 0)
+    return new Bme280Driver(i2cBus(), i2cAddress ? i2cAddress : Bme280Driver::kDefaultAddress);
+  if (strcasecmp(type, "sim") == 0)
+    return new SimulatedDriver(simScript);
+  if (strcasecmp(type, "dht") != 0)
+    LOGF_WARN("Unknown sensor driver '%s'; using the DHT", type);
+  return new DhtDriver(dhtPin >= 0 ? static_cast<uint8_t>(dhtPin) : DHTPIN, DHTTYPE);
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stdint.h>
+
+// A temperature/humidity sensor. The sensor task owns one instance per
+// channel (see SensorChannels.h) and serialises all calls across them, so
+// probes may share a bus and implementations need no locking of their own.
+class SensorDriver
+{
+public:
+  virtual ~SensorDriver() {}
+
+  // Short label used in logs, error posts and /status.
+  virtual const char *name() const = 0;
+
+  // Brings the sensor into a known state; also used to recover after a
+  // failed read. False if the sensor did not answer.
+  virtual bool begin() = 0;
+
+  // One measurement. A channel that could not be read is set to NaN; the
+  // result is true only when both are valid.
+  virtual bool read(float &temperatureC, float &humidityPct) = 0;
+
+  // Shortest time between two reads the sensor tolerates; a read asked
+  // for sooner is answered from the previous sample (see SampleCache.h).
+  // The sampler takes a sample a GET /read took in that time as its own
+  // measurement, and skips the cycle only for one it already processed.
+  virtual uint32_t minIntervalMs() const { return 0; }
+};
+
+// Builds a driver by type: "dht", "sht3x", "bme280" or "sim"; unknown
+// names fall back to the DHT. i2cAddress 0 = the driver's default,
+// dhtPin < 0 = DHTPIN; simScript is only used by "sim".
+SensorDriver *createSensorDriver(const char *type, uint8_t i2cAddress, int dhtPin, const char *simScript);
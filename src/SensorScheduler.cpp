@@ -0,0 +1,91 @@
+#include "SensorScheduler.h"
+
+namespace
+{
+  // Intervals are clamped so interval * 1000 fits the millis() timeline
+  // with room to compare (about 24 days).
+  constexpr uint32_t kMaxIntervalSec = 0x7FFFFFFFUL / 1000UL;
+
+  bool reached(uint32_t nowMs, uint32_t dueMs)
+  {
+    return static_cast<int32_t>(nowMs - dueMs) >= 0;
+  }
+}
+
+SensorScheduler::SensorScheduler() : count_(0), align_(false), intervalMs_(), dueMs_()
+{
+}
+
+void SensorScheduler::configure(size_t count, const uint32_t *intervalSec, bool align, uint32_t nowMs, uint64_t wallMs)
+{
+  count_ = count < kMaxChannels ? count : kMaxChannels;
+  align_ = align;
+  for (size_t i = 0; i < count_; ++i)
+  {
+    uint32_t sec = intervalSec[i] ? intervalSec[i] : 1;
+    if (sec > kMaxIntervalSec)
+      sec = kMaxIntervalSec;
+    intervalMs_[i] = sec * 1000UL;
+  }
+  replan(nowMs, wallMs);
+}
+
+void SensorScheduler::replan(uint32_t nowMs, uint64_t wallMs)
+{
+  for (size_t i = 0; i < count_; ++i)
+    dueMs_[i] = next(i, nowMs, wallMs, false);
+}
+
+void SensorScheduler::advance(size_t channel, uint32_t nowMs, uint64_t wallMs)
+{
+  if (channel < count_)
+    dueMs_[channel] = next(channel, nowMs, wallMs, true);
+}
+
+uint32_t SensorScheduler::next(size_t channel, uint32_t nowMs, uint64_t wallMs, bool fromPrevious) const
+{
+  const uint32_t interval = intervalMs_[channel];
+  if (align_ && wallMs)
+  {
+    uint64_t target = (wallMs / interval + 1) * interval;
+    // millis() and the wall clock drift apart slightly; a sample taken
+    // just before its boundary must not make the same boundary due again.
+    if (fromPrevious && target - wallMs < interval / 2)
+      target += interval;
+    return nowMs + static_cast<uint32_t>(target - wallMs);
+  }
+  if (fromPrevious)
+  {
+    const uint32_t due = dueMs_[channel] + interval;
+    // Fell more than an interval behind (long read, suspended task):
+    // resume from now instead of bursting to catch up.
+    if (!reached(nowMs, due))
+      return due;
+  }
+  return nowMs + interval;
+}
+
+uint32_t SensorScheduler::dueMask(uint32_t nowMs) const
+{
+  uint32_t mask = 0;
+  for (size_t i = 0; i < count_; ++i)
+  {
+    if (reached(nowMs, dueMs_[i]))
+      mask |= 1UL << i;
+  }
+  return mask;
+}
+
+uint32_t SensorScheduler::msUntilNext(uint32_t nowMs) const
+{
+  uint32_t wait = 0xFFFFFFFFUL;
+  for (size_t i = 0; i < count_; ++i)
+  {
+    if (reached(nowMs, dueMs_[i]))
+      return 0;
+    const uint32_t left = dueMs_[i] - nowMs;
+    if (left < wait)
+      wait = left;
+  }
+  return count_ ? wait : 1000;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Sample timetable for up to kMaxChannels sensor channels, each with its
+// own interval. Due times live on the caller's millis() timeline.
+//
+// With a wall clock (wallMs != 0) and alignment on, a channel is due at the
+// next multiple of its interval since the epoch, so channels whose
+// intervals divide each other fall due together (10 s and 30 s meet every
+// 30 s) and their readings go out as one cycle. Otherwise a channel is due
+// one interval after its previous due time, which keeps the cadence free
+// of drift from read and upload time.
+//
+// Time comes from the caller, keeping the class free of platform calls.
+class SensorScheduler
+{
+public:
+  static constexpr size_t kMaxChannels = 4;
+
+  SensorScheduler();
+
+  // Replaces the channel intervals (seconds, 0 is treated as 1) and
+  // plans every channel from nowMs.
+  void configure(size_t count, const uint32_t *intervalSec, bool align, uint32_t nowMs, uint64_t wallMs);
+  // Plans every channel again from nowMs (e.g. once the clock is set).
+  void replan(uint32_t nowMs, uint64_t wallMs);
+  // Plans the next sample of one channel after it was taken.
+  void advance(size_t channel, uint32_t nowMs, uint64_t wallMs);
+
+  // Bit i set when channel i is due at nowMs.
+  uint32_t dueMask(uint32_t nowMs) const;
+  // Milliseconds until the earliest channel is due (0 if one is due now).
+  uint32_t msUntilNext(uint32_t nowMs) const;
+  uint32_t dueAt(size_t channel) const { return channel < count_ ? dueMs_[channel] : 0; }
+  size_t count() const { return count_; }
+
+private:
+  uint32_t next(size_t channel, uint32_t nowMs, uint64_t wallMs, bool fromPrevious) const;
+
+  size_t count_;
+  bool align_;
+  uint32_t intervalMs_[kMaxChannels];
+  uint32_t dueMs_[kMaxChannels];
+};
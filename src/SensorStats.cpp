@@ -0,0 +1,120 @@
+#include "SensorStats.h"
+
+#include <stdlib.h>
+
+#include "StructuredLog.h"
+#include "config.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#ifndef STATS_WINDOWS_SEC
+#define STATS_WINDOWS_SEC "300,3600,86400"
+#endif
+
+namespace
+{
+    uint32_t gWindowSec[SensorStats::kMaxWindows];
+    size_t gWindows = 0;
+    size_t gChannels = 0;
+    // gChannels x gWindows, channel-major.
+    WindowStats *gStats = nullptr;
+    // A mutex rather than a critical section: a summary walks every bucket
+    // and takes square roots, too long to run with interrupts masked.
+    // Created by init() before gStats is set.
+    SemaphoreHandle_t gMutex = nullptr;
+
+    void lock()
+    {
+        xSemaphoreTake(gMutex, portMAX_DELAY);
+    }
+
+    void unlock()
+    {
+        xSemaphoreGive(gMutex);
+    }
+
+    void parseWindows(const char *text)
+    {
+        gWindows = 0;
+        while (*text && gWindows < SensorStats::kMaxWindows)
+        {
+            char *end = nullptr;
+            const unsigned long sec = strtoul(text, &end, 10);
+            if (end == text)
+                break;
+            if (sec > 0)
+                gWindowSec[gWindows++] = static_cast<uint32_t>(sec);
+            text = end;
+            while (*text == ',' || *text == ' ')
+                ++text;
+        }
+        if (*text && gWindows == SensorStats::kMaxWindows)
+            LOGF_WARN("STATS_WINDOWS_SEC: only the first %u windows are kept", static_cast<unsigned>(SensorStats::kMaxWindows));
+    }
+}
+
+void SensorStats::init()
+{
+    if (!gMutex)
+        gMutex = xSemaphoreCreateMutex();
+    parseWindows(STATS_WINDOWS_SEC);
+    gChannels = SensorChannels::count();
+    if (gWindows == 0)
+    {
+        LOG_INFO(F("Sliding-window statistics disabled"));
+        return;
+    }
+    gStats = new WindowStats[gChannels * gWindows];
+    const uint32_t now = millis();
+    for (size_t c = 0; c < gChannels; ++c)
+    {
+        for (size_t w = 0; w < gWindows; ++w)
+            gStats[c * gWindows + w].configure(gWindowSec[w], now);
+    }
+    LOGF_INFO("Sliding-window statistics: %u window(s) per channel, %u bytes",
+              static_cast<unsigned>(gWindows), static_cast<unsigned>(gChannels * gWindows * sizeof(WindowStats)));
+}
+
+size_t SensorStats::windowCount()
+{
+    return gStats ? gWindows : 0;
+}
+
+void SensorStats::record(uint8_t channel, float temperatureC, float humidityPct, uint32_t nowMs)
+{
+    if (!gStats || channel >= gChannels)
+        return;
+    WindowStats *stats = &gStats[channel * gWindows];
+    lock();
+    for (size_t w = 0; w < gWindows; ++w)
+        stats[w].add(temperatureC, humidityPct, nowMs);
+    unlock();
+}
+
+bool SensorStats::summary(uint8_t channel, size_t window, WindowStats::Summary &out)
+{
+    if (!gStats || channel >= gChannels || window >= gWindows)
+        return false;
+    const uint32_t now = millis();
+    lock();
+    out = gStats[channel * gWindows + window].summary(now);
+    unlock();
+    return true;
+}
+
+void SensorStats::snapshot(Snapshot &out)
+{
+    out.channels = gStats ? gChannels : 0;
+    out.windows = windowCount();
+    const uint32_t now = millis();
+    if (!out.channels)
+        return;
+    lock();
+    for (size_t c = 0; c < out.channels; ++c)
+    {
+        for (size_t w = 0; w < out.windows; ++w)
+            out.summaries[c][w] = gStats[c * gWindows + w].summary(now);
+    }
+    unlock();
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "SensorChannels.h"
+#include "WindowStats.h"
+
+// Rolling statistics per sensor channel over the STATS_WINDOWS_SEC windows
+// (default 5 min, 1 h and 24 h). Every filtered sample is recorded, also
+// those the deadband keeps from being uploaded, so the windows describe
+// what the sensor saw rather than what was posted.
+//
+// Storage is allocated once by init() for the configured channels; record()
+// and summary() are constant time and safe from any task (not from an
+// interrupt: they take a mutex).
+namespace SensorStats
+{
+    constexpr size_t kMaxWindows = 3;
+
+    // Parses STATS_WINDOWS_SEC. Call once at startup, after
+    // SensorChannels::init().
+    void init();
+
+    size_t windowCount();
+
+    void record(uint8_t channel, float temperatureC, float humidityPct, uint32_t nowMs);
+
+    // False for a channel or window out of range.
+    bool summary(uint8_t channel, size_t window, WindowStats::Summary &out);
+
+    // Every channel's windows at one moment, for payloads that are
+    // rendered more than once (sizing pass, then the real one).
+    struct Snapshot
+    {
+        size_t channels;
+        size_t windows;
+        WindowStats::Summary summaries[SensorChannels::kMaxChannels][kMaxWindows];
+    };
+
+    void snapshot(Snapshot &out);
+}
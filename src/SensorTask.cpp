@@ -1,56 +1,171 @@
 #include "SensorTask.h"
 
-#include <Adafruit_Sensor.h>
-#include <DHT.h>
-#include <DHT_U.h>
 #include <WiFi.h>
 #include <time.h>
 #include <sys/time.h>
+#include <string.h>
 
-#include "Poster.h"
 #include "config.h"
 #include "AppConfig.h"
+#include "Deadband.h"
 #include "Metrics.h"
+#include "ReadingFilter.h"
+#include "SampleCache.h"
+#include "SensorChannels.h"
+#include "SensorDriver.h"
+#include "SensorScheduler.h"
+#include "SensorStats.h"
+#include "Sequence.h"
 #include "StructuredLog.h"
 #include "TaskWatchdog.h"
+#include "UploaderTask.h"
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 
-static Poster *gPoster = nullptr;
+static_assert(SensorChannels::kMaxChannels <= SensorScheduler::kMaxChannels, "Scheduler must cover every sensor channel");
+
 static TaskHandle_t gSensorTaskHandle = nullptr;
-static SemaphoreHandle_t gDhtMutex = nullptr;
+// Serialises every driver call, so channels may share a bus. Created by
+// initSensorTask() before any task can read a sensor.
+static SemaphoreHandle_t gSensorMutex = nullptr;
+
+// Created on first use and kept across task restarts.
+static SensorDriver *gSensors[SensorChannels::kMaxChannels] = {};
 
-// DHT sensor instance
-static DHT_Unified dht(DHTPIN, DHTTYPE);
+static constexpr time_t kMinValidEpoch = 1600000000;
 
-static uint8_t dhtFailCount = 0;
+// Per-channel filter and report-by-exception state; only the sensor task
+// touches them.
+static ReadingFilter gFilter[SensorChannels::kMaxChannels];
+static Deadband gDeadband[SensorChannels::kMaxChannels];
 
-static bool takeReading(float &t, float &h, String &err)
+// Caller holds gSensorMutex.
+static SensorDriver &sensor(uint8_t channel)
 {
-  if (!gDhtMutex)
+  const SensorChannels::Channel &ch = SensorChannels::get(channel);
+  if (channel >= SensorChannels::count())
+    channel = 0;
+  SensorDriver *&drv = gSensors[channel];
+  if (!drv)
   {
-    gDhtMutex = xSemaphoreCreateMutex();
+    drv = createSensorDriver(ch.driver.c_str(), ch.i2cAddress, ch.pin, ch.script.c_str());
+    if (drv->begin())
+      LOGF_INFO("%s sensor initialized (channel '%s')", drv->name(), ch.name.c_str());
+    else
+      LOGF_WARN("%s sensor (channel '%s') did not answer; retrying on each read", drv->name(), ch.name.c_str());
   }
-  xSemaphoreTake(gDhtMutex, portMAX_DELAY);
+  return *drv;
+}
+
+static void lockSensor()
+{
+  xSemaphoreTake(gSensorMutex, portMAX_DELAY);
+}
 
-  sensors_event_t event;
-  t = NAN;
-  h = NAN;
+// Written with gSensorMutex held; read under gCacheMux so a cache hit
+// never waits for a read in progress.
+static SampleCache gCache;
+static portMUX_TYPE gCacheMux = portMUX_INITIALIZER_UNLOCKED;
+
+static void toSensorSample(const SampleCache::Entry &e, uint32_t now, SensorSample &out)
+{
+  out.ok = e.ok;
+  out.temperatureC = e.temperatureC;
+  out.humidityPct = e.humidityPct;
+  out.ageMs = now - e.takenMs;
+  out.error = e.ok ? String() : String(e.error);
+}
+
+// True if the channel's last sample is at most maxAgeMs old; fills out.
+static bool cachedSample(uint8_t channel, uint32_t maxAgeMs, SensorSample &out)
+{
+  const uint32_t now = millis();
+  SampleCache::Entry e;
+  portENTER_CRITICAL(&gCacheMux);
+  const bool hit = gCache.get(channel, maxAgeMs, now, e);
+  portEXIT_CRITICAL(&gCacheMux);
+  if (hit)
+    toSensorSample(e, now, out);
+  return hit;
+}
 
-  dht.temperature().getEvent(&event);
-  if (!isnan(event.temperature))
-    t = event.temperature;
+static void storeSample(uint8_t channel, const SensorSample &s, uint32_t takenMs, bool bySampler)
+{
+  SampleCache::Entry e;
+  e.ok = s.ok;
+  e.temperatureC = s.temperatureC;
+  e.humidityPct = s.humidityPct;
+  e.takenMs = takenMs;
+  strncpy(e.error, s.error.c_str(), sizeof(e.error) - 1);
+  e.error[sizeof(e.error) - 1] = '\0';
+  portENTER_CRITICAL(&gCacheMux);
+  gCache.store(channel, e, bySampler);
+  portEXIT_CRITICAL(&gCacheMux);
+}
 
-  dht.humidity().getEvent(&event);
-  if (!isnan(event.relative_humidity))
-    h = event.relative_humidity;
+// Caller holds gSensorMutex. Reads the channel's sensor, unless the driver
+// needs more rest since its last read; then the previous sample answers.
+// With oversampling the sample averages several back-to-back reads (not
+// for drivers with a minimum read interval).
+//
+// For a poller, false when out came from the cache. For the sampler, a
+// cached sample it has not processed yet (one a GET /read took) counts as
+// its new measurement; false only when it already processed the cached
+// one.
+static bool readLocked(uint8_t channel, SensorSample &out, bool forSampler)
+{
+  SensorDriver &drv = sensor(channel);
+  if (drv.minIntervalMs() > 0)
+  {
+    if (!forSampler)
+    {
+      if (cachedSample(channel, drv.minIntervalMs(), out))
+        return false;
+    }
+    else
+    {
+      const uint32_t now = millis();
+      SampleCache::Entry e;
+      portENTER_CRITICAL(&gCacheMux);
+      const SampleCache::Claim claim = gCache.claim(channel, drv.minIntervalMs(), now, e);
+      portEXIT_CRITICAL(&gCacheMux);
+      if (claim != SampleCache::Claim::None)
+      {
+        toSensorSample(e, now, out);
+        return claim == SampleCache::Claim::Fresh;
+      }
+    }
+  }
 
-  if (isnan(t) || isnan(h))
+  const uint8_t reads = drv.minIntervalMs() > 0 ? 1 : AppConfig::get().getFilterSettings().oversample;
+  Oversampler burst;
+  float t = NAN, h = NAN;
+  const uint32_t start = millis();
+  for (uint8_t i = 0; i < reads; ++i)
   {
-    dhtFailCount++;
+    (void)drv.read(t, h);
+    burst.add(t, h);
+  }
+  const bool ok = burst.result(t, h);
+  const uint32_t durationMs = millis() - start;
+
+  out.ok = ok;
+  out.temperatureC = t;
+  out.humidityPct = h;
+  out.ageMs = 0;
+  out.error = String();
+  if (!ok)
+  {
+    String &err = out.error;
     err.reserve(64);
-    err = F("DHT read failed: ");
+    if (SensorChannels::tagged())
+    {
+      err = SensorChannels::get(channel).name;
+      err += F(": ");
+    }
+    err += drv.name();
+    err += F(" read failed: ");
     if (isnan(t) && isnan(h))
       err += F("temp+hum");
     else if (isnan(t))
@@ -58,36 +173,74 @@ static bool takeReading(float &t, float &h, String &err)
     else if (isnan(h))
       err += F("hum");
     LOG_WARN(err);
-    if ((dhtFailCount % 1) == 0)
-    {
-      LOG_INFO(F("Reinitializing DHT sensor..."));
-      dht.begin();
-    }
-    xSemaphoreGive(gDhtMutex);
-    Metrics::recordSensorRead(false, t, h);
-    return false;
+    LOGF_INFO("Reinitializing %s sensor...", drv.name());
+    (void)drv.begin();
   }
-
-  dhtFailCount = 0;
-  xSemaphoreGive(gDhtMutex);
-  Metrics::recordSensorRead(true, t, h);
+  storeSample(channel, out, start + durationMs, forSampler);
+  Metrics::recordSensorRead(channel, ok, t, h, durationMs);
   return true;
 }
 
-static bool readAndPost()
+// False when the driver could not be read yet and the sampler has already
+// processed its last sample; out then holds that sample.
+static bool takeReading(uint8_t channel, SensorSample &out)
 {
-  float t = NAN, h = NAN;
-  String err;
-  bool ok = takeReading(t, h, err);
-  if (!ok)
+  lockSensor();
+  const bool fresh = readLocked(channel, out, true);
+  xSemaphoreGive(gSensorMutex);
+  return fresh;
+}
+
+// Samples one channel. True when out holds a reading to upload; a failed
+// read is sent as an error post right away, a reading inside the deadband
+// is dropped. A channel whose driver still needs rest uses the sample a
+// GET /read took meanwhile; it skips the cycle only if that sample went
+// through here already, since filtering, recording and numbering it again
+// would count it twice.
+static bool sampleChannel(uint8_t channel, Reading &out)
+{
+  SensorSample s;
+  if (!takeReading(channel, s))
+  {
+    LOGF_DEBUG("Channel %u: sample from %lu ms ago already processed, skipping this cycle", static_cast<unsigned>(channel),
+               static_cast<unsigned long>(s.ageMs));
+    return false;
+  }
+  if (!s.ok)
   {
-    if (gPoster)
-      (void)gPoster->postError(err);
+    (void)uploaderSubmitError(s.error);
     return false;
   }
+  float t = s.temperatureC, h = s.humidityPct;
+
+  Reading &r = out;
+  const time_t now = time(nullptr);
+  r.timestamp = (now >= kMinValidEpoch) ? static_cast<uint32_t>(now) : 0;
+  r.sampledMs = millis();
+  r.channel = channel;
+
+  auto &cfg = AppConfig::get();
+  const float rawT = t, rawH = h;
+  const uint8_t rejected = gFilter[channel].apply(cfg.getFilterSettings(), t, h, r.sampledMs);
+  if (rejected)
+  {
+    Metrics::recordFilterRejected(((rejected & ReadingFilter::kRejectedTemperature) ? 1 : 0) +
+                                  ((rejected & ReadingFilter::kRejectedHumidity) ? 1 : 0));
+    LOGF_INFO("Spike rejected: %.2f °C, %.2f %% (rate limit)", static_cast<double>(rawT), static_cast<double>(rawH));
+  }
+  r.temperatureC = t;
+  r.humidityPct = h;
+  // Before the deadband: the windows see every sample.
+  SensorStats::record(channel, t, h, r.sampledMs);
 
   {
-    String msg = F("Temperature: ");
+    String msg;
+    if (SensorChannels::tagged())
+    {
+      msg = SensorChannels::get(channel).name;
+      msg += F(": ");
+    }
+    msg += F("Temperature: ");
     msg += String(t, 2);
     msg += F(" °C, Humidity: ");
     msg += String(h, 2);
@@ -95,19 +248,50 @@ static bool readAndPost()
     LOG_INFO(msg);
   }
 
-  if (gPoster)
-    return gPoster->postReading(t, h);
-  return false;
+  const uint32_t maxSilenceSec = cfg.getMaxSilenceSeconds();
+  const uint32_t maxSilenceMs = maxSilenceSec >= 4294967UL ? 0xFFFFFFFFUL : maxSilenceSec * 1000UL;
+  const bool report = gDeadband[channel].shouldReport(t, h, r.sampledMs, cfg.getDeadbandTempC(), cfg.getDeadbandHumidityPct(), maxSilenceMs);
+  Metrics::recordReadingReported(report);
+  if (!report)
+  {
+    LOG_DEBUG(F("Reading within deadband; not reported"));
+    return false;
+  }
+  // Numbered only once reported, so a gap in seq means a lost reading.
+  Sequence::stamp(r);
+  return true;
+}
+
+// Wall clock in ms, or 0 while it is not synced.
+static uint64_t wallClockMs(bool timeSynced)
+{
+  struct timeval tv;
+  if (!timeSynced || gettimeofday(&tv, nullptr) != 0)
+    return 0;
+  return static_cast<uint64_t>(tv.tv_sec) * 1000ULL + static_cast<uint64_t>(tv.tv_usec / 1000);
+}
+
+// Samples every channel in mask, one after the other, and hands the
+// readings to the uploader as one cycle (one post when not batching).
+// Readings taken while offline go to the offline queue (uploader side).
+static void sampleCycle(uint32_t mask)
+{
+  Reading cycle[SensorChannels::kMaxChannels];
+  size_t n = 0;
+  for (size_t i = 0; i < SensorChannels::count(); ++i)
+  {
+    if ((mask & (1UL << i)) && sampleChannel(static_cast<uint8_t>(i), cycle[n]))
+      ++n;
+  }
+  if (n)
+    (void)uploaderSubmitReadings(cycle, n);
 }
 
 static void SensorTask(void *pv)
 {
   // Attempt to use UTC minute boundaries when time is available
   bool timeSynced = false;
-  time_t nextPostEpoch = 0; // next UTC epoch second to post
-
   TickType_t lastWakeTick = xTaskGetTickCount();
-  TickType_t nextPostTick = lastWakeTick;
   TickType_t lastSyncAttemptTick = lastWakeTick;
 
   auto readIntervalSeconds = []()
@@ -118,102 +302,47 @@ static void SensorTask(void *pv)
     return value;
   };
 
-  auto computeIntervalMillis = [](uint32_t sec)
-  {
-    if (sec >= 4294967UL)
-      return 0xFFFFFFFFUL; // clamp to avoid overflow
-    return static_cast<unsigned long>(sec * 1000UL);
-  };
-
   uint32_t intervalSec = readIntervalSeconds();
   bool alignToMinute = AppConfig::get().getAlignPostsToMinute();
+  SensorScheduler schedule;
 
-  auto scheduleNextTick = [&](TickType_t nowTicks, bool logReason, const __FlashStringHelper *message)
+  // Channels without their own interval follow post_interval_sec.
+  auto configureSchedule = [&](const __FlashStringHelper *message)
   {
-    uint32_t intervalMs = computeIntervalMillis(intervalSec);
-    TickType_t scheduledTick = nowTicks + pdMS_TO_TICKS(intervalMs ? intervalMs : 1UL);
-
-    if (timeSynced)
+    uint32_t intervals[SensorChannels::kMaxChannels];
+    const size_t count = SensorChannels::count();
+    for (size_t i = 0; i < count; ++i)
     {
-      time_t nowEpoch = time(nullptr);
-      time_t targetEpoch;
-      if (alignToMinute)
-      {
-        targetEpoch = ((nowEpoch / intervalSec) + 1) * static_cast<time_t>(intervalSec);
-      }
-      else
-      {
-        targetEpoch = nowEpoch + static_cast<time_t>(intervalSec);
-      }
-      if (targetEpoch <= nowEpoch)
-      {
-        targetEpoch = nowEpoch + 1;
-      }
-      nextPostEpoch = targetEpoch;
-
-      struct timeval tv;
-      if (gettimeofday(&tv, nullptr) == 0)
-      {
-        uint64_t nowMs = (static_cast<uint64_t>(tv.tv_sec) * 1000ULL) + (tv.tv_usec / 1000ULL);
-        uint64_t targetMs = static_cast<uint64_t>(targetEpoch) * 1000ULL;
-        uint64_t deltaMs = (targetMs > nowMs) ? (targetMs - nowMs) : 0ULL;
-        if (deltaMs == 0ULL)
-        {
-          deltaMs = intervalMs ? intervalMs : 1ULL;
-        }
-        if (deltaMs > 0xFFFFFFFFULL)
-        {
-          deltaMs = 0xFFFFFFFFULL;
-        }
-        scheduledTick = nowTicks + pdMS_TO_TICKS(static_cast<uint32_t>(deltaMs));
-      }
-
-      if (logReason)
-      {
-        String msg = F("Next measurement (epoch): ");
-        msg += static_cast<long>(nextPostEpoch);
-        LOG_DEBUG(msg);
-        if (message)
-        {
-          LOG_DEBUG(message);
-        }
-      }
+      const uint32_t own = SensorChannels::get(static_cast<uint8_t>(i)).intervalSec;
+      intervals[i] = own ? own : intervalSec;
     }
-    else
+    const uint32_t nowMs = millis();
+    const uint64_t wallMs = wallClockMs(timeSynced);
+    schedule.configure(count, intervals, alignToMinute, nowMs, wallMs);
+    if (wallMs)
     {
-      nextPostEpoch = 0;
-      if (logReason && message)
-      {
-        LOG_DEBUG(message);
-      }
+      String msg = F("Next measurement (epoch): ");
+      msg += static_cast<long>((wallMs + (schedule.dueAt(0) - nowMs)) / 1000ULL);
+      LOG_DEBUG(msg);
     }
-
-    return scheduledTick;
+    LOG_DEBUG(message);
   };
 
-  // Initialize sensor
-  dht.begin();
-  if (!gDhtMutex)
-    gDhtMutex = xSemaphoreCreateMutex();
-  LOG_INFO(F("DHT sensor initialized (task)"));
+  // Initialize sensors
+  lockSensor();
+  for (size_t i = 0; i < SensorChannels::count(); ++i)
+    (void)sensor(static_cast<uint8_t>(i));
+  xSemaphoreGive(gSensorMutex);
 
   TaskWatchdog::registerTask(TaskWatchdog::TaskId::Sensor, "SensorPostTask", restartSensorTask, 60000);
 
-  // Take one immediate measurement after boot
-  (void)readAndPost();
-
   // Check if time is available yet (non-blocking)
   struct tm ti;
-  TickType_t initialTick = xTaskGetTickCount();
-  if (getLocalTime(&ti, 1))
-  {
-    timeSynced = true;
-    nextPostTick = scheduleNextTick(initialTick, true, F("Scheduling cadence initialized (time-synced)."));
-  }
-  else
-  {
-    nextPostTick = scheduleNextTick(initialTick, true, F("Scheduling cadence initialized (pre time-sync)."));
-  }
+  timeSynced = getLocalTime(&ti, 1);
+
+  // Take one immediate measurement of every channel after boot
+  sampleCycle((1UL << SensorChannels::count()) - 1);
+  configureSchedule(timeSynced ? F("Scheduling cadence initialized (time-synced).") : F("Scheduling cadence initialized (pre time-sync)."));
 
   for (;;)
   {
@@ -225,8 +354,7 @@ static void SensorTask(void *pv)
     {
       intervalSec = latestInterval;
       alignToMinute = latestAlign;
-      TickType_t nowTicks = xTaskGetTickCount();
-      nextPostTick = scheduleNextTick(nowTicks, true, timeSynced ? F("Scheduling cadence updated (time-synced).") : F("Scheduling cadence updated (pre time-sync)."));
+      configureSchedule(timeSynced ? F("Scheduling cadence updated (time-synced).") : F("Scheduling cadence updated (pre time-sync)."));
     }
 
     bool wifiConnected = (WiFi.status() == WL_CONNECTED);
@@ -240,24 +368,25 @@ static void SensorTask(void *pv)
         if (getLocalTime(&ti, 1))
         {
           timeSynced = true;
-          nextPostTick = scheduleNextTick(now, true, F("Time synchronized; switching to epoch-based schedule."));
+          configureSchedule(F("Time synchronized; switching to epoch-based schedule."));
         }
       }
     }
 
-    TickType_t nowTicks = xTaskGetTickCount();
-    if ((int32_t)(nowTicks - nextPostTick) >= 0)
+    const uint32_t due = schedule.dueMask(millis());
+    if (due)
     {
-      if (wifiConnected)
+      sampleCycle(due);
+      const uint32_t afterRead = millis();
+      const uint64_t wallMs = wallClockMs(timeSynced);
+      for (size_t i = 0; i < schedule.count(); ++i)
       {
-        (void)readAndPost();
+        if (due & (1UL << i))
+          schedule.advance(i, afterRead, wallMs);
       }
-      TickType_t afterRead = xTaskGetTickCount();
-      nextPostTick = scheduleNextTick(afterRead, false, nullptr);
-      continue;
     }
 
-    TickType_t waitTicks = nextPostTick - nowTicks;
+    TickType_t waitTicks = pdMS_TO_TICKS(schedule.msUntilNext(millis()));
     const TickType_t kMaxSleepTicks = pdMS_TO_TICKS(1000UL);
     if (waitTicks > kMaxSleepTicks)
     {
@@ -271,9 +400,14 @@ static void SensorTask(void *pv)
   }
 }
 
-void startSensorTask(Poster *poster)
+void initSensorTask()
+{
+  if (!gSensorMutex)
+    gSensorMutex = xSemaphoreCreateMutex();
+}
+
+void startSensorTask()
 {
-  gPoster = poster;
   xTaskCreate(
       SensorTask,
       "SensorPostTask",
@@ -297,11 +431,35 @@ extern "C"
       vTaskDelete(h);
       vTaskDelay(pdMS_TO_TICKS(10));
     }
-    startSensorTask(gPoster);
+    startSensorTask();
   }
 }
 
-bool sensorTakeReading(float &temperatureC, float &humidityPct, String &errorOut)
+bool sensorReadCached(uint8_t channel, uint32_t maxAgeMs, SensorSample &out)
+{
+  if (channel >= SensorChannels::count())
+    channel = 0;
+  if (cachedSample(channel, maxAgeMs, out))
+  {
+    Metrics::recordReadCache(Metrics::ReadCacheResult::Hit);
+    return out.ok;
+  }
+
+  // Requests arriving while a read is in flight queue on the mutex; the
+  // first one through reads, the rest find its sample in the cache.
+  lockSensor();
+  Metrics::ReadCacheResult result = Metrics::ReadCacheResult::Coalesced;
+  if (!cachedSample(channel, maxAgeMs, out))
+    result = readLocked(channel, out, false) ? Metrics::ReadCacheResult::Miss : Metrics::ReadCacheResult::Hit;
+  xSemaphoreGive(gSensorMutex);
+  Metrics::recordReadCache(result);
+  return out.ok;
+}
+
+const char *sensorDriverName(uint8_t channel)
 {
-  return takeReading(temperatureC, humidityPct, errorOut);
+  lockSensor();
+  const char *name = sensor(channel).name();
+  xSemaphoreGive(gSensorMutex);
+  return name;
 }
@@ -2,11 +2,14 @@
 
 #include <Arduino.h>
 
-class Poster;
+// Creates the lock that serialises sensor reads between the sampler and
+// on-demand readers. Call once at startup, before the HTTP server and the
+// sensor task start.
+void initSensorTask();
 
-// Starts the sensor reading + posting task.
-// Pass a pointer to a global/static Poster instance.
-void startSensorTask(Poster* poster);
+// Starts the sensor sampling task. Readings are handed to the uploader task
+// (see UploaderTask.h), which does all network I/O.
+void startSensorTask();
 
 // Expose handle/control for server
 extern "C" {
@@ -14,6 +17,22 @@ extern "C" {
   void restartSensorTask();
 }
 
-// Take an immediate DHT reading (thread-safe) without posting.
-// Returns true on success and fills temperatureC/humidityPct; false with errorOut.
-bool sensorTakeReading(float &temperatureC, float &humidityPct, String &errorOut);
+struct SensorSample
+{
+  bool ok;
+  float temperatureC;
+  float humidityPct;
+  uint32_t ageMs; // how long ago the sensor was read
+  String error;   // set when !ok
+};
+
+// A reading of one sensor channel (see SensorChannels.h) for on-demand
+// callers such as GET /read; thread-safe, never posted. The last sample
+// (from the sampler or an earlier call) answers when it is at most maxAgeMs
+// old, or younger than the driver's minimum read interval. Otherwise the
+// sensor is read, and callers that arrive meanwhile share that one read.
+// Returns out.ok.
+bool sensorReadCached(uint8_t channel, uint32_t maxAgeMs, SensorSample &out);
+
+// Label of a channel's sensor driver (see SensorDriver.h).
+const char *sensorDriverName(uint8_t channel = 0);
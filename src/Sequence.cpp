@@ -0,0 +1,86 @@
+#include "Sequence.h"
+
+#include <Preferences.h>
+#include <esp_system.h>
+#include <stdio.h>
+
+#include "StructuredLog.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+namespace
+{
+    constexpr const char kPrefsNamespace[] = "seq";
+    constexpr const char kKeyBootId[] = "boot_id";
+
+    uint32_t gBootId = 0;
+    uint32_t gNextSeq = 1;
+
+    // Created by init() before any task can stamp a reading.
+    SemaphoreHandle_t gMutex = nullptr;
+
+    void lock()
+    {
+        xSemaphoreTake(gMutex, portMAX_DELAY);
+    }
+
+    void unlock()
+    {
+        xSemaphoreGive(gMutex);
+    }
+}
+
+void Sequence::init()
+{
+    if (!gMutex)
+        gMutex = xSemaphoreCreateMutex();
+    Preferences prefs;
+    uint32_t id = 0;
+    if (prefs.begin(kPrefsNamespace, false))
+    {
+        id = prefs.getUInt(kKeyBootId, 0) + 1;
+        if (id == 0)
+            id = 1;
+        if (prefs.putUInt(kKeyBootId, id) == 0)
+            id = 0;
+        prefs.end();
+    }
+    if (id == 0)
+    {
+        // Without NVS the ids lose their order, but a random high one still
+        // keeps this boot's keys apart from earlier boots'.
+        id = esp_random() | 0x80000000UL;
+        LOGF_WARN("Boot counter not persisted; using random boot id %lu", static_cast<unsigned long>(id));
+    }
+    lock();
+    gBootId = id;
+    gNextSeq = 1;
+    unlock();
+    LOGF_INFO("Boot id %lu", static_cast<unsigned long>(id));
+}
+
+uint32_t Sequence::bootId()
+{
+    lock();
+    const uint32_t id = gBootId;
+    unlock();
+    return id;
+}
+
+void Sequence::stamp(Reading &reading)
+{
+    lock();
+    reading.bootId = gBootId;
+    reading.seq = gBootId ? gNextSeq++ : 0;
+    unlock();
+}
+
+bool Sequence::formatKey(const Reading &reading, char *out, size_t outSize)
+{
+    if (reading.bootId == 0 || reading.seq == 0)
+        return false;
+    const int n = snprintf(out, outSize, "%lu-%lu", static_cast<unsigned long>(reading.bootId),
+                           static_cast<unsigned long>(reading.seq));
+    return n > 0 && static_cast<size_t>(n) < outSize;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "Reading.h"
+
+// Identity for every reported reading: (bootId, seq).
+//
+// bootId is a counter kept in its own NVS namespace and bumped once per boot
+// (a factory reset of the settings leaves it alone); seq counts readings
+// from 1 within a boot. Ordered as a pair the two only ever increase, so the
+// ingest side can drop a retried or backfilled duplicate with one lookup.
+// 0 in either field means "not assigned".
+namespace Sequence
+{
+    // Reads and advances the persisted boot counter. Call once at startup,
+    // before the first reading is stamped.
+    void init();
+
+    uint32_t bootId();
+    // Gives reading the next sequence number of this boot.
+    void stamp(Reading &reading);
+
+    // Writes "<bootId>-<seq>" (the Idempotency-Key form); false if the
+    // reading has no sequence number or out is too small.
+    bool formatKey(const Reading &reading, char *out, size_t outSize);
+}
@@ -0,0 +1,72 @@
+#include "Sht3xDriver.h"
+
+#include <math.h>
+
+namespace
+{
+  constexpr uint16_t kCmdSoftReset = 0x30A2;
+  constexpr uint16_t kCmdMeasureHighRep = 0x2400;
+  // Datasheet maximum for high repeatability is 15.5 ms.
+  constexpr uint32_t kMeasureMs = 16;
+  constexpr uint32_t kResetMs = 2;
+
+  // CRC-8, polynomial 0x31, init 0xFF, over each 16-bit word.
+  uint8_t crc8(const uint8_t *data, size_t len)
+  {
+    uint8_t crc = 0xFF;
+    for (size_t i = 0; i < len; ++i)
+    {
+      crc ^= data[i];
+      for (int b = 0; b < 8; ++b)
+        crc = (crc & 0x80) ? static_cast<uint8_t>((crc << 1) ^ 0x31) : static_cast<uint8_t>(crc << 1);
+    }
+    return crc;
+  }
+}
+
+Sht3xDriver::Sht3xDriver(TwoWire &wire, uint8_t address) : wire_(wire), address_(address)
+{
+}
+
+bool Sht3xDriver::command(uint16_t cmd)
+{
+  wire_.beginTransmission(address_);
+  wire_.write(static_cast<uint8_t>(cmd >> 8));
+  wire_.write(static_cast<uint8_t>(cmd & 0xFF));
+  return wire_.endTransmission() == 0;
+}
+
+bool Sht3xDriver::begin()
+{
+  if (!command(kCmdSoftReset))
+    return false;
+  delay(kResetMs);
+  return true;
+}
+
+bool Sht3xDriver::read(float &temperatureC, float &humidityPct)
+{
+  temperatureC = NAN;
+  humidityPct = NAN;
+  if (!command(kCmdMeasureHighRep))
+    return false;
+  delay(kMeasureMs);
+
+  uint8_t buf[6];
+  if (wire_.requestFrom(address_, static_cast<uint8_t>(sizeof(buf))) != sizeof(buf))
+    return false;
+  for (uint8_t &b : buf)
+    b = static_cast<uint8_t>(wire_.read());
+
+  if (crc8(buf, 2) == buf[2])
+  {
+    const uint16_t raw = static_cast<uint16_t>((buf[0] << 8) | buf[1]);
+    temperatureC = -45.0f + 175.0f * static_cast<float>(raw) / 65535.0f;
+  }
+  if (crc8(buf + 3, 2) == buf[5])
+  {
+    const uint16_t raw = static_cast<uint16_t>((buf[3] << 8) | buf[4]);
+    humidityPct = 100.0f * static_cast<float>(raw) / 65535.0f;
+  }
+  return !isnan(temperatureC) && !isnan(humidityPct);
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <Wire.h>
+
+#include "SensorDriver.h"
+
+// Sensirion SHT30/31/35 over I2C. Each read is a single-shot, high
+// repeatability measurement without clock stretching: one command, a
+// ~15 ms conversion, then six bytes with a CRC per word.
+class Sht3xDriver : public SensorDriver
+{
+public:
+  static constexpr uint8_t kDefaultAddress = 0x44; // ADDR pin low; 0x45 when high
+
+  explicit Sht3xDriver(TwoWire &wire, uint8_t address = kDefaultAddress);
+
+  const char *name() const override { return "SHT3x"; }
+  bool begin() override;
+  bool read(float &temperatureC, float &humidityPct) override;
+
+private:
+  bool command(uint16_t cmd);
+
+  TwoWire &wire_;
+  uint8_t address_;
+};
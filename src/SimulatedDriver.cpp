@@ -0,0 +1,86 @@
+#include "SimulatedDriver.h"
+
+#include <Arduino.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace
+{
+  constexpr uint32_t kWavePeriod = 360;
+  constexpr uint32_t kNoiseSeed = 0x2545F491;
+  constexpr float kTwoPi = 6.28318531f;
+}
+
+SimulatedDriver::SimulatedDriver(const char *script) : steps_(), stepCount_(0), reads_(0), rng_(kNoiseSeed)
+{
+  const char *p = script ? script : "";
+  while (*p && stepCount_ < kMaxSteps)
+  {
+    const char *end = strchr(p, ';');
+    const size_t len = end ? static_cast<size_t>(end - p) : strlen(p);
+    if (len > 0 && parseStep(p, len, steps_[stepCount_]))
+      ++stepCount_;
+    p += len;
+    if (*p == ';')
+      ++p;
+  }
+}
+
+bool SimulatedDriver::parseStep(const char *text, size_t len, Step &out) const
+{
+  char buf[48];
+  if (len >= sizeof(buf))
+    return false;
+  memcpy(buf, text, len);
+  buf[len] = '\0';
+
+  out.latencyMs = 0;
+  char *at = strchr(buf, '@');
+  if (at)
+  {
+    *at = '\0';
+    out.latencyMs = static_cast<uint16_t>(strtoul(at + 1, nullptr, 10));
+  }
+  if (strcmp(buf, "fail") == 0)
+  {
+    out.temperatureC = NAN;
+    out.humidityPct = NAN;
+    return true;
+  }
+  char *end = nullptr;
+  out.temperatureC = strtof(buf, &end);
+  if (end == buf || *end != ',')
+    return false;
+  const char *h = end + 1;
+  out.humidityPct = strtof(h, &end);
+  return end != h;
+}
+
+// xorshift32, mapped to [-0.05, 0.05).
+float SimulatedDriver::noise()
+{
+  rng_ ^= rng_ << 13;
+  rng_ ^= rng_ >> 17;
+  rng_ ^= rng_ << 5;
+  return (static_cast<float>(rng_ % 1000) / 1000.0f - 0.5f) * 0.1f;
+}
+
+bool SimulatedDriver::read(float &temperatureC, float &humidityPct)
+{
+  const uint32_t n = reads_++;
+  if (stepCount_ == 0)
+  {
+    const float phase = kTwoPi * static_cast<float>(n % kWavePeriod) / static_cast<float>(kWavePeriod);
+    temperatureC = 22.0f + 3.0f * sinf(phase) + noise();
+    humidityPct = 45.0f - 10.0f * sinf(phase) + noise();
+    return true;
+  }
+
+  const Step &step = steps_[n % stepCount_];
+  if (step.latencyMs)
+    delay(step.latencyMs);
+  temperatureC = step.temperatureC;
+  humidityPct = step.humidityPct;
+  return !isnan(temperatureC) && !isnan(humidityPct);
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "SensorDriver.h"
+
+// Deterministic stand-in sensor for benches and host runs. The script is a
+// ';'-separated list of steps, played in a loop, one per read:
+//
+//   "21.5,40"      temperature °C, humidity %
+//   "21.5,40@120"  the same, with the read taking 120 ms
+//   "21.5,nan"     humidity channel fails
+//   "fail@2000"    both channels fail after 2 s (a stuck bus)
+//
+// An empty script yields a slow sine wave (period 360 reads) with a little
+// fixed-seed noise, so runs are reproducible. The only platform call is
+// delay() for scripted latency.
+class SimulatedDriver : public SensorDriver
+{
+public:
+  static constexpr size_t kMaxSteps = 32;
+
+  explicit SimulatedDriver(const char *script);
+
+  const char *name() const override { return "sim"; }
+  bool begin() override { return true; }
+  bool read(float &temperatureC, float &humidityPct) override;
+
+  // Reads served so far (the position in the script or wave).
+  uint32_t reads() const { return reads_; }
+  // Steps parsed from the script; 0 = generated wave.
+  size_t steps() const { return stepCount_; }
+
+private:
+  struct Step
+  {
+    float temperatureC;
+    float humidityPct;
+    uint16_t latencyMs;
+  };
+
+  bool parseStep(const char *text, size_t len, Step &out) const;
+  float noise();
+
+  Step steps_[kMaxSteps];
+  size_t stepCount_;
+  uint32_t reads_;
+  uint32_t rng_;
+};
@@ -8,6 +8,10 @@ namespace TaskWatchdog
     {
         Sensor = 0,
         HttpServer = 1,
+        Uploader = 2,
+        // One per extra output sink (AppConfig::kMaxExtraSinks).
+        UploaderSink1 = 3,
+        UploaderSink2 = 4,
         Count
     };
 
@@ -0,0 +1,526 @@
+#include "TlsClient.h"
+
+#include <WiFi.h>
+#include <esp_attr.h>
+#include <errno.h>
+#include <lwip/sockets.h>
+#include <string.h>
+
+#include <mbedtls/error.h>
+#include <mbedtls/net_sockets.h>
+
+#include "config.h"
+#include "StructuredLog.h"
+
+#ifndef MBEDTLS_PRIVATE
+#define MBEDTLS_PRIVATE(member) member
+#endif
+
+namespace
+{
+  constexpr uint32_t kConnectTimeoutMs = 5000;
+  constexpr uint32_t kDefaultHandshakeTimeoutMs = 10000;
+  constexpr uint32_t kWriteTimeoutMs = 5000;
+  constexpr uint32_t kSelectSliceMs = 100;
+  constexpr uint32_t kSessionMagic = 0x544C5353; // "TLSS"
+  constexpr char kDrbgPersonalization[] = "esp32-poster-tls";
+
+#if defined(TLS_SESSION_RTC_CACHE) && TLS_SESSION_RTC_CACHE
+  // Not cleared on soft reset or deep sleep; validated by magic + checksum.
+  RTC_NOINIT_ATTR TlsClient::CachedSession gRtcSession;
+#endif
+
+  uint32_t sessionChecksum(const TlsClient::CachedSession &s)
+  {
+    // FNV-1a over everything after the checksum field.
+    uint32_t h = 2166136261UL;
+    auto mix = [&h](const uint8_t *p, size_t n)
+    {
+      for (size_t i = 0; i < n; ++i)
+      {
+        h ^= p[i];
+        h *= 16777619UL;
+      }
+    };
+    mix(reinterpret_cast<const uint8_t *>(&s.port), sizeof(s.port));
+    mix(reinterpret_cast<const uint8_t *>(&s.length), sizeof(s.length));
+    mix(reinterpret_cast<const uint8_t *>(s.host), sizeof(s.host));
+    mix(s.data, s.length <= sizeof(s.data) ? s.length : sizeof(s.data));
+    return h;
+  }
+
+  bool sessionValid(const TlsClient::CachedSession &s)
+  {
+    return s.magic == kSessionMagic && s.length > 0 && s.length <= sizeof(s.data) &&
+           s.host[sizeof(s.host) - 1] == '\0' && s.checksum == sessionChecksum(s);
+  }
+
+  int64_t sessionStart(const mbedtls_ssl_session &s)
+  {
+#if defined(MBEDTLS_HAVE_TIME)
+    return static_cast<int64_t>(s.MBEDTLS_PRIVATE(start));
+#else
+    (void)s;
+    return -1;
+#endif
+  }
+
+  bool waitWritable(int fd, uint32_t timeoutMs)
+  {
+    fd_set wfds;
+    FD_ZERO(&wfds);
+    FD_SET(fd, &wfds);
+    struct timeval tv;
+    tv.tv_sec = timeoutMs / 1000;
+    tv.tv_usec = (timeoutMs % 1000) * 1000;
+    if (select(fd + 1, nullptr, &wfds, nullptr, &tv) <= 0)
+      return false;
+    int err = 0;
+    socklen_t len = sizeof(err);
+    return getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) == 0 && err == 0;
+  }
+}
+
+TlsClient::TlsClient()
+    : fd_(-1), drbgReady_(false), sslReady_(false), configReady_(false), insecure_(false), peerClosed_(false),
+      pollMode_(false), rootCA_(nullptr), handshakeTimeoutMs_(kDefaultHandshakeTimeoutMs), peeked_(-1),
+      persistInRtc_(false), offeredSession_(false), offeredStart_(-1), lastResumed_(false), lastHandshakeMs_(0),
+      recordsWritten_(0)
+{
+  mbedtls_entropy_init(&entropy_);
+  mbedtls_ctr_drbg_init(&drbg_);
+  mbedtls_x509_crt_init(&ca_);
+  mbedtls_ssl_config_init(&conf_);
+  mbedtls_ssl_init(&ssl_);
+  memset(&session_, 0, sizeof(session_));
+}
+
+TlsClient::~TlsClient()
+{
+  stop();
+  mbedtls_ssl_config_free(&conf_);
+  mbedtls_x509_crt_free(&ca_);
+  mbedtls_ctr_drbg_free(&drbg_);
+  mbedtls_entropy_free(&entropy_);
+}
+
+void TlsClient::setCACert(const char *rootCA)
+{
+  if (!insecure_ && rootCA_ == rootCA)
+    return;
+  insecure_ = false;
+  rootCA_ = rootCA;
+  resetConfig();
+}
+
+void TlsClient::setInsecure()
+{
+  if (insecure_)
+    return;
+  insecure_ = true;
+  resetConfig();
+}
+
+void TlsClient::resetConfig()
+{
+  // A session negotiated under different verification settings must never
+  // be resumed: resumption skips the certificate check entirely.
+  stop();
+  clearSession();
+  mbedtls_ssl_config_free(&conf_);
+  mbedtls_ssl_config_init(&conf_);
+  mbedtls_x509_crt_free(&ca_);
+  mbedtls_x509_crt_init(&ca_);
+  configReady_ = false;
+}
+
+bool TlsClient::ensureConfig()
+{
+  if (configReady_)
+    return true;
+
+  int ret = 0;
+  if (!drbgReady_)
+  {
+    ret = mbedtls_ctr_drbg_seed(&drbg_, mbedtls_entropy_func, &entropy_,
+                                reinterpret_cast<const unsigned char *>(kDrbgPersonalization),
+                                sizeof(kDrbgPersonalization) - 1);
+    if (ret != 0)
+    {
+      LOGF_WARN("TLS DRBG seed failed: -0x%04x", -ret);
+      return false;
+    }
+    drbgReady_ = true;
+  }
+
+  ret = mbedtls_ssl_config_defaults(&conf_, MBEDTLS_SSL_IS_CLIENT, MBEDTLS_SSL_TRANSPORT_STREAM,
+                                    MBEDTLS_SSL_PRESET_DEFAULT);
+  if (ret != 0)
+  {
+    LOGF_WARN("TLS config defaults failed: -0x%04x", -ret);
+    return false;
+  }
+  mbedtls_ssl_conf_rng(&conf_, mbedtls_ctr_drbg_random, &drbg_);
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+  mbedtls_ssl_conf_session_tickets(&conf_, MBEDTLS_SSL_SESSION_TICKETS_ENABLED);
+#endif
+
+  if (insecure_ || !rootCA_)
+  {
+    mbedtls_ssl_conf_authmode(&conf_, MBEDTLS_SSL_VERIFY_NONE);
+  }
+  else
+  {
+    ret = mbedtls_x509_crt_parse(&ca_, reinterpret_cast<const unsigned char *>(rootCA_), strlen(rootCA_) + 1);
+    if (ret != 0)
+    {
+      LOGF_WARN("TLS root CA parse failed: -0x%04x", -ret);
+      return false;
+    }
+    mbedtls_ssl_conf_ca_chain(&conf_, &ca_, nullptr);
+    mbedtls_ssl_conf_authmode(&conf_, MBEDTLS_SSL_VERIFY_REQUIRED);
+  }
+
+  configReady_ = true;
+  return true;
+}
+
+void TlsClient::clearSession()
+{
+  session_.magic = 0;
+  session_.length = 0;
+#if defined(TLS_SESSION_RTC_CACHE) && TLS_SESSION_RTC_CACHE
+  if (persistInRtc_)
+    gRtcSession.magic = 0;
+#endif
+}
+
+bool TlsClient::offerCachedSession(const char *host, uint16_t port)
+{
+#if defined(TLS_SESSION_RTC_CACHE) && TLS_SESSION_RTC_CACHE
+  if (persistInRtc_ && session_.magic != kSessionMagic && sessionValid(gRtcSession))
+  {
+    memcpy(&session_, &gRtcSession, sizeof(session_));
+    LOG_DEBUG(F("TLS session restored from RTC memory"));
+  }
+#endif
+  if (!host || session_.magic != kSessionMagic || session_.port != port || strcmp(session_.host, host) != 0)
+    return false;
+
+  mbedtls_ssl_session cached;
+  mbedtls_ssl_session_init(&cached);
+  bool offered = false;
+  if (mbedtls_ssl_session_load(&cached, session_.data, session_.length) == 0 &&
+      mbedtls_ssl_set_session(&ssl_, &cached) == 0)
+  {
+    offered = true;
+    offeredStart_ = sessionStart(cached);
+  }
+  mbedtls_ssl_session_free(&cached);
+  if (!offered)
+    clearSession();
+  return offered;
+}
+
+void TlsClient::saveSession(const mbedtls_ssl_session &session, const char *host, uint16_t port)
+{
+  if (!host || strlen(host) >= kMaxHostLen)
+    return;
+  size_t len = 0;
+  int ret = mbedtls_ssl_session_save(&session, session_.data, sizeof(session_.data), &len);
+  if (ret != 0)
+  {
+    LOGF_DEBUG("TLS session not cached: -0x%04x", -ret);
+    clearSession();
+    return;
+  }
+  memset(session_.host, 0, sizeof(session_.host));
+  strncpy(session_.host, host, sizeof(session_.host) - 1);
+  session_.port = port;
+  session_.length = static_cast<uint16_t>(len);
+  session_.magic = kSessionMagic;
+  session_.checksum = sessionChecksum(session_);
+#if defined(TLS_SESSION_RTC_CACHE) && TLS_SESSION_RTC_CACHE
+  if (persistInRtc_)
+    memcpy(&gRtcSession, &session_, sizeof(session_));
+#endif
+}
+
+int TlsClient::connect(IPAddress ip, uint16_t port)
+{
+  return connect(ip, port, nullptr);
+}
+
+int TlsClient::connect(const char *host, uint16_t port)
+{
+  IPAddress ip;
+  if (!WiFi.hostByName(host, ip))
+    return 0;
+  return connect(ip, port, host);
+}
+
+int TlsClient::connect(IPAddress ip, uint16_t port, const char *host)
+{
+  stop();
+  if (!ensureConfig())
+    return 0;
+
+  fd_ = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  if (fd_ < 0)
+    return 0;
+
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = static_cast<uint32_t>(ip);
+
+  int flags = fcntl(fd_, F_GETFL, 0);
+  fcntl(fd_, F_SETFL, flags | O_NONBLOCK);
+  int res = ::connect(fd_, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr));
+  if ((res < 0 && errno != EINPROGRESS) || (res < 0 && !waitWritable(fd_, kConnectTimeoutMs)))
+  {
+    LOGF_DEBUG("TLS TCP connect failed (errno %d)", errno);
+    stop();
+    return 0;
+  }
+  fcntl(fd_, F_SETFL, flags & ~O_NONBLOCK);
+
+  int one = 1;
+  setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  struct timeval tv;
+  tv.tv_sec = kWriteTimeoutMs / 1000;
+  tv.tv_usec = 0;
+  setsockopt(fd_, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+  int ret = mbedtls_ssl_setup(&ssl_, &conf_);
+  if (ret != 0)
+  {
+    LOGF_WARN("TLS setup failed: -0x%04x", -ret);
+    stop();
+    return 0;
+  }
+  sslReady_ = true;
+  if (host)
+    mbedtls_ssl_set_hostname(&ssl_, host);
+  mbedtls_ssl_set_bio(&ssl_, this, bioSend, bioRecv, nullptr);
+
+  offeredSession_ = offerCachedSession(host, port);
+
+  const unsigned long start = millis();
+  while ((ret = mbedtls_ssl_handshake(&ssl_)) != 0)
+  {
+    if (ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE)
+      break;
+    if (millis() - start >= handshakeTimeoutMs_)
+    {
+      ret = MBEDTLS_ERR_SSL_TIMEOUT;
+      break;
+    }
+  }
+  if (ret != 0)
+  {
+    char err[64];
+    mbedtls_strerror(ret, err, sizeof(err));
+    LOGF_WARN("TLS handshake failed: -0x%04x %s", -ret, err);
+    if (offeredSession_)
+      clearSession();
+    stop();
+    return 0;
+  }
+  lastHandshakeMs_ = millis() - start;
+
+  if (!insecure_ && rootCA_)
+  {
+    uint32_t flagsVerify = mbedtls_ssl_get_verify_result(&ssl_);
+    if (flagsVerify != 0)
+    {
+      LOGF_WARN("TLS certificate verification failed: 0x%08x", static_cast<unsigned>(flagsVerify));
+      clearSession();
+      stop();
+      return 0;
+    }
+  }
+
+  // A resumed session keeps the start time of the full handshake that
+  // created it; a full handshake stamps a new one.
+  mbedtls_ssl_session negotiated;
+  mbedtls_ssl_session_init(&negotiated);
+  lastResumed_ = false;
+  if (mbedtls_ssl_get_session(&ssl_, &negotiated) == 0)
+  {
+    lastResumed_ = offeredSession_ && offeredStart_ >= 0 && sessionStart(negotiated) == offeredStart_;
+    saveSession(negotiated, host, port);
+  }
+  mbedtls_ssl_session_free(&negotiated);
+  return 1;
+}
+
+int TlsClient::bioSend(void *ctx, const unsigned char *buf, size_t len)
+{
+  TlsClient *self = static_cast<TlsClient *>(ctx);
+  int ret = send(self->fd_, buf, len, 0);
+  if (ret >= 0)
+    return ret;
+  if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+    return MBEDTLS_ERR_SSL_WANT_WRITE;
+  if (errno == EPIPE || errno == ECONNRESET)
+    return MBEDTLS_ERR_NET_CONN_RESET;
+  return MBEDTLS_ERR_NET_SEND_FAILED;
+}
+
+int TlsClient::bioRecv(void *ctx, unsigned char *buf, size_t len)
+{
+  TlsClient *self = static_cast<TlsClient *>(ctx);
+  fd_set rfds;
+  FD_ZERO(&rfds);
+  FD_SET(self->fd_, &rfds);
+  struct timeval tv;
+  tv.tv_sec = 0;
+  tv.tv_usec = self->pollMode_ ? 0 : kSelectSliceMs * 1000;
+  int ready = select(self->fd_ + 1, &rfds, nullptr, nullptr, &tv);
+  if (ready == 0)
+    return MBEDTLS_ERR_SSL_WANT_READ;
+  if (ready < 0)
+    return MBEDTLS_ERR_NET_RECV_FAILED;
+
+  int ret = recv(self->fd_, buf, len, 0);
+  if (ret >= 0)
+    return ret; // 0 = orderly shutdown, surfaces as MBEDTLS_ERR_SSL_CONN_EOF
+  if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+    return MBEDTLS_ERR_SSL_WANT_READ;
+  if (errno == ECONNRESET)
+    return MBEDTLS_ERR_NET_CONN_RESET;
+  return MBEDTLS_ERR_NET_RECV_FAILED;
+}
+
+int TlsClient::pollRecords()
+{
+  if (!sslReady_)
+    return 0;
+  int avail = static_cast<int>(mbedtls_ssl_get_bytes_avail(&ssl_));
+  if (avail > 0 || peerClosed_)
+    return avail;
+
+  // Zero-length read processes at most one pending record without blocking.
+  pollMode_ = true;
+  int ret = mbedtls_ssl_read(&ssl_, nullptr, 0);
+  pollMode_ = false;
+  if (ret < 0 && ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE)
+    peerClosed_ = true;
+  return static_cast<int>(mbedtls_ssl_get_bytes_avail(&ssl_));
+}
+
+size_t TlsClient::write(uint8_t b)
+{
+  return write(&b, 1);
+}
+
+size_t TlsClient::write(const uint8_t *buf, size_t size)
+{
+  if (!sslReady_ || peerClosed_)
+    return 0;
+  size_t sent = 0;
+  const unsigned long start = millis();
+  while (sent < size)
+  {
+    int ret = mbedtls_ssl_write(&ssl_, buf + sent, size - sent);
+    if (ret > 0)
+    {
+      sent += static_cast<size_t>(ret);
+      ++recordsWritten_;
+      continue;
+    }
+    if ((ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE) && millis() - start < kWriteTimeoutMs)
+      continue;
+    peerClosed_ = true;
+    break;
+  }
+  return sent;
+}
+
+int TlsClient::available()
+{
+  return pollRecords() + (peeked_ >= 0 ? 1 : 0);
+}
+
+int TlsClient::read()
+{
+  uint8_t b;
+  return read(&b, 1) == 1 ? b : -1;
+}
+
+int TlsClient::read(uint8_t *buf, size_t size)
+{
+  if (size == 0)
+    return 0;
+  size_t got = 0;
+  if (peeked_ >= 0)
+  {
+    buf[got++] = static_cast<uint8_t>(peeked_);
+    peeked_ = -1;
+    if (got == size)
+      return 1;
+  }
+  int avail = pollRecords();
+  if (avail <= 0)
+    return got ? static_cast<int>(got) : -1;
+  size_t want = size - got;
+  if (want > static_cast<size_t>(avail))
+    want = static_cast<size_t>(avail);
+  int ret = mbedtls_ssl_read(&ssl_, buf + got, want);
+  if (ret > 0)
+    got += static_cast<size_t>(ret);
+  return got ? static_cast<int>(got) : -1;
+}
+
+int TlsClient::peek()
+{
+  if (peeked_ < 0)
+  {
+    uint8_t b;
+    if (read(&b, 1) == 1)
+      peeked_ = b;
+  }
+  return peeked_;
+}
+
+uint8_t TlsClient::connected()
+{
+  if (fd_ < 0 || !sslReady_)
+    return 0;
+  if (available() > 0)
+    return 1;
+  if (peerClosed_)
+    return 0;
+  uint8_t probe;
+  int ret = recv(fd_, &probe, 1, MSG_PEEK | MSG_DONTWAIT);
+  if (ret == 0)
+  {
+    peerClosed_ = true;
+    return 0;
+  }
+  if (ret < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+    return 0;
+  return 1;
+}
+
+void TlsClient::stop()
+{
+  if (sslReady_)
+  {
+    if (!peerClosed_ && fd_ >= 0)
+      (void)mbedtls_ssl_close_notify(&ssl_);
+    mbedtls_ssl_free(&ssl_);
+    mbedtls_ssl_init(&ssl_);
+    sslReady_ = false;
+  }
+  if (fd_ >= 0)
+  {
+    close(fd_);
+    fd_ = -1;
+  }
+  peeked_ = -1;
+  peerClosed_ = false;
+  pollMode_ = false;
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <Arduino.h>
+#include <Client.h>
+
+#include <mbedtls/ctr_drbg.h>
+#include <mbedtls/entropy.h>
+#include <mbedtls/ssl.h>
+#include <mbedtls/x509_crt.h>
+
+// Minimal mbedTLS client implementing Arduino's Client interface. Unlike
+// WiFiClientSecure it keeps the negotiated TLS session (session ticket or
+// session ID) after each handshake and offers it on the next connect to the
+// same host, so reconnects do an abbreviated handshake instead of a full
+// certificate exchange + key agreement.
+//
+// The cached session lives in RAM; with TLS_SESSION_RTC_CACHE it is also
+// mirrored into RTC memory so it survives deep sleep and soft resets.
+class TlsClient : public Client
+{
+public:
+  TlsClient();
+  ~TlsClient() override;
+
+  void setCACert(const char *rootCA);
+  void setInsecure();
+  void setHandshakeTimeout(uint32_t ms) { handshakeTimeoutMs_ = ms; }
+
+  int connect(IPAddress ip, uint16_t port) override;
+  int connect(const char *host, uint16_t port) override;
+  // Connects to ip and negotiates TLS with host as SNI / verification name.
+  int connect(IPAddress ip, uint16_t port, const char *host);
+
+  size_t write(uint8_t b) override;
+  size_t write(const uint8_t *buf, size_t size) override;
+  int available() override;
+  int read() override;
+  int read(uint8_t *buf, size_t size) override;
+  int peek() override;
+  void flush() override {}
+  void stop() override;
+  uint8_t connected() override;
+  operator bool() override { return connected(); }
+  // Underlying socket (for select()); -1 when not connected.
+  int fd() const { return fd_; }
+
+  // Outcome of the most recent successful handshake.
+  bool lastHandshakeResumed() const { return lastResumed_; }
+  uint32_t lastHandshakeMillis() const { return lastHandshakeMs_; }
+  // Application data records sent since construction (one per
+  // mbedtls_ssl_write that made progress).
+  uint32_t recordsWritten() const { return recordsWritten_; }
+
+  // Forget the cached session (e.g. after the server rejected it).
+  void clearSession();
+  // Mirror this client's session into RTC memory (needs TLS_SESSION_RTC_CACHE).
+  void persistSessionInRtc(bool enable) { persistInRtc_ = enable; }
+
+  static constexpr size_t kMaxSessionBytes = 2048;
+  static constexpr size_t kMaxHostLen = 64;
+
+  struct CachedSession
+  {
+    uint32_t magic;
+    uint32_t checksum;
+    uint16_t port;
+    uint16_t length;
+    char host[kMaxHostLen];
+    uint8_t data[kMaxSessionBytes];
+  };
+
+private:
+  bool ensureConfig();
+  void resetConfig();
+  bool offerCachedSession(const char *host, uint16_t port);
+  void saveSession(const mbedtls_ssl_session &session, const char *host, uint16_t port);
+  int pollRecords();
+
+  static int bioSend(void *ctx, const unsigned char *buf, size_t len);
+  static int bioRecv(void *ctx, unsigned char *buf, size_t len);
+
+  int fd_;
+  bool drbgReady_;
+  bool sslReady_;
+  bool configReady_;
+  bool insecure_;
+  bool peerClosed_;
+  bool pollMode_;
+  const char *rootCA_;
+  uint32_t handshakeTimeoutMs_;
+  int peeked_;
+  bool persistInRtc_;
+
+  bool offeredSession_;
+  int64_t offeredStart_;
+  bool lastResumed_;
+  uint32_t lastHandshakeMs_;
+  uint32_t recordsWritten_;
+
+  mbedtls_entropy_context entropy_;
+  mbedtls_ctr_drbg_context drbg_;
+  mbedtls_x509_crt ca_;
+  mbedtls_ssl_config conf_;
+  mbedtls_ssl_context ssl_;
+
+  CachedSession session_;
+};
@@ -0,0 +1,268 @@
+#include "UdpSink.h"
+
+#include <ctype.h>
+#include <math.h>
+#include <string.h>
+#include <time.h>
+
+#include "AppConfig.h"
+#include "DnsCache.h"
+#include "Metrics.h"
+#include "SensorChannels.h"
+#include "StructuredLog.h"
+
+namespace
+{
+  constexpr uint32_t kCounterIntervalMs = 60000;
+  // Longest metric line, newline included.
+  constexpr size_t kMaxLine = 160;
+  // Epoch values below this mean SNTP has not set the clock yet.
+  constexpr time_t kMinValidEpoch = 1600000000;
+
+  struct Counter
+  {
+    const char *name;
+    uint32_t MetricsSnapshot::*field;
+  };
+
+  // Device counters forwarded as running totals.
+  const Counter kCounters[] = {
+      {"sensor.reads", &MetricsSnapshot::sensorReadTotal},
+      {"sensor.read_failures", &MetricsSnapshot::sensorReadFailed},
+      {"post.readings", &MetricsSnapshot::postReadingTotal},
+      {"post.reading_failures", &MetricsSnapshot::postReadingFailed},
+      {"post.errors", &MetricsSnapshot::postErrorTotal},
+      {"post.batches", &MetricsSnapshot::postBatchTotal},
+      {"post.batch_failures", &MetricsSnapshot::postBatchFailed},
+      {"post.readings_rejected", &MetricsSnapshot::postReadingsRejected},
+      {"upload_queue.enqueued", &MetricsSnapshot::uploadQueueEnqueued},
+      {"upload_queue.dropped", &MetricsSnapshot::uploadQueueDropped},
+      {"upload_queue.depth_max", &MetricsSnapshot::uploadQueueDepthMax},
+      {"circuit.trips", &MetricsSnapshot::breakerTrips},
+      {"circuit.short_circuits", &MetricsSnapshot::breakerShortCircuits},
+      {"upstream.connections_opened", &MetricsSnapshot::upstreamConnectionsOpened},
+      {"upstream.connections_reused", &MetricsSnapshot::upstreamConnectionsReused},
+      {"tls.handshakes_full", &MetricsSnapshot::tlsHandshakesFull},
+      {"tls.handshakes_resumed", &MetricsSnapshot::tlsHandshakesResumed},
+      {"tls.handshakes_failed", &MetricsSnapshot::tlsHandshakesFailed},
+      {"wifi.reconnects", &MetricsSnapshot::wifiReconnectEvents},
+      {"uptime_ms", &MetricsSnapshot::uptimeMillis},
+      {"heap.free_bytes", &MetricsSnapshot::heapFreeBytes},
+      {"heap.min_free_bytes", &MetricsSnapshot::heapMinBytes},
+  };
+
+  // Metric paths allow letters, digits, '_', '-' and '.' as separator.
+  void sanitize(String &s)
+  {
+    for (size_t i = 0; i < s.length(); ++i)
+    {
+      const char c = s[i];
+      if (!isalnum(static_cast<unsigned char>(c)) && c != '_' && c != '-' && c != '.')
+        s.setCharAt(i, '_');
+    }
+  }
+
+  uint32_t wallClockNow()
+  {
+    const time_t now = time(nullptr);
+    return now >= kMinValidEpoch ? static_cast<uint32_t>(now) : 0;
+  }
+}
+
+UdpSink::UdpSink(uint8_t sinkIndex)
+    : sinkIndex_(sinkIndex), settingsGeneration_(0), settingsValid_(false), datagramLen_(0), countersDueMs_(0)
+{
+  strncpy(name_, "udp", sizeof(name_) - 1);
+  name_[sizeof(name_) - 1] = '\0';
+  AppConfig::SinkConfig sink;
+  if (sinkIndex_ > 0 && AppConfig::get().getExtraSink(sinkIndex_ - 1, sink))
+  {
+    strncpy(name_, sink.name.c_str(), sizeof(name_) - 1);
+    name_[sizeof(name_) - 1] = '\0';
+  }
+}
+
+void UdpSink::refreshSettings()
+{
+  auto &cfg = AppConfig::get();
+  const uint32_t gen = cfg.getGeneration();
+  if (settingsValid_ && gen == settingsGeneration_)
+    return;
+
+  AppConfig::SinkConfig sink;
+  const bool found = cfg.getExtraSink(sinkIndex_ - 1, sink);
+  settings_.dialect = sink.type.equalsIgnoreCase("graphite") ? Dialect::Graphite : Dialect::Statsd;
+  settings_.enabled = found && sink.enabled && (sink.type.equalsIgnoreCase("statsd") || sink.type.equalsIgnoreCase("graphite"));
+  settings_.host = sink.host;
+  settings_.port = sink.port;
+
+  String location = cfg.getDeviceLocation();
+  String name(name_);
+  sanitize(location);
+  sanitize(name);
+  settings_.prefix = sink.prefix;
+  settings_.prefix.replace("{location}", location);
+  settings_.prefix.replace("{name}", name);
+  sanitize(settings_.prefix);
+  while (settings_.prefix.endsWith("."))
+    settings_.prefix.remove(settings_.prefix.length() - 1);
+
+  settingsGeneration_ = gen;
+  settingsValid_ = true;
+}
+
+bool UdpSink::add(const char *metric, const char *value, uint32_t epoch)
+{
+  char line[kMaxLine];
+  int n;
+  if (settings_.dialect == Dialect::Graphite)
+  {
+    // Carbon stamps lines sent with -1 on arrival.
+    if (epoch)
+      n = snprintf(line, sizeof(line), "%s.%s %s %lu\n", settings_.prefix.c_str(), metric, value, static_cast<unsigned long>(epoch));
+    else
+      n = snprintf(line, sizeof(line), "%s.%s %s -1\n", settings_.prefix.c_str(), metric, value);
+  }
+  else
+  {
+    n = snprintf(line, sizeof(line), "%s.%s:%s\n", settings_.prefix.c_str(), metric, value);
+  }
+  if (n <= 0 || static_cast<size_t>(n) >= sizeof(line))
+    return false;
+
+  bool ok = true;
+  if (datagramLen_ + static_cast<size_t>(n) > sizeof(datagram_))
+    ok = send();
+  memcpy(datagram_ + datagramLen_, line, static_cast<size_t>(n));
+  datagramLen_ += static_cast<size_t>(n);
+  return ok;
+}
+
+bool UdpSink::send()
+{
+  if (datagramLen_ == 0)
+    return true;
+  // StatsD takes newline-separated metrics; drop the trailing one.
+  size_t len = datagramLen_;
+  if (settings_.dialect == Dialect::Statsd && datagram_[len - 1] == '\n')
+    --len;
+  datagramLen_ = 0;
+
+  IPAddress ip;
+  if (WiFi.status() != WL_CONNECTED || !DnsCache::resolve(settings_.host, ip))
+    return false;
+  if (!udp_.beginPacket(ip, settings_.port))
+    return false;
+  udp_.write(reinterpret_cast<const uint8_t *>(datagram_), len);
+  return udp_.endPacket() == 1;
+}
+
+bool UdpSink::addReading(const Reading &reading)
+{
+  const bool graphite = settings_.dialect == Dialect::Graphite;
+  const uint32_t epoch = reading.timestamp ? reading.timestamp : wallClockNow();
+  // With several sensor channels the metric path names the channel.
+  String channel;
+  if (SensorChannels::tagged())
+  {
+    channel = SensorChannels::get(reading.channel).name;
+    sanitize(channel);
+    channel += '.';
+  }
+  char metric[48];
+  char value[24];
+  bool ok = true;
+  if (!isnan(reading.temperatureC))
+  {
+    snprintf(metric, sizeof(metric), "%stemperature_c", channel.c_str());
+    snprintf(value, sizeof(value), graphite ? "%.2f" : "%.2f|g", static_cast<double>(reading.temperatureC));
+    ok = add(metric, value, epoch) && ok;
+  }
+  if (!isnan(reading.humidityPct))
+  {
+    snprintf(metric, sizeof(metric), "%shumidity_pct", channel.c_str());
+    snprintf(value, sizeof(value), graphite ? "%.2f" : "%.2f|g", static_cast<double>(reading.humidityPct));
+    ok = add(metric, value, epoch) && ok;
+  }
+  return ok;
+}
+
+bool UdpSink::postReading(const Reading &reading)
+{
+  return postReadings(&reading, 1);
+}
+
+bool UdpSink::postReadings(const Reading *readings, size_t count)
+{
+  refreshSettings();
+  if (!settings_.enabled)
+  {
+    Metrics::recordSinkDropped(sinkIndex_, count);
+    return false;
+  }
+
+  // A reading's lines always share a datagram, so a failed send loses
+  // exactly the readings in it.
+  size_t lost = 0;
+  size_t pending = 0;
+  for (size_t i = 0; i < count; ++i)
+  {
+    if (datagramLen_ > sizeof(datagram_) - 2 * kMaxLine)
+    {
+      if (!send())
+        lost += pending;
+      pending = 0;
+    }
+    if (addReading(readings[i]))
+      ++pending;
+    else
+      ++lost;
+  }
+  if (!send())
+    lost += pending;
+  if (lost)
+    Metrics::recordSinkDropped(sinkIndex_, lost);
+  return lost == 0;
+}
+
+bool UdpSink::postError(const String &message)
+{
+  (void)message;
+  refreshSettings();
+  if (!settings_.enabled)
+    return false;
+  const bool graphite = settings_.dialect == Dialect::Graphite;
+  // Graphite has no counter type; the event is a 1 at that time.
+  const bool ok = add("errors", graphite ? "1" : "1|c", wallClockNow());
+  return send() && ok;
+}
+
+void UdpSink::sendCounters()
+{
+  const MetricsSnapshot snap = Metrics::snapshot();
+  const bool graphite = settings_.dialect == Dialect::Graphite;
+  const uint32_t epoch = wallClockNow();
+  char value[24];
+  bool ok = true;
+  for (const Counter &c : kCounters)
+  {
+    snprintf(value, sizeof(value), graphite ? "%lu" : "%lu|g", static_cast<unsigned long>(snap.*(c.field)));
+    ok = add(c.name, value, epoch) && ok;
+  }
+  ok = send() && ok;
+  if (!ok)
+    LOGF_DEBUG("UDP sink '%s': counter datagram not sent", name_);
+}
+
+void UdpSink::service()
+{
+  refreshSettings();
+  if (!settings_.enabled || WiFi.status() != WL_CONNECTED)
+    return;
+  DnsCache::refresh(settings_.host);
+  const uint32_t now = millis();
+  if (static_cast<int32_t>(now - countersDueMs_) < 0)
+    return;
+  countersDueMs_ = now + kCounterIntervalMs;
+  sendCounters();
+}
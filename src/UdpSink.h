@@ -0,0 +1,76 @@
+#pragma once
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <WiFiUdp.h>
+
+#include "OutputSink.h"
+#include "Reading.h"
+
+// Fire-and-forget metrics over UDP (extra sinks with "type": "statsd" or
+// "graphite"). A reading is one datagram carrying both values:
+//
+//   statsd:    <prefix>.temperature_c:21.50|g
+//   graphite:  <prefix>.temperature_c 21.50 1700000000
+//
+// With several sensor channels the path gains the channel name
+// (<prefix>.<channel>.temperature_c) and a sample cycle shares a datagram.
+//
+// Once a minute the device counters from MetricsSnapshot follow as gauges
+// of their running totals, packed into as few datagrams as the MTU allows.
+// No connection, no acknowledgement: a datagram that is lost stays lost,
+// which is the trade this sink exists for.
+class UdpSink : public OutputSink
+{
+public:
+  enum class Dialect : uint8_t
+  {
+    Statsd,
+    Graphite
+  };
+
+  explicit UdpSink(uint8_t sinkIndex);
+
+  const char *name() const override { return name_; }
+
+  bool postReading(const Reading &reading) override;
+  bool postReadings(const Reading *readings, size_t count) override;
+  // Sent as a counter increment ("<prefix>.errors"); the text is not carried.
+  bool postError(const String &message) override;
+  // Emits the counter datagrams when they are due.
+  void service() override;
+
+  // Largest datagram sent: fits a 1500-byte Ethernet/Wi-Fi MTU after the
+  // IPv4 and UDP headers (1472) with room to spare for tunnels.
+  static constexpr size_t kMaxDatagram = 1400;
+
+private:
+  struct Settings
+  {
+    String host;
+    String prefix; // placeholders expanded, unsafe characters replaced
+    uint16_t port = 8125;
+    Dialect dialect = Dialect::Statsd;
+    bool enabled = false;
+  };
+
+  void refreshSettings();
+  // Appends one metric line; sends the pending datagram first if the line
+  // would not fit. false if a send failed.
+  bool add(const char *metric, const char *value, uint32_t epoch);
+  bool addReading(const Reading &reading);
+  bool send();
+  void sendCounters();
+
+  uint8_t sinkIndex_;
+  char name_[16];
+
+  WiFiUDP udp_;
+  Settings settings_;
+  uint32_t settingsGeneration_;
+  bool settingsValid_;
+
+  char datagram_[kMaxDatagram];
+  size_t datagramLen_;
+  uint32_t countersDueMs_;
+};
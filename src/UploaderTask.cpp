@@ -0,0 +1,405 @@
+#include "UploaderTask.h"
+
+#include <WiFi.h>
+#include <string.h>
+
+#include "Poster.h"
+#include "config.h"
+#include "AppConfig.h"
+#include "Metrics.h"
+#include "MqttSink.h"
+#include "OfflineQueue.h"
+#include "OutputSink.h"
+#include "SensorChannels.h"
+#include "StructuredLog.h"
+#include "TaskWatchdog.h"
+#include "UdpSink.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+
+#ifndef UPLOAD_QUEUE_LENGTH
+#define UPLOAD_QUEUE_LENGTH 16
+#endif
+
+namespace
+{
+  // Longest one submit waits for queue space under the Block policy, for
+  // all sinks together; a sink still full after that drops the new item so
+  // the sensor task keeps its watchdog.
+  constexpr uint32_t kBlockTimeoutMs = 10000;
+  // OutputSink::service() runs at least this often while the queue is idle.
+  constexpr uint32_t kIdleWaitMs = 1000;
+  // Error messages share the item with the readings, so they may use all
+  // of that space; longer ones end in "...".
+  constexpr size_t kMaxMessageBytes = sizeof(Reading) * SensorChannels::kMaxChannels;
+  constexpr size_t kMaxSinks = 1 + AppConfig::kMaxExtraSinks;
+  static_assert(kMaxSinks <= kMetricsMaxSinks, "Metrics must have a slot per sink");
+  static_assert(static_cast<size_t>(TaskWatchdog::TaskId::Count) - static_cast<size_t>(TaskWatchdog::TaskId::Uploader) >= kMaxSinks,
+                "TaskWatchdog needs an id per sink worker");
+
+  enum class ItemKind : uint8_t
+  {
+    Reading = 0,
+    Error = 1
+  };
+
+  // A reading item carries one sample cycle: up to one reading per sensor
+  // channel, delivered to the sink together.
+  struct UploadItem
+  {
+    ItemKind kind;
+    uint8_t count;
+    uint32_t enqueuedMs;
+    union
+    {
+      Reading readings[SensorChannels::kMaxChannels];
+      char message[kMaxMessageBytes];
+    };
+  };
+
+  // One queue + task per output sink.
+  struct SinkWorker
+  {
+    OutputSink *sink;
+    QueueHandle_t queue;
+    TaskHandle_t task;
+    char taskName[16];
+  };
+
+  SinkWorker gWorkers[kMaxSinks];
+  size_t gWorkerCount = 0;
+
+  TaskWatchdog::TaskId watchdogId(size_t index)
+  {
+    return static_cast<TaskWatchdog::TaskId>(static_cast<uint8_t>(TaskWatchdog::TaskId::Uploader) + index);
+  }
+
+  template <size_t I>
+  void restartWorkerThunk()
+  {
+    restartUploaderSink(I);
+  }
+
+  const TaskWatchdog::RestartFn kRestartFns[kMaxSinks] = {restartWorkerThunk<0>, restartWorkerThunk<1>, restartWorkerThunk<2>};
+
+  void recordDropped(size_t index, uint32_t items)
+  {
+    Metrics::recordSinkDropped(index, items);
+    if (index == 0)
+      Metrics::recordUploadQueueDropped(items);
+  }
+
+  // Moves every queued reading into the offline queue, a bufferful per
+  // call; its drain then delivers them as multi-reading posts.
+  void coalesceIntoOfflineQueue(QueueHandle_t queue)
+  {
+    Reading spill[UPLOAD_QUEUE_LENGTH];
+    size_t buffered = 0;
+    size_t count = 0;
+    uint32_t dropped = 0;
+    UploadItem item;
+    for (size_t i = 0; i < UPLOAD_QUEUE_LENGTH && xQueueReceive(queue, &item, 0) == pdTRUE; ++i)
+    {
+      if (item.kind != ItemKind::Reading)
+      {
+        ++dropped;
+        continue;
+      }
+      if (buffered + item.count > UPLOAD_QUEUE_LENGTH)
+      {
+        OfflineQueue::pushMany(spill, buffered);
+        buffered = 0;
+      }
+      memcpy(&spill[buffered], item.readings, item.count * sizeof(Reading));
+      buffered += item.count;
+      count += item.count;
+    }
+    if (buffered)
+      OfflineQueue::pushMany(spill, buffered);
+    Metrics::recordUploadQueueCoalesced(count);
+    if (dropped)
+      recordDropped(0, dropped);
+    LOGF_DEBUG("Upload queue full; coalesced %u readings into the offline queue", static_cast<unsigned>(count));
+  }
+
+  // blockUntilMs: end of this submit's Block budget (millis()).
+  bool submitTo(size_t index, const UploadItem &item, uint32_t blockUntilMs)
+  {
+    QueueHandle_t queue = gWorkers[index].queue;
+    if (xQueueSend(queue, &item, 0) != pdTRUE)
+    {
+      UploadQueuePolicy policy = AppConfig::get().getUploadQueuePolicy();
+      // Only the primary sink has an offline queue to coalesce into.
+      if (policy == UploadQueuePolicy::Coalesce && index != 0)
+        policy = UploadQueuePolicy::DropOldest;
+
+      switch (policy)
+      {
+      case UploadQueuePolicy::Block:
+      {
+        const uint32_t startMs = millis();
+        const int32_t budgetMs = static_cast<int32_t>(blockUntilMs - startMs);
+        const bool queued = xQueueSend(queue, &item, budgetMs > 0 ? pdMS_TO_TICKS(budgetMs) : 0) == pdTRUE;
+        Metrics::recordUploadQueueBlocked(millis() - startMs);
+        if (!queued)
+        {
+          recordDropped(index, 1);
+          LOGF_WARN("Upload queue (%s) still full after blocking; dropped newest item", gWorkers[index].sink->name());
+          return false;
+        }
+        break;
+      }
+      case UploadQueuePolicy::Coalesce:
+        coalesceIntoOfflineQueue(queue);
+        if (xQueueSend(queue, &item, 0) != pdTRUE)
+        {
+          recordDropped(index, 1);
+          return false;
+        }
+        break;
+      case UploadQueuePolicy::DropOldest:
+      default:
+      {
+        UploadItem evicted;
+        if (xQueueReceive(queue, &evicted, 0) == pdTRUE)
+        {
+          recordDropped(index, 1);
+          LOGF_WARN("Upload queue (%s) full; dropped oldest item", gWorkers[index].sink->name());
+        }
+        if (xQueueSend(queue, &item, 0) != pdTRUE)
+        {
+          recordDropped(index, 1);
+          return false;
+        }
+        break;
+      }
+      }
+    }
+    if (index == 0)
+      Metrics::recordUploadQueued(uxQueueMessagesWaiting(queue));
+    return true;
+  }
+
+  bool submit(UploadItem &item)
+  {
+    item.enqueuedMs = millis();
+    const uint32_t blockUntilMs = item.enqueuedMs + kBlockTimeoutMs;
+    bool ok = gWorkerCount > 0;
+    for (size_t i = 0; i < gWorkerCount; ++i)
+    {
+      if (!submitTo(i, item, blockUntilMs))
+        ok = false;
+    }
+    return ok;
+  }
+
+  void UploaderTask(void *pv)
+  {
+    const size_t index = reinterpret_cast<size_t>(pv);
+    SinkWorker &w = gWorkers[index];
+    TaskWatchdog::registerTask(watchdogId(index), w.taskName, kRestartFns[index], 60000);
+    LOGF_INFO("Uploader task started for sink '%s'", w.sink->name());
+
+    for (;;)
+    {
+      TaskWatchdog::heartbeat(watchdogId(index));
+
+      UploadItem item;
+      if (xQueueReceive(w.queue, &item, pdMS_TO_TICKS(kIdleWaitMs)) == pdTRUE)
+      {
+        if (index == 0)
+          Metrics::recordUploadQueueWait(millis() - item.enqueuedMs);
+        const uint32_t start = millis();
+        bool ok = false;
+        if (item.kind == ItemKind::Reading)
+        {
+          ok = w.sink->postReadings(item.readings, item.count);
+        }
+        else if (WiFi.status() == WL_CONNECTED)
+        {
+          ok = w.sink->postError(String(item.message));
+        }
+        Metrics::recordSinkPost(index, ok, millis() - start);
+      }
+
+      w.sink->service();
+    }
+  }
+
+  void startWorker(size_t index)
+  {
+    SinkWorker &w = gWorkers[index];
+    xTaskCreate(
+        UploaderTask,
+        w.taskName,
+        8192,
+        reinterpret_cast<void *>(index),
+        1,
+        &w.task);
+  }
+
+  bool addWorker(OutputSink *sink, const char *taskName)
+  {
+    if (gWorkerCount >= kMaxSinks)
+      return false;
+    SinkWorker &w = gWorkers[gWorkerCount];
+    w.queue = xQueueCreate(UPLOAD_QUEUE_LENGTH, sizeof(UploadItem));
+    if (!w.queue)
+    {
+      LOGF_ERROR("Failed to allocate upload queue for sink '%s'", sink->name());
+      return false;
+    }
+    w.sink = sink;
+    w.task = nullptr;
+    strncpy(w.taskName, taskName, sizeof(w.taskName) - 1);
+    w.taskName[sizeof(w.taskName) - 1] = '\0';
+    ++gWorkerCount;
+    return true;
+  }
+}
+
+const char *uploadQueuePolicyName(UploadQueuePolicy policy)
+{
+  switch (policy)
+  {
+  case UploadQueuePolicy::Block:
+    return "block";
+  case UploadQueuePolicy::Coalesce:
+    return "coalesce";
+  case UploadQueuePolicy::DropOldest:
+  default:
+    return "drop_oldest";
+  }
+}
+
+bool uploadQueuePolicyFromString(const String &text, UploadQueuePolicy &out)
+{
+  if (text.equalsIgnoreCase("drop_oldest") || text.equalsIgnoreCase("drop-oldest"))
+    out = UploadQueuePolicy::DropOldest;
+  else if (text.equalsIgnoreCase("block"))
+    out = UploadQueuePolicy::Block;
+  else if (text.equalsIgnoreCase("coalesce"))
+    out = UploadQueuePolicy::Coalesce;
+  else
+    return false;
+  return true;
+}
+
+void startUploaderTask(Poster *poster)
+{
+  if (gWorkerCount > 0)
+    return;
+  if (!addWorker(poster, "UploaderTask"))
+    return;
+
+  auto &cfg = AppConfig::get();
+  const size_t extra = cfg.getExtraSinkCount();
+  for (size_t i = 0; i < extra; ++i)
+  {
+    AppConfig::SinkConfig sc;
+    if (!cfg.getExtraSink(i, sc))
+      break;
+    // Lives for the rest of the run, like the primary Poster.
+    OutputSink *sink = nullptr;
+    if (sc.type.equalsIgnoreCase("http"))
+      sink = new Poster(static_cast<uint8_t>(i + 1));
+    else if (sc.type.equalsIgnoreCase("mqtt"))
+      sink = new MqttSink(static_cast<uint8_t>(i + 1));
+    else if (sc.type.equalsIgnoreCase("statsd") || sc.type.equalsIgnoreCase("graphite"))
+      sink = new UdpSink(static_cast<uint8_t>(i + 1));
+    if (!sink)
+    {
+      LOGF_WARN("Sink '%s': unsupported type '%s'; skipped", sc.name.c_str(), sc.type.c_str());
+      continue;
+    }
+    String taskName = String("Up-") + sc.name;
+    if (!addWorker(sink, taskName.c_str()))
+      delete sink;
+  }
+
+  for (size_t i = 0; i < gWorkerCount; ++i)
+    startWorker(i);
+  LOGF_INFO("Uploading to %u sink(s)", static_cast<unsigned>(gWorkerCount));
+}
+
+bool uploaderSubmitReading(const Reading &reading)
+{
+  return uploaderSubmitReadings(&reading, 1);
+}
+
+bool uploaderSubmitReadings(const Reading *readings, size_t count)
+{
+  UploadItem item;
+  item.kind = ItemKind::Reading;
+  item.count = static_cast<uint8_t>(count < SensorChannels::kMaxChannels ? count : SensorChannels::kMaxChannels);
+  memcpy(item.readings, readings, item.count * sizeof(Reading));
+  return submit(item);
+}
+
+bool uploaderSubmitError(const String &message)
+{
+  UploadItem item;
+  item.kind = ItemKind::Error;
+  item.count = 0;
+  strncpy(item.message, message.c_str(), sizeof(item.message) - 1);
+  item.message[sizeof(item.message) - 1] = '\0';
+  if (message.length() >= sizeof(item.message))
+    memcpy(item.message + sizeof(item.message) - 4, "...", 3);
+  return submit(item);
+}
+
+uint32_t uploaderQueueDepth()
+{
+  return uploaderSinkQueueDepth(0);
+}
+
+size_t uploaderSinkCount()
+{
+  return gWorkerCount;
+}
+
+const char *uploaderSinkName(size_t index)
+{
+  return index < gWorkerCount ? gWorkers[index].sink->name() : "";
+}
+
+const char *uploaderSinkTaskName(size_t index)
+{
+  return index < gWorkerCount ? gWorkers[index].taskName : "";
+}
+
+uint32_t uploaderSinkQueueDepth(size_t index)
+{
+  return index < gWorkerCount ? uxQueueMessagesWaiting(gWorkers[index].queue) : 0;
+}
+
+TaskHandle_t uploaderSinkTaskHandle(size_t index)
+{
+  return index < gWorkerCount ? gWorkers[index].task : nullptr;
+}
+
+void restartUploaderSink(size_t index)
+{
+  if (index >= gWorkerCount)
+    return;
+  SinkWorker &w = gWorkers[index];
+  TaskHandle_t h = w.task;
+  w.task = nullptr;
+  TaskWatchdog::unregisterTask(watchdogId(index));
+  if (h)
+  {
+    vTaskDelete(h);
+    vTaskDelay(pdMS_TO_TICKS(10));
+  }
+  // Queued items survive the restart; the queue is created once.
+  startWorker(index);
+}
+
+// Helpers for task control/status
+extern "C"
+{
+  TaskHandle_t uploaderTaskHandle() { return uploaderSinkTaskHandle(0); }
+  void restartUploaderTask() { restartUploaderSink(0); }
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "Reading.h"
+
+class Poster;
+
+// What the sampler does when a sink's upload queue is full.
+enum class UploadQueuePolicy : uint8_t
+{
+  DropOldest = 0, // evict the oldest queued item to make room
+  Block = 1,      // wait (bounded) for the uploader to catch up
+  Coalesce = 2    // hand the queued readings to the offline queue as one batch
+};
+
+const char *uploadQueuePolicyName(UploadQueuePolicy policy);
+bool uploadQueuePolicyFromString(const String &text, UploadQueuePolicy &out);
+
+// Starts one worker task per output sink: the primary Poster passed in,
+// plus one per entry in AppConfig's extra sink list. Every worker has its
+// own bounded queue, so a slow sink only backs up its own queue. Pass a
+// pointer to a global/static Poster instance.
+void startUploaderTask(Poster *poster);
+
+// Queue a reading / error message for every sink. Never blocks longer than
+// the Block policy allows (10 s per call, however many sinks are full);
+// returns false if any sink discarded the item. An error message too long
+// for a queue item (111 characters) is cut and ends in "...".
+bool uploaderSubmitReading(const Reading &reading);
+// One sample cycle (a reading per sensor channel, at most
+// SensorChannels::kMaxChannels); sinks deliver it together.
+bool uploaderSubmitReadings(const Reading *readings, size_t count);
+bool uploaderSubmitError(const String &message);
+
+// Items currently waiting in the primary sink's queue.
+uint32_t uploaderQueueDepth();
+
+// Per-sink access for status, metrics and task control (0 = primary).
+size_t uploaderSinkCount();
+const char *uploaderSinkName(size_t index);
+const char *uploaderSinkTaskName(size_t index);
+uint32_t uploaderSinkQueueDepth(size_t index);
+TaskHandle_t uploaderSinkTaskHandle(size_t index);
+void restartUploaderSink(size_t index);
+
+// Expose handle/control for server (primary sink worker)
+extern "C" {
+  TaskHandle_t uploaderTaskHandle();
+  void restartUploaderTask();
+}
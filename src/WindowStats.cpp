@@ -0,0 +1,205 @@
+#include "WindowStats.h"
+
+#include <initializer_list>
+#include <math.h>
+
+WindowStats::WindowStats() : windowSec_(0), bucketMs_(0), openStartMs_(0), openSeq_(0), closed_(0)
+{
+  clear();
+}
+
+void WindowStats::configure(uint32_t windowSec, uint32_t nowMs)
+{
+  // At least one second per bucket; at most about 24 days so the window
+  // fits the millis() timeline with room to compare.
+  const uint32_t maxSec = 0x7FFFFFFFUL / 1000UL;
+  if (windowSec < kBuckets)
+    windowSec = kBuckets;
+  if (windowSec > maxSec)
+    windowSec = maxSec;
+  windowSec_ = windowSec;
+  bucketMs_ = (windowSec * 1000UL) / kBuckets;
+  clear();
+  openStartMs_ = nowMs;
+}
+
+void WindowStats::clear()
+{
+  for (Track *t : {&temperature_, &humidity_})
+  {
+    for (size_t i = 0; i < kBuckets; ++i)
+      clearBucket(t->buckets[i]);
+    clearBucket(t->open);
+    t->totals = Totals{0, 0.0, 0.0};
+    t->minQ.head = t->minQ.size = 0;
+    t->maxQ.head = t->maxQ.size = 0;
+  }
+  openSeq_ = 0;
+  closed_ = 0;
+}
+
+void WindowStats::clearBucket(Bucket &b)
+{
+  b.count = 0;
+  b.mean = 0.0f;
+  b.m2 = 0.0f;
+  b.min = NAN;
+  b.max = NAN;
+}
+
+void WindowStats::addSample(Bucket &b, float value)
+{
+  if (b.count == 0xFFFF)
+    return;
+  ++b.count;
+  const float delta = value - b.mean;
+  b.mean += delta / b.count;
+  b.m2 += delta * (value - b.mean);
+  if (b.count == 1 || value < b.min)
+    b.min = value;
+  if (b.count == 1 || value > b.max)
+    b.max = value;
+}
+
+void WindowStats::merge(Totals &t, const Bucket &b)
+{
+  if (b.count == 0)
+    return;
+  const uint32_t n = t.count + b.count;
+  const double delta = static_cast<double>(b.mean) - t.mean;
+  t.mean += delta * b.count / n;
+  t.m2 += b.m2 + delta * delta * (static_cast<double>(t.count) * b.count / n);
+  t.count = n;
+}
+
+void WindowStats::remove(Totals &t, const Bucket &b)
+{
+  if (b.count == 0)
+    return;
+  if (t.count <= b.count)
+  {
+    t = Totals{0, 0.0, 0.0};
+    return;
+  }
+  const uint32_t n = t.count - b.count;
+  const double mean = (t.mean * t.count - static_cast<double>(b.mean) * b.count) / n;
+  const double delta = static_cast<double>(b.mean) - mean;
+  t.m2 -= b.m2 + delta * delta * (static_cast<double>(n) * b.count / t.count);
+  if (t.m2 < 0.0)
+    t.m2 = 0.0;
+  t.mean = mean;
+  t.count = n;
+}
+
+// Back-to-front: drop buckets that can no longer be the minimum.
+void WindowStats::pushMin(Deque &q, const Bucket *buckets, uint32_t seq)
+{
+  const float v = buckets[seq % kBuckets].min;
+  while (q.size && buckets[q.seq[(q.head + q.size - 1) % kBuckets] % kBuckets].min >= v)
+    --q.size;
+  q.seq[(q.head + q.size) % kBuckets] = seq;
+  ++q.size;
+}
+
+void WindowStats::pushMax(Deque &q, const Bucket *buckets, uint32_t seq)
+{
+  const float v = buckets[seq % kBuckets].max;
+  while (q.size && buckets[q.seq[(q.head + q.size - 1) % kBuckets] % kBuckets].max <= v)
+    --q.size;
+  q.seq[(q.head + q.size) % kBuckets] = seq;
+  ++q.size;
+}
+
+void WindowStats::expire(Deque &q, uint32_t seq)
+{
+  if (q.size && q.seq[q.head] == seq)
+  {
+    q.head = (q.head + 1) % kBuckets;
+    --q.size;
+  }
+}
+
+// The window holds the open bucket plus kBuckets - 1 closed ones.
+void WindowStats::closeBucket(Track &t)
+{
+  if (closed_ == kBuckets - 1)
+  {
+    const uint32_t oldest = openSeq_ - (kBuckets - 1);
+    const Bucket &old = t.buckets[oldest % kBuckets];
+    remove(t.totals, old);
+    expire(t.minQ, oldest);
+    expire(t.maxQ, oldest);
+  }
+  Bucket &slot = t.buckets[openSeq_ % kBuckets];
+  slot = t.open;
+  clearBucket(t.open);
+  merge(t.totals, slot);
+  if (slot.count)
+  {
+    pushMin(t.minQ, t.buckets, openSeq_);
+    pushMax(t.maxQ, t.buckets, openSeq_);
+  }
+}
+
+void WindowStats::advance(uint32_t nowMs)
+{
+  if (bucketMs_ == 0)
+    return;
+  if (nowMs - openStartMs_ >= bucketMs_ * kBuckets)
+  {
+    // Idle for a whole window: nothing in it is current any more.
+    clear();
+    openStartMs_ = nowMs;
+    return;
+  }
+  while (nowMs - openStartMs_ >= bucketMs_)
+  {
+    closeBucket(temperature_);
+    closeBucket(humidity_);
+    if (closed_ < kBuckets - 1)
+      ++closed_;
+    ++openSeq_;
+    openStartMs_ += bucketMs_;
+  }
+}
+
+void WindowStats::add(float temperatureC, float humidityPct, uint32_t nowMs)
+{
+  advance(nowMs);
+  if (!isnan(temperatureC) && !isinf(temperatureC))
+    addSample(temperature_.open, temperatureC);
+  if (!isnan(humidityPct) && !isinf(humidityPct))
+    addSample(humidity_.open, humidityPct);
+}
+
+WindowStats::Quantity WindowStats::summarize(const Track &t)
+{
+  Quantity q{0, NAN, NAN, NAN, NAN};
+  Totals all = t.totals;
+  merge(all, t.open);
+  if (all.count == 0)
+    return q;
+  q.count = all.count;
+  q.mean = static_cast<float>(all.mean);
+  q.stddev = static_cast<float>(sqrt(all.m2 / all.count));
+  q.min = t.minQ.size ? t.buckets[t.minQ.seq[t.minQ.head] % kBuckets].min : NAN;
+  q.max = t.maxQ.size ? t.buckets[t.maxQ.seq[t.maxQ.head] % kBuckets].max : NAN;
+  if (t.open.count)
+  {
+    if (isnan(q.min) || t.open.min < q.min)
+      q.min = t.open.min;
+    if (isnan(q.max) || t.open.max > q.max)
+      q.max = t.open.max;
+  }
+  return q;
+}
+
+WindowStats::Summary WindowStats::summary(uint32_t nowMs)
+{
+  advance(nowMs);
+  Summary s;
+  s.windowSec = windowSec_;
+  s.temperature = summarize(temperature_);
+  s.humidity = summarize(humidity_);
+  return s;
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Min/max/mean/standard deviation of temperature and humidity over a
+// sliding time window, constant time per sample and per query.
+//
+// The window is split into kBuckets buckets of window/kBuckets each, so it
+// slides in bucket steps (a 5 min window by 10 s, 24 h by 48 min). Samples
+// go into the open bucket with Welford's update. When a bucket closes it is
+// merged into the window totals (Chan's parallel formula) and appended to
+// a monotonic deque per quantity for min and max; a bucket leaving the
+// window is subtracted from the totals the same way and popped from the
+// deques if it is at their front. A query combines the totals with the
+// open bucket.
+//
+// Fixed-size storage, no heap, no platform calls; time comes from the
+// caller (millis(), wrap-safe). NaN values are skipped per quantity.
+class WindowStats
+{
+public:
+  static constexpr size_t kBuckets = 30;
+
+  struct Quantity
+  {
+    uint32_t count;
+    float min;
+    float max;
+    float mean;
+    float stddev; // population standard deviation
+  };
+
+  struct Summary
+  {
+    uint32_t windowSec;
+    Quantity temperature;
+    Quantity humidity;
+  };
+
+  WindowStats();
+
+  // Sets the window length and clears all samples.
+  void configure(uint32_t windowSec, uint32_t nowMs);
+
+  void add(float temperatureC, float humidityPct, uint32_t nowMs);
+  // Statistics of the samples inside the window ending at nowMs; values
+  // are NaN for a quantity without samples.
+  Summary summary(uint32_t nowMs);
+
+  uint32_t windowSec() const { return windowSec_; }
+
+private:
+  // Count/mean/M2 plus extremes of one quantity. Bucket values are small
+  // enough for float; the window totals keep doubles so subtracting
+  // buckets does not accumulate rounding error.
+  struct Bucket
+  {
+    uint16_t count;
+    float mean;
+    float m2;
+    float min;
+    float max;
+  };
+
+  struct Totals
+  {
+    uint32_t count;
+    double mean;
+    double m2;
+  };
+
+  // Monotonic deque of bucket sequence numbers over the closed buckets.
+  struct Deque
+  {
+    uint32_t seq[kBuckets];
+    uint8_t head;
+    uint8_t size;
+  };
+
+  struct Track
+  {
+    Bucket buckets[kBuckets];
+    Bucket open;
+    Totals totals;
+    Deque minQ;
+    Deque maxQ;
+  };
+
+  static void clearBucket(Bucket &b);
+  static void addSample(Bucket &b, float value);
+  static void merge(Totals &t, const Bucket &b);
+  static void remove(Totals &t, const Bucket &b);
+  static void pushMin(Deque &q, const Bucket *buckets, uint32_t seq);
+  static void pushMax(Deque &q, const Bucket *buckets, uint32_t seq);
+  static void expire(Deque &q, uint32_t seq);
+  static Quantity summarize(const Track &t);
+
+  void advance(uint32_t nowMs);
+  void closeBucket(Track &t);
+  void clear();
+
+  uint32_t windowSec_;
+  uint32_t bucketMs_;
+  uint32_t openStartMs_; // millis() when the open bucket started
+  uint32_t openSeq_;     // sequence number of the open bucket
+  uint32_t closed_;      // closed buckets currently in the window
+  Track temperature_;
+  Track humidity_;
+};
@@ -8,9 +8,15 @@
 #include "SensorTask.h"
 #include "HttpServerTask.h"
 #include "AppConfig.h"
+#include "DnsCache.h"
+#include "OfflineQueue.h"
+#include "SensorChannels.h"
+#include "SensorStats.h"
+#include "Sequence.h"
 #include "WifiManager.h"
 #include "StructuredLog.h"
 #include "TaskWatchdog.h"
+#include "UploaderTask.h"
 
 // WiFi credentials come from AppConfig defaults, but can be updated at runtime
 
@@ -111,6 +117,12 @@ void setup()
   maybeFactoryResetOnBoot();
 
   TaskWatchdog::init();
+  OfflineQueue::init();
+  DnsCache::init();
+  Sequence::init();
+  SensorChannels::init();
+  SensorStats::init();
+  initSensorTask();
 
   wifiManagerInit();
 
@@ -137,7 +149,8 @@ void setup()
 
   // Start tasks
   startHttpServerTask();
-  startSensorTask(&gPoster);
+  startUploaderTask(&gPoster);
+  startSensorTask();
 }
 
 void loop()
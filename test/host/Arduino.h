@@ -0,0 +1,191 @@
+#pragma once
+
+// Host stand-in for the parts of the Arduino core that the platform-free
+// modules use, so they build in the [env:native] tests. Header-only: the
+// native env compiles a selected list of src/ files (build_src_filter) and
+// everything here is inline.
+//
+// Time is simulated: millis() reads HostClock, delay() advances it, so a
+// test (or the simulated sensor's latency) moves time explicitly and runs
+// without sleeping.
+
+#include <ctype.h>
+#include <math.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include <string>
+
+#include "pgmspace.h"
+
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper *>(s))
+
+namespace HostClock
+{
+    inline uint32_t gNowMs = 0;
+
+    inline void set(uint32_t ms) { gNowMs = ms; }
+    inline void advance(uint32_t ms) { gNowMs += ms; }
+}
+
+inline unsigned long millis() { return HostClock::gNowMs; }
+inline unsigned long micros() { return HostClock::gNowMs * 1000UL; }
+inline void delay(uint32_t ms) { HostClock::advance(ms); }
+inline void yield() {}
+
+// std::string underneath; same names and semantics as WString for the
+// calls the host-built modules make.
+class String
+{
+public:
+  String() {}
+  String(const char *s) : s_(s ? s : "") {}
+  String(const __FlashStringHelper *s) : s_(reinterpret_cast<const char *>(s)) {}
+  explicit String(char c) : s_(1, c) {}
+  explicit String(int v) : s_(std::to_string(v)) {}
+  explicit String(unsigned int v) : s_(std::to_string(v)) {}
+  explicit String(long v) : s_(std::to_string(v)) {}
+  explicit String(unsigned long v) : s_(std::to_string(v)) {}
+  explicit String(float v, unsigned int decimals = 2) { format(v, decimals); }
+  explicit String(double v, unsigned int decimals = 2) { format(v, decimals); }
+
+  String &operator=(const char *s)
+  {
+    s_ = s ? s : "";
+    return *this;
+  }
+  String &operator+=(const String &o)
+  {
+    s_ += o.s_;
+    return *this;
+  }
+  String &operator+=(const char *s)
+  {
+    s_ += s;
+    return *this;
+  }
+  String &operator+=(const __FlashStringHelper *s)
+  {
+    s_ += reinterpret_cast<const char *>(s);
+    return *this;
+  }
+  String &operator+=(char c)
+  {
+    s_ += c;
+    return *this;
+  }
+  friend String operator+(const String &a, const String &b)
+  {
+    String r(a);
+    r += b;
+    return r;
+  }
+  bool operator==(const String &o) const { return s_ == o.s_; }
+  bool operator==(const char *o) const { return s_ == o; }
+  bool operator!=(const String &o) const { return s_ != o.s_; }
+
+  const char *c_str() const { return s_.c_str(); }
+  unsigned int length() const { return static_cast<unsigned int>(s_.size()); }
+  bool isEmpty() const { return s_.empty(); }
+  bool reserve(unsigned int n)
+  {
+    s_.reserve(n);
+    return true;
+  }
+  char operator[](unsigned int i) const { return s_[i]; }
+  bool equalsIgnoreCase(const String &o) const { return strcasecmp(s_.c_str(), o.s_.c_str()) == 0; }
+  bool startsWith(const char *p) const { return s_.compare(0, strlen(p), p) == 0; }
+  int indexOf(char c, unsigned int from = 0) const
+  {
+    const size_t p = s_.find(c, from);
+    return p == std::string::npos ? -1 : static_cast<int>(p);
+  }
+  String substring(unsigned int from, unsigned int to = 0xFFFFFFFFu) const
+  {
+    if (from > s_.size())
+      return String();
+    return String(s_.substr(from, to == 0xFFFFFFFFu ? std::string::npos : to - from).c_str());
+  }
+  void trim()
+  {
+    size_t a = 0, b = s_.size();
+    while (a < b && isspace(static_cast<unsigned char>(s_[a])))
+      ++a;
+    while (b > a && isspace(static_cast<unsigned char>(s_[b - 1])))
+      --b;
+    s_ = s_.substr(a, b - a);
+  }
+  void toLowerCase()
+  {
+    for (char &c : s_)
+      c = static_cast<char>(tolower(static_cast<unsigned char>(c)));
+  }
+  long toInt() const { return atol(s_.c_str()); }
+  float toFloat() const { return static_cast<float>(atof(s_.c_str())); }
+
+private:
+  void format(double v, unsigned int decimals)
+  {
+    char buf[48];
+    snprintf(buf, sizeof(buf), "%.*f", static_cast<int>(decimals), v);
+    s_ = buf;
+  }
+
+  std::string s_;
+};
+
+class Print
+{
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t b) = 0;
+  virtual size_t write(const uint8_t *buffer, size_t size)
+  {
+    size_t n = 0;
+    while (size--)
+    {
+      if (write(*buffer++) != 1)
+        break;
+      ++n;
+    }
+    return n;
+  }
+  size_t write(const char *s) { return write(reinterpret_cast<const uint8_t *>(s), strlen(s)); }
+  virtual void flush() {}
+
+  size_t print(const char *s) { return write(s); }
+  size_t print(const String &s) { return write(reinterpret_cast<const uint8_t *>(s.c_str()), s.length()); }
+  size_t print(const __FlashStringHelper *s) { return write(reinterpret_cast<const char *>(s)); }
+  size_t println(const char *s) { return print(s) + write("\r\n"); }
+  size_t println(const String &s) { return print(s) + write("\r\n"); }
+  size_t println(const __FlashStringHelper *s) { return print(s) + write("\r\n"); }
+  size_t printf(const char *fmt, ...) __attribute__((format(printf, 2, 3)))
+  {
+    char buf[256];
+    va_list args;
+    va_start(args, fmt);
+    const int n = vsnprintf(buf, sizeof(buf), fmt, args);
+    va_end(args);
+    if (n <= 0)
+      return 0;
+    return write(reinterpret_cast<const uint8_t *>(buf), static_cast<size_t>(n) < sizeof(buf) ? n : sizeof(buf) - 1);
+  }
+};
+
+// Serial goes to stdout, so log lines show up in the test output.
+class HostSerial : public Print
+{
+public:
+  void begin(unsigned long) {}
+  size_t write(uint8_t b) override { return fwrite(&b, 1, 1, stdout); }
+  size_t write(const uint8_t *buffer, size_t size) override { return fwrite(buffer, 1, size, stdout); }
+  using Print::write;
+};
+
+inline HostSerial Serial;
@@ -0,0 +1,21 @@
+#pragma once
+
+// The Arduino Client interface, as far as the host-built modules use it: a
+// byte stream that can be connected, polled and stopped. Tests implement
+// it over a host socket. connect(IPAddress, port) is left out; nothing
+// built on the host calls it.
+#include <Arduino.h>
+
+class Client : public Print
+{
+public:
+  virtual int connect(const char *host, uint16_t port) = 0;
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int read(uint8_t *buf, size_t size) = 0;
+  virtual int peek() = 0;
+  virtual void stop() = 0;
+  virtual uint8_t connected() = 0;
+  virtual operator bool() = 0;
+  using Print::write;
+};
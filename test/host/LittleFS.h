@@ -0,0 +1,15 @@
+#pragma once
+
+// On the host the modules that use LittleFS work in a plain directory
+// (SegmentLog only uses stdio/dirent), so mounting always succeeds.
+class HostLittleFS
+{
+public:
+  bool begin(bool formatOnFail = false)
+  {
+    (void)formatOnFail;
+    return true;
+  }
+};
+
+inline HostLittleFS LittleFS;
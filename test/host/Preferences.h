@@ -0,0 +1,43 @@
+#pragma once
+
+// In-memory NVS: values live for the life of the process, so a test can
+// "reboot" a module by calling its init() again and see what it persisted.
+#include <stdint.h>
+
+#include <map>
+#include <string>
+
+class Preferences
+{
+public:
+  bool begin(const char *name, bool readOnly = false)
+  {
+    ns_ = name;
+    readOnly_ = readOnly;
+    return true;
+  }
+  void end() { ns_.clear(); }
+
+  uint32_t getUInt(const char *key, uint32_t defaultValue = 0)
+  {
+    const auto it = store().find(ns_ + "/" + key);
+    return it == store().end() ? defaultValue : it->second;
+  }
+  size_t putUInt(const char *key, uint32_t value)
+  {
+    if (readOnly_ || ns_.empty())
+      return 0;
+    store()[ns_ + "/" + key] = value;
+    return sizeof(value);
+  }
+
+  static std::map<std::string, uint32_t> &store()
+  {
+    static std::map<std::string, uint32_t> values;
+    return values;
+  }
+
+private:
+  std::string ns_;
+  bool readOnly_ = false;
+};
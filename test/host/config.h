@@ -0,0 +1,4 @@
+#pragma once
+
+// Host builds take every setting's built-in default (the #ifndef blocks in
+// the modules); a test that needs another value sets it in build_flags.
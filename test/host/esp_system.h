@@ -0,0 +1,13 @@
+#pragma once
+
+#include <stdint.h>
+
+// Deterministic, so host runs repeat exactly (xorshift32).
+inline uint32_t esp_random()
+{
+    static uint32_t state = 0x2545F491u;
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
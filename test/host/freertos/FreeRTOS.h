@@ -0,0 +1,26 @@
+#pragma once
+
+// Host stand-in for the FreeRTOS types and macros the host-built modules
+// use. Ticks are milliseconds.
+
+#include <stdint.h>
+
+#include <mutex>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS pdTRUE
+#define portMAX_DELAY 0xFFFFFFFFu
+#define pdMS_TO_TICKS(ms) (static_cast<TickType_t>(ms))
+
+// Critical sections become a plain mutex per portMUX.
+struct portMUX_TYPE
+{
+    std::mutex m;
+};
+#define portMUX_INITIALIZER_UNLOCKED {}
+#define portENTER_CRITICAL(mux) (mux)->m.lock()
+#define portEXIT_CRITICAL(mux) (mux)->m.unlock()
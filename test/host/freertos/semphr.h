@@ -0,0 +1,30 @@
+#pragma once
+
+#include <chrono>
+#include <mutex>
+
+#include "FreeRTOS.h"
+
+struct HostSemaphore
+{
+    std::timed_mutex m;
+};
+typedef HostSemaphore *SemaphoreHandle_t;
+
+inline SemaphoreHandle_t xSemaphoreCreateMutex() { return new HostSemaphore; }
+
+inline BaseType_t xSemaphoreTake(SemaphoreHandle_t s, TickType_t ticks)
+{
+    if (ticks == portMAX_DELAY)
+    {
+        s->m.lock();
+        return pdTRUE;
+    }
+    return s->m.try_lock_for(std::chrono::milliseconds(ticks)) ? pdTRUE : pdFALSE;
+}
+
+inline BaseType_t xSemaphoreGive(SemaphoreHandle_t s)
+{
+    s->m.unlock();
+    return pdTRUE;
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+// Flash and RAM share one address space on the host.
+#include <string.h>
+
+#define PROGMEM
+#define PSTR(s) (s)
+#define strncpy_P strncpy
+#define strlen_P strlen
+#define memcpy_P memcpy
@@ -0,0 +1,631 @@
+// CBOR and MessagePack output decoded and compared field by field with the
+// JSON writer's output for the same payload, plus the size and encode time
+// of each format.
+//
+// The payloads follow Poster's reading bodies (single reading with boot_id
+// and seq, a batch with timestamp/age_ms entries, a NaN reading and a stats
+// block). Every decoder must consume the buffer exactly, which also checks
+// the container sizes the binary writers were given.
+
+#include <Arduino.h>
+#include <unity.h>
+
+#include <chrono>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "BinaryWriters.h"
+#include "JsonWriter.h"
+
+namespace
+{
+  struct Value
+  {
+    enum class Type
+    {
+      Null,
+      Bool,
+      Int,
+      Float,
+      Text,
+      Array,
+      Map
+    };
+    Type type = Type::Null;
+    bool b = false;
+    int64_t i = 0;
+    double f = 0;
+    std::string s;
+    std::vector<Value> items;
+    std::vector<std::pair<std::string, Value>> fields;
+  };
+
+  class Sink : public Print
+  {
+  public:
+    size_t write(uint8_t b) override
+    {
+      data.push_back(b);
+      return 1;
+    }
+    size_t write(const uint8_t *p, size_t n) override
+    {
+      data.insert(data.end(), p, p + n);
+      return n;
+    }
+    std::vector<uint8_t> data;
+  };
+
+  // ------------------------------------------------------------- decoders
+
+  class Reader
+  {
+  public:
+    explicit Reader(const std::vector<uint8_t> &data) : data_(data) {}
+    bool done() const { return pos_ == data_.size(); }
+    bool failed() const { return failed_; }
+
+  protected:
+    uint8_t next()
+    {
+      if (pos_ >= data_.size())
+      {
+        failed_ = true;
+        return 0;
+      }
+      return data_[pos_++];
+    }
+    uint64_t be(size_t bytes)
+    {
+      uint64_t v = 0;
+      while (bytes--)
+        v = (v << 8) | next();
+      return v;
+    }
+    std::string text(size_t n)
+    {
+      std::string out;
+      while (n-- && !failed_)
+        out += static_cast<char>(next());
+      return out;
+    }
+    static double float32(uint32_t bits)
+    {
+      float v;
+      memcpy(&v, &bits, sizeof(v));
+      return v;
+    }
+    char peekChar() const { return pos_ < data_.size() ? static_cast<char>(data_[pos_]) : '\0'; }
+
+    const std::vector<uint8_t> &data_;
+    size_t pos_ = 0;
+    bool failed_ = false;
+  };
+
+  class CborReader : public Reader
+  {
+  public:
+    using Reader::Reader;
+
+    Value read()
+    {
+      Value v;
+      const uint8_t ib = next();
+      const uint8_t major = ib >> 5;
+      const uint8_t info = ib & 0x1F;
+      if (major == 7)
+      {
+        if (info == 20 || info == 21)
+        {
+          v.type = Value::Type::Bool;
+          v.b = info == 21;
+        }
+        else if (info == 26)
+        {
+          v.type = Value::Type::Float;
+          v.f = float32(static_cast<uint32_t>(be(4)));
+        }
+        else if (info != 22)
+        {
+          failed_ = true;
+        }
+        return v;
+      }
+      uint64_t arg = info;
+      if (info == 24)
+        arg = be(1);
+      else if (info == 25)
+        arg = be(2);
+      else if (info == 26)
+        arg = be(4);
+      else if (info > 26)
+        failed_ = true;
+      switch (major)
+      {
+      case 0:
+        v.type = Value::Type::Int;
+        v.i = static_cast<int64_t>(arg);
+        break;
+      case 1:
+        v.type = Value::Type::Int;
+        v.i = -1 - static_cast<int64_t>(arg);
+        break;
+      case 3:
+        v.type = Value::Type::Text;
+        v.s = text(arg);
+        break;
+      case 4:
+        v.type = Value::Type::Array;
+        for (uint64_t n = 0; n < arg && !failed_; ++n)
+          v.items.push_back(read());
+        break;
+      case 5:
+        v.type = Value::Type::Map;
+        for (uint64_t n = 0; n < arg && !failed_; ++n)
+        {
+          const Value k = read();
+          if (k.type != Value::Type::Text)
+            failed_ = true;
+          v.fields.emplace_back(k.s, read());
+        }
+        break;
+      default:
+        failed_ = true;
+      }
+      return v;
+    }
+  };
+
+  class MsgPackReader : public Reader
+  {
+  public:
+    using Reader::Reader;
+
+    Value read()
+    {
+      Value v;
+      const uint8_t b = next();
+      if (b < 0x80 || b >= 0xE0)
+      {
+        v.type = Value::Type::Int;
+        v.i = static_cast<int8_t>(b);
+        if (b < 0x80)
+          v.i = b;
+        return v;
+      }
+      if ((b & 0xF0) == 0x80)
+        return map(b & 0x0F);
+      if ((b & 0xF0) == 0x90)
+        return array(b & 0x0F);
+      if ((b & 0xE0) == 0xA0)
+        return str(b & 0x1F);
+      switch (b)
+      {
+      case 0xC0:
+        return v;
+      case 0xC2:
+      case 0xC3:
+        v.type = Value::Type::Bool;
+        v.b = b == 0xC3;
+        return v;
+      case 0xCA:
+        v.type = Value::Type::Float;
+        v.f = float32(static_cast<uint32_t>(be(4)));
+        return v;
+      case 0xCC:
+      case 0xCD:
+      case 0xCE:
+        v.type = Value::Type::Int;
+        v.i = static_cast<int64_t>(be(size_t(1) << (b - 0xCC)));
+        return v;
+      case 0xD0:
+        v.type = Value::Type::Int;
+        v.i = static_cast<int8_t>(be(1));
+        return v;
+      case 0xD1:
+        v.type = Value::Type::Int;
+        v.i = static_cast<int16_t>(be(2));
+        return v;
+      case 0xD2:
+        v.type = Value::Type::Int;
+        v.i = static_cast<int32_t>(be(4));
+        return v;
+      case 0xD9:
+        return str(be(1));
+      case 0xDA:
+        return str(be(2));
+      case 0xDB:
+        return str(be(4));
+      case 0xDC:
+        return array(be(2));
+      case 0xDD:
+        return array(be(4));
+      case 0xDE:
+        return map(be(2));
+      case 0xDF:
+        return map(be(4));
+      default:
+        failed_ = true;
+        return v;
+      }
+    }
+
+  private:
+    Value str(uint64_t n)
+    {
+      Value v;
+      v.type = Value::Type::Text;
+      v.s = text(n);
+      return v;
+    }
+    Value array(uint64_t n)
+    {
+      Value v;
+      v.type = Value::Type::Array;
+      for (uint64_t k = 0; k < n && !failed_; ++k)
+        v.items.push_back(read());
+      return v;
+    }
+    Value map(uint64_t n)
+    {
+      Value v;
+      v.type = Value::Type::Map;
+      for (uint64_t k = 0; k < n && !failed_; ++k)
+      {
+        const Value key = read();
+        if (key.type != Value::Type::Text)
+          failed_ = true;
+        v.fields.emplace_back(key.s, read());
+      }
+      return v;
+    }
+  };
+
+  // Enough JSON for what JsonWriter produces (no whitespace).
+  class JsonReader : public Reader
+  {
+  public:
+    using Reader::Reader;
+
+    Value read()
+    {
+      Value v;
+      const char c = peekChar();
+      if (c == '{')
+      {
+        next();
+        v.type = Value::Type::Map;
+        while (!failed_ && peekChar() != '}')
+        {
+          if (!v.fields.empty() && next() != ',')
+            failed_ = true;
+          const Value k = read();
+          if (k.type != Value::Type::Text || next() != ':')
+            failed_ = true;
+          v.fields.emplace_back(k.s, read());
+        }
+        next();
+      }
+      else if (c == '[')
+      {
+        next();
+        v.type = Value::Type::Array;
+        while (!failed_ && peekChar() != ']')
+        {
+          if (!v.items.empty() && next() != ',')
+            failed_ = true;
+          v.items.push_back(read());
+        }
+        next();
+      }
+      else if (c == '"')
+      {
+        next();
+        v.type = Value::Type::Text;
+        for (char ch = static_cast<char>(next()); ch != '"' && !failed_; ch = static_cast<char>(next()))
+        {
+          if (ch != '\\')
+          {
+            v.s += ch;
+            continue;
+          }
+          const char e = static_cast<char>(next());
+          if (e == 'n')
+            v.s += '\n';
+          else if (e == 't')
+            v.s += '\t';
+          else if (e == 'r')
+            v.s += '\r';
+          else if (e == 'u')
+            v.s += static_cast<char>(strtol(text(4).c_str(), nullptr, 16));
+          else
+            v.s += e;
+        }
+      }
+      else if (c == 'n')
+      {
+        failed_ |= text(4) != "null";
+      }
+      else if (c == 't' || c == 'f')
+      {
+        v.type = Value::Type::Bool;
+        v.b = c == 't';
+        failed_ |= text(v.b ? 4 : 5) != (v.b ? "true" : "false");
+      }
+      else
+      {
+        std::string num;
+        while (strchr("-0123456789.", peekChar()) && peekChar())
+          num += static_cast<char>(next());
+        if (num.empty())
+          failed_ = true;
+        v.type = num.find('.') == std::string::npos ? Value::Type::Int : Value::Type::Float;
+        v.i = strtoll(num.c_str(), nullptr, 10);
+        v.f = strtod(num.c_str(), nullptr);
+      }
+      return v;
+    }
+  };
+
+  // ------------------------------------------------------------- payloads
+
+  struct Entry
+  {
+    uint32_t bootId;
+    uint32_t seq;
+    uint32_t timestamp;
+    uint32_t ageMs;
+    float temperatureC;
+    float humidityPct;
+  };
+
+  const Entry kEntries[] = {
+      {0x5A17C0DEu, 1, 1767225600u, 0, 21.53f, 40.12f},
+      {0x5A17C0DEu, 2, 1767225660u, 0, -12.5f, 99.99f},
+      {0x5A17C0DEu, 127, 0, 59000, 0.0f, 0.5f},
+      {0x5A17C0DEu, 128, 0, 65536, -0.25f, NAN},
+      {0x5A17C0DEu, 70000, 1767225900u, 0, 104.99f, 7.0f},
+  };
+
+  void renderEntry(PayloadWriter &w, const Entry &e)
+  {
+    w.beginObject(5);
+    w.field("boot_id", e.bootId);
+    w.field("seq", e.seq);
+    if (e.timestamp)
+      w.field("timestamp", e.timestamp);
+    else
+      w.field("age_ms", e.ageMs);
+    w.field("temperature_c", e.temperatureC, 2);
+    w.field("humidity_pct", e.humidityPct, 2);
+    w.endObject();
+  }
+
+  void renderSingle(PayloadWriter &w)
+  {
+    const Entry &e = kEntries[0];
+    w.beginObject(5);
+    w.field("location", "kitchen \"north\"");
+    w.field("boot_id", e.bootId);
+    w.field("seq", e.seq);
+    w.field("temperature_c", e.temperatureC, 2);
+    w.field("humidity_pct", e.humidityPct, 2);
+    w.endObject();
+  }
+
+  void renderBatch(PayloadWriter &w, size_t repeat)
+  {
+    const size_t n = sizeof(kEntries) / sizeof(kEntries[0]);
+    w.beginObject(3);
+    w.field("location", "kitchen");
+    w.key("readings");
+    w.beginArray(n * repeat);
+    for (size_t r = 0; r < repeat; ++r)
+    {
+      for (const Entry &e : kEntries)
+        renderEntry(w, e);
+    }
+    w.endArray();
+    w.key("stats");
+    w.beginArray(1);
+    w.beginObject(3);
+    w.field("window_sec", static_cast<uint32_t>(300));
+    w.key("temperature_c");
+    w.beginObject(5);
+    w.field("count", static_cast<uint32_t>(30));
+    w.field("min", -12.5f, 2);
+    w.field("max", 104.99f, 2);
+    w.field("mean", 21.0f, 2);
+    w.field("stddev", 3.1415f, 3);
+    w.endObject();
+    w.field("offset", static_cast<int32_t>(-40000));
+    w.endObject();
+    w.endArray();
+    w.endObject();
+  }
+
+  template <typename Writer, typename Fn>
+  std::vector<uint8_t> encode(Fn render)
+  {
+    Sink out;
+    {
+      Writer w(out);
+      render(w);
+      w.flush();
+      TEST_ASSERT_TRUE(w.ok());
+      TEST_ASSERT_EQUAL_UINT32(w.bytesWritten(), out.data.size());
+    }
+    return out.data;
+  }
+
+  template <typename R>
+  Value decode(const std::vector<uint8_t> &data)
+  {
+    R reader(data);
+    Value v = reader.read();
+    TEST_ASSERT_FALSE(reader.failed());
+    TEST_ASSERT_TRUE_MESSAGE(reader.done(), "trailing bytes after the top-level value");
+    return v;
+  }
+
+  // binary against json; path names the field in a failure message.
+  void compare(const Value &json, const Value &bin, const std::string &path)
+  {
+    char msg[200];
+    snprintf(msg, sizeof(msg), "type differs at %s", path.c_str());
+    if (json.type == Value::Type::Float || bin.type == Value::Type::Float)
+    {
+      // Measurements are float32 in the binary formats and rounded to the
+      // requested decimals in JSON.
+      TEST_ASSERT_TRUE_MESSAGE(bin.type == Value::Type::Float, msg);
+      TEST_ASSERT_TRUE_MESSAGE(json.type == Value::Type::Float, msg);
+      snprintf(msg, sizeof(msg), "%s: json %g, binary %g", path.c_str(), json.f, bin.f);
+      TEST_ASSERT_TRUE_MESSAGE(fabs(json.f - bin.f) <= 0.0005 + 1e-6 * fabs(bin.f), msg);
+      return;
+    }
+    TEST_ASSERT_TRUE_MESSAGE(json.type == bin.type, msg);
+    snprintf(msg, sizeof(msg), "value differs at %s", path.c_str());
+    switch (json.type)
+    {
+    case Value::Type::Null:
+      break;
+    case Value::Type::Bool:
+      TEST_ASSERT_TRUE_MESSAGE(json.b == bin.b, msg);
+      break;
+    case Value::Type::Int:
+      TEST_ASSERT_TRUE_MESSAGE(json.i == bin.i, msg);
+      break;
+    case Value::Type::Text:
+      TEST_ASSERT_TRUE_MESSAGE(json.s == bin.s, msg);
+      break;
+    case Value::Type::Array:
+      TEST_ASSERT_TRUE_MESSAGE(json.items.size() == bin.items.size(), msg);
+      for (size_t i = 0; i < json.items.size(); ++i)
+        compare(json.items[i], bin.items[i], path + "[" + std::to_string(i) + "]");
+      break;
+    case Value::Type::Map:
+      TEST_ASSERT_TRUE_MESSAGE(json.fields.size() == bin.fields.size(), msg);
+      for (size_t i = 0; i < json.fields.size(); ++i)
+      {
+        snprintf(msg, sizeof(msg), "key order differs at %s.%s", path.c_str(), json.fields[i].first.c_str());
+        TEST_ASSERT_TRUE_MESSAGE(json.fields[i].first == bin.fields[i].first, msg);
+        compare(json.fields[i].second, bin.fields[i].second, path + "." + json.fields[i].first);
+      }
+      break;
+    case Value::Type::Float:
+      break;
+    }
+  }
+
+  template <typename Fn>
+  void checkAllFormats(Fn render)
+  {
+    const Value json = decode<JsonReader>(encode<JsonWriter>(render));
+    compare(json, decode<CborReader>(encode<CborWriter>(render)), "$");
+    compare(json, decode<MsgPackReader>(encode<MsgPackWriter>(render)), "$");
+  }
+
+  struct Measured
+  {
+    size_t bytes;
+    double usPerPayload;
+  };
+
+  class NullSink : public Print
+  {
+  public:
+    size_t write(uint8_t) override { return 1; }
+    size_t write(const uint8_t *, size_t n) override { return n; }
+  };
+
+  template <typename Writer, typename Fn>
+  Measured measure(Fn render)
+  {
+    constexpr size_t kIterations = 2000;
+    NullSink out;
+    size_t bytes = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < kIterations; ++i)
+    {
+      Writer w(out);
+      render(w);
+      w.flush();
+      bytes = w.bytesWritten();
+    }
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    return Measured{bytes, std::chrono::duration<double, std::micro>(elapsed).count() / kIterations};
+  }
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_single_reading_matches_json()
+{
+  checkAllFormats([](PayloadWriter &w) { renderSingle(w); });
+}
+
+void test_batch_matches_json()
+{
+  checkAllFormats([](PayloadWriter &w) { renderBatch(w, 1); });
+}
+
+// 20 x 5 entries: arrays past the 16-item fix forms and CBOR's 1-byte
+// length.
+void test_large_batch_matches_json()
+{
+  checkAllFormats([](PayloadWriter &w) { renderBatch(w, 20); });
+}
+
+void test_long_strings_and_integer_edges()
+{
+  const std::string longText(300, 'x');
+  checkAllFormats([&](PayloadWriter &w) {
+    w.beginObject(10);
+    w.field("s31", std::string(31, 'a').c_str());
+    w.field("s32", std::string(32, 'b').c_str());
+    w.field("s300", longText.c_str());
+    w.field("u23", static_cast<uint32_t>(23));
+    w.field("u24", static_cast<uint32_t>(24));
+    w.field("umax", static_cast<uint32_t>(0xFFFFFFFFu));
+    w.field("n32", static_cast<int32_t>(-32));
+    w.field("n33", static_cast<int32_t>(-33));
+    w.field("nmin", static_cast<int32_t>(-2147483647 - 1));
+    w.field("flag", false);
+    w.endObject();
+  });
+}
+
+void test_size_and_time()
+{
+  const auto single = [](PayloadWriter &w) { renderSingle(w); };
+  const auto batch = [](PayloadWriter &w) { renderBatch(w, 20); };
+  const Measured rows[][3] = {
+      {measure<JsonWriter>(single), measure<CborWriter>(single), measure<MsgPackWriter>(single)},
+      {measure<JsonWriter>(batch), measure<CborWriter>(batch), measure<MsgPackWriter>(batch)},
+  };
+  const char *names[] = {"single", "batch of 100"};
+  for (size_t r = 0; r < 2; ++r)
+  {
+    char line[200];
+    snprintf(line, sizeof(line), "%s: json %u B %.2f us, cbor %u B %.2f us, msgpack %u B %.2f us", names[r],
+             static_cast<unsigned>(rows[r][0].bytes), rows[r][0].usPerPayload,
+             static_cast<unsigned>(rows[r][1].bytes), rows[r][1].usPerPayload,
+             static_cast<unsigned>(rows[r][2].bytes), rows[r][2].usPerPayload);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_LESS_THAN(rows[r][0].bytes, rows[r][1].bytes);
+    TEST_ASSERT_LESS_THAN(rows[r][0].bytes, rows[r][2].bytes);
+  }
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_single_reading_matches_json);
+  RUN_TEST(test_batch_matches_json);
+  RUN_TEST(test_large_batch_matches_json);
+  RUN_TEST(test_long_strings_and_integer_edges);
+  RUN_TEST(test_size_and_time);
+  return UNITY_END();
+}
@@ -0,0 +1,598 @@
+// Streams a flash backlog through ChunkedPrint to a stand-in ingest server
+// on a loopback socket, the way Poster::postStream does: JSON rendered page
+// by page from the log, framed as HTTP/1.1 chunks in a 1 KiB buffer.
+//
+// The server thread decodes the chunked body strictly and reports what it
+// got. The client hashes what it rendered, so both ends must agree byte for
+// byte. The OfflineQueue cases cut the link mid-body and drop segments
+// mid-stream, then check that the cursor and drop counters say exactly
+// what was delivered and what was lost.
+
+#include <Arduino.h>
+#include <unity.h>
+
+#include <arpa/inet.h>
+#include <dirent.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "JsonWriter.h"
+#include "OfflineQueue.h"
+#include "SegmentLog.h"
+
+#ifndef OFFLINE_QUEUE_DIR
+#error "the native env sets OFFLINE_QUEUE_DIR"
+#endif
+
+namespace
+{
+  constexpr uint32_t kBootId = 7;
+  constexpr size_t kPage = 16;        // Poster's kDrainChunk
+  constexpr size_t kWriteBuf = 1024;  // Poster's kWriteBufferBytes
+
+  uint32_t fnv1a(uint32_t h, const uint8_t *data, size_t n)
+  {
+    while (n--)
+    {
+      h ^= *data++;
+      h *= 16777619u;
+    }
+    return h;
+  }
+
+  void clearDir(const char *dir)
+  {
+    DIR *d = opendir(dir);
+    if (!d)
+      return;
+    while (dirent *e = readdir(d))
+    {
+      if (e->d_name[0] == '.')
+        continue;
+      const std::string path = std::string(dir) + "/" + e->d_name;
+      remove(path.c_str());
+    }
+    closedir(d);
+  }
+
+  // ----------------------------------------------------- stand-in server
+
+  struct Received
+  {
+    bool complete = false;
+    std::string body;
+    size_t chunks = 0;
+    size_t largestChunk = 0;
+    size_t wireBytes = 0;
+  };
+
+  // Accepts one connection, reads the request head and a chunked body,
+  // answers 200 if the body ended with the zero-length chunk.
+  class IngestServer
+  {
+  public:
+    IngestServer()
+    {
+      listenFd_ = socket(AF_INET, SOCK_STREAM, 0);
+      sockaddr_in addr = {};
+      addr.sin_family = AF_INET;
+      addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+      addr.sin_port = 0;
+      bind(listenFd_, reinterpret_cast<sockaddr *>(&addr), sizeof(addr));
+      socklen_t len = sizeof(addr);
+      getsockname(listenFd_, reinterpret_cast<sockaddr *>(&addr), &len);
+      port_ = ntohs(addr.sin_port);
+      listen(listenFd_, 1);
+      thread_ = std::thread([this] { serve(); });
+    }
+    ~IngestServer()
+    {
+      if (thread_.joinable())
+        thread_.join();
+      close(listenFd_);
+    }
+
+    uint16_t port() const { return port_; }
+    // Waits for the connection to finish.
+    const Received &result()
+    {
+      if (thread_.joinable())
+        thread_.join();
+      return got_;
+    }
+
+  private:
+    bool fill()
+    {
+      char buf[4096];
+      const ssize_t n = recv(fd_, buf, sizeof(buf), 0);
+      if (n <= 0)
+        return false;
+      in_.append(buf, static_cast<size_t>(n));
+      got_.wireBytes += static_cast<size_t>(n);
+      return true;
+    }
+    bool line(std::string &out)
+    {
+      size_t p;
+      while ((p = in_.find("\r\n")) == std::string::npos)
+      {
+        if (!fill())
+          return false;
+      }
+      out = in_.substr(0, p);
+      in_.erase(0, p + 2);
+      return true;
+    }
+    bool take(size_t n, std::string *out)
+    {
+      while (in_.size() < n)
+      {
+        if (!fill())
+          return false;
+      }
+      if (out)
+        out->append(in_, 0, n);
+      in_.erase(0, n);
+      return true;
+    }
+
+    void serve()
+    {
+      fd_ = accept(listenFd_, nullptr, nullptr);
+      std::string l;
+      while (line(l) && !l.empty())
+      {
+      }
+      for (;;)
+      {
+        if (!line(l))
+          break;
+        char *end = nullptr;
+        const unsigned long size = strtoul(l.c_str(), &end, 16);
+        if (end == l.c_str() || *end != '\0')
+          break;
+        std::string crlf;
+        if (size == 0)
+        {
+          got_.complete = line(l) && l.empty();
+          break;
+        }
+        if (!take(size, &got_.body) || !take(2, &crlf) || crlf != "\r\n")
+          break;
+        ++got_.chunks;
+        if (size > got_.largestChunk)
+          got_.largestChunk = size;
+      }
+      if (got_.complete)
+      {
+        static const char kOk[] = "HTTP/1.1 200 OK\r\nContent-Length: 0\r\n\r\n";
+        send(fd_, kOk, sizeof(kOk) - 1, MSG_NOSIGNAL);
+      }
+      close(fd_);
+    }
+
+    int listenFd_ = -1;
+    int fd_ = -1;
+    uint16_t port_ = 0;
+    std::thread thread_;
+    std::string in_;
+    Received got_;
+  };
+
+  // ------------------------------------------------------------- client
+
+  // The connection as a Print. failAfter simulates the link dropping: the
+  // write that crosses it is cut short and the socket is closed.
+  class SocketPrint : public Print
+  {
+  public:
+    SocketPrint(uint16_t port, size_t failAfter = SIZE_MAX) : failAfter_(failAfter)
+    {
+      fd_ = socket(AF_INET, SOCK_STREAM, 0);
+      sockaddr_in addr = {};
+      addr.sin_family = AF_INET;
+      addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+      addr.sin_port = htons(port);
+      connected_ = connect(fd_, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) == 0;
+    }
+    ~SocketPrint() { closeLink(); }
+
+    size_t write(uint8_t b) override { return write(&b, 1); }
+    size_t write(const uint8_t *data, size_t size) override
+    {
+      if (!connected_)
+        return 0;
+      size_t allowed = size;
+      if (sent_ + size > failAfter_)
+        allowed = failAfter_ - sent_;
+      size_t done = 0;
+      while (done < allowed)
+      {
+        const ssize_t n = send(fd_, data + done, allowed - done, MSG_NOSIGNAL);
+        if (n <= 0)
+          break;
+        done += static_cast<size_t>(n);
+      }
+      sent_ += done;
+      ++writes_;
+      if (done < size)
+        closeLink();
+      return done;
+    }
+    void header()
+    {
+      static const char kHead[] = "POST /ingest HTTP/1.1\r\nHost: test\r\nContent-Type: application/json\r\n"
+                                  "Transfer-Encoding: chunked\r\n\r\n";
+      write(reinterpret_cast<const uint8_t *>(kHead), sizeof(kHead) - 1);
+    }
+    // Half-closes and reads the status line; 0 if there was none.
+    int status()
+    {
+      if (!connected_)
+        return 0;
+      shutdown(fd_, SHUT_WR);
+      char buf[64] = {};
+      const ssize_t n = recv(fd_, buf, sizeof(buf) - 1, 0);
+      closeLink();
+      return n > 12 ? atoi(buf + 9) : 0;
+    }
+    size_t sent() const { return sent_; }
+    size_t writes() const { return writes_; }
+
+  private:
+    void closeLink()
+    {
+      if (fd_ >= 0)
+        close(fd_);
+      fd_ = -1;
+      connected_ = false;
+    }
+
+    int fd_ = -1;
+    bool connected_ = false;
+    size_t failAfter_;
+    size_t sent_ = 0;
+    size_t writes_ = 0;
+  };
+
+  // Hashes everything written through it before passing it on.
+  class HashingPrint : public Print
+  {
+  public:
+    explicit HashingPrint(Print &out) : out_(out) {}
+    size_t write(uint8_t b) override { return write(&b, 1); }
+    size_t write(const uint8_t *data, size_t size) override
+    {
+      hash_ = fnv1a(hash_, data, size);
+      bytes_ += size;
+      return out_.write(data, size);
+    }
+    uint32_t hash() const { return hash_; }
+    size_t bytes() const { return bytes_; }
+
+  private:
+    Print &out_;
+    uint32_t hash_ = 2166136261u;
+    size_t bytes_ = 0;
+  };
+
+  void renderEntry(PayloadWriter &w, const Reading &r)
+  {
+    w.beginObject(5);
+    w.field("boot_id", r.bootId);
+    w.field("seq", r.seq);
+    w.field("timestamp", r.timestamp);
+    w.field("temperature_c", r.temperatureC, 2);
+    w.field("humidity_pct", r.humidityPct, 2);
+    w.endObject();
+  }
+
+  Reading makeReading(uint32_t seq)
+  {
+    Reading r = {};
+    r.timestamp = 1767225600u + seq * 60;
+    r.sampledMs = millis();
+    r.temperatureC = 20.0f + static_cast<float>(seq % 500) * 0.01f;
+    r.humidityPct = 40.0f + static_cast<float>(seq % 300) * 0.1f;
+    r.bootId = kBootId;
+    r.seq = seq;
+    return r;
+  }
+
+  uint32_t gNextSeq = 1;
+
+  void pushReadings(size_t count)
+  {
+    Reading page[kPage];
+    while (count > 0)
+    {
+      const size_t n = count < kPage ? count : kPage;
+      for (size_t i = 0; i < n; ++i)
+        page[i] = makeReading(gNextSeq++);
+      OfflineQueue::pushMany(page, n);
+      count -= n;
+    }
+  }
+
+  // The "seq" values of a received body, in order.
+  std::vector<uint32_t> seqsIn(const std::string &body)
+  {
+    std::vector<uint32_t> out;
+    for (size_t p = body.find("\"seq\":"); p != std::string::npos; p = body.find("\"seq\":", p + 6))
+      out.push_back(static_cast<uint32_t>(strtoul(body.c_str() + p + 6, nullptr, 10)));
+    return out;
+  }
+
+  struct StreamPost
+  {
+    int status;
+    bool finished;
+    uint32_t hash;
+    size_t bodyBytes;
+    uint32_t readings;
+  };
+
+  // Poster::postStream over OfflineQueue, minus the HTTP client around it.
+  StreamPost postStream(IngestServer &server, OfflineQueue::Stream &s, size_t failAfter = SIZE_MAX,
+                        void (*midway)() = nullptr)
+  {
+    SocketPrint link(server.port(), failAfter);
+    link.header();
+    uint8_t buf[kWriteBuf];
+    ChunkedPrint chunks(link, buf, sizeof(buf));
+    HashingPrint hashed(chunks);
+    uint32_t rendered = 0;
+    {
+      JsonWriter w(hashed);
+      w.beginObject(2);
+      w.field("location", "kitchen");
+      w.key("readings");
+      w.beginArray(s.count);
+      Reading page[kPage];
+      size_t n;
+      while ((n = OfflineQueue::readStream(s, page, kPage)) > 0)
+      {
+        for (size_t i = 0; i < n; ++i)
+          renderEntry(w, page[i]);
+        rendered += n;
+        if (midway && rendered >= kPage * 4)
+        {
+          midway();
+          midway = nullptr;
+        }
+      }
+      w.endArray();
+      w.endObject();
+      w.flush();
+    }
+    const bool finished = chunks.finish();
+    return StreamPost{link.status(), finished, hashed.hash(), hashed.bytes(), rendered};
+  }
+
+  void checkAccounting()
+  {
+    const OfflineQueue::Stats st = OfflineQueue::stats();
+    TEST_ASSERT_EQUAL_UINT32(st.enqueued - st.drained - st.dropped, st.depth);
+  }
+}
+
+void setUp() {}
+void tearDown() {}
+
+// A multi-MB backlog straight from a SegmentLog, with segments large
+// enough to hold it; both ends must see the same bytes.
+void test_segment_log_streams_multi_megabyte_backlog()
+{
+  constexpr const char *kDir = "/tmp/esp32-poster-seglog";
+  constexpr uint32_t kReadings = 60000;
+  clearDir(kDir);
+  SegmentLog log(kDir, 256 * 1024, 64);
+  TEST_ASSERT_TRUE(log.open());
+  Reading batch[250];
+  for (uint32_t seq = 1; seq <= kReadings; seq += 250)
+  {
+    for (uint32_t i = 0; i < 250; ++i)
+      batch[i] = makeReading(seq + i);
+    TEST_ASSERT_TRUE(log.append(batch, sizeof(Reading), 250));
+  }
+  TEST_ASSERT_EQUAL_UINT32(kReadings, log.records());
+  TEST_ASSERT_EQUAL_UINT32(0, log.droppedRecords());
+
+  IngestServer server;
+  SocketPrint link(server.port());
+  link.header();
+  uint8_t buf[kWriteBuf];
+  ChunkedPrint chunks(link, buf, sizeof(buf));
+  HashingPrint hashed(chunks);
+  {
+    JsonWriter w(hashed);
+    w.beginObject(2);
+    w.field("location", "kitchen");
+    w.key("readings");
+    w.beginArray(kReadings);
+    SegmentLog::Position pos = log.cursor();
+    Reading page[kPage];
+    size_t n;
+    while ((n = log.read(pos, page, sizeof(Reading), kPage)) > 0)
+    {
+      for (size_t i = 0; i < n; ++i)
+        renderEntry(w, page[i]);
+    }
+    w.endArray();
+    w.endObject();
+    w.flush();
+  }
+  TEST_ASSERT_TRUE(chunks.finish());
+  TEST_ASSERT_EQUAL(200, link.status());
+
+  const Received &got = server.result();
+  TEST_ASSERT_TRUE(got.complete);
+  TEST_ASSERT_GREATER_THAN(4u * 1024 * 1024, got.body.size());
+  TEST_ASSERT_EQUAL_UINT32(hashed.bytes(), got.body.size());
+  TEST_ASSERT_EQUAL_UINT32(hashed.hash(), fnv1a(2166136261u, reinterpret_cast<const uint8_t *>(got.body.data()), got.body.size()));
+  // Every chunk but the last fills the buffer; each is one write.
+  TEST_ASSERT_EQUAL_UINT32(kWriteBuf - ChunkedPrint::kFraming, got.largestChunk);
+  TEST_ASSERT_EQUAL_UINT32(got.chunks + 1, chunks.writes());
+  const std::vector<uint32_t> seqs = seqsIn(got.body);
+  TEST_ASSERT_EQUAL_UINT32(kReadings, seqs.size());
+  for (uint32_t i = 0; i < kReadings; ++i)
+    TEST_ASSERT_EQUAL_UINT32(i + 1, seqs[i]);
+
+  char msg[160];
+  snprintf(msg, sizeof(msg), "%u readings: %u body bytes in %u chunks, %u bytes on the wire", static_cast<unsigned>(kReadings),
+           static_cast<unsigned>(got.body.size()), static_cast<unsigned>(got.chunks), static_cast<unsigned>(got.wireBytes));
+  TEST_MESSAGE(msg);
+
+  log.consume(kReadings);
+  TEST_ASSERT_EQUAL_UINT32(0, log.records());
+}
+
+// The link drops halfway: nothing is committed, and the next stream starts
+// at the same reading.
+void test_partial_failure_keeps_cursor()
+{
+  pushReadings(5000);
+  OfflineQueue::maintain();
+  const OfflineQueue::Stats before = OfflineQueue::stats();
+  TEST_ASSERT_GREATER_THAN(1440u, before.flashDepth);
+
+  OfflineQueue::Stream s;
+  TEST_ASSERT_TRUE(OfflineQueue::beginStream(s, 1440));
+  IngestServer server;
+  const StreamPost post = postStream(server, s, 64 * 1024);
+  TEST_ASSERT_FALSE(post.finished);
+  TEST_ASSERT_EQUAL(0, post.status);
+  const Received &got = server.result();
+  TEST_ASSERT_FALSE(got.complete);
+  TEST_ASSERT_LESS_THAN(post.bodyBytes, got.body.size());
+  // Not committed: same depth, no drops, same first reading.
+  const OfflineQueue::Stats after = OfflineQueue::stats();
+  TEST_ASSERT_EQUAL_UINT32(before.depth, after.depth);
+  TEST_ASSERT_EQUAL_UINT32(before.dropped, after.dropped);
+  TEST_ASSERT_EQUAL_UINT32(before.drained, after.drained);
+  OfflineQueue::Stream again;
+  TEST_ASSERT_TRUE(OfflineQueue::beginStream(again, 1));
+  Reading first;
+  TEST_ASSERT_EQUAL_UINT32(1, OfflineQueue::readStream(again, &first, 1));
+  TEST_ASSERT_EQUAL_UINT32(1, first.seq);
+  checkAccounting();
+}
+
+// A delivered stream is committed: exactly what the server received
+// leaves the queue.
+void test_delivered_stream_commits()
+{
+  const OfflineQueue::Stats before = OfflineQueue::stats();
+  OfflineQueue::Stream s;
+  TEST_ASSERT_TRUE(OfflineQueue::beginStream(s, 1440));
+  IngestServer server;
+  const StreamPost post = postStream(server, s);
+  TEST_ASSERT_TRUE(post.finished);
+  TEST_ASSERT_EQUAL(200, post.status);
+  const Received &got = server.result();
+  TEST_ASSERT_TRUE(got.complete);
+  TEST_ASSERT_EQUAL_UINT32(post.bodyBytes, got.body.size());
+  TEST_ASSERT_EQUAL_UINT32(post.hash, fnv1a(2166136261u, reinterpret_cast<const uint8_t *>(got.body.data()), got.body.size()));
+  const std::vector<uint32_t> seqs = seqsIn(got.body);
+  TEST_ASSERT_EQUAL_UINT32(1440, seqs.size());
+  TEST_ASSERT_EQUAL_UINT32(1, seqs.front());
+  TEST_ASSERT_EQUAL_UINT32(1440, seqs.back());
+
+  TEST_ASSERT_TRUE(OfflineQueue::commitStream(s, 100));
+  const OfflineQueue::Stats after = OfflineQueue::stats();
+  TEST_ASSERT_EQUAL_UINT32(before.depth - 1440, after.depth);
+  TEST_ASSERT_EQUAL_UINT32(before.drained + 1440, after.drained);
+  checkAccounting();
+}
+
+// Flash fills up while a stream is being sent and the oldest segment is
+// dropped under it: the stream stops short, the commit is refused and the
+// lost readings are counted as dropped, not as drained.
+void test_drop_during_stream_is_accounted()
+{
+  const OfflineQueue::Stats before = OfflineQueue::stats();
+  OfflineQueue::Stream s;
+  TEST_ASSERT_TRUE(OfflineQueue::beginStream(s, 1440));
+  IngestServer server;
+  const StreamPost post = postStream(server, s, SIZE_MAX, [] {
+    pushReadings(4000);
+    OfflineQueue::maintain();
+  });
+  (void)server.result();
+  TEST_ASSERT_LESS_THAN(1440u, post.readings);
+  TEST_ASSERT_FALSE(OfflineQueue::commitStream(s, 100));
+
+  const OfflineQueue::Stats after = OfflineQueue::stats();
+  TEST_ASSERT_GREATER_THAN(before.dropped, after.dropped);
+  TEST_ASSERT_EQUAL_UINT32(before.drained, after.drained);
+  checkAccounting();
+}
+
+// Drains the rest with streams and batches: every reading pushed was
+// either delivered once or counted as dropped.
+void test_everything_delivered_or_dropped()
+{
+  std::vector<bool> seen(gNextSeq, false);
+  uint32_t delivered = 0;
+  const OfflineQueue::Stats start = OfflineQueue::stats();
+  for (;;)
+  {
+    OfflineQueue::Stream s;
+    if (!OfflineQueue::beginStream(s, 1440))
+      break;
+    IngestServer server;
+    const StreamPost post = postStream(server, s);
+    TEST_ASSERT_EQUAL(200, post.status);
+    const Received &got = server.result();
+    TEST_ASSERT_TRUE(OfflineQueue::commitStream(s, 100));
+    for (uint32_t seq : seqsIn(got.body))
+    {
+      TEST_ASSERT_FALSE(seen[seq]);
+      seen[seq] = true;
+      ++delivered;
+    }
+  }
+  Reading page[kPage];
+  OfflineQueue::Mark mark;
+  size_t n;
+  while ((n = OfflineQueue::peek(page, kPage, mark)) > 0)
+  {
+    for (size_t i = 0; i < n; ++i)
+    {
+      TEST_ASSERT_FALSE(seen[page[i].seq]);
+      seen[page[i].seq] = true;
+      ++delivered;
+    }
+    TEST_ASSERT_TRUE(OfflineQueue::pop(mark, n, 1));
+  }
+  TEST_ASSERT_TRUE(OfflineQueue::empty());
+
+  const OfflineQueue::Stats end = OfflineQueue::stats();
+  TEST_ASSERT_EQUAL_UINT32(0, end.depth);
+  TEST_ASSERT_EQUAL_UINT32(start.depth, delivered + (end.dropped - start.dropped));
+  // The readings before this test's start were delivered or dropped by the
+  // earlier tests: all of them are accounted for.
+  TEST_ASSERT_EQUAL_UINT32(gNextSeq - 1, end.drained + end.dropped);
+  checkAccounting();
+}
+
+int main()
+{
+  HostClock::set(1000000);
+  clearDir(OFFLINE_QUEUE_DIR);
+  OfflineQueue::init();
+
+  UNITY_BEGIN();
+  RUN_TEST(test_segment_log_streams_multi_megabyte_backlog);
+  RUN_TEST(test_partial_failure_keeps_cursor);
+  RUN_TEST(test_delivered_stream_commits);
+  RUN_TEST(test_drop_during_stream_is_accounted);
+  RUN_TEST(test_everything_delivered_or_dropped);
+  return UNITY_END();
+}
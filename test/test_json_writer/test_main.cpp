@@ -0,0 +1,225 @@
+// JsonWriter output checks and the payload benchmark against the String
+// concatenation the posts were built with before the streaming writers.
+//
+// Heap use is counted by replacing the global operator new; the host
+// String is std::string based, so the absolute numbers differ from WString
+// on the device, but the allocations per payload are the same kind (grow on
+// +=, one per String(float, 2) temporary).
+
+#include <Arduino.h>
+#include <unity.h>
+
+#include <chrono>
+#include <new>
+
+#include "JsonWriter.h"
+
+namespace
+{
+  size_t gAllocs = 0;
+  size_t gAllocBytes = 0;
+
+  // Print into a fixed buffer, so the sink itself does not allocate.
+  class Sink : public Print
+  {
+  public:
+    size_t write(uint8_t b) override { return write(&b, 1); }
+    size_t write(const uint8_t *data, size_t size) override
+    {
+      if (size > sizeof(buf_) - 1 - len_)
+        return 0;
+      memcpy(buf_ + len_, data, size);
+      len_ += size;
+      buf_[len_] = '\0';
+      return size;
+    }
+    const char *c_str() const { return buf_; }
+    size_t length() const { return len_; }
+    void clear()
+    {
+      len_ = 0;
+      buf_[0] = '\0';
+    }
+
+  private:
+    char buf_[512] = {};
+    size_t len_ = 0;
+  };
+
+  const String kLocation("kitchen");
+
+  // The single-reading body as Poster::postReading built it before the
+  // PayloadWriter (String, reserve(64), one temporary per number).
+  String stringReading(const String &configured, float t, float h)
+  {
+    const String location = configured; // getDeviceLocation() returned a copy
+    String body;
+    body.reserve(64);
+    body += F("{\"location\":\"");
+    body += location;
+    body += F("\",\"temperature_c\":");
+    body += String(t, 2);
+    body += F(",\"humidity_pct\":");
+    body += String(h, 2);
+    body += F("}");
+    return body;
+  }
+
+  void writerReading(Print &out, const String &location, float t, float h)
+  {
+    JsonWriter w(out);
+    w.beginObject(3);
+    w.field("location", location);
+    w.field("temperature_c", t, 2);
+    w.field("humidity_pct", h, 2);
+    w.endObject();
+    w.flush();
+  }
+
+  struct Cost
+  {
+    double nsPerPayload;
+    double allocsPerPayload;
+    double bytesPerPayload;
+  };
+
+  template <typename Fn>
+  Cost measure(size_t iterations, Fn fn)
+  {
+    const size_t allocs = gAllocs;
+    const size_t bytes = gAllocBytes;
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i)
+      fn(i);
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    return Cost{std::chrono::duration<double, std::nano>(elapsed).count() / iterations,
+                static_cast<double>(gAllocs - allocs) / iterations,
+                static_cast<double>(gAllocBytes - bytes) / iterations};
+  }
+}
+
+void *operator new(size_t size)
+{
+  ++gAllocs;
+  gAllocBytes += size;
+  if (void *p = malloc(size ? size : 1))
+    return p;
+  throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+void setUp() {}
+void tearDown() {}
+
+void test_reading_matches_string_path()
+{
+  const float samples[][2] = {{21.5f, 40.0f}, {-3.25f, 99.99f}, {0.004f, 0.0f}, {104.99f, 7.1f}};
+  Sink out;
+  for (const auto &s : samples)
+  {
+    out.clear();
+    writerReading(out, kLocation, s[0], s[1]);
+    const String expected = stringReading(kLocation, s[0], s[1]);
+    TEST_ASSERT_EQUAL_STRING(expected.c_str(), out.c_str());
+  }
+
+  // The one intended difference: no "-0.00" for values that round to zero.
+  out.clear();
+  writerReading(out, kLocation, -0.004f, 55.555f);
+  TEST_ASSERT_EQUAL_STRING("{\"location\":\"kitchen\",\"temperature_c\":0.00,\"humidity_pct\":55.56}", out.c_str());
+}
+
+void test_escapes_strings()
+{
+  Sink out;
+  {
+    JsonWriter w(out);
+    w.beginObject(2);
+    w.field("location", "a\"b\\c\n\t\x01 \xc3\xa4");
+    w.field("error", "");
+    w.endObject();
+  }
+  TEST_ASSERT_EQUAL_STRING("{\"location\":\"a\\\"b\\\\c\\n\\t\\u0001 \xc3\xa4\",\"error\":\"\"}", out.c_str());
+}
+
+void test_numbers_and_nesting()
+{
+  Sink out;
+  {
+    JsonWriter w(out);
+    w.beginObject(3);
+    w.key("readings");
+    w.beginArray(2);
+    w.beginObject(2);
+    w.field("seq", static_cast<uint32_t>(4294967295u));
+    w.field("t", NAN, 2);
+    w.endObject();
+    w.beginObject(1);
+    w.field("offset", static_cast<int32_t>(-2147483647 - 1));
+    w.endObject();
+    w.endArray();
+    w.field("ok", true);
+    w.field("stddev", 0.1234f, 3);
+    w.endObject();
+  }
+  TEST_ASSERT_EQUAL_STRING("{\"readings\":[{\"seq\":4294967295,\"t\":null},{\"offset\":-2147483648}],\"ok\":true,\"stddev\":0.123}",
+                           out.c_str());
+}
+
+void test_reports_short_write()
+{
+  uint8_t buf[20];
+  BufferPrint out(buf, sizeof(buf));
+  JsonWriter w(out);
+  w.beginObject(3);
+  w.field("location", kLocation);
+  w.field("temperature_c", 21.5f, 2);
+  w.endObject();
+  w.flush();
+  TEST_ASSERT_FALSE(w.ok());
+  // Counts what was produced, not what the Print accepted.
+  TEST_ASSERT_EQUAL_UINT32(44, w.bytesWritten());
+}
+
+void test_benchmark_against_string_path()
+{
+  constexpr size_t kIterations = 200000;
+  Sink out;
+  size_t checksum = 0;
+
+  const Cost before = measure(kIterations, [&](size_t i) {
+    const String body = stringReading(kLocation, 20.0f + (i % 100) * 0.01f, 40.0f + (i % 7));
+    checksum += body.length();
+  });
+  const Cost after = measure(kIterations, [&](size_t i) {
+    out.clear();
+    writerReading(out, kLocation, 20.0f + (i % 100) * 0.01f, 40.0f + (i % 7));
+    checksum -= out.length();
+  });
+
+  char line[160];
+  snprintf(line, sizeof(line), "String path: %.1f ns, %.2f allocations, %.1f bytes allocated per payload",
+           before.nsPerPayload, before.allocsPerPayload, before.bytesPerPayload);
+  TEST_MESSAGE(line);
+  snprintf(line, sizeof(line), "JsonWriter:  %.1f ns, %.2f allocations, %.1f bytes allocated per payload",
+           after.nsPerPayload, after.allocsPerPayload, after.bytesPerPayload);
+  TEST_MESSAGE(line);
+
+  // Same bytes on both paths, and none of them from the heap on the new one.
+  TEST_ASSERT_EQUAL_UINT32(0, checksum);
+  TEST_ASSERT_EQUAL_UINT32(0, static_cast<uint32_t>(after.allocsPerPayload * kIterations));
+  TEST_ASSERT_GREATER_THAN(0, before.allocsPerPayload);
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_reading_matches_string_path);
+  RUN_TEST(test_escapes_strings);
+  RUN_TEST(test_numbers_and_nesting);
+  RUN_TEST(test_reports_short_write);
+  RUN_TEST(test_benchmark_against_string_path);
+  return UNITY_END();
+}
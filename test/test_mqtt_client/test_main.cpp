@@ -0,0 +1,594 @@
+// MqttClient against a stand-in broker on a loopback socket: CONNECT and
+// CONNACK (accepted and refused), QoS 0 and QoS 1 publishes with PUBACK,
+// keep-alive pings, and the persistent-session case where unacknowledged
+// QoS 1 messages are re-sent with DUP set after a reconnect.
+//
+// The broker runs in its own thread and speaks just enough MQTT 3.1.1 for
+// a publish-only client. millis() is the simulated clock; the socket's
+// available() waits up to 1 ms of real time for data, so MqttClient's
+// timeouts still give the broker thread time to answer.
+
+#include <Arduino.h>
+#include <Client.h>
+#include <unity.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "MqttClient.h"
+
+namespace
+{
+  // ----------------------------------------------------- stand-in broker
+
+  struct Connect
+  {
+    std::string clientId;
+    uint16_t keepAliveSec = 0;
+    bool cleanSession = false;
+    std::string willTopic;
+    std::string willPayload;
+    bool willRetain = false;
+    std::string user;
+    std::string password;
+  };
+
+  struct Published
+  {
+    std::string topic;
+    std::string payload;
+    uint8_t qos = 0;
+    bool dup = false;
+    bool retain = false;
+    uint16_t packetId = 0;
+  };
+
+  // Accepts connections one after the other until destroyed. Sessions are
+  // remembered by client id, so a CONNECT without clean session after an
+  // earlier one gets "session present".
+  class Broker
+  {
+  public:
+    Broker()
+    {
+      listenFd_ = socket(AF_INET, SOCK_STREAM, 0);
+      sockaddr_in addr = {};
+      addr.sin_family = AF_INET;
+      addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+      addr.sin_port = 0;
+      bind(listenFd_, reinterpret_cast<sockaddr *>(&addr), sizeof(addr));
+      socklen_t len = sizeof(addr);
+      getsockname(listenFd_, reinterpret_cast<sockaddr *>(&addr), &len);
+      port_ = ntohs(addr.sin_port);
+      listen(listenFd_, 4);
+      thread_ = std::thread([this] { serve(); });
+    }
+    ~Broker()
+    {
+      stop_ = true;
+      thread_.join();
+      close(listenFd_);
+    }
+
+    uint16_t port() const { return port_; }
+
+    // CONNACK return code for the next connections.
+    std::atomic<uint8_t> connackCode{0};
+    // Answer QoS 1 publishes with PUBACK.
+    std::atomic<bool> ackPublishes{true};
+    // Close the connection after this many publishes (0 = never): the
+    // link dropping with messages unacknowledged.
+    std::atomic<size_t> closeAfterPublishes{0};
+
+    std::vector<Connect> connects()
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      return connects_;
+    }
+    std::vector<Published> published()
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      return published_;
+    }
+    size_t pings()
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      return pings_;
+    }
+    size_t disconnects()
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      return disconnects_;
+    }
+
+  private:
+    bool readByte(int fd, uint8_t &b)
+    {
+      for (;;)
+      {
+        pollfd p{fd, POLLIN, 0};
+        if (stop_)
+          return false;
+        if (::poll(&p, 1, 20) <= 0)
+          continue;
+        return recv(fd, &b, 1, 0) == 1;
+      }
+    }
+
+    bool readPacket(int fd, uint8_t &type, std::string &body)
+    {
+      if (!readByte(fd, type))
+        return false;
+      size_t remaining = 0, multiplier = 1;
+      uint8_t digit;
+      do
+      {
+        if (!readByte(fd, digit))
+          return false;
+        remaining += (digit & 0x7F) * multiplier;
+        multiplier *= 128;
+      } while (digit & 0x80);
+      body.clear();
+      while (remaining--)
+      {
+        uint8_t b;
+        if (!readByte(fd, b))
+          return false;
+        body.push_back(static_cast<char>(b));
+      }
+      return true;
+    }
+
+    static std::string str(const std::string &body, size_t &pos)
+    {
+      const size_t n = (static_cast<uint8_t>(body[pos]) << 8) | static_cast<uint8_t>(body[pos + 1]);
+      std::string s = body.substr(pos + 2, n);
+      pos += 2 + n;
+      return s;
+    }
+
+    void send(int fd, std::initializer_list<uint8_t> bytes)
+    {
+      const std::vector<uint8_t> v(bytes);
+      ::send(fd, v.data(), v.size(), MSG_NOSIGNAL);
+    }
+
+    void serve()
+    {
+      while (!stop_)
+      {
+        pollfd p{listenFd_, POLLIN, 0};
+        if (::poll(&p, 1, 20) <= 0)
+          continue;
+        const int fd = accept(listenFd_, nullptr, nullptr);
+        if (fd >= 0)
+          session(fd);
+      }
+    }
+
+    void session(int fd)
+    {
+      uint8_t type;
+      std::string body;
+      if (!readPacket(fd, type, body) || type != 0x10)
+      {
+        close(fd);
+        return;
+      }
+      Connect c;
+      size_t pos = 0;
+      const std::string protocol = str(body, pos);
+      const uint8_t level = static_cast<uint8_t>(body[pos++]);
+      const uint8_t flags = static_cast<uint8_t>(body[pos++]);
+      c.keepAliveSec = static_cast<uint16_t>((static_cast<uint8_t>(body[pos]) << 8) | static_cast<uint8_t>(body[pos + 1]));
+      pos += 2;
+      c.cleanSession = flags & 0x02;
+      c.clientId = str(body, pos);
+      if (flags & 0x04)
+      {
+        c.willTopic = str(body, pos);
+        c.willPayload = str(body, pos);
+        c.willRetain = flags & 0x20;
+      }
+      if (flags & 0x80)
+        c.user = str(body, pos);
+      if (flags & 0x40)
+        c.password = str(body, pos);
+      if (protocol != "MQTT" || level != 4 || pos != body.size())
+      {
+        close(fd);
+        return;
+      }
+
+      bool present;
+      {
+        std::lock_guard<std::mutex> guard(mutex_);
+        connects_.push_back(c);
+        if (c.cleanSession)
+          sessions_.erase(c.clientId);
+        present = sessions_.count(c.clientId) != 0;
+        if (!c.cleanSession)
+          sessions_.insert(c.clientId);
+      }
+      const uint8_t code = connackCode;
+      send(fd, {0x20, 2, static_cast<uint8_t>(present && code == 0 ? 1 : 0), code});
+      if (code != 0)
+      {
+        close(fd);
+        return;
+      }
+
+      size_t publishes = 0;
+      while (readPacket(fd, type, body))
+      {
+        if ((type & 0xF0) == 0x30)
+        {
+          Published m;
+          m.qos = (type >> 1) & 0x03;
+          m.dup = type & 0x08;
+          m.retain = type & 0x01;
+          pos = 0;
+          m.topic = str(body, pos);
+          if (m.qos)
+          {
+            m.packetId = static_cast<uint16_t>((static_cast<uint8_t>(body[pos]) << 8) | static_cast<uint8_t>(body[pos + 1]));
+            pos += 2;
+          }
+          m.payload = body.substr(pos);
+          {
+            std::lock_guard<std::mutex> guard(mutex_);
+            published_.push_back(m);
+          }
+          if (m.qos == 1 && ackPublishes)
+            send(fd, {0x40, 2, static_cast<uint8_t>(m.packetId >> 8), static_cast<uint8_t>(m.packetId & 0xFF)});
+          if (closeAfterPublishes && ++publishes >= closeAfterPublishes)
+            break;
+        }
+        else if (type == 0xC0)
+        {
+          {
+            std::lock_guard<std::mutex> guard(mutex_);
+            ++pings_;
+          }
+          send(fd, {0xD0, 0});
+        }
+        else if (type == 0xE0)
+        {
+          std::lock_guard<std::mutex> guard(mutex_);
+          ++disconnects_;
+          break;
+        }
+      }
+      shutdown(fd, SHUT_RDWR);
+      close(fd);
+    }
+
+    int listenFd_ = -1;
+    uint16_t port_ = 0;
+    std::atomic<bool> stop_{false};
+    std::thread thread_;
+    std::mutex mutex_;
+    std::set<std::string> sessions_;
+    std::vector<Connect> connects_;
+    std::vector<Published> published_;
+    size_t pings_ = 0;
+    size_t disconnects_ = 0;
+  };
+
+  // ------------------------------------------------------------- client
+
+  // Client over a loopback TCP socket, as WiFiClient / TlsClient are on the
+  // device. connected() stays true while received bytes are unread.
+  class SocketClient : public Client
+  {
+  public:
+    ~SocketClient() { stop(); }
+
+    int connect(const char *host, uint16_t port) override
+    {
+      (void)host;
+      stop();
+      fd_ = socket(AF_INET, SOCK_STREAM, 0);
+      sockaddr_in addr = {};
+      addr.sin_family = AF_INET;
+      addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+      addr.sin_port = htons(port);
+      if (::connect(fd_, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0)
+      {
+        stop();
+        return 0;
+      }
+      peerClosed_ = false;
+      return 1;
+    }
+    size_t write(uint8_t b) override { return write(&b, 1); }
+    size_t write(const uint8_t *data, size_t size) override
+    {
+      if (fd_ < 0)
+        return 0;
+      const ssize_t n = send(fd_, data, size, MSG_NOSIGNAL);
+      return n < 0 ? 0 : static_cast<size_t>(n);
+    }
+    int available() override
+    {
+      if (in_.empty())
+        fill(1);
+      return static_cast<int>(in_.size());
+    }
+    int read() override
+    {
+      if (!available())
+        return -1;
+      const uint8_t b = static_cast<uint8_t>(in_.front());
+      in_.erase(0, 1);
+      return b;
+    }
+    int read(uint8_t *buf, size_t size) override
+    {
+      size_t n = 0;
+      while (n < size && available())
+        buf[n++] = static_cast<uint8_t>(read());
+      return static_cast<int>(n);
+    }
+    int peek() override { return available() ? static_cast<uint8_t>(in_.front()) : -1; }
+    void stop() override
+    {
+      if (fd_ >= 0)
+        close(fd_);
+      fd_ = -1;
+      in_.clear();
+    }
+    uint8_t connected() override
+    {
+      if (fd_ >= 0 && !peerClosed_)
+        fill(0);
+      return fd_ >= 0 && (!peerClosed_ || !in_.empty());
+    }
+    operator bool() override { return fd_ >= 0; }
+
+  private:
+    void fill(int waitMs)
+    {
+      if (fd_ < 0 || peerClosed_)
+        return;
+      pollfd p{fd_, POLLIN, 0};
+      if (::poll(&p, 1, waitMs) <= 0)
+        return;
+      char buf[512];
+      const ssize_t n = recv(fd_, buf, sizeof(buf), 0);
+      if (n <= 0)
+        peerClosed_ = true;
+      else
+        in_.append(buf, static_cast<size_t>(n));
+    }
+
+    int fd_ = -1;
+    bool peerClosed_ = false;
+    std::string in_;
+  };
+
+  // Runs the client's loop() until cond holds or a second of real time has
+  // passed.
+  template <typename Cond>
+  bool pump(MqttClient &mqtt, Cond cond)
+  {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+    while (!cond())
+    {
+      if (std::chrono::steady_clock::now() > deadline)
+        return false;
+      (void)mqtt.loop();
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+  }
+
+  bool publish(MqttClient &mqtt, const char *topic, const char *payload, uint8_t qos)
+  {
+    return mqtt.publish(topic, reinterpret_cast<const uint8_t *>(payload), strlen(payload), qos, false);
+  }
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_connect_and_connack()
+{
+  Broker broker;
+  SocketClient sock;
+  MqttClient mqtt;
+  mqtt.setClient(&sock);
+
+  TEST_ASSERT_EQUAL(1, sock.connect("localhost", broker.port()));
+  const MqttClient::Will will{"esp/kitchen/status", "offline", 1, true};
+  TEST_ASSERT_TRUE(mqtt.connect("esp-kitchen", "sensor", "secret", 60, true, &will, 2000));
+  TEST_ASSERT_TRUE(mqtt.connected());
+  TEST_ASSERT_EQUAL(0, mqtt.lastConnectResult());
+  TEST_ASSERT_FALSE(mqtt.sessionPresent());
+
+  const std::vector<Connect> seen = broker.connects();
+  TEST_ASSERT_EQUAL(1, seen.size());
+  TEST_ASSERT_EQUAL_STRING("esp-kitchen", seen[0].clientId.c_str());
+  TEST_ASSERT_EQUAL(60, seen[0].keepAliveSec);
+  TEST_ASSERT_TRUE(seen[0].cleanSession);
+  TEST_ASSERT_EQUAL_STRING("esp/kitchen/status", seen[0].willTopic.c_str());
+  TEST_ASSERT_EQUAL_STRING("offline", seen[0].willPayload.c_str());
+  TEST_ASSERT_TRUE(seen[0].willRetain);
+  TEST_ASSERT_EQUAL_STRING("sensor", seen[0].user.c_str());
+  TEST_ASSERT_EQUAL_STRING("secret", seen[0].password.c_str());
+
+  mqtt.disconnect();
+  TEST_ASSERT_FALSE(mqtt.connected());
+  TEST_ASSERT_TRUE(pump(mqtt, [&] { return broker.disconnects() == 1; }));
+
+  // Refused: 5 = not authorised.
+  broker.connackCode = 5;
+  TEST_ASSERT_EQUAL(1, sock.connect("localhost", broker.port()));
+  TEST_ASSERT_FALSE(mqtt.connect("esp-kitchen", "sensor", "wrong", 60, true, nullptr, 2000));
+  TEST_ASSERT_FALSE(mqtt.connected());
+  TEST_ASSERT_EQUAL(5, mqtt.lastConnectResult());
+}
+
+void test_publish_qos0_and_qos1()
+{
+  Broker broker;
+  SocketClient sock;
+  MqttClient mqtt;
+  mqtt.setClient(&sock);
+  TEST_ASSERT_EQUAL(1, sock.connect("localhost", broker.port()));
+  TEST_ASSERT_TRUE(mqtt.connect("esp-kitchen", "", "", 60, true, nullptr, 2000));
+
+  TEST_ASSERT_TRUE(publish(mqtt, "esp/kitchen/state", "{\"temperature_c\":21.50}", 0));
+  TEST_ASSERT_EQUAL(0, mqtt.inflight());
+  for (int i = 0; i < 3; ++i)
+    TEST_ASSERT_TRUE(publish(mqtt, "esp/kitchen/reading", "{\"seq\":1}", 1));
+  TEST_ASSERT_EQUAL(3, mqtt.inflight());
+
+  TEST_ASSERT_TRUE(pump(mqtt, [&] { return mqtt.acked() == 3; }));
+  TEST_ASSERT_EQUAL(0, mqtt.inflight());
+
+  const std::vector<Published> got = broker.published();
+  TEST_ASSERT_EQUAL(4, got.size());
+  TEST_ASSERT_EQUAL_STRING("esp/kitchen/state", got[0].topic.c_str());
+  TEST_ASSERT_EQUAL_STRING("{\"temperature_c\":21.50}", got[0].payload.c_str());
+  TEST_ASSERT_EQUAL(0, got[0].qos);
+  for (size_t i = 1; i < got.size(); ++i)
+  {
+    TEST_ASSERT_EQUAL(1, got[i].qos);
+    TEST_ASSERT_FALSE(got[i].dup);
+    TEST_ASSERT_NOT_EQUAL(0, got[i].packetId);
+    TEST_ASSERT_EQUAL_STRING("{\"seq\":1}", got[i].payload.c_str());
+  }
+  // Distinct packet ids for the messages in flight together.
+  TEST_ASSERT_TRUE(got[1].packetId != got[2].packetId && got[2].packetId != got[3].packetId &&
+                   got[1].packetId != got[3].packetId);
+  mqtt.disconnect();
+}
+
+void test_window_full()
+{
+  Broker broker;
+  broker.ackPublishes = false;
+  SocketClient sock;
+  MqttClient mqtt;
+  mqtt.setClient(&sock);
+  TEST_ASSERT_EQUAL(1, sock.connect("localhost", broker.port()));
+  TEST_ASSERT_TRUE(mqtt.connect("esp-kitchen", "", "", 60, true, nullptr, 2000));
+
+  for (size_t i = 0; i < MqttClient::kMaxInflight; ++i)
+    TEST_ASSERT_TRUE(publish(mqtt, "esp/kitchen/reading", "x", 1));
+  TEST_ASSERT_TRUE(mqtt.windowFull());
+  TEST_ASSERT_FALSE(publish(mqtt, "esp/kitchen/reading", "x", 1));
+  // QoS 0 does not use the window.
+  TEST_ASSERT_TRUE(publish(mqtt, "esp/kitchen/state", "x", 0));
+  mqtt.drop();
+}
+
+void test_keepalive_ping()
+{
+  Broker broker;
+  SocketClient sock;
+  MqttClient mqtt;
+  mqtt.setClient(&sock);
+  TEST_ASSERT_EQUAL(1, sock.connect("localhost", broker.port()));
+  TEST_ASSERT_TRUE(mqtt.connect("esp-kitchen", "", "", 10, true, nullptr, 2000));
+
+  // Half the keep-alive without sending anything: a PINGREQ goes out.
+  HostClock::advance(5000);
+  TEST_ASSERT_TRUE(mqtt.loop());
+  TEST_ASSERT_TRUE(pump(mqtt, [&] { return broker.pings() == 1; }));
+  // Once the PINGRESP is read, another half keep-alive does not drop the
+  // link (an unanswered ping would after a full one).
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  TEST_ASSERT_TRUE(mqtt.loop());
+  HostClock::advance(5000);
+  TEST_ASSERT_TRUE(mqtt.loop());
+  TEST_ASSERT_TRUE(mqtt.connected());
+  mqtt.disconnect();
+}
+
+void test_dup_resend_after_reconnect()
+{
+  Broker broker;
+  broker.ackPublishes = false;
+  broker.closeAfterPublishes = 3;
+  SocketClient sock;
+  MqttClient mqtt;
+  mqtt.setClient(&sock);
+  TEST_ASSERT_EQUAL(1, sock.connect("localhost", broker.port()));
+  TEST_ASSERT_TRUE(mqtt.connect("esp-kitchen", "", "", 60, false, nullptr, 2000));
+  TEST_ASSERT_FALSE(mqtt.sessionPresent());
+
+  const char *payloads[] = {"{\"seq\":1}", "{\"seq\":2}", "{\"seq\":3}"};
+  for (const char *p : payloads)
+    TEST_ASSERT_TRUE(publish(mqtt, "esp/kitchen/reading", p, 1));
+
+  // The broker closes the link without acknowledging anything.
+  TEST_ASSERT_TRUE(pump(mqtt, [&] { return !mqtt.connected(); }));
+  TEST_ASSERT_EQUAL(3, mqtt.inflight());
+  TEST_ASSERT_EQUAL(0, mqtt.acked());
+  // Still accepted while offline; it goes out with the resend.
+  TEST_ASSERT_TRUE(publish(mqtt, "esp/kitchen/reading", "{\"seq\":4}", 1));
+
+  broker.ackPublishes = true;
+  broker.closeAfterPublishes = 0;
+  TEST_ASSERT_EQUAL(1, sock.connect("localhost", broker.port()));
+  TEST_ASSERT_TRUE(mqtt.connect("esp-kitchen", "", "", 60, false, nullptr, 2000));
+  TEST_ASSERT_TRUE(mqtt.sessionPresent());
+  TEST_ASSERT_TRUE(mqtt.resendInflight());
+  TEST_ASSERT_EQUAL(4, mqtt.resent());
+  TEST_ASSERT_TRUE(pump(mqtt, [&] { return mqtt.acked() == 4; }));
+  TEST_ASSERT_EQUAL(0, mqtt.inflight());
+
+  const std::vector<Published> got = broker.published();
+  TEST_ASSERT_EQUAL(7, got.size());
+  for (size_t i = 0; i < 3; ++i)
+    TEST_ASSERT_FALSE(got[i].dup);
+  // The resend carries the same packet ids and payloads, flagged DUP.
+  std::set<uint16_t> firstIds;
+  for (size_t i = 0; i < 3; ++i)
+    firstIds.insert(got[i].packetId);
+  size_t resentOriginals = 0;
+  for (size_t i = 3; i < got.size(); ++i)
+  {
+    TEST_ASSERT_TRUE(got[i].dup);
+    TEST_ASSERT_EQUAL(1, got[i].qos);
+    if (firstIds.count(got[i].packetId))
+    {
+      ++resentOriginals;
+      for (size_t j = 0; j < 3; ++j)
+      {
+        if (got[j].packetId == got[i].packetId)
+          TEST_ASSERT_EQUAL_STRING(got[j].payload.c_str(), got[i].payload.c_str());
+      }
+    }
+    else
+    {
+      TEST_ASSERT_EQUAL_STRING("{\"seq\":4}", got[i].payload.c_str());
+    }
+  }
+  TEST_ASSERT_EQUAL(3, resentOriginals);
+  mqtt.disconnect();
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_connect_and_connack);
+  RUN_TEST(test_publish_qos0_and_qos1);
+  RUN_TEST(test_window_full);
+  RUN_TEST(test_keepalive_ping);
+  RUN_TEST(test_dup_resend_after_reconnect);
+  return UNITY_END();
+}
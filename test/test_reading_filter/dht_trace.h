@@ -0,0 +1,397 @@
+#pragma once
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// One hour of DHT22 readings at the sampler's 10 s interval, next to a
+// reference thermometer/hygrometer. Generated once from the DHT22's error
+// model and checked in, so every run replays the same samples:
+//
+//   - 0.1 °C / 0.1 %RH resolution, about 0.12 °C and 0.4 %RH of noise
+//   - single-read spikes that pass the checksum (+8, +12.8 or -6.4 °C; half
+//     of them with humidity stuck at 99.9 %)
+//   - dropouts (both values NaN, a failed read)
+//   - a real 3 °C drop and +6 %RH step at sample 200 (a window opened)
+//
+// spike marks the samples with a spiked temperature.
+
+namespace DhtTrace
+{
+  struct Sample
+  {
+    float temperatureC;
+    float humidityPct;
+    float referenceC;
+    float referencePct;
+    bool spike;
+  };
+
+  constexpr uint32_t kIntervalMs = 10000;
+  constexpr size_t kStepIndex = 200;
+
+  const Sample kSamples[] = {
+      {21.0f, 45.1f, 21.00f, 45.00f, false},
+      {21.0f, 45.2f, 21.00f, 45.03f, false},
+      {20.9f, 45.8f, 21.01f, 45.07f, false},
+      {21.1f, 45.0f, 21.01f, 45.10f, false},
+      {21.2f, 44.9f, 21.01f, 45.13f, false},
+      {21.0f, 45.0f, 21.02f, 45.17f, false},
+      {20.9f, 45.0f, 21.02f, 45.20f, false},
+      {21.1f, 44.8f, 21.02f, 45.23f, false},
+      {21.1f, 44.3f, 21.02f, 45.27f, false},
+      {21.0f, 44.8f, 21.03f, 45.30f, false},
+      {21.1f, 45.2f, 21.03f, 45.33f, false},
+      {21.2f, 45.2f, 21.03f, 45.36f, false},
+      {21.1f, 44.9f, 21.04f, 45.40f, false},
+      {21.2f, 45.6f, 21.04f, 45.43f, false},
+      {21.2f, 45.2f, 21.04f, 45.46f, false},
+      {20.9f, 45.8f, 21.05f, 45.49f, false},
+      {21.0f, 45.9f, 21.05f, 45.53f, false},
+      {21.0f, 46.1f, 21.05f, 45.56f, false},
+      {20.9f, 45.8f, 21.05f, 45.59f, false},
+      {21.4f, 46.3f, 21.06f, 45.62f, false},
+      {20.9f, 45.8f, 21.06f, 45.65f, false},
+      {21.2f, 45.5f, 21.06f, 45.69f, false},
+      {21.3f, 46.2f, 21.07f, 45.72f, false},
+      {21.0f, 45.6f, 21.07f, 45.75f, false},
+      {21.0f, 46.0f, 21.07f, 45.78f, false},
+      {20.9f, 45.7f, 21.07f, 45.81f, false},
+      {21.1f, 46.4f, 21.08f, 45.84f, false},
+      {20.9f, 46.3f, 21.08f, 45.87f, false},
+      {20.9f, 46.1f, 21.08f, 45.90f, false},
+      {20.9f, 45.8f, 21.09f, 45.93f, false},
+      {29.1f, 45.5f, 21.09f, 45.96f, true},
+      {21.1f, 45.3f, 21.09f, 45.99f, false},
+      {21.1f, 46.0f, 21.10f, 46.02f, false},
+      {21.0f, 45.8f, 21.10f, 46.05f, false},
+      {21.1f, 45.7f, 21.10f, 46.07f, false},
+      {21.4f, 46.4f, 21.11f, 46.10f, false},
+      {21.2f, 46.3f, 21.11f, 46.13f, false},
+      {21.2f, 46.0f, 21.11f, 46.16f, false},
+      {21.2f, 46.4f, 21.11f, 46.18f, false},
+      {21.0f, 46.8f, 21.12f, 46.21f, false},
+      {21.1f, 46.1f, 21.12f, 46.24f, false},
+      {21.1f, 46.2f, 21.12f, 46.26f, false},
+      {21.0f, 46.3f, 21.13f, 46.29f, false},
+      {21.1f, 45.9f, 21.13f, 46.31f, false},
+      {21.1f, 46.7f, 21.13f, 46.34f, false},
+      {21.1f, 46.2f, 21.14f, 46.36f, false},
+      {21.1f, 46.3f, 21.14f, 46.39f, false},
+      {21.1f, 46.3f, 21.14f, 46.41f, false},
+      {21.3f, 46.6f, 21.14f, 46.43f, false},
+      {NAN, NAN, 21.15f, 46.46f, false},
+      {21.4f, 46.4f, 21.15f, 46.48f, false},
+      {21.1f, 46.5f, 21.15f, 46.50f, false},
+      {21.3f, 46.0f, 21.16f, 46.52f, false},
+      {NAN, NAN, 21.16f, 46.55f, false},
+      {21.1f, 46.4f, 21.16f, 46.57f, false},
+      {21.3f, 46.3f, 21.16f, 46.59f, false},
+      {21.3f, 46.2f, 21.17f, 46.61f, false},
+      {21.2f, 46.9f, 21.17f, 46.63f, false},
+      {21.0f, 46.6f, 21.17f, 46.65f, false},
+      {21.3f, 46.6f, 21.18f, 46.66f, false},
+      {21.3f, 46.2f, 21.18f, 46.68f, false},
+      {21.1f, 46.5f, 21.18f, 46.70f, false},
+      {21.3f, 46.8f, 21.19f, 46.72f, false},
+      {20.9f, 46.6f, 21.19f, 46.73f, false},
+      {21.0f, 46.5f, 21.19f, 46.75f, false},
+      {21.0f, 46.7f, 21.20f, 46.77f, false},
+      {NAN, NAN, 21.20f, 46.78f, false},
+      {21.1f, 46.1f, 21.20f, 46.80f, false},
+      {21.2f, 46.9f, 21.20f, 46.81f, false},
+      {20.9f, 46.8f, 21.21f, 46.83f, false},
+      {21.1f, 47.1f, 21.21f, 46.84f, false},
+      {21.1f, 47.8f, 21.21f, 46.85f, false},
+      {21.2f, 46.0f, 21.22f, 46.86f, false},
+      {21.2f, 46.6f, 21.22f, 46.88f, false},
+      {21.2f, 47.0f, 21.22f, 46.89f, false},
+      {21.2f, 47.0f, 21.23f, 46.90f, false},
+      {21.3f, 47.2f, 21.23f, 46.91f, false},
+      {21.3f, 47.3f, 21.23f, 46.92f, false},
+      {21.1f, 47.5f, 21.23f, 46.93f, false},
+      {21.0f, 46.7f, 21.24f, 46.94f, false},
+      {34.0f, 47.0f, 21.24f, 46.94f, true},
+      {21.3f, 47.2f, 21.24f, 46.95f, false},
+      {21.3f, 47.1f, 21.25f, 46.96f, false},
+      {14.9f, 99.9f, 21.25f, 46.96f, true},
+      {21.1f, 47.4f, 21.25f, 46.97f, false},
+      {21.4f, 47.4f, 21.25f, 46.98f, false},
+      {21.1f, 47.2f, 21.26f, 46.98f, false},
+      {21.0f, 47.2f, 21.26f, 46.99f, false},
+      {21.3f, 47.6f, 21.26f, 46.99f, false},
+      {21.4f, 47.5f, 21.27f, 46.99f, false},
+      {21.4f, 47.2f, 21.27f, 46.99f, false},
+      {21.3f, 47.2f, 21.27f, 47.00f, false},
+      {21.4f, 47.6f, 21.28f, 47.00f, false},
+      {21.2f, 46.9f, 21.28f, 47.00f, false},
+      {21.3f, 46.6f, 21.28f, 47.00f, false},
+      {21.3f, 46.4f, 21.29f, 47.00f, false},
+      {21.3f, 46.6f, 21.29f, 47.00f, false},
+      {21.3f, 47.3f, 21.29f, 47.00f, false},
+      {21.3f, 47.3f, 21.29f, 47.00f, false},
+      {21.4f, 46.8f, 21.30f, 46.99f, false},
+      {21.1f, 47.2f, 21.30f, 46.99f, false},
+      {34.2f, 99.9f, 21.30f, 46.99f, true},
+      {21.3f, 46.9f, 21.31f, 46.98f, false},
+      {21.2f, 47.6f, 21.31f, 46.98f, false},
+      {21.2f, 46.4f, 21.31f, 46.97f, false},
+      {21.4f, 47.2f, 21.32f, 46.97f, false},
+      {21.3f, 47.0f, 21.32f, 46.96f, false},
+      {21.3f, 46.7f, 21.32f, 46.95f, false},
+      {21.3f, 46.9f, 21.32f, 46.95f, false},
+      {21.2f, 47.3f, 21.33f, 46.94f, false},
+      {21.5f, 47.2f, 21.33f, 46.93f, false},
+      {21.2f, 47.1f, 21.33f, 46.92f, false},
+      {21.3f, 46.8f, 21.34f, 46.91f, false},
+      {21.4f, 46.8f, 21.34f, 46.90f, false},
+      {21.5f, 47.2f, 21.34f, 46.89f, false},
+      {21.5f, 46.6f, 21.34f, 46.88f, false},
+      {21.2f, 47.1f, 21.35f, 46.87f, false},
+      {21.4f, 46.5f, 21.35f, 46.86f, false},
+      {21.3f, 47.3f, 21.35f, 46.85f, false},
+      {21.6f, 46.3f, 21.36f, 46.83f, false},
+      {21.5f, 46.5f, 21.36f, 46.82f, false},
+      {21.5f, 47.6f, 21.36f, 46.80f, false},
+      {21.3f, 46.9f, 21.37f, 46.79f, false},
+      {21.2f, 46.2f, 21.37f, 46.77f, false},
+      {21.3f, 47.3f, 21.37f, 46.76f, false},
+      {21.4f, 47.0f, 21.38f, 46.74f, false},
+      {21.6f, 46.9f, 21.38f, 46.73f, false},
+      {21.4f, 46.3f, 21.38f, 46.71f, false},
+      {21.4f, 46.7f, 21.38f, 46.69f, false},
+      {21.4f, 46.0f, 21.39f, 46.67f, false},
+      {21.3f, 47.2f, 21.39f, 46.66f, false},
+      {21.4f, 46.8f, 21.39f, 46.64f, false},
+      {21.4f, 46.9f, 21.40f, 46.62f, false},
+      {21.6f, 47.0f, 21.40f, 46.60f, false},
+      {21.6f, 46.2f, 21.40f, 46.58f, false},
+      {NAN, NAN, 21.41f, 46.56f, false},
+      {21.5f, 46.1f, 21.41f, 46.53f, false},
+      {21.4f, 46.5f, 21.41f, 46.51f, false},
+      {21.3f, 47.2f, 21.41f, 46.49f, false},
+      {21.5f, 46.7f, 21.42f, 46.47f, false},
+      {21.4f, 46.8f, 21.42f, 46.45f, false},
+      {21.5f, 46.9f, 21.42f, 46.42f, false},
+      {21.5f, 46.1f, 21.43f, 46.40f, false},
+      {21.4f, 46.0f, 21.43f, 46.38f, false},
+      {21.5f, 46.6f, 21.43f, 46.35f, false},
+      {21.4f, 46.0f, 21.43f, 46.33f, false},
+      {21.4f, 46.5f, 21.44f, 46.30f, false},
+      {21.2f, 46.8f, 21.44f, 46.28f, false},
+      {21.5f, 46.5f, 21.44f, 46.25f, false},
+      {21.7f, 46.0f, 21.45f, 46.22f, false},
+      {21.6f, 46.3f, 21.45f, 46.20f, false},
+      {21.5f, 46.4f, 21.45f, 46.17f, false},
+      {21.6f, 46.1f, 21.46f, 46.14f, false},
+      {21.5f, 45.7f, 21.46f, 46.12f, false},
+      {21.4f, 46.1f, 21.46f, 46.09f, false},
+      {21.5f, 46.4f, 21.46f, 46.06f, false},
+      {21.5f, 46.1f, 21.47f, 46.03f, false},
+      {21.5f, 46.5f, 21.47f, 46.00f, false},
+      {21.5f, 46.2f, 21.47f, 45.97f, false},
+      {21.4f, 45.4f, 21.48f, 45.94f, false},
+      {21.5f, 45.9f, 21.48f, 45.91f, false},
+      {21.5f, 45.5f, 21.48f, 45.88f, false},
+      {21.3f, 46.2f, 21.49f, 45.85f, false},
+      {21.6f, 46.1f, 21.49f, 45.82f, false},
+      {21.4f, 46.0f, 21.49f, 45.79f, false},
+      {21.6f, 46.0f, 21.50f, 45.76f, false},
+      {21.6f, 45.1f, 21.50f, 45.73f, false},
+      {21.5f, 46.1f, 21.50f, 45.70f, false},
+      {21.5f, 46.3f, 21.50f, 45.67f, false},
+      {34.3f, 45.8f, 21.51f, 45.64f, true},
+      {21.3f, 46.0f, 21.51f, 45.61f, false},
+      {21.5f, 45.1f, 21.51f, 45.57f, false},
+      {15.1f, 45.3f, 21.52f, 45.54f, true},
+      {21.3f, 45.6f, 21.52f, 45.51f, false},
+      {21.7f, 45.4f, 21.52f, 45.48f, false},
+      {21.6f, 45.4f, 21.52f, 45.45f, false},
+      {21.5f, 45.6f, 21.53f, 45.41f, false},
+      {21.4f, 45.1f, 21.53f, 45.38f, false},
+      {21.3f, 45.6f, 21.53f, 45.35f, false},
+      {15.1f, 99.9f, 21.54f, 45.32f, true},
+      {21.5f, 44.3f, 21.54f, 45.28f, false},
+      {21.4f, 45.1f, 21.54f, 45.25f, false},
+      {NAN, NAN, 21.55f, 45.22f, false},
+      {21.6f, 44.5f, 21.55f, 45.18f, false},
+      {21.7f, 45.3f, 21.55f, 45.15f, false},
+      {21.4f, 45.6f, 21.55f, 45.12f, false},
+      {21.5f, 45.1f, 21.56f, 45.08f, false},
+      {21.6f, 45.3f, 21.56f, 45.05f, false},
+      {21.6f, 45.1f, 21.56f, 45.02f, false},
+      {21.5f, 43.9f, 21.57f, 44.98f, false},
+      {21.5f, 44.9f, 21.57f, 44.95f, false},
+      {21.6f, 45.0f, 21.57f, 44.92f, false},
+      {21.6f, 44.6f, 21.58f, 44.88f, false},
+      {21.4f, 45.8f, 21.58f, 44.85f, false},
+      {21.8f, 44.0f, 21.58f, 44.82f, false},
+      {21.6f, 45.2f, 21.59f, 44.78f, false},
+      {21.6f, 44.5f, 21.59f, 44.75f, false},
+      {21.6f, 45.0f, 21.59f, 44.72f, false},
+      {21.6f, 44.2f, 21.59f, 44.68f, false},
+      {21.6f, 45.0f, 21.60f, 44.65f, false},
+      {18.6f, 51.0f, 18.60f, 50.62f, false},
+      {18.6f, 51.2f, 18.60f, 50.59f, false},
+      {18.4f, 49.9f, 18.61f, 50.55f, false},
+      {18.7f, 50.8f, 18.61f, 50.52f, false},
+      {18.6f, 50.0f, 18.61f, 50.49f, false},
+      {18.4f, 50.5f, 18.61f, 50.46f, false},
+      {18.5f, 50.5f, 18.62f, 50.42f, false},
+      {18.4f, 50.4f, 18.62f, 50.39f, false},
+      {18.5f, 50.3f, 18.62f, 50.36f, false},
+      {18.6f, 50.5f, 18.62f, 50.33f, false},
+      {NAN, NAN, 18.62f, 50.30f, false},
+      {18.7f, 50.0f, 18.63f, 50.27f, false},
+      {12.3f, 99.9f, 18.63f, 50.24f, true},
+      {18.8f, 50.5f, 18.63f, 50.21f, false},
+      {18.6f, 50.3f, 18.64f, 50.18f, false},
+      {18.9f, 50.4f, 18.64f, 50.14f, false},
+      {18.8f, 49.7f, 18.64f, 50.11f, false},
+      {18.7f, 49.5f, 18.64f, 50.09f, false},
+      {18.6f, 50.5f, 18.65f, 50.06f, false},
+      {18.7f, 50.2f, 18.65f, 50.03f, false},
+      {18.5f, 49.4f, 18.65f, 50.00f, false},
+      {18.9f, 49.6f, 18.65f, 49.97f, false},
+      {18.5f, 50.2f, 18.66f, 49.94f, false},
+      {18.6f, 49.1f, 18.66f, 49.91f, false},
+      {18.8f, 50.5f, 18.66f, 49.88f, false},
+      {18.5f, 50.1f, 18.66f, 49.86f, false},
+      {18.6f, 50.3f, 18.67f, 49.83f, false},
+      {18.7f, 50.2f, 18.67f, 49.80f, false},
+      {18.7f, 49.2f, 18.67f, 49.78f, false},
+      {18.7f, 50.2f, 18.67f, 49.75f, false},
+      {18.5f, 49.1f, 18.68f, 49.72f, false},
+      {18.6f, 49.4f, 18.68f, 49.70f, false},
+      {18.6f, 49.4f, 18.68f, 49.67f, false},
+      {18.7f, 49.5f, 18.68f, 49.65f, false},
+      {18.6f, 49.8f, 18.69f, 49.62f, false},
+      {18.7f, 49.7f, 18.69f, 49.60f, false},
+      {18.7f, 49.3f, 18.69f, 49.58f, false},
+      {18.8f, 50.3f, 18.69f, 49.55f, false},
+      {18.8f, 50.1f, 18.70f, 49.53f, false},
+      {18.7f, 50.0f, 18.70f, 49.51f, false},
+      {18.9f, 49.9f, 18.70f, 49.49f, false},
+      {18.8f, 49.5f, 18.70f, 49.46f, false},
+      {18.6f, 49.7f, 18.71f, 49.44f, false},
+      {18.8f, 48.9f, 18.71f, 49.42f, false},
+      {18.5f, 48.7f, 18.71f, 49.40f, false},
+      {18.7f, 48.9f, 18.71f, 49.38f, false},
+      {18.7f, 49.5f, 18.71f, 49.36f, false},
+      {18.3f, 49.9f, 18.72f, 49.34f, false},
+      {NAN, NAN, 18.72f, 49.33f, false},
+      {18.5f, 48.4f, 18.72f, 49.31f, false},
+      {18.8f, 50.0f, 18.73f, 49.29f, false},
+      {18.9f, 49.1f, 18.73f, 49.27f, false},
+      {18.8f, 49.2f, 18.73f, 49.26f, false},
+      {18.7f, 49.3f, 18.73f, 49.24f, false},
+      {18.8f, 49.2f, 18.74f, 49.23f, false},
+      {18.7f, 49.1f, 18.74f, 49.21f, false},
+      {18.8f, 48.9f, 18.74f, 49.20f, false},
+      {18.7f, 49.3f, 18.74f, 49.18f, false},
+      {18.7f, 49.4f, 18.75f, 49.17f, false},
+      {18.6f, 48.3f, 18.75f, 49.15f, false},
+      {18.7f, 49.1f, 18.75f, 49.14f, false},
+      {18.6f, 48.9f, 18.75f, 49.13f, false},
+      {19.1f, 48.5f, 18.76f, 49.12f, false},
+      {19.0f, 48.8f, 18.76f, 49.11f, false},
+      {18.7f, 49.5f, 18.76f, 49.10f, false},
+      {18.7f, 49.0f, 18.76f, 49.09f, false},
+      {18.8f, 49.1f, 18.77f, 49.08f, false},
+      {18.9f, 49.1f, 18.77f, 49.07f, false},
+      {18.7f, 48.7f, 18.77f, 49.06f, false},
+      {18.8f, 49.5f, 18.77f, 49.05f, false},
+      {18.9f, 49.0f, 18.78f, 49.04f, false},
+      {12.4f, 49.1f, 18.78f, 49.04f, true},
+      {18.9f, 48.7f, 18.78f, 49.03f, false},
+      {18.8f, 48.4f, 18.78f, 49.03f, false},
+      {19.0f, 49.3f, 18.79f, 49.02f, false},
+      {19.0f, 48.7f, 18.79f, 49.02f, false},
+      {12.5f, 48.6f, 18.79f, 49.01f, true},
+      {18.8f, 49.2f, 18.79f, 49.01f, false},
+      {18.9f, 49.1f, 18.80f, 49.01f, false},
+      {18.8f, 49.0f, 18.80f, 49.00f, false},
+      {18.6f, 48.5f, 18.80f, 49.00f, false},
+      {18.8f, 49.1f, 18.80f, 49.00f, false},
+      {18.7f, 48.3f, 18.80f, 49.00f, false},
+      {18.9f, 49.0f, 18.81f, 49.00f, false},
+      {18.8f, 48.7f, 18.81f, 49.00f, false},
+      {19.0f, 49.1f, 18.81f, 49.00f, false},
+      {18.6f, 49.4f, 18.82f, 49.00f, false},
+      {18.9f, 49.2f, 18.82f, 49.01f, false},
+      {18.8f, 48.5f, 18.82f, 49.01f, false},
+      {18.8f, 49.3f, 18.82f, 49.01f, false},
+      {18.8f, 49.6f, 18.83f, 49.01f, false},
+      {18.8f, 48.5f, 18.83f, 49.02f, false},
+      {18.9f, 49.0f, 18.83f, 49.02f, false},
+      {18.9f, 48.9f, 18.83f, 49.03f, false},
+      {18.9f, 49.1f, 18.84f, 49.04f, false},
+      {18.9f, 48.5f, 18.84f, 49.04f, false},
+      {18.7f, 49.0f, 18.84f, 49.05f, false},
+      {18.7f, 48.6f, 18.84f, 49.06f, false},
+      {18.6f, 49.1f, 18.85f, 49.06f, false},
+      {18.9f, 48.8f, 18.85f, 49.07f, false},
+      {18.9f, 49.3f, 18.85f, 49.08f, false},
+      {18.9f, 49.1f, 18.85f, 49.09f, false},
+      {18.9f, 49.5f, 18.86f, 49.10f, false},
+      {18.9f, 48.7f, 18.86f, 49.11f, false},
+      {18.7f, 49.2f, 18.86f, 49.12f, false},
+      {18.7f, 49.3f, 18.86f, 49.14f, false},
+      {18.8f, 48.7f, 18.87f, 49.15f, false},
+      {12.4f, 49.3f, 18.87f, 49.16f, true},
+      {19.1f, 49.2f, 18.87f, 49.17f, false},
+      {18.8f, 49.1f, 18.87f, 49.19f, false},
+      {18.9f, 49.6f, 18.88f, 49.20f, false},
+      {18.7f, 49.0f, 18.88f, 49.22f, false},
+      {18.8f, 48.9f, 18.88f, 49.23f, false},
+      {18.8f, 49.9f, 18.88f, 49.25f, false},
+      {18.9f, 49.3f, 18.89f, 49.27f, false},
+      {18.7f, 48.3f, 18.89f, 49.28f, false},
+      {19.0f, 49.6f, 18.89f, 49.30f, false},
+      {18.7f, 49.0f, 18.89f, 49.32f, false},
+      {19.2f, 49.0f, 18.90f, 49.34f, false},
+      {18.8f, 48.9f, 18.90f, 49.35f, false},
+      {18.8f, 50.0f, 18.90f, 49.37f, false},
+      {18.7f, 49.2f, 18.90f, 49.39f, false},
+      {18.9f, 50.0f, 18.91f, 49.41f, false},
+      {18.5f, 50.3f, 18.91f, 49.43f, false},
+      {18.9f, 49.1f, 18.91f, 49.45f, false},
+      {18.7f, 49.8f, 18.91f, 49.48f, false},
+      {19.1f, 48.6f, 18.92f, 49.50f, false},
+      {18.8f, 49.7f, 18.92f, 49.52f, false},
+      {19.0f, 49.4f, 18.92f, 49.54f, false},
+      {18.9f, 49.9f, 18.92f, 49.57f, false},
+      {19.0f, 49.9f, 18.93f, 49.59f, false},
+      {19.0f, 50.5f, 18.93f, 49.61f, false},
+      {18.9f, 49.8f, 18.93f, 49.64f, false},
+      {18.9f, 49.7f, 18.93f, 49.66f, false},
+      {19.3f, 49.3f, 18.94f, 49.69f, false},
+      {19.0f, 49.8f, 18.94f, 49.71f, false},
+      {19.0f, 49.8f, 18.94f, 49.74f, false},
+      {18.9f, 49.5f, 18.94f, 49.76f, false},
+      {19.0f, 49.5f, 18.95f, 49.79f, false},
+      {19.0f, 49.8f, 18.95f, 49.82f, false},
+      {19.1f, 49.9f, 18.95f, 49.84f, false},
+      {19.2f, 50.0f, 18.95f, 49.87f, false},
+      {18.9f, 49.9f, 18.96f, 49.90f, false},
+      {12.5f, 49.7f, 18.96f, 49.93f, true},
+      {18.9f, 50.1f, 18.96f, 49.95f, false},
+      {18.9f, 50.2f, 18.96f, 49.98f, false},
+      {NAN, NAN, 18.96f, 50.01f, false},
+      {19.1f, 49.8f, 18.97f, 50.04f, false},
+      {18.9f, 50.3f, 18.97f, 50.07f, false},
+      {19.0f, 50.5f, 18.97f, 50.10f, false},
+      {18.8f, 50.7f, 18.98f, 50.13f, false},
+      {18.9f, 49.8f, 18.98f, 50.16f, false},
+      {19.1f, 49.8f, 18.98f, 50.19f, false},
+      {18.9f, 50.6f, 18.98f, 50.22f, false},
+      {18.9f, 50.5f, 18.99f, 50.25f, false},
+      {19.2f, 50.3f, 18.99f, 50.28f, false},
+      {19.0f, 50.2f, 18.99f, 50.31f, false},
+      {19.0f, 49.9f, 18.99f, 50.35f, false},
+      {18.9f, 50.0f, 19.00f, 50.38f, false},
+      {19.1f, 50.5f, 19.00f, 50.41f, false},
+  };
+
+  constexpr size_t kCount = sizeof(kSamples) / sizeof(kSamples[0]);
+}
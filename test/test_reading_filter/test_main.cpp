@@ -0,0 +1,206 @@
+// ReadingFilter against a fixed DHT22 trace (dht_trace.h): how many spikes
+// it rejects, how far its output is from the reference, and how quickly it
+// follows a real step. The settings are the ones config.h.example suggests
+// for a DHT22 (10 °C/min, 30 %RH/min), with a 3-sample median.
+
+#include <Arduino.h>
+#include <unity.h>
+
+#include "ReadingFilter.h"
+#include "dht_trace.h"
+
+namespace
+{
+  // Within this of the reference the output counts as having followed the
+  // step: noise plus resolution of the sensor.
+  constexpr float kSettledC = 0.3f;
+
+  struct Replay
+  {
+    float filteredC[DhtTrace::kCount];
+    float filteredPct[DhtTrace::kCount];
+    uint8_t rejected[DhtTrace::kCount];
+  };
+
+  ReadingFilter::Settings dhtSettings()
+  {
+    ReadingFilter::Settings s;
+    s.median = 3;
+    s.maxRateTempCPerMin = 10.0f;
+    s.maxRateHumidityPctPerMin = 30.0f;
+    return s;
+  }
+
+  void replay(const ReadingFilter::Settings &s, Replay &out)
+  {
+    ReadingFilter filter;
+    uint32_t now = 0;
+    for (size_t i = 0; i < DhtTrace::kCount; ++i)
+    {
+      now += DhtTrace::kIntervalMs;
+      float t = DhtTrace::kSamples[i].temperatureC;
+      float h = DhtTrace::kSamples[i].humidityPct;
+      out.rejected[i] = filter.apply(s, t, h, now);
+      out.filteredC[i] = t;
+      out.filteredPct[i] = h;
+    }
+  }
+
+  // Mean absolute temperature error over the valid samples, skipping the
+  // samples right after the step (those are measured by the recovery test).
+  float temperatureMae(const float *values)
+  {
+    double sum = 0;
+    size_t n = 0;
+    for (size_t i = 0; i < DhtTrace::kCount; ++i)
+    {
+      if (isnan(values[i]) || (i >= DhtTrace::kStepIndex && i < DhtTrace::kStepIndex + 6))
+        continue;
+      sum += fabs(values[i] - DhtTrace::kSamples[i].referenceC);
+      ++n;
+    }
+    return static_cast<float>(sum / n);
+  }
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_rejects_spikes()
+{
+  Replay r;
+  replay(dhtSettings(), r);
+
+  size_t spikes = 0, caught = 0, falseRejects = 0, clean = 0;
+  for (size_t i = 0; i < DhtTrace::kCount; ++i)
+  {
+    const DhtTrace::Sample &s = DhtTrace::kSamples[i];
+    const bool rejectedT = r.rejected[i] & ReadingFilter::kRejectedTemperature;
+    if (s.spike)
+    {
+      ++spikes;
+      caught += rejectedT ? 1 : 0;
+      // The spike never reaches the output.
+      TEST_ASSERT_FLOAT_WITHIN(1.0f, s.referenceC, r.filteredC[i]);
+    }
+    else if (!isnan(s.temperatureC) && (i < DhtTrace::kStepIndex || i >= DhtTrace::kStepIndex + 4))
+    {
+      ++clean;
+      falseRejects += rejectedT ? 1 : 0;
+    }
+    if (s.humidityPct > 99.0f)
+      TEST_ASSERT_TRUE(r.rejected[i] & ReadingFilter::kRejectedHumidity);
+  }
+
+  char line[96];
+  snprintf(line, sizeof(line), "spikes rejected: %u of %u; clean samples rejected: %u of %u",
+           static_cast<unsigned>(caught), static_cast<unsigned>(spikes), static_cast<unsigned>(falseRejects),
+           static_cast<unsigned>(clean));
+  TEST_MESSAGE(line);
+  TEST_ASSERT_GREATER_THAN(10, spikes);
+  TEST_ASSERT_EQUAL_UINT32(spikes, caught);
+  TEST_ASSERT_EQUAL_UINT32(0, falseRejects);
+}
+
+void test_mean_absolute_error()
+{
+  float raw[DhtTrace::kCount];
+  for (size_t i = 0; i < DhtTrace::kCount; ++i)
+    raw[i] = DhtTrace::kSamples[i].temperatureC;
+  Replay r;
+  replay(dhtSettings(), r);
+
+  const float before = temperatureMae(raw);
+  const float after = temperatureMae(r.filteredC);
+  char line[96];
+  snprintf(line, sizeof(line), "temperature MAE: raw %.3f °C, filtered %.3f °C", static_cast<double>(before),
+           static_cast<double>(after));
+  TEST_MESSAGE(line);
+  TEST_ASSERT_LESS_THAN(0.1f, after);
+  TEST_ASSERT_LESS_THAN(before / 3.0f, after);
+
+  // Humidity: the 99.9 % readings dominate the raw error.
+  double sum = 0;
+  size_t n = 0;
+  for (size_t i = 0; i < DhtTrace::kCount; ++i)
+  {
+    if (isnan(r.filteredPct[i]) || (i >= DhtTrace::kStepIndex && i < DhtTrace::kStepIndex + 6))
+      continue;
+    sum += fabs(r.filteredPct[i] - DhtTrace::kSamples[i].referencePct);
+    ++n;
+  }
+  TEST_ASSERT_LESS_THAN(0.6f, static_cast<float>(sum / n));
+}
+
+void test_step_recovery()
+{
+  Replay r;
+  replay(dhtSettings(), r);
+
+  // The step is more than the rate limit allows, so it is first held back
+  // like a spike; after kMaxRejects samples the filter restarts from it.
+  size_t settled = DhtTrace::kCount;
+  for (size_t i = DhtTrace::kStepIndex; i < DhtTrace::kCount; ++i)
+  {
+    if (fabsf(r.filteredC[i] - DhtTrace::kSamples[i].referenceC) <= kSettledC)
+    {
+      settled = i;
+      break;
+    }
+  }
+  const size_t samples = settled - DhtTrace::kStepIndex;
+  char line[96];
+  snprintf(line, sizeof(line), "step followed after %u samples (%u s)", static_cast<unsigned>(samples),
+           static_cast<unsigned>(samples * DhtTrace::kIntervalMs / 1000));
+  TEST_MESSAGE(line);
+  TEST_ASSERT_EQUAL_UINT32(ReadingFilter::kMaxRejects, samples);
+  // And stays there.
+  for (size_t i = settled; i < settled + 20; ++i)
+  {
+    if (!isnan(r.filteredC[i]))
+      TEST_ASSERT_FLOAT_WITHIN(kSettledC, DhtTrace::kSamples[i].referenceC, r.filteredC[i]);
+  }
+}
+
+void test_dropouts_pass_through()
+{
+  Replay r;
+  replay(dhtSettings(), r);
+  for (size_t i = 0; i < DhtTrace::kCount; ++i)
+  {
+    const DhtTrace::Sample &s = DhtTrace::kSamples[i];
+    if (!isnan(s.temperatureC))
+      continue;
+    TEST_ASSERT_TRUE(isnan(r.filteredC[i]) && isnan(r.filteredPct[i]));
+    TEST_ASSERT_EQUAL_UINT8(0, r.rejected[i]);
+    // The gap widens the allowance but does not reset the estimate.
+    if (i + 1 < DhtTrace::kCount && !DhtTrace::kSamples[i + 1].spike && !isnan(DhtTrace::kSamples[i + 1].temperatureC))
+      TEST_ASSERT_FLOAT_WITHIN(0.5f, DhtTrace::kSamples[i + 1].referenceC, r.filteredC[i + 1]);
+  }
+}
+
+void test_defaults_pass_through()
+{
+  Replay r;
+  replay(ReadingFilter::Settings(), r);
+  for (size_t i = 0; i < DhtTrace::kCount; ++i)
+  {
+    const DhtTrace::Sample &s = DhtTrace::kSamples[i];
+    TEST_ASSERT_EQUAL_UINT8(0, r.rejected[i]);
+    if (isnan(s.temperatureC))
+      TEST_ASSERT_TRUE(isnan(r.filteredC[i]));
+    else
+      TEST_ASSERT_EQUAL_FLOAT(s.temperatureC, r.filteredC[i]);
+  }
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_rejects_spikes);
+  RUN_TEST(test_mean_absolute_error);
+  RUN_TEST(test_step_recovery);
+  RUN_TEST(test_dropouts_pass_through);
+  RUN_TEST(test_defaults_pass_through);
+  return UNITY_END();
+}
@@ -0,0 +1,345 @@
+// The sensor path from driver to stamped reading, on the host: the
+// simulated driver, SampleCache, ReadingFilter, SensorStats (WindowStats),
+// Deadband and Sequence, in the order SensorTask's readLocked() and
+// sampleChannel() run them. The glue itself (AppConfig, Metrics, the
+// uploader) stays on the device; the helpers below repeat its steps with
+// the settings passed in.
+
+#include <Arduino.h>
+#include <unity.h>
+
+#include "Deadband.h"
+#include "ReadingFilter.h"
+#include "Reading.h"
+#include "SampleCache.h"
+#include "SensorChannels.h"
+#include "SensorStats.h"
+#include "Sequence.h"
+#include "SimulatedDriver.h"
+
+namespace
+{
+  constexpr uint32_t kIntervalMs = 10000;
+
+  struct Pipeline
+  {
+    ReadingFilter::Settings filter;
+    float deadbandTempC = 0.0f;
+    float deadbandHumidityPct = 0.0f;
+    uint32_t maxSilenceMs = 0;
+
+    ReadingFilter filterState;
+    Deadband deadband;
+    uint32_t rejected = 0;
+    uint32_t failed = 0;
+  };
+
+  // sampleChannel() after the read, for channel 0; true when the reading
+  // is reported.
+  bool process(Pipeline &p, bool ok, float t, float h, Reading &r)
+  {
+    if (!ok)
+    {
+      ++p.failed;
+      return false;
+    }
+    r.timestamp = 0;
+    r.sampledMs = millis();
+    r.channel = 0;
+    if (p.filterState.apply(p.filter, t, h, r.sampledMs))
+      ++p.rejected;
+    r.temperatureC = t;
+    r.humidityPct = h;
+    SensorStats::record(0, t, h, r.sampledMs);
+    if (!p.deadband.shouldReport(t, h, r.sampledMs, p.deadbandTempC, p.deadbandHumidityPct, p.maxSilenceMs))
+      return false;
+    Sequence::stamp(r);
+    return true;
+  }
+
+  bool sample(SensorDriver &drv, Pipeline &p, Reading &r)
+  {
+    float t = NAN, h = NAN;
+    const bool ok = drv.read(t, h);
+    return process(p, ok, t, h, r);
+  }
+
+  SampleCache::Entry entry(bool ok, float t, float h)
+  {
+    SampleCache::Entry e{};
+    e.ok = ok;
+    e.temperatureC = t;
+    e.humidityPct = h;
+    e.takenMs = millis();
+    return e;
+  }
+
+  // A GET /read of channel 0 that had to read the sensor.
+  void pollerRead(SensorDriver &drv, SampleCache &cache)
+  {
+    float t = NAN, h = NAN;
+    const bool ok = drv.read(t, h);
+    cache.store(0, entry(ok, t, h), false);
+  }
+
+  enum class Cycle
+  {
+    Read,    // the sampler read the sensor itself
+    Reused,  // it took the poller's sample as its measurement
+    Skipped  // it had processed the cached sample already
+  };
+
+  // One sampler cycle of channel 0 for a driver that needs restMs between
+  // reads: readLocked(forSampler) and then sampleChannel(). reported is set
+  // when a reading comes out.
+  Cycle samplerCycle(SensorDriver &drv, SampleCache &cache, uint32_t restMs, Pipeline &p, Reading &r, bool &reported)
+  {
+    reported = false;
+    SampleCache::Entry e;
+    switch (cache.claim(0, restMs, millis(), e))
+    {
+    case SampleCache::Claim::Fresh:
+      reported = process(p, e.ok, e.temperatureC, e.humidityPct, r);
+      return Cycle::Reused;
+    case SampleCache::Claim::Seen:
+      return Cycle::Skipped;
+    case SampleCache::Claim::None:
+    default:
+      break;
+    }
+    float t = NAN, h = NAN;
+    const bool ok = drv.read(t, h);
+    cache.store(0, entry(ok, t, h), true);
+    reported = process(p, ok, t, h, r);
+    return Cycle::Read;
+  }
+
+  bool initialised = false;
+}
+
+void setUp()
+{
+  if (!initialised)
+  {
+    SensorChannels::init();
+    SensorStats::init();
+    Sequence::init();
+    initialised = true;
+  }
+}
+
+void tearDown() {}
+
+void test_script_steps()
+{
+  SimulatedDriver drv("21.5,40; 22,nan ;fail@2000;garbage;23,41@120");
+  TEST_ASSERT_EQUAL_UINT32(4, drv.steps());
+
+  float t = 0, h = 0;
+  TEST_ASSERT_TRUE(drv.read(t, h));
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 21.5f, t);
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 40.0f, h);
+
+  TEST_ASSERT_FALSE(drv.read(t, h));
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 22.0f, t);
+  TEST_ASSERT_TRUE(isnan(h));
+
+  // Scripted latency runs on the simulated clock.
+  const uint32_t before = millis();
+  TEST_ASSERT_FALSE(drv.read(t, h));
+  TEST_ASSERT_TRUE(isnan(t) && isnan(h));
+  TEST_ASSERT_EQUAL_UINT32(2000, millis() - before);
+
+  TEST_ASSERT_TRUE(drv.read(t, h));
+  TEST_ASSERT_EQUAL_UINT32(2120, millis() - before);
+
+  // The script loops.
+  TEST_ASSERT_TRUE(drv.read(t, h));
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 21.5f, t);
+  TEST_ASSERT_EQUAL_UINT32(5, drv.reads());
+}
+
+void test_spike_deadband_and_sequence()
+{
+  // Flat, one spike, flat, a failed read, then a real move of 1 °C.
+  SimulatedDriver drv("21.0,40;21.02,40;35.0,40;21.01,40.1;fail;21.03,40;22.0,40;22.0,40");
+  Pipeline p;
+  p.filter.maxRateTempCPerMin = 6.0f; // 1 °C per 10 s sample
+  p.filter.maxRateHumidityPctPerMin = 6.0f;
+  p.deadbandTempC = 0.2f;
+  p.deadbandHumidityPct = 1.0f;
+
+  float reportedT[8];
+  uint32_t reportedSeq[8];
+  size_t reported = 0;
+  for (size_t i = 0; i < drv.steps(); ++i)
+  {
+    HostClock::advance(kIntervalMs);
+    Reading r{};
+    if (sample(drv, p, r))
+    {
+      TEST_ASSERT_EQUAL_UINT32(Sequence::bootId(), r.bootId);
+      reportedT[reported] = r.temperatureC;
+      reportedSeq[reported++] = r.seq;
+    }
+  }
+
+  TEST_ASSERT_EQUAL_UINT32(1, p.rejected);
+  TEST_ASSERT_EQUAL_UINT32(1, p.failed);
+  // The first reading, then the step; the spike and the jitter stay out.
+  TEST_ASSERT_EQUAL_UINT32(2, reported);
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 21.0f, reportedT[0]);
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 22.0f, reportedT[1]);
+  // Numbered only when reported, so there is no gap.
+  TEST_ASSERT_EQUAL_UINT32(reportedSeq[0] + 1, reportedSeq[1]);
+
+  // The windows saw every filtered sample, but not the spike.
+  WindowStats::Summary s;
+  TEST_ASSERT_TRUE(SensorStats::summary(0, 0, s));
+  TEST_ASSERT_EQUAL_UINT32(300, s.windowSec);
+  TEST_ASSERT_EQUAL_UINT32(7, s.temperature.count);
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 22.0f, s.temperature.max);
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 21.0f, s.temperature.min);
+}
+
+void test_wave_through_windows()
+{
+  // A day of the generated wave at one sample a minute: the 1 h window
+  // holds the last 60 samples, the 24 h window about all of them.
+  HostClock::advance(86400000UL); // let the earlier test's samples expire
+  SimulatedDriver drv("");
+  Pipeline p;
+  p.filter.median = 3;
+  p.filter.smoothing = ReadingFilter::Smoothing::Ema;
+  p.deadbandTempC = 0.1f;
+  p.maxSilenceMs = 15UL * 60UL * 1000UL;
+
+  float lastHour[60];
+  uint32_t reported = 0, lastSeq = 0;
+  for (uint32_t i = 0; i < 1440; ++i)
+  {
+    HostClock::advance(60000);
+    Reading r{};
+    if (sample(drv, p, r))
+    {
+      ++reported;
+      TEST_ASSERT_GREATER_THAN(lastSeq, r.seq);
+      lastSeq = r.seq;
+    }
+    lastHour[i % 60] = r.temperatureC;
+  }
+  TEST_ASSERT_EQUAL_UINT32(0, p.failed);
+  TEST_ASSERT_LESS_THAN(1440, reported);
+  TEST_ASSERT_GREATER_THAN(96, reported); // at least the heartbeats
+
+  double sum = 0;
+  float lo = lastHour[0], hi = lastHour[0];
+  for (float v : lastHour)
+  {
+    sum += v;
+    lo = v < lo ? v : lo;
+    hi = v > hi ? v : hi;
+  }
+  WindowStats::Summary hour;
+  TEST_ASSERT_TRUE(SensorStats::summary(0, 1, hour));
+  // The window slides in 2 min buckets, so it holds 59-60 samples.
+  TEST_ASSERT_UINT32_WITHIN(1, 60, hour.temperature.count);
+  TEST_ASSERT_FLOAT_WITHIN(0.05f, static_cast<float>(sum / 60), hour.temperature.mean);
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, hi, hour.temperature.max);
+  TEST_ASSERT_TRUE(hour.temperature.min >= lo - 0.001f);
+
+  SensorStats::Snapshot snap;
+  SensorStats::snapshot(snap);
+  TEST_ASSERT_EQUAL_UINT32(1, snap.channels);
+  TEST_ASSERT_EQUAL_UINT32(3, snap.windows);
+  TEST_ASSERT_UINT32_WITHIN(50, 1440, snap.summaries[0][2].temperature.count);
+  // Full sine periods: the day's mean is the wave's centre line.
+  TEST_ASSERT_FLOAT_WITHIN(0.1f, 22.0f, snap.summaries[0][2].temperature.mean);
+  TEST_ASSERT_FLOAT_WITHIN(0.2f, 3.0f / sqrtf(2.0f), snap.summaries[0][2].temperature.stddev);
+}
+
+void test_read_then_sampler_cycle()
+{
+  // A DHT-like driver: at most one read per 2 s.
+  constexpr uint32_t kRestMs = 2000;
+  SimulatedDriver drv("21.5,40;21.7,41;fail;22.0,42");
+  SampleCache cache;
+  Pipeline p;
+  Reading r{};
+  bool reported = false;
+  HostClock::advance(60000);
+
+  // A poller reads the sensor just before the sampler's tick.
+  pollerRead(drv, cache);
+  TEST_ASSERT_EQUAL_UINT32(1, drv.reads());
+  HostClock::advance(300);
+
+  // The sampler may not read yet, but the poller's sample is new to it:
+  // the cycle still produces a reading, without touching the sensor.
+  const uint32_t before = r.seq;
+  TEST_ASSERT_TRUE(samplerCycle(drv, cache, kRestMs, p, r, reported) == Cycle::Reused);
+  TEST_ASSERT_TRUE(reported);
+  TEST_ASSERT_EQUAL_UINT32(1, drv.reads());
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 21.5f, r.temperatureC);
+  TEST_ASSERT_NOT_EQUAL(before, r.seq);
+  const uint32_t firstSeq = r.seq;
+
+  // The poller still gets the sample from the cache.
+  SampleCache::Entry e;
+  TEST_ASSERT_TRUE(cache.get(0, kRestMs, millis(), e));
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 21.5f, e.temperatureC);
+
+  // Another cycle inside the rest time has nothing new: skipped, not
+  // reported or numbered twice.
+  HostClock::advance(300);
+  TEST_ASSERT_TRUE(samplerCycle(drv, cache, kRestMs, p, r, reported) == Cycle::Skipped);
+  TEST_ASSERT_FALSE(reported);
+
+  // After the rest time the sampler reads the sensor itself.
+  HostClock::advance(kRestMs);
+  Reading next{};
+  TEST_ASSERT_TRUE(samplerCycle(drv, cache, kRestMs, p, next, reported) == Cycle::Read);
+  TEST_ASSERT_TRUE(reported);
+  TEST_ASSERT_EQUAL_UINT32(2, drv.reads());
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 21.7f, next.temperatureC);
+  TEST_ASSERT_EQUAL_UINT32(firstSeq + 1, next.seq);
+
+  // A failed read by a poller reaches the sampler once, as one failure.
+  HostClock::advance(kRestMs + 1);
+  pollerRead(drv, cache);
+  HostClock::advance(100);
+  const uint32_t failedBefore = p.failed;
+  TEST_ASSERT_TRUE(samplerCycle(drv, cache, kRestMs, p, r, reported) == Cycle::Reused);
+  TEST_ASSERT_FALSE(reported);
+  TEST_ASSERT_EQUAL_UINT32(failedBefore + 1, p.failed);
+  TEST_ASSERT_TRUE(samplerCycle(drv, cache, kRestMs, p, r, reported) == Cycle::Skipped);
+  TEST_ASSERT_EQUAL_UINT32(failedBefore + 1, p.failed);
+}
+
+void test_boot_id_persists()
+{
+  const uint32_t first = Sequence::bootId();
+  TEST_ASSERT_NOT_EQUAL(0, first);
+  Sequence::init(); // a reboot
+  TEST_ASSERT_EQUAL_UINT32(first + 1, Sequence::bootId());
+
+  Reading r{};
+  Sequence::stamp(r);
+  TEST_ASSERT_EQUAL_UINT32(1, r.seq);
+  char key[24];
+  TEST_ASSERT_TRUE(Sequence::formatKey(r, key, sizeof(key)));
+  char expected[24];
+  snprintf(expected, sizeof(expected), "%lu-1", static_cast<unsigned long>(first + 1));
+  TEST_ASSERT_EQUAL_STRING(expected, key);
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_script_steps);
+  RUN_TEST(test_spike_deadband_and_sequence);
+  RUN_TEST(test_wave_through_windows);
+  RUN_TEST(test_read_then_sampler_cycle);
+  RUN_TEST(test_boot_id_persists);
+  return UNITY_END();
+}
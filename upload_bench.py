@@ -0,0 +1,549 @@
+#!/usr/bin/env python3
+"""
+Upload bench — regression benchmark for the upload path of the ESP32 Temperature & Humidity Poster
+
+Runs against mock_ingest_server.py (started in-process unless --upstream is
+given) and reports posts/sec, p50/p99 post latency and how failures were
+handled. Two targets:
+
+  model   A Python model of the Poster's wire behaviour, for exercising the
+          mock and comparing fault profiles without hardware: one keep-alive
+          connection, the same request header block, numbered JSON readings
+          with an Idempotency-Key, a single retry when a reused connection
+          turns out stale, a 5 s response timeout, and the same Delivered /
+          Retry / Rejected classification (Retry-After honoured on 429/503).
+          Retried readings are resent, rejected ones dropped, so the mock's
+          duplicate and loss counts show whether that handling holds. None of
+          the firmware runs here: the numbers are a baseline for the mock and
+          this client, not a measurement of Poster.cpp. Use --target device
+          for that; the firmware's host-buildable paths (payload writers,
+          chunked offline-queue stream) are covered by `pio test -e native`.
+
+  device  Points a real device at the mock through POST /config (server
+          host/port/path, TLS, post interval), runs a steady phase, a fault
+          phase and a recovery phase, and reads the results from the
+          device's /metrics (esp_post_phase_duration_millis{phase="total"},
+          esp_post_fail_*, circuit breaker, offline queue) together with the
+          mock's counters. The original settings are restored afterwards.
+
+Usage examples:
+    python upload_bench.py --target model --posts 2000
+    python upload_bench.py --target model --tls --posts 500 --error-rate 0.1 --reset-rate 0.02
+    python upload_bench.py --target device --base-url http://192.168.10.42 --api-key sk_http_local \\
+        --advertise-host 192.168.10.20 --duration 120 --error-rate 0.3 --retry-after 10
+
+Requires: Python 3.8+; --target device also needs requests (pip install requests)
+"""
+
+from __future__ import annotations
+import argparse
+import json
+import random
+import re
+import socket
+import ssl
+import sys
+import time
+from collections import Counter
+from typing import Any, Dict, List, Optional, Tuple
+
+import mock_ingest_server as mock
+
+RESPONSE_TIMEOUT_S = 5.0
+CONNECT_TIMEOUT_S = 5.0
+# Retry-After beyond this is clamped, as in HttpResponseParser.
+MAX_RETRY_AFTER_S = 3600
+
+
+class Outcome:
+    DELIVERED = "delivered"
+    RETRY = "retry"
+    REJECTED = "rejected"
+
+
+class PostFailed(Exception):
+    def __init__(self, kind: str, received: int = 0):
+        super().__init__(kind)
+        self.kind = kind
+        self.received = received
+
+
+class PosterModel:
+    """Python model of the firmware Poster's wire behaviour (see Poster::exchange)."""
+
+    def __init__(self, host: str, port: int, path: str, tls: bool, ca_file: Optional[str], insecure: bool,
+                 api_key: str, location: str, boot_id: int):
+        self.host, self.port, self.path, self.tls = host, port, path, tls
+        self.location = location
+        self.boot_id = boot_id
+        self.seq = 0
+        self.sock: Optional[socket.socket] = None
+        self.buf = b""
+        self.ctx: Optional[ssl.SSLContext] = None
+        if tls:
+            self.ctx = ssl.create_default_context(cafile=ca_file)
+            if insecure:
+                self.ctx.check_hostname = False
+                self.ctx.verify_mode = ssl.CERT_NONE
+        host_hdr = host if port in (80, 443) else f"{host}:{port}"
+        self.header_block = (f"POST {path} HTTP/1.1\r\nHost: {host_hdr}\r\n"
+                             + (f"Authorization: Bearer {api_key}\r\n" if api_key else "")
+                             + "Content-Type: application/json\r\nConnection: keep-alive\r\n")
+        self.failures: Counter = Counter()
+        self.connections_opened = 0
+        self.connections_reused = 0
+        self.server_closes = 0
+        self.hold_until = 0.0
+
+    def next_reading(self) -> Dict[str, Any]:
+        self.seq += 1
+        return {"temperature_c": round(random.uniform(18, 26), 2), "humidity_pct": round(random.uniform(30, 60), 2),
+                "timestamp": int(time.time()), "boot_id": self.boot_id, "seq": self.seq}
+
+    def close(self) -> None:
+        if self.sock is not None:
+            try:
+                self.sock.close()
+            except OSError:
+                pass
+        self.sock = None
+        self.buf = b""
+
+    def _connect(self) -> Tuple[socket.socket, bool]:
+        if self.sock is not None:
+            self.connections_reused += 1
+            return self.sock, True
+        raw = socket.create_connection((self.host, self.port), timeout=CONNECT_TIMEOUT_S)
+        raw.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        self.sock = self.ctx.wrap_socket(raw, server_hostname=self.host) if self.ctx else raw
+        self.sock.settimeout(RESPONSE_TIMEOUT_S)
+        self.connections_opened += 1
+        return self.sock, False
+
+    def _read_line(self, sock: socket.socket, deadline: float, received: List[int]) -> bytes:
+        while b"\r\n" not in self.buf:
+            if time.monotonic() > deadline:
+                raise PostFailed("timeout", received[0])
+            try:
+                data = sock.recv(4096)
+            except socket.timeout:
+                raise PostFailed("timeout", received[0])
+            if not data:
+                raise PostFailed("bad_response", received[0])
+            received[0] += len(data)
+            self.buf += data
+        line, _, self.buf = self.buf.partition(b"\r\n")
+        return line
+
+    def _read_response(self, sock: socket.socket) -> Tuple[int, bool, int]:
+        deadline = time.monotonic() + RESPONSE_TIMEOUT_S
+        received = [0]
+        status_line = self._read_line(sock, deadline, received)
+        m = re.match(rb"HTTP/1\.[01] (\d{3})", status_line)
+        if not m:
+            raise PostFailed("bad_response", received[0])
+        status = int(m.group(1))
+        keep_alive, length, retry_after = True, 0, 0
+        while True:
+            line = self._read_line(sock, deadline, received)
+            if not line:
+                break
+            name, _, value = line.decode("latin-1").partition(":")
+            name, value = name.strip().lower(), value.strip()
+            if name == "connection":
+                keep_alive = value.lower() != "close"
+            elif name == "content-length":
+                length = int(value)
+            elif name == "retry-after" and value.isdigit():
+                retry_after = min(int(value), MAX_RETRY_AFTER_S)
+        while len(self.buf) < length:
+            data = sock.recv(4096)
+            if not data:
+                raise PostFailed("bad_response", received[0])
+            self.buf += data
+        self.buf = self.buf[length:]
+        return status, keep_alive, retry_after
+
+    def post(self, readings: List[Dict[str, Any]]) -> str:
+        body = json.dumps({"location": self.location, "readings": readings} if len(readings) > 1
+                          else {"location": self.location, **readings[0]}, separators=(",", ":")).encode()
+        headers = self.header_block
+        if all(r.get("seq") for r in readings):
+            headers += f"Idempotency-Key: {self.boot_id}-{readings[0]['seq']}..{self.boot_id}-{readings[-1]['seq']}\r\n"
+        request = (headers + f"Content-Length: {len(body)}\r\n\r\n").encode("latin-1") + body
+
+        for _attempt in range(2):
+            try:
+                sock, reused = self._connect()
+            except (OSError, ssl.SSLError):
+                self.close()
+                self.failures["connect"] += 1
+                return Outcome.RETRY
+            try:
+                sock.sendall(request)
+            except (OSError, ssl.SSLError):
+                self.close()
+                if reused:
+                    continue
+                self.failures["write"] += 1
+                return Outcome.RETRY
+            try:
+                status, keep_alive, retry_after = self._read_response(sock)
+            except (PostFailed, OSError, ssl.SSLError) as e:
+                self.close()
+                kind = e.kind if isinstance(e, PostFailed) else "bad_response"
+                received = e.received if isinstance(e, PostFailed) else 0
+                if reused and received == 0 and kind != "timeout":
+                    self.server_closes += 1
+                    continue
+                self.failures[kind] += 1
+                return Outcome.RETRY
+            if not keep_alive:
+                self.close()
+            break
+        else:
+            self.failures["connect"] += 1
+            return Outcome.RETRY
+
+        if 200 <= status < 300:
+            return Outcome.DELIVERED
+        if retry_after > 0 and status in (429, 503):
+            self.hold_until = time.monotonic() + retry_after
+        if status >= 500:
+            self.failures["http_5xx"] += 1
+            return Outcome.RETRY
+        if status >= 400:
+            self.failures["http_4xx"] += 1
+            return Outcome.REJECTED if status in (400, 413, 422) else Outcome.RETRY
+        self.failures["http_other"] += 1
+        return Outcome.RETRY
+
+
+def percentile(values: List[float], q: float) -> Optional[float]:
+    return mock.percentile(sorted(values), q)
+
+
+def fmt_ms(v: Optional[float]) -> str:
+    return "n/a" if v is None else f"{v:.1f} ms"
+
+
+def run_model(args: argparse.Namespace, host: str, port: int, ca_file: Optional[str]) -> Dict[str, Any]:
+    poster = PosterModel(host, port, args.path, args.tls, ca_file, args.insecure, args.server_api_key,
+                         args.location, boot_id=random.randint(1, 2**31))
+    pending: List[Dict[str, Any]] = []
+    outcomes: Counter = Counter()
+    latencies: List[float] = []
+    delivered_latencies: List[float] = []
+    generated = delivered = rejected = 0
+    hold_waits = 0
+    start = time.monotonic()
+    attempts = 0
+    while attempts < args.posts:
+        # Keep a batch's worth of readings waiting, like a backlog draining.
+        while len(pending) < args.batch:
+            pending.append(poster.next_reading())
+            generated += 1
+        if poster.hold_until > time.monotonic():
+            hold_waits += 1
+            time.sleep(min(poster.hold_until - time.monotonic(), args.max_hold))
+            poster.hold_until = 0.0
+        batch = pending[:args.batch]
+        t0 = time.monotonic()
+        outcome = poster.post(batch)
+        elapsed_ms = (time.monotonic() - t0) * 1000.0
+        attempts += 1
+        outcomes[outcome] += 1
+        latencies.append(elapsed_ms)
+        if outcome == Outcome.DELIVERED:
+            delivered_latencies.append(elapsed_ms)
+            delivered += len(batch)
+            del pending[:len(batch)]
+        elif outcome == Outcome.REJECTED:
+            rejected += len(batch)
+            del pending[:len(batch)]
+        if args.interval_ms > 0:
+            time.sleep(args.interval_ms / 1000.0)
+    # Whatever is still pending was neither delivered nor given up on.
+    elapsed = time.monotonic() - start
+    poster.close()
+    return {
+        "elapsed_s": round(elapsed, 3),
+        "posts": attempts,
+        "posts_per_s": round(attempts / elapsed, 2) if elapsed > 0 else 0.0,
+        "delivered_posts_per_s": round(outcomes[Outcome.DELIVERED] / elapsed, 2) if elapsed > 0 else 0.0,
+        "latency_p50_ms": percentile(latencies, 0.50),
+        "latency_p99_ms": percentile(latencies, 0.99),
+        "delivered_latency_p50_ms": percentile(delivered_latencies, 0.50),
+        "delivered_latency_p99_ms": percentile(delivered_latencies, 0.99),
+        "outcomes": dict(outcomes),
+        "failures": dict(poster.failures),
+        "readings_generated": generated,
+        "readings_delivered": delivered,
+        "readings_rejected": rejected,
+        "readings_pending": len(pending),
+        "connections_opened": poster.connections_opened,
+        "connections_reused": poster.connections_reused,
+        "stale_connection_retries": poster.server_closes,
+        "retry_after_holds": hold_waits,
+    }
+
+
+# ---- device target ----
+
+METRIC_LINE = re.compile(r'^([a-zA-Z_:][a-zA-Z0-9_:]*)(\{[^}]*\})?\s+(\S+)$')
+DEVICE_COUNTERS = [
+    "esp_post_reading_total", "esp_post_reading_failed_total", "esp_post_batch_total", "esp_post_batch_failed_total",
+    "esp_post_fail_connect_total", "esp_post_fail_write_total", "esp_post_fail_timeout_total",
+    "esp_post_fail_bad_response_total", "esp_post_fail_http_4xx_total", "esp_post_fail_http_5xx_total",
+    "esp_post_fail_http_other_total", "esp_upstream_circuit_trips_total", "esp_upstream_circuit_short_circuits_total",
+    "esp_upstream_connections_opened_total", "esp_upstream_connections_reused_total",
+    "esp_upstream_server_closes_total", "esp_offline_queue_enqueued_total", "esp_offline_queue_drained_total",
+    "esp_offline_queue_dropped_total", "esp_posts_chunked_total",
+]
+DEVICE_GAUGES = ["esp_offline_queue_depth", "esp_upstream_circuit_state"]
+# Settings the bench changes; restored from the saved /config afterwards.
+PATCHED_KEYS = ["server_host", "server_port", "server_path", "use_tls", "https_insecure", "post_interval_sec"]
+
+
+def parse_metrics(text: str) -> Dict[str, float]:
+    out: Dict[str, float] = {}
+    for line in text.splitlines():
+        if not line or line.startswith("#"):
+            continue
+        m = METRIC_LINE.match(line.strip())
+        if m:
+            try:
+                out[m.group(1) + (m.group(2) or "")] = float(m.group(3))
+            except ValueError:
+                pass
+    return out
+
+
+def histogram_quantile(before: Dict[str, float], after: Dict[str, float], phase: str, q: float) -> Optional[float]:
+    """Quantile of the observations made between two scrapes, as an upper bucket bound."""
+    prefix = f'esp_post_phase_duration_millis_bucket{{phase="{phase}",le="'
+    buckets: List[Tuple[float, float]] = []
+    for key, value in after.items():
+        if key.startswith(prefix):
+            le = key[len(prefix):-2]
+            bound = float("inf") if le == "+Inf" else float(le)
+            buckets.append((bound, value - before.get(key, 0.0)))
+    buckets.sort()
+    if not buckets or buckets[-1][1] <= 0:
+        return None
+    target = q * buckets[-1][1]
+    for bound, cumulative in buckets:
+        if cumulative >= target:
+            return bound
+    return None
+
+
+def run_device_phase(api: Any, server: mock.MockServer, name: str, duration: float,
+                     faults: Optional[Dict[str, Any]]) -> Dict[str, Any]:
+    server.faults.update(faults or asdict_faults(mock.Faults()))
+    server.stats.reset()
+    before = parse_metrics(api.get_metrics().text)
+    print(f"  {name}: {duration:.0f} s" + (f" with faults {faults}" if faults else ""))
+    time.sleep(duration)
+    after = parse_metrics(api.get_metrics().text)
+    upstream = server.stats.snapshot()
+    counters = {k.replace("esp_", "", 1): int(after.get(k, 0) - before.get(k, 0)) for k in DEVICE_COUNTERS}
+    gauges = {k.replace("esp_", "", 1): after.get(k) for k in DEVICE_GAUGES}
+    return {
+        "phase": name,
+        "posts_per_s": upstream["posts_per_s"],
+        "latency_p50_ms": histogram_quantile(before, after, "total", 0.50),
+        "latency_p99_ms": histogram_quantile(before, after, "total", 0.99),
+        "device": {**counters, **gauges},
+        "upstream": {k: upstream[k] for k in ("requests", "posts_ok", "statuses", "resets", "unique_readings",
+                                              "duplicate_readings", "repeated_idempotency_keys", "chunked_posts")},
+    }
+
+
+def asdict_faults(f: mock.Faults) -> Dict[str, Any]:
+    return {k: getattr(f, k) for k in mock.Faults.__dataclass_fields__}
+
+
+def run_device(args: argparse.Namespace, server: mock.MockServer, faults: Dict[str, Any]) -> List[Dict[str, Any]]:
+    from esp_api_tester import EspApi
+
+    api = EspApi(args.base_url, api_key=args.api_key, timeout=args.timeout)
+    r = api.get_config()
+    r.raise_for_status()
+    saved = {k: v for k, v in r.json().items() if k in PATCHED_KEYS}
+    patch = {"server_host": args.advertise_host, "server_port": args.port, "server_path": args.path,
+             "use_tls": args.tls, "https_insecure": args.tls and args.insecure,
+             "post_interval_sec": args.post_interval}
+    print(f"Pointing the device at {'https' if args.tls else 'http'}://{args.advertise_host}:{args.port}{args.path}")
+    r = api.post_config(patch)
+    r.raise_for_status()
+    results: List[Dict[str, Any]] = []
+    try:
+        # Let the device pick up the new endpoint before measuring.
+        time.sleep(max(5.0, 2 * args.post_interval))
+        results.append(run_device_phase(api, server, "steady", args.duration, None))
+        if faults:
+            results.append(run_device_phase(api, server, "faults", args.duration, faults))
+            results.append(run_device_phase(api, server, "recovery", args.duration, None))
+    finally:
+        r = api.post_config(saved)
+        print("Restored device settings" if r.ok else f"Restoring device settings failed: HTTP {r.status_code}")
+    return results
+
+
+# ---- reporting ----
+
+def print_model_report(result: Dict[str, Any], upstream: Dict[str, Any]) -> None:
+    print("target:           model (Python Poster model against the mock; not a firmware measurement)")
+    print(f"posts:            {result['posts']} in {result['elapsed_s']} s "
+          f"({result['posts_per_s']} posts/s, {result['delivered_posts_per_s']} delivered/s)")
+    print(f"latency:          p50 {fmt_ms(result['latency_p50_ms'])}, p99 {fmt_ms(result['latency_p99_ms'])}")
+    print(f"  delivered only: p50 {fmt_ms(result['delivered_latency_p50_ms'])}, "
+          f"p99 {fmt_ms(result['delivered_latency_p99_ms'])}")
+    print(f"outcomes:         {result['outcomes']}")
+    print(f"failures:         {result['failures'] or 'none'}")
+    print(f"connections:      {result['connections_opened']} opened, {result['connections_reused']} reused, "
+          f"{result['stale_connection_retries']} stale retries")
+    print(f"readings:         {result['readings_generated']} generated, {result['readings_delivered']} delivered, "
+          f"{result['readings_rejected']} rejected, {result['readings_pending']} pending")
+    print(f"upstream:         {upstream['unique_readings']} unique readings, {upstream['duplicate_readings']} duplicates, "
+          f"{upstream['repeated_idempotency_keys']} repeated keys, statuses {upstream['statuses']}, "
+          f"resets {upstream['resets']}")
+    print(f"server handling:  p50 {fmt_ms(upstream['handling_ms_p50'])}, p99 {fmt_ms(upstream['handling_ms_p99'])}")
+
+
+def print_device_report(results: List[Dict[str, Any]]) -> None:
+    for r in results:
+        print(f"[{r['phase']}] {r['posts_per_s']} posts/s, "
+              f"p50 <= {fmt_ms(r['latency_p50_ms'])}, p99 <= {fmt_ms(r['latency_p99_ms'])}")
+        failures = {k: v for k, v in r["device"].items() if k.startswith("post_fail_") and v}
+        print(f"  failures: {failures or 'none'}")
+        print(f"  device:   {json.dumps({k: v for k, v in r['device'].items() if not k.startswith('post_fail_')})}")
+        print(f"  upstream: {json.dumps(r['upstream'])}")
+
+
+def check_expectations(args: argparse.Namespace, delivered_per_s: float, p99: Optional[float],
+                       upstream: Dict[str, Any]) -> int:
+    failures = 0
+    if args.min_posts_per_s is not None and delivered_per_s < args.min_posts_per_s:
+        print(f"FAIL: {delivered_per_s} delivered posts/s is below {args.min_posts_per_s}")
+        failures += 1
+    if args.max_p99_ms is not None and (p99 is None or p99 > args.max_p99_ms):
+        print(f"FAIL: p99 latency {fmt_ms(p99)} is above {args.max_p99_ms} ms")
+        failures += 1
+    if args.max_duplicates is not None and upstream["duplicate_readings"] > args.max_duplicates:
+        print(f"FAIL: {upstream['duplicate_readings']} duplicate readings upstream (allowed {args.max_duplicates})")
+        failures += 1
+    return failures
+
+
+def parse_args(argv: list[str]) -> argparse.Namespace:
+    p = argparse.ArgumentParser(description="Regression benchmark for the ESP32 upload path against a mock ingest server")
+    p.add_argument("--target", choices=["model", "device"], default="model",
+                   help="Drive the Python model of the Poster (mock-only baseline) or a real device "
+                        "[default: %(default)s]")
+    p.add_argument("--upstream", default=None,
+                   help="host:port of an already running mock_ingest_server.py (model target only); default: start one")
+    p.add_argument("--bind", default="0.0.0.0", help="Address the in-process mock listens on [default: %(default)s]")
+    p.add_argument("--port", type=int, default=8080, help="Port the in-process mock listens on [default: %(default)s]")
+    p.add_argument("--path", default="/ingest", help="Request path [default: %(default)s]")
+    p.add_argument("--tls", action="store_true", help="Serve and post over HTTPS with the mock's test CA")
+    p.add_argument("--insecure", action="store_true", help="Skip certificate checks (https_insecure on the device)")
+    p.add_argument("--cert-dir", default="mock_certs", help="Test CA directory [default: %(default)s]")
+    p.add_argument("--quiet", action="store_true", help="Silence the mock's connection log")
+    p.add_argument("--json", action="store_true", help="Print the results as JSON instead of text")
+
+    h = p.add_argument_group("model target")
+    h.add_argument("--posts", type=int, default=1000, help="Posts to send [default: %(default)s]")
+    h.add_argument("--batch", type=int, default=1, help="Readings per post (batch_max_readings) [default: %(default)s]")
+    h.add_argument("--interval-ms", type=float, default=0.0, help="Pause between posts [default: %(default)s]")
+    h.add_argument("--max-hold", type=float, default=2.0,
+                   help="Cap on a Retry-After wait so runs stay short, seconds [default: %(default)s]")
+    h.add_argument("--location", default="bench", help="Location sent in payloads [default: %(default)s]")
+    h.add_argument("--server-api-key", default="", help="Bearer token sent upstream (api_key)")
+
+    d = p.add_argument_group("device target")
+    d.add_argument("--base-url", default="http://esp.local", help="Device base URL [default: %(default)s]")
+    d.add_argument("--api-key", default=None, help="Device HTTP API key (Bearer token)")
+    d.add_argument("--timeout", type=float, default=5.0, help="Device API timeout in seconds [default: %(default)s]")
+    d.add_argument("--advertise-host", default=None,
+                   help="Address of this machine as the device should reach it (also the certificate SAN)")
+    d.add_argument("--duration", type=float, default=60.0, help="Seconds per phase [default: %(default)s]")
+    d.add_argument("--post-interval", type=int, default=2, help="post_interval_sec during the run [default: %(default)s]")
+
+    g = p.add_argument_group("expectations (non-zero exit when not met)")
+    g.add_argument("--min-posts-per-s", type=float, default=None, help="Minimum delivered posts/s")
+    g.add_argument("--max-p99-ms", type=float, default=None, help="Maximum p99 post latency")
+    g.add_argument("--max-duplicates", type=int, default=None, help="Maximum duplicate readings seen upstream")
+
+    mock.add_fault_args(p)
+    return p.parse_args(argv)
+
+
+def main(argv: list[str]) -> int:
+    args = parse_args(argv)
+    faults = mock.faults_from_args(args)
+    fault_patch = {k: v for k, v in asdict_faults(faults).items() if v != getattr(mock.Faults(), k)}
+
+    if args.target == "device":
+        if not args.advertise_host:
+            print("--target device needs --advertise-host (this machine's address as seen by the device)", file=sys.stderr)
+            return 2
+        try:
+            server, _ca = mock.start_server(args.bind, args.port, mock.Faults(), tls=args.tls,
+                                            cert_dir=args.cert_dir, cert_host=args.advertise_host, quiet=args.quiet)
+        except (OSError, mock.subprocess.CalledProcessError) as e:
+            print(f"Cannot start the mock: {e}", file=sys.stderr)
+            return 2
+        results = run_device(args, server, fault_patch)
+        server.shutdown()
+        if args.json:
+            print(json.dumps(results, indent=2))
+        else:
+            print_device_report(results)
+        steady = results[0]
+        total_dupes = {"duplicate_readings": sum(r["upstream"]["duplicate_readings"] for r in results)}
+        return 1 if check_expectations(args, steady["posts_per_s"], steady["latency_p99_ms"], total_dupes) else 0
+
+    server: Optional[mock.MockServer] = None
+    if args.upstream:
+        host, _, port_s = args.upstream.rpartition(":")
+        port, ca_file = int(port_s), f"{args.cert_dir}/ca.pem"
+    else:
+        try:
+            server, ca_file = mock.start_server(args.bind, args.port, faults, tls=args.tls, cert_dir=args.cert_dir,
+                                                cert_host="localhost", quiet=args.quiet)
+        except (OSError, mock.subprocess.CalledProcessError) as e:
+            print(f"Cannot start the mock: {e}", file=sys.stderr)
+            return 2
+        host, port = "localhost", server.server_address[1]
+
+    result = run_model(args, host, port, ca_file if args.tls else None)
+    if server is not None:
+        upstream = server.stats.snapshot()
+        server.shutdown()
+    else:
+        upstream = fetch_remote_stats(host, port, args.tls, ca_file, args.insecure)
+    if args.json:
+        print(json.dumps({"client": result, "upstream": upstream}, indent=2))
+    else:
+        print_model_report(result, upstream)
+    return 1 if check_expectations(args, result["delivered_posts_per_s"], result["latency_p99_ms"], upstream) else 0
+
+
+def fetch_remote_stats(host: str, port: int, tls: bool, ca_file: Optional[str], insecure: bool) -> Dict[str, Any]:
+    import http.client
+    if tls:
+        ctx = ssl.create_default_context(cafile=ca_file)
+        if insecure:
+            ctx.check_hostname = False
+            ctx.verify_mode = ssl.CERT_NONE
+        conn: http.client.HTTPConnection = http.client.HTTPSConnection(host, port, context=ctx, timeout=5)
+    else:
+        conn = http.client.HTTPConnection(host, port, timeout=5)
+    conn.request("GET", "/__stats")
+    return json.loads(conn.getresponse().read())
+
+
+if __name__ == "__main__":
+    raise SystemExit(main(sys.argv[1:]))